@@ -1,14 +1,23 @@
 #ifndef ASSMPQ_H_
 #define ASSMPQ_H_
 
-#include <vector>
+#include <cstddef>
+#include <span>
 #include <string>
 
+#include "assets_mpq_importer/byte_buffer.hpp"
+
 namespace assmpq {
 
-using FileData = std::vector<char>;
+using FileData = ByteBuffer;
 using ErrorMessage = std::string;
 
+/// @brief Bytes of a file viewed as characters, for the std::istream based readers
+[[nodiscard]] inline auto as_chars(std::span<const std::byte> bytes) noexcept-> std::span<const char>
+{
+    return { reinterpret_cast<const char*>(bytes.data()), bytes.size() }; // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
 }
 
 #endif // ASSMPQ_H_
@@ -1,7 +1,10 @@
 #ifndef ASSMPQ_BLP_H_
 #define ASSMPQ_BLP_H_
 
+#include <cstdint>
 #include <expected>
+#include <memory_resource>
+#include <span>
 
 #include "assets_mpq_importer/blp_library_export.hpp"
 #include "assmpq.hpp"
@@ -21,15 +24,90 @@ enum class Compression: int { // NOLINT
     DDS_BC7
 };
 
+/// Decoded texture image with tightly packed RGBA8 pixels
+struct RgbaImage {
+    uint32_t width = 0;            ///< Image width in pixels
+    uint32_t height = 0;           ///< Image height in pixels
+    std::vector<uint32_t> pixels;  ///< Row-major pixels, R in the lowest byte, A in the highest
+};
+
+/**
+ * Decodes a single mipmap level of a BLP texture file to RGBA8 pixels
+ * @param blp_file The BLP file data to decode
+ * @param mipmap_idx The mipmap level index to decode (default: 0 for highest resolution)
+ * @return Decoded image on success, or error message on failure
+ */
+[[nodiscard]] BLP_LIBRARY_EXPORT auto decode_blp_to_rgba_image(
+    const FileData& blp_file,
+    size_t mipmap_idx = 0
+)-> std::expected<RgbaImage, ErrorMessage>;
+
+/**
+ * @copydoc decode_blp_to_rgba_image(const FileData&, size_t)
+ * @details Reads the texture in place, for example straight from a memory-mapped file, without a FileData copy.
+ */
+[[nodiscard]] BLP_LIBRARY_EXPORT auto decode_blp_to_rgba_image(
+    std::span<const std::byte> blp_file,
+    size_t mipmap_idx = 0
+)-> std::expected<RgbaImage, ErrorMessage>;
+
+/**
+ * Converts a decoded RGBA8 image to PNG image format
+ * @param image The image to convert
+ * @return PNG image data on success, or error message on failure
+ */
+[[nodiscard]] BLP_LIBRARY_EXPORT auto convert_rgba_to_png_image(const RgbaImage& image)
+    -> std::expected<FileData, ErrorMessage>;
+
+/**
+ * Converts a decoded RGBA8 image to DDS texture format with specified compression
+ * This function uses Nvidia Texture Tools library backend.
+ * @param image The image to convert, used as the first mipmap level
+ * @param compression The DDS compression format to use (default: DDS_BC3)
+ * @param mipmap_levels Number of mipmap levels to write, 0 for the full chain down to 1x1
+ * @return DDS texture data on success, or error message on failure
+ */
+[[nodiscard]] BLP_LIBRARY_EXPORT auto convert_rgba_to_dds_texture_nvtt(
+    const RgbaImage& image,
+    const Compression& compression = Compression::DDS_BC3,
+    size_t mipmap_levels = 0
+)-> std::expected<FileData, ErrorMessage>;
+
+/**
+ * Converts a decoded RGBA8 image to DDS texture format with specified compression
+ * This function uses AMD Compressionator library backend.
+ * @param image The image to convert, used as the first mipmap level
+ * @param compression The DDS compression format to use (default: DDS_BC3)
+ * @param mipmap_levels Number of mipmap levels to write, 0 for the full chain down to 1x1
+ * @return DDS texture data on success, or error message on failure
+ */
+[[nodiscard]] BLP_LIBRARY_EXPORT auto convert_rgba_to_dds_texture_amdc(
+    const RgbaImage& image,
+    const Compression& compression = Compression::DDS_BC3,
+    size_t mipmap_levels = 0
+)-> std::expected<FileData, ErrorMessage>;
+
 /**
  * Converts a BLP texture file to PNG image format
  * @param blp_file The BLP file data to convert
  * @param mipmap_idx The mipmap level index to extract (default: 0 for highest resolution)
+ * @param memory Resource for the temporary pixel buffers, the returned data is not allocated from it
  * @return PNG image data on success, or error message on failure
  */
 [[nodiscard]] BLP_LIBRARY_EXPORT auto convert_blp_to_png_image(
     const FileData& blp_file,
-    size_t mipmap_idx = 0
+    size_t mipmap_idx = 0,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource()
+)-> std::expected<FileData, ErrorMessage>;
+
+/**
+ * @copydoc convert_blp_to_png_image(const FileData&, size_t, std::pmr::memory_resource*)
+ * @details Reads the texture in place, for example straight from a memory-mapped file, without a FileData copy.
+ */
+[[nodiscard]] BLP_LIBRARY_EXPORT auto convert_blp_to_png_image(
+    std::span<const std::byte> blp_file,
+    size_t mipmap_idx = 0,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource()
 )-> std::expected<FileData, ErrorMessage>;
 
 /**
@@ -38,12 +116,25 @@ enum class Compression: int { // NOLINT
  * @param blp_file The BLP file data to convert
  * @param compression The DDS compression format to use (default: DDS_BC3)
  * @param regen_mipmaps Whether to generate mipmaps from scratch (default: false)
+ * @param memory Resource for the temporary pixel buffers, the returned data is not allocated from it
  * @return DDS texture data on success, or error message on failure
  */
 [[nodiscard]] BLP_LIBRARY_EXPORT auto convert_blp_to_dds_texture_nvtt(
     const FileData& blp_file,
     const Compression& compression = Compression::DDS_BC3,
-    bool regen_mipmaps = false
+    bool regen_mipmaps = false,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource()
+)-> std::expected<FileData, ErrorMessage>;
+
+/**
+ * @copydoc convert_blp_to_dds_texture_nvtt(const FileData&, const Compression&, bool, std::pmr::memory_resource*)
+ * @details Reads the texture in place, for example straight from a memory-mapped file, without a FileData copy.
+ */
+[[nodiscard]] BLP_LIBRARY_EXPORT auto convert_blp_to_dds_texture_nvtt(
+    std::span<const std::byte> blp_file,
+    const Compression& compression = Compression::DDS_BC3,
+    bool regen_mipmaps = false,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource()
 )-> std::expected<FileData, ErrorMessage>;
 
 /**
@@ -52,12 +143,25 @@ enum class Compression: int { // NOLINT
  * @param blp_file The BLP file data to convert
  * @param compression The DDS compression format to use (default: DDS_BC3)
  * @param regen_mipmaps Whether to generate mipmaps from scratch (default: false)
+ * @param memory Resource for the temporary pixel buffers, the returned data is not allocated from it
  * @return DDS texture data on success, or error message on failure
  */
 [[nodiscard]] BLP_LIBRARY_EXPORT auto convert_blp_to_dds_texture_amdc(
     const FileData& blp_file,
     const Compression& compression = Compression::DDS_BC3,
-    bool regen_mipmaps = false
+    bool regen_mipmaps = false,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource()
+)-> std::expected<FileData, ErrorMessage>;
+
+/**
+ * @copydoc convert_blp_to_dds_texture_amdc(const FileData&, const Compression&, bool, std::pmr::memory_resource*)
+ * @details Reads the texture in place, for example straight from a memory-mapped file, without a FileData copy.
+ */
+[[nodiscard]] BLP_LIBRARY_EXPORT auto convert_blp_to_dds_texture_amdc(
+    std::span<const std::byte> blp_file,
+    const Compression& compression = Compression::DDS_BC3,
+    bool regen_mipmaps = false,
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource()
 )-> std::expected<FileData, ErrorMessage>;
 
 } // namespace assmpq::blp
@@ -0,0 +1,230 @@
+#ifndef ASSMPQ_BYTE_BUFFER_H_
+#define ASSMPQ_BYTE_BUFFER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace assmpq {
+
+/**
+ * @brief Move-only byte buffer passed through the public API
+ * @details Follows the std::vector<char> interface. Bytes added by resize_uninitialized are left
+ * as they are, so a payload decoded into the buffer is written exactly once. A buffer may adopt
+ * memory of another owner, an export blob or a vector, which is released together with the buffer.
+ * Adopted memory is copied into storage of the buffer only once the buffer has to grow.
+ */
+class ByteBuffer {
+public:
+    using value_type = char;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = char&;
+    using const_reference = const char&;
+    using pointer = char*;
+    using const_pointer = const char*;
+    using iterator = char*;
+    using const_iterator = const char*;
+
+    ByteBuffer() noexcept = default;
+
+    /// @brief Buffer of size bytes set to value
+    explicit ByteBuffer(size_type size, char value = 0) { resize(size, value); }
+
+    /// @brief Copy of the bytes [first, last)
+    template <std::input_iterator Iterator, std::sentinel_for<Iterator> Sentinel>
+    ByteBuffer(Iterator first, Sentinel last) { insert(end(), first, last); }
+
+    ByteBuffer(std::initializer_list<char> bytes) : ByteBuffer(bytes.begin(), bytes.end()) {}
+
+    /// @brief Copy of a byte span
+    explicit ByteBuffer(std::span<const char> bytes) : ByteBuffer(bytes.begin(), bytes.end()) {}
+
+    /// @brief Adopt the storage of a vector, nothing is copied
+    ByteBuffer(std::vector<char>&& bytes) // NOLINT(google-explicit-constructor)
+    {
+        if (!bytes.empty()) {
+            // Taken before the move, the argument order of adopt is unspecified
+            const std::span<char> storage(bytes);
+            *this = adopt(storage, std::move(bytes));
+        }
+    }
+
+    /**
+     * @brief Adopt memory of another owner
+     * @param bytes Memory to expose, must stay valid as long as the owner lives
+     * @param owner Object releasing the memory when it is destroyed, such as a std::unique_ptr
+     * @return Buffer over the adopted memory
+     */
+    template <typename Owner>
+    [[nodiscard]] static auto adopt(std::span<char> bytes, Owner owner)-> ByteBuffer
+    {
+        ByteBuffer buffer;
+        buffer.owner_ = OwnerPtr(new Owner(std::move(owner)), [](void* ptr) { delete static_cast<Owner*>(ptr); }); // NOLINT(cppcoreguidelines-owning-memory)
+        buffer.data_ = bytes.data();
+        buffer.size_ = bytes.size();
+        buffer.capacity_ = bytes.size();
+        return buffer;
+    }
+
+    ByteBuffer(const ByteBuffer&) = delete;
+    auto operator=(const ByteBuffer&)-> ByteBuffer& = delete;
+
+    ByteBuffer(ByteBuffer&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)),
+          owner_(std::move(other.owner_)) {}
+
+    auto operator=(ByteBuffer&& other) noexcept-> ByteBuffer&
+    {
+        ByteBuffer moved(std::move(other));
+        swap(moved);
+        return *this;
+    }
+
+    ~ByteBuffer() = default;
+
+    /// @brief Explicit copy, buffers are never copied implicitly
+    [[nodiscard]] auto clone() const-> ByteBuffer { return ByteBuffer(begin(), end()); }
+
+    [[nodiscard]] auto data() noexcept-> char* { return data_; }
+    [[nodiscard]] auto data() const noexcept-> const char* { return data_; }
+    [[nodiscard]] auto size() const noexcept-> size_type { return size_; }
+    [[nodiscard]] auto capacity() const noexcept-> size_type { return capacity_; }
+    [[nodiscard]] auto empty() const noexcept-> bool { return size_ == 0; }
+
+    [[nodiscard]] auto begin() noexcept-> iterator { return data_; }
+    [[nodiscard]] auto begin() const noexcept-> const_iterator { return data_; }
+    [[nodiscard]] auto cbegin() const noexcept-> const_iterator { return data_; }
+    [[nodiscard]] auto end() noexcept-> iterator { return data_ + size_; } // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    [[nodiscard]] auto end() const noexcept-> const_iterator { return data_ + size_; } // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    [[nodiscard]] auto cend() const noexcept-> const_iterator { return end(); }
+
+    [[nodiscard]] auto operator[](size_type idx) noexcept-> char& { return data_[idx]; } // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    [[nodiscard]] auto operator[](size_type idx) const noexcept-> const char& { return data_[idx]; } // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    [[nodiscard]] auto front() noexcept-> char& { return *data_; }
+    [[nodiscard]] auto front() const noexcept-> const char& { return *data_; }
+    [[nodiscard]] auto back() noexcept-> char& { return data_[size_ - 1]; } // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    [[nodiscard]] auto back() const noexcept-> const char& { return data_[size_ - 1]; } // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    void reserve(size_type capacity)
+    {
+        if (capacity > capacity_) {
+            (void)reallocate(capacity);
+        }
+    }
+
+    /// @brief Resize without touching the added bytes, the caller writes them
+    void resize_uninitialized(size_type size)
+    {
+        reserve(size);
+        size_ = size;
+    }
+
+    void resize(size_type size, char value = 0)
+    {
+        const size_type old_size = size_;
+        resize_uninitialized(size);
+        if (size > old_size) {
+            std::memset(data_ + old_size, value, size - old_size); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        }
+    }
+
+    void clear() noexcept { size_ = 0; }
+
+    void push_back(char byte)
+    {
+        if (size_ == capacity_) {
+            (void)reallocate(grown_capacity(size_ + 1));
+        }
+        data_[size_++] = byte; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+
+    /// @brief Insert a copy of the bytes [first, last) before position
+    template <std::input_iterator Iterator, std::sentinel_for<Iterator> Sentinel>
+    auto insert(const_iterator position, Iterator first, Sentinel last)-> iterator
+    {
+        const auto offset = static_cast<size_type>(position - data_);
+        const size_type old_size = size_;
+        if constexpr (std::forward_iterator<Iterator>) {
+            // The previous storage outlives the copy, the bytes may come from this buffer
+            const auto count = static_cast<size_type>(std::ranges::distance(first, last));
+            const OwnerPtr previous = size_ + count > capacity_ ? reallocate(grown_capacity(size_ + count)) : OwnerPtr(nullptr, nullptr);
+            std::ranges::copy(first, last, data_ + size_); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            size_ += count;
+        } else {
+            std::ranges::copy(first, last, std::back_inserter(*this));
+        }
+        // Appended at the end first, then moved in front of the tail
+        std::rotate(data_ + offset, data_ + old_size, data_ + size_); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        return data_ + offset; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+
+    auto erase(const_iterator first, const_iterator last)-> iterator
+    {
+        const auto offset = static_cast<size_type>(first - data_);
+        const auto count = static_cast<size_type>(last - first);
+        std::memmove(data_ + offset, data_ + offset + count, size_ - offset - count); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        size_ -= count;
+        return data_ + offset; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+
+    template <std::input_iterator Iterator, std::sentinel_for<Iterator> Sentinel>
+    void assign(Iterator first, Sentinel last)
+    {
+        clear();
+        insert(end(), first, last);
+    }
+
+    void swap(ByteBuffer& other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(owner_, other.owner_);
+    }
+
+    [[nodiscard]] friend auto operator==(const ByteBuffer& lhs, const ByteBuffer& rhs) noexcept-> bool
+    {
+        return std::ranges::equal(lhs, rhs);
+    }
+
+private:
+    using OwnerPtr = std::unique_ptr<void, void (*)(void*)>;
+
+    [[nodiscard]] auto grown_capacity(size_type min_capacity) const noexcept-> size_type
+    {
+        return std::max(min_capacity, capacity_ * 2);
+    }
+
+    // Move the bytes into own storage of the given capacity, the new bytes are left uninitialized.
+    // Returns the previous storage, released by the caller
+    [[nodiscard]] auto reallocate(size_type capacity)-> OwnerPtr
+    {
+        OwnerPtr storage(new char[capacity], [](void* ptr) { delete[] static_cast<char*>(ptr); }); // NOLINT(cppcoreguidelines-owning-memory)
+        auto* storage_data = static_cast<char*>(storage.get());
+        if (size_ > 0) {
+            std::memcpy(storage_data, data_, size_);
+        }
+        std::swap(owner_, storage);
+        data_ = storage_data;
+        capacity_ = capacity;
+        return storage;
+    }
+
+    char* data_ = nullptr;
+    size_type size_ = 0;
+    size_type capacity_ = 0;
+    OwnerPtr owner_ { nullptr, nullptr };
+};
+
+} // namespace assmpq
+
+#endif // ASSMPQ_BYTE_BUFFER_H_
@@ -0,0 +1,80 @@
+#ifndef ASSMPQ_GLOB_H_
+#define ASSMPQ_GLOB_H_
+
+#include <bitset>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "assets_mpq_importer/mpq_library_export.hpp"
+#include "assmpq.hpp"
+
+namespace assmpq::mpq {
+
+/**
+ * @brief Compiled case-insensitive glob filter
+ * @details Patterns are separated by ';', a pattern starting with '!' excludes matching names.
+ *          A name passes if it matches any include pattern (or there are none) and no exclude pattern.
+ *          '/' and '\' are equivalent. Supported syntax:
+ *          - '?' any character, '*' any sequence, "[abc]", "[a-z]", "[!abc]" character classes;
+ *          - "**" any sequence including separators, "**\/" zero or more directories.
+ *          A pattern containing "**" is path aware, its '*', '?' and classes never match a separator.
+ *          Other characters are literals.
+ */
+class GlobFilter {
+public:
+    static constexpr size_t kMaxPatternTokens = 255;
+
+    /**
+     * @brief Compile the pattern list
+     * @param patterns Patterns separated by ';', an empty list matches every non-empty name
+     * @return Expected containing the filter or an error message for a malformed pattern
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT static auto compile(std::string_view patterns)-> std::expected<GlobFilter, ErrorMessage>;
+
+    /**
+     * @brief Check the name against the compiled patterns
+     * @param filename File name or path
+     * @return true if the name passes the filter, false otherwise
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT auto matches(std::string_view filename) const-> bool;
+
+private:
+    enum class TokenKind : uint8_t {
+        Char,           ///< Single lowercase character
+        AnyChar,        ///< '?'
+        Class,          ///< "[...]"
+        Star,           ///< '*'
+        Globstar,       ///< "**"
+        GlobstarDir,    ///< "**/"
+    };
+
+    struct Token {
+        TokenKind kind = TokenKind::Char;
+        char value = 0;                 ///< Character of a Char token
+        uint8_t class_idx = 0;          ///< Class of a Class token
+    };
+
+    struct Pattern {
+        std::vector<Token> tokens;
+        std::vector<std::bitset<256>> classes;
+        std::vector<size_t> star_positions;
+        std::string literal_prefix;     ///< Leading literal characters, checked before matching
+        std::string literal_suffix;     ///< Trailing literal characters, checked before matching
+        bool is_path_aware = false;
+    };
+
+    static auto compile_pattern(std::string_view pattern)-> std::expected<Pattern, ErrorMessage>;
+    static auto match_pattern(const Pattern& pattern, std::string_view filename)-> bool;
+    static auto match_segments(const Pattern& pattern, std::string_view filename)-> bool;
+    static auto match_tokens(const Pattern& pattern, size_t token_begin, size_t token_end, std::string_view filename, size_t name_pos)-> bool;
+
+    std::vector<Pattern> includes_;
+    std::vector<Pattern> excludes_;
+};
+
+} // namespace assmpq::mpq
+
+#endif  /// ASSMPQ_GLOB_H_
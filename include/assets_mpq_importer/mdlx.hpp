@@ -2,6 +2,7 @@
 #define ASSMPQ_MDLX_H_
 
 #include <expected>
+#include <span>
 
 #include "assets_mpq_importer/mdlx_library_export.hpp"
 #include "assmpq.hpp"
@@ -17,8 +18,19 @@ namespace assmpq::mdlx {
  * @param mdx_file The MDLX file data to convert
  * @return std::expected<FileData, ErrorMessage> The resulting OBJ mesh data or an error message
  */
-[[nodiscard]] MDLX_LIBRARY_EXPORT auto convert_mdlx_to_obj_mesh(const std::string& mesh_name, const FileData& mdx_file)
-    -> std::expected<FileData, ErrorMessage>;
+[[nodiscard]] MDLX_LIBRARY_EXPORT auto convert_mdlx_to_obj_mesh(
+    const std::string& mesh_name,
+    const FileData& mdx_file
+)-> std::expected<FileData, ErrorMessage>;
+
+/**
+ * @copydoc convert_mdlx_to_obj_mesh(const std::string&, const FileData&)
+ * @details Reads the model in place, for example straight from a memory-mapped file, without a FileData copy.
+ */
+[[nodiscard]] MDLX_LIBRARY_EXPORT auto convert_mdlx_to_obj_mesh(
+    const std::string& mesh_name,
+    std::span<const std::byte> mdx_file
+)-> std::expected<FileData, ErrorMessage>;
 
 } // namespace assmpq::mdlx
 
@@ -1,6 +1,13 @@
 #ifndef ASSMPQ_MPQ_H_
 #define ASSMPQ_MPQ_H_
 
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <filesystem>
 #include <expected>
@@ -21,17 +28,169 @@ struct FileEntry {
 
 using ArchiveEntries = std::vector<FileEntry>;
 
+using file_entry_callback_t = std::function<void(const FileEntry&)>;
+
+/// @brief Kind of difference of a file between two archive versions
+enum class FileChange : uint8_t {
+    Added,
+    Removed,
+    Changed,
+};
+
+/// @brief Represents a file which differs between two MPQ archives
+struct FileDiffEntry {
+    std::string filename;
+    FileChange change = FileChange::Changed;
+
+    bool operator==(const FileDiffEntry& other) const = default;
+};
+
+using ArchiveDiff = std::vector<FileDiffEntry>;
+
+/// @brief File of an MPQ archive which failed verification
+struct VerifyFailure {
+    std::string filename;
+    ErrorMessage reason;
+
+    bool operator==(const VerifyFailure& other) const = default;
+};
+
+/// @brief Outcome of an MPQ archive verification
+struct VerifyReport {
+    size_t verified_count = 0;      ///< Files decoded with every present checksum matching
+    size_t unchecked_count = 0;     ///< Files decoded without any checksum to compare
+    size_t skipped_count = 0;       ///< Encrypted files of unknown name, they cannot be decrypted
+    size_t checksum_count = 0;      ///< Matched CRC32, MD5 and sector checksums
+    uint64_t byte_count = 0;        ///< Decoded bytes
+    double seconds = 0.0;           ///< Wall time of the verification
+    std::vector<VerifyFailure> failures;
+
+    [[nodiscard]] auto is_valid() const-> bool { return failures.empty(); }
+};
+
+/// @brief Compression of a file written into an MPQ archive
+enum class FileCompression : uint8_t {
+    None,       ///< Stored as it is, for data which is compressed already
+    Deflate,    ///< zlib, read by every MPQ reader
+    Bzip2,      ///< Smaller and slower, needs a Warcraft III era reader
+};
+
+/// @brief File to write into an MPQ archive
+struct ArchiveFile {
+    std::string filename;           ///< Name in the archive, '/' is stored as '\\'
+    FileData data;
+};
+
+/// @brief Compression of the files matching a GlobFilter mask
+struct CompressionRule {
+    std::string mask;
+    FileCompression compression = FileCompression::Deflate;
+};
+
+/// @brief Settings of write_mpq_archive
+struct ArchiveWriteOptions {
+    std::vector<CompressionRule> compression_rules;             ///< The first matching rule picks the compression
+    FileCompression compression = FileCompression::Deflate;     ///< Compression of files no rule matches
+    uint16_t sector_size_shift = 3;     ///< Sectors are 512 << shift bytes, 4 KB by default
+    bool has_listfile = true;           ///< Add a "(listfile)" naming every file
+    bool has_attributes = true;         ///< Add "(attributes)" with the CRC32 and MD5 of every file
+    unsigned thread_count = 0;          ///< Compression threads of the shared pool, 0 for one per core
+    size_t batch_size = size_t { 64 } << 20U;   ///< Bytes of added files ArchiveWriter compresses together, 64 MB by default
+};
+
 /**
  *  @brief Lists files in an MPQ archive
  *  @param archive_path Path to the MPQ archive file
- *  @param mask Optional filter mask for file names (default: "")
+ *  @param mask Optional GlobFilter patterns for file names (default: "")
+ *  @param dictionary_path Optional name dictionary for archives without a listfile (default: none)
  *  @return Expected containing a vector of FileEntry objects or an error message
  *  @details Retrieves a list of files contained in the specified Blizzard MPQ archive.
  *           If a mask is provided, only files matching the mask will be returned.
  */
-[[nodiscard]] MPQ_LIBRARY_EXPORT auto list_mpq_files(const std::filesystem::path& archive_path, const std::string& mask = "")
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto list_mpq_files(
+    const std::filesystem::path& archive_path,
+    const std::string& mask = "",
+    const std::filesystem::path& dictionary_path = {})
     -> std::expected<ArchiveEntries, ErrorMessage>;
 
+/**
+ *  @brief Streams files of an MPQ archive to a callback
+ *  @param archive_path Path to the MPQ archive file
+ *  @param callback Function called for every matching file as soon as it is resolved
+ *  @param mask Optional GlobFilter patterns for file names (default: "")
+ *  @param sorted Visit files sorted by name instead of the listfile order (default: false)
+ *  @param dictionary_path Optional name dictionary for archives without a listfile (default: none)
+ *  @return Expected containing the number of visited files or an error message
+ *  @details Unlike list_mpq_files, no entry list is built up front, so the caller can start
+ *           processing the first file while the rest of the archive is still being walked.
+ *           Listfile entries missing from the hash table are skipped.
+ *           If the archive has no listfile and a dictionary is given, the block table is walked
+ *           instead: names are recovered from the dictionary by their hashes, blocks with
+ *           unknown names are reported as "File%08u.xxx" with the block index and can be
+ *           extracted by that name, encrypted blocks with unknown names are skipped.
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto for_each_mpq_file(
+    const std::filesystem::path& archive_path,
+    const file_entry_callback_t& callback,
+    const std::string& mask = "",
+    bool sorted = false,
+    const std::filesystem::path& dictionary_path = {})
+    -> std::expected<size_t, ErrorMessage>;
+
+/**
+ *  @brief Saves a sidecar index of an MPQ archive
+ *  @param archive_path Path to the MPQ archive file
+ *  @param sidecar_path Path of the sidecar index to write
+ *  @param dictionary_path Optional name dictionary for archives without a listfile (default: none)
+ *  @return Expected containing the number of indexed files or an error message
+ *  @details The sidecar holds the resolved names, sizes, flags, block offsets and sector offset
+ *           tables in a memory-mappable layout. It is keyed by the archive path, size,
+ *           modification time and header hash, so a changed archive makes it stale.
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto write_mpq_sidecar(
+    const std::filesystem::path& archive_path,
+    const std::filesystem::path& sidecar_path,
+    const std::filesystem::path& dictionary_path = {})
+    -> std::expected<size_t, ErrorMessage>;
+
+/**
+ *  @brief Streams files of an MPQ archive from its sidecar index
+ *  @param archive_path Path to the MPQ archive file
+ *  @param sidecar_path Path to the sidecar index written by write_mpq_sidecar
+ *  @param callback Function called for every matching file, in name order
+ *  @param mask Optional GlobFilter patterns for file names (default: "")
+ *  @return Expected containing the number of visited files or an error message,
+ *          "Sidecar index is stale." if the archive changed since the sidecar was written
+ *  @details The archive itself is not opened, only its header is read to validate the sidecar.
+ *           Nothing is visited if the sidecar is missing, invalid or stale.
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto for_each_mpq_sidecar_file(
+    const std::filesystem::path& archive_path,
+    const std::filesystem::path& sidecar_path,
+    const file_entry_callback_t& callback,
+    const std::string& mask = "")
+    -> std::expected<size_t, ErrorMessage>;
+
+/**
+ *  @brief Builds a name dictionary for archives without a listfile
+ *  @param listfile_paths Plain text listfiles, names separated by ';' or line breaks
+ *  @param dictionary_path Path of the dictionary index to write
+ *  @return Expected containing the number of unique names or an error message
+ *  @details The index stores the names by their MPQ hashes and is memory-mapped when used,
+ *           so it is built once and shared by any number of enumerations.
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto build_name_dictionary(
+    const std::vector<std::filesystem::path>& listfile_paths,
+    const std::filesystem::path& dictionary_path)
+    -> std::expected<size_t, ErrorMessage>;
+
+/**
+ * @brief MD5 digest of a file, as the "(attributes)" file of an archive stores it
+ * @param data File content
+ * @return RFC 1321 MD5 digest
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto md5_digest(std::span<const char> data)-> std::array<uint8_t, 16>;
+
 /**
  * @brief Extracts a file from an MPQ archive
  * @param archive_path Path to the MPQ archive file
@@ -43,6 +202,228 @@ using ArchiveEntries = std::vector<FileEntry>;
 [[nodiscard]] MPQ_LIBRARY_EXPORT auto extract_mpq_file(const std::filesystem::path& archive_path, const std::string& filename)
     -> std::expected<FileData, ErrorMessage>;
 
+/**
+ * @brief Extracts a file from an MPQ archive straight into an output file
+ * @param archive_path Path to the MPQ archive file
+ * @param filename Name of the file to extract from the archive
+ * @param output_path Path of the file to write, replaced if it exists
+ * @return Expected containing the number of written bytes or an error message
+ * @details The file is never held in memory as a whole. Files stored neither compressed nor
+ *          encrypted are copied by the kernel where the platform allows it (copy_file_range or
+ *          sendfile on Linux), the others are decoded from the memory-mapped archive and written
+ *          one run of sectors at a time.
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto extract_mpq_file_to(
+    const std::filesystem::path& archive_path,
+    const std::string& filename,
+    const std::filesystem::path& output_path)
+    -> std::expected<uint64_t, ErrorMessage>;
+
+/**
+ * @brief Reads a byte range of a file in an MPQ archive
+ * @param archive_path Path to the MPQ archive file
+ * @param filename Name of the file in the archive
+ * @param offset First byte of the range
+ * @param length Range length, clamped to the end of the file
+ * @return Expected containing the range data or an error message
+ * @details Only the sectors covering the range are read and decompressed, so probing a header
+ *          costs the same for any file size. Files stored as a single compressed unit are
+ *          decompressed whole.
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto read_mpq_file_range(
+    const std::filesystem::path& archive_path,
+    const std::string& filename,
+    size_t offset,
+    size_t length)
+    -> std::expected<FileData, ErrorMessage>;
+
+/**
+ * @brief Builds the key of the stored copy of a file from the archive metadata
+ * @param archive_path Path to the MPQ archive file
+ * @param filename Name of the file in the archive
+ * @return Expected containing the key or an error message
+ * @details The key joins the identity of the archive on disk (canonical path, size and modification
+ *          time) with the block table entry of the file (offset, sizes and flags). No file data is
+ *          read, so an unchanged file is recognized before it is extracted. Any rewrite of the
+ *          archive changes the keys of all its files.
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto mpq_file_source_key(const std::filesystem::path& archive_path, const std::string& filename)
+    -> std::expected<std::string, ErrorMessage>;
+
+/**
+ * @brief Compares two versions of an MPQ archive without decompressing file payloads
+ * @param old_archive_path Path to the previous MPQ archive version
+ * @param new_archive_path Path to the new MPQ archive version
+ * @param mask Optional GlobFilter patterns for file names (default: "")
+ * @return Expected containing added, removed and changed files sorted by name or an error message
+ * @details Files are compared by their block table entries and the "(attributes)" MD5, CRC32
+ *          or FILETIME records. A file without comparable checksums is reported as changed.
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto diff_mpq_archives(
+    const std::filesystem::path& old_archive_path,
+    const std::filesystem::path& new_archive_path,
+    const std::string& mask = "")
+    -> std::expected<ArchiveDiff, ErrorMessage>;
+
+/**
+ * @brief Verifies every file of an MPQ archive against its checksums
+ * @param archive_path Path to the MPQ archive file
+ * @param fail_fast Stop at the first corrupted file (default: true)
+ * @param dictionary_path Optional name dictionary for archives without a listfile (default: none)
+ * @return Expected containing the verification report or an error message if the archive cannot be read
+ * @details The archive is memory-mapped and every file is decoded in runs of sectors by a pool of
+ *          threads. Stored sectors are compared with the "(sector crc)" Adler-32 table of their file,
+ *          decoded files with the "(attributes)" CRC32 and MD5 records. A file that does not decode is
+ *          reported as corrupted as well. Files are named by the listfile or the dictionary, the
+ *          remaining ones by their block index.
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto verify_mpq_archive(
+    const std::filesystem::path& archive_path,
+    bool fail_fast = true,
+    const std::filesystem::path& dictionary_path = {})
+    -> std::expected<VerifyReport, ErrorMessage>;
+
+/**
+ * @brief Writes a new MPQ archive file by file
+ * @details Added files are kept until batch_size bytes are pending, then their sectors are compressed
+ *          by a pool of threads and written right away, so the memory use does not grow with the archive.
+ *          finish() adds the special files, the hash table and the block table of a format version 0
+ *          archive, which every reader supports. Files are not encrypted. Duplicate names and archives
+ *          larger than 4 GB are rejected. An archive which is not finished is removed.
+ */
+class ArchiveWriter {
+public:
+    /**
+     * @brief Create the archive file
+     * @param archive_path Path of the archive to write, replaced if it exists
+     * @param options Compression and special file settings
+     * @return Expected containing the writer or an error message
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT static auto open(const std::filesystem::path& archive_path, const ArchiveWriteOptions& options = {})
+        -> std::expected<ArchiveWriter, ErrorMessage>;
+
+    MPQ_LIBRARY_EXPORT ArchiveWriter(ArchiveWriter&& other) noexcept;
+    MPQ_LIBRARY_EXPORT ~ArchiveWriter();
+
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    auto operator=(const ArchiveWriter&)-> ArchiveWriter& = delete;
+    auto operator=(ArchiveWriter&&)-> ArchiveWriter& = delete;
+
+    /**
+     * @brief Add a file behind the files added before
+     * @param file File to store, its data is released once the batch holding it is written
+     * @return Expected containing nothing or an error message, the archive is removed on a write error
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT auto add(ArchiveFile file)-> std::expected<void, ErrorMessage>;
+
+    /**
+     * @brief Write the pending files, the special files and the tables
+     * @return Expected containing the number of added files or an error message
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT auto finish()-> std::expected<size_t, ErrorMessage>;
+
+private:
+    struct State;
+
+    ArchiveWriter();
+
+    std::unique_ptr<State> state_;
+};
+
+/**
+ * @brief Writes a new MPQ archive
+ * @param archive_path Path of the archive to write, replaced if it exists
+ * @param files Files to store, in block table order
+ * @param options Compression and special file settings
+ * @return Expected containing the number of stored files or an error message
+ * @details The files are handed to an ArchiveWriter one after another, see there.
+ */
+[[nodiscard]] MPQ_LIBRARY_EXPORT auto write_mpq_archive(
+    const std::filesystem::path& archive_path,
+    const std::vector<ArchiveFile>& files,
+    const ArchiveWriteOptions& options = {})
+    -> std::expected<size_t, ErrorMessage>;
+
+/**
+ * @brief Ordered set of MPQ archives resolved as one, the way the game resolves its patch chain
+ * @details Archives are given from the base to the highest priority patch, a file of a later archive
+ *          overrides the file of the same name in the earlier ones. The merged index maps the MPQ name
+ *          hashes of every file to its winning archive once, so a lookup is a single hash probe whatever
+ *          the chain length. Files of unknown name are matched across archives by their hash table entries.
+ */
+class ArchiveChain {
+public:
+    /**
+     * @brief Index the files of an archive chain
+     * @param archive_paths Archives ordered from the base to the highest priority patch
+     * @param dictionary_path Optional name dictionary for archives without a listfile (default: none)
+     * @return Expected containing the chain or an error message naming the archive which cannot be listed
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT static auto open(
+        const std::vector<std::filesystem::path>& archive_paths,
+        const std::filesystem::path& dictionary_path = {})
+        -> std::expected<ArchiveChain, ErrorMessage>;
+
+    /**
+     * @brief Find the archive a file is resolved from
+     * @param filename Name of the file, case-insensitive, '/' and '\' are equivalent
+     * @return Path of the winning archive or nullptr if no archive of the chain has the file
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT auto find(std::string_view filename) const-> const std::filesystem::path*;
+
+    /**
+     * @brief Builds the key of the winning copy of a file, see mpq_file_source_key
+     * @param filename Name of the file
+     * @return Expected containing the key or an error message
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT auto source_key(const std::string& filename) const-> std::expected<std::string, ErrorMessage>;
+
+    /**
+     * @brief Streams the effective files of the chain, overridden copies are not visited
+     * @param callback Function called for every matching file, in name order
+     * @param mask Optional GlobFilter patterns for file names (default: "")
+     * @return Expected containing the number of visited files or an error message
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT auto for_each_file(const file_entry_callback_t& callback, const std::string& mask = "") const
+        -> std::expected<size_t, ErrorMessage>;
+
+    /**
+     * @brief Extracts the winning copy of a file
+     * @param filename Name of the file
+     * @return Expected containing the file data or an error message
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT auto extract_file(const std::string& filename) const-> std::expected<FileData, ErrorMessage>;
+
+    /**
+     * @brief Extracts the winning copy of a file straight into an output file, see extract_mpq_file_to
+     * @param filename Name of the file
+     * @param output_path Path of the file to write, replaced if it exists
+     * @return Expected containing the number of written bytes or an error message
+     */
+    [[nodiscard]] MPQ_LIBRARY_EXPORT auto extract_file_to(const std::string& filename, const std::filesystem::path& output_path) const
+        -> std::expected<uint64_t, ErrorMessage>;
+
+    [[nodiscard]] auto archive_paths() const-> const std::vector<std::filesystem::path>& { return archive_paths_; }
+
+    /// @brief Number of effective files
+    [[nodiscard]] auto file_count() const-> size_t { return entries_.size(); }
+
+    /// @brief Number of copies overridden by a later archive
+    [[nodiscard]] auto overridden_count() const-> size_t { return overridden_count_; }
+
+private:
+    struct Entry {
+        FileEntry file;
+        uint64_t name_key = 0;          ///< MPQ name hashes A and B
+        size_t archive_idx = 0;         ///< Winning archive
+    };
+
+    std::vector<std::filesystem::path> archive_paths_;
+    std::vector<Entry> entries_;                            ///< Effective files sorted by name
+    std::unordered_map<uint64_t, size_t> entry_lookup_;     ///< Name key to the entry index
+    size_t overridden_count_ = 0;
+};
+
 } // namespace assmpq::mpq
 
 #endif  /// ASSMPQ_MPQ_H_
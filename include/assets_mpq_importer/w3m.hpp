@@ -2,6 +2,7 @@
 #define ASSMPQ_W3M_H_
 
 #include <expected>
+#include <span>
 
 #include "assets_mpq_importer/w3m_library_export.hpp"
 #include "assmpq.hpp"
@@ -15,8 +16,17 @@ namespace assmpq::w3m {
  * @return std::expected<FileData, ErrorMessage> containing the extracted file data
  *         on success, or an error message on failure.
  */
-[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_w3e_file(const FileData& w3m_file)
-    -> std::expected<FileData, ErrorMessage>;
+[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_w3e_file(
+    const FileData& w3m_file
+)-> std::expected<FileData, ErrorMessage>;
+
+/**
+ * @copydoc extract_w3e_file(const FileData&)
+ * @details Reads the map in place, for example straight from a memory-mapped file, without a FileData copy.
+ */
+[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_w3e_file(
+    std::span<const std::byte> w3m_file
+)-> std::expected<FileData, ErrorMessage>;
 
 /**
  * @brief Extracts the SHD (Shadow Map File) file from a W3M/W3X (Warcraft III map) file.
@@ -25,8 +35,17 @@ namespace assmpq::w3m {
  * @return std::expected<FileData, ErrorMessage> containing the extracted file data
  *         on success, or an error message on failure.
  */
-[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_shd_file(const FileData& w3m_file)
-    -> std::expected<FileData, ErrorMessage>;
+[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_shd_file(
+    const FileData& w3m_file
+)-> std::expected<FileData, ErrorMessage>;
+
+/**
+ * @copydoc extract_shd_file(const FileData&)
+ * @details Reads the map in place, for example straight from a memory-mapped file, without a FileData copy.
+ */
+[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_shd_file(
+    std::span<const std::byte> w3m_file
+)-> std::expected<FileData, ErrorMessage>;
 
 /**
  * @brief Extracts the WPM (The Path Map File) file from a W3M/W3X (Warcraft III map) file.
@@ -35,8 +54,17 @@ namespace assmpq::w3m {
  * @return std::expected<FileData, ErrorMessage> containing the extracted file data
  *         on success, or an error message on failure.
  */
-[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_wpm_file(const FileData& w3m_file)
-    -> std::expected<FileData, ErrorMessage>;
+[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_wpm_file(
+    const FileData& w3m_file
+)-> std::expected<FileData, ErrorMessage>;
+
+/**
+ * @copydoc extract_wpm_file(const FileData&)
+ * @details Reads the map in place, for example straight from a memory-mapped file, without a FileData copy.
+ */
+[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_wpm_file(
+    std::span<const std::byte> w3m_file
+)-> std::expected<FileData, ErrorMessage>;
 
 /**
  * @brief Extracts the DOO (The doodad file for trees) file from a W3M/W3X (Warcraft III map) file.
@@ -45,8 +73,17 @@ namespace assmpq::w3m {
  * @return std::expected<FileData, ErrorMessage> containing the extracted file data
  *         on success, or an error message on failure.
  */
-[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_doo_file(const FileData& w3m_file)
-    -> std::expected<FileData, ErrorMessage>;
+[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_doo_file(
+    const FileData& w3m_file
+)-> std::expected<FileData, ErrorMessage>;
+
+/**
+ * @copydoc extract_doo_file(const FileData&)
+ * @details Reads the map in place, for example straight from a memory-mapped file, without a FileData copy.
+ */
+[[nodiscard]] W3M_LIBRARY_EXPORT auto extract_doo_file(
+    std::span<const std::byte> w3m_file
+)-> std::expected<FileData, ErrorMessage>;
 
 } // namespace assmpq::w3m
 
@@ -1,6 +1,9 @@
 #include <expected>
 #include <spanstream>
 #include <algorithm>
+#include <cstring>
+#include <memory_resource>
+#include <span>
 
 #ifdef _MSC_VER
 #define NOMINMAX
@@ -34,6 +37,12 @@ struct MipSetDeleter {
 
 using MipSetPtr = std::unique_ptr<CMP_MipSet, MipSetDeleter>;
 
+static const std::unordered_map<Compression, CMP_FORMAT> format_map = {
+    { Compression::DDS_BC1, CMP_FORMAT_BC1 },
+    { Compression::DDS_BC3, CMP_FORMAT_BC3 },
+    { Compression::DDS_BC7, CMP_FORMAT_BC7 },
+};
+
 static auto get_dxgi_format(const MipSet& mipSet)-> DXGI_FORMAT
 {
     switch (mipSet.m_format) {
@@ -48,7 +57,7 @@ static auto get_dxgi_format(const MipSet& mipSet)-> DXGI_FORMAT
     }
 }
 
-auto persist_dds_dx10(const MipSet& mipSet)-> std::vector<char>
+auto persist_dds_dx10(const MipSet& mipSet)-> FileData
 {
     DDS_FILE_HEADER ddsd2 = {};
     ddsd2.size        = sizeof(DDS_FILE_HEADER);
@@ -67,12 +76,6 @@ auto persist_dds_dx10(const MipSet& mipSet)-> std::vector<char>
         ddsd2.caps  |= DDSCAPS_MIPMAP;
     }
 
-    std::ostringstream output;
-
-    // Write the header
-    output.write( reinterpret_cast<const char*>(&DDS_HEADER), static_cast<std::streamsize>(sizeof(DDS_HEADER)));
-    output.write( reinterpret_cast<const char*>(&ddsd2), static_cast<std::streamsize>(sizeof(ddsd2)));
-
     DDS_FILE_HEADER_DXT10 HeaderDDS10 = {
         .dxgiFormat          = get_dxgi_format(mipSet),
         .resourceDimension   = 3, // D3D10_RESOURCE_DIMENSION_TEXTURE2D
@@ -81,32 +84,46 @@ auto persist_dds_dx10(const MipSet& mipSet)-> std::vector<char>
         .miscFlags2          = 0
     };
 
-    // Write DDS10 header
-    output.write( reinterpret_cast<const char*>(&HeaderDDS10), static_cast<std::streamsize>(sizeof(HeaderDDS10)));
+    // Sized up front, the headers and the mip levels are copied into the buffer once
+    size_t dds_size = sizeof(DDS_HEADER) + sizeof(ddsd2) + sizeof(HeaderDDS10);
+    for (int nMipLevel = 0; nMipLevel < mipSet.m_nMipLevels; nMipLevel++) {
+        dds_size += size_t { g_CMIPS.GetMipLevel(&mipSet, nMipLevel)->m_dwLinearSize };
+    }
+
+    FileData output;
+    output.resize_uninitialized(dds_size);
+    size_t output_pos = 0;
+    const auto write = [&output, &output_pos](const void* data, size_t size) {
+        std::memcpy(output.data() + output_pos, data, size); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        output_pos += size;
+    };
+
+    // Write the headers
+    write(&DDS_HEADER, sizeof(DDS_HEADER));
+    write(&ddsd2, sizeof(ddsd2));
+    write(&HeaderDDS10, sizeof(HeaderDDS10));
 
     // Write the data
     for (int nMipLevel = 0; nMipLevel < mipSet.m_nMipLevels; nMipLevel++) {
         const auto *mip_level_ptr = g_CMIPS.GetMipLevel(&mipSet, nMipLevel);
-        output.write(
-            reinterpret_cast<const char*>(mip_level_ptr->m_pbData), // NOLINT(cppcoreguidelines-pro-type-union-access)
-            static_cast<std::streamsize>(mip_level_ptr->m_dwLinearSize));
+        write(mip_level_ptr->m_pbData, size_t { mip_level_ptr->m_dwLinearSize }); // NOLINT(cppcoreguidelines-pro-type-union-access)
     }
-    const auto& buffer_str = output.str();
-    return { buffer_str.begin(), buffer_str.end() };
+    return output;
 }
 
-// Generate additional mipmaps up to 1x1 size
+// Generate additional mipmaps up to 1x1 size or the mipset level count
 static auto generate_extra_mipmaps(
     MipSet& mipset_in,
-    const wc3lib::blp::Blp::MipMap& last_mipmap,
+    int last_mipmap_width,
+    int last_mipmap_height,
     const size_t last_mipmap_idx
 )-> bool
 {
     size_t mip_idx = last_mipmap_idx;
-    int mip_width = static_cast<int>(last_mipmap.width());
-    int mip_height = static_cast<int>(last_mipmap.height());
+    int mip_width = last_mipmap_width;
+    int mip_height = last_mipmap_height;
 
-    while (mip_width > 1 || mip_height > 1) {
+    while ((mip_width > 1 || mip_height > 1) && mip_idx + 1 < static_cast<size_t>(mipset_in.m_nMipLevels)) {
         mip_width = std::max(1, mip_width / 2);
         mip_height = std::max(1, mip_height / 2);
         mip_idx++;
@@ -151,25 +168,48 @@ static auto generate_extra_mipmaps(
     return true;
 }
 
+// Compress the prepared RGBA mipset and persist it as DX10 DDS
+static auto compress_mipset(MipSet& mipset_in, CMP_FORMAT format)-> std::expected<FileData, ErrorMessage>
+{
+    // Do compression
+    KernelOptions options = {};
+    options.encodeWith    = CMP_Compute_type::CMP_CPU;
+    options.format        = format;                         // Destination format (e.g., BC1, BC3, BC7)
+    options.fquality      = 1.0F;                           // Quality level (0.0 to 1.0)
+    options.threads       = 0;
+
+    if (options.format == CMP_FORMAT_BC1) {
+        options.bc15.useAlphaThreshold  = true; // NOLINT(cppcoreguidelines-pro-type-union-access)
+        options.bc15.alphaThreshold     = 1;    // NOLINT(cppcoreguidelines-pro-type-union-access)
+    }
+
+    const MipSetPtr mipset_out(new CMP_MipSet{});
+
+    auto dont_stop_callback = [] (CMP_FLOAT /*fProgress*/, CMP_DWORD_PTR /*pUser1*/, CMP_DWORD_PTR /*pUser2*/) -> bool {
+        return false;
+    };
+
+    // Perform compression CMP_CalculateBufferSize()
+    if (CMP_ProcessTexture(&mipset_in, mipset_out.get(), options, dont_stop_callback) != CMP_OK) {
+        return std::unexpected("Compressionator: Error processing texture.");
+    }
+
+    return persist_dds_dx10(*mipset_out);
+}
 
 // NOLINTEND(clang-diagnostic-missing-designated-field-initializers, cppcoreguidelines-avoid-non-const-global-variables, cppcoreguidelines-pro-type-reinterpret-cast)
 
 auto convert_blp_to_dds_texture_amdc( // NOLINT
-    const FileData& blp_file,
+    std::span<const std::byte> blp_file,
     const Compression& compression,
-    bool regen_mipmaps
+    bool regen_mipmaps,
+    std::pmr::memory_resource* memory
 )-> std::expected<FileData, ErrorMessage>
 {
     wc3lib::blp::Blp texture;
 
-    static const std::unordered_map<Compression, CMP_FORMAT> format_map = {
-        { Compression::DDS_BC1, CMP_FORMAT_BC1 },
-        { Compression::DDS_BC3, CMP_FORMAT_BC3 },
-        { Compression::DDS_BC7, CMP_FORMAT_BC7 },
-    };
-
 	try	{
-        std::ispanstream input(blp_file);
+        std::ispanstream input(as_chars(blp_file));
         texture.read(input);
 
         CMP_InitFramework();
@@ -201,21 +241,18 @@ auto convert_blp_to_dds_texture_amdc( // NOLINT
                 return std::unexpected("Compressionator: Error allocating MipLevelData");
             }
 
-            std::vector<uint32_t> mipmap_color_buffer;
-            if (texture.compression() == wc3lib::blp::Blp::Compression::Paletted) {
-                const auto& palette = texture.palette();
-                mipmap_color_buffer = get_paletted_mipmap_buffer_rgba(mipmap, palette);
-            } else {
-                mipmap_color_buffer = get_mipmap_buffer_rgba(mipmap);
-            }
+            const auto mipmap_color_buffer = texture.compression() == wc3lib::blp::Blp::Compression::Paletted
+                ? get_paletted_mipmap_buffer_rgba(mipmap, texture.palette(), memory)
+                : get_mipmap_buffer_rgba(mipmap, memory);
 
+            const size_t data_size = mipmap_color_buffer.size() * sizeof(uint32_t);
             CMP_BYTE* data_ptr = mip_level_ptr->m_pbData; // NOLINT(cppcoreguidelines-pro-type-union-access)
-            memcpy(data_ptr, mipmap_color_buffer.data(), mipmap_color_buffer.size());
+            memcpy(data_ptr, mipmap_color_buffer.data(), data_size);
 
             // Assign miplevel 0 to MipSetin pData ref
             if (mipset_in->pData == nullptr) {
                 mipset_in->pData       = data_ptr;
-                mipset_in->dwDataSize  = static_cast<CMP_DWORD>(mipmap_color_buffer.size());
+                mipset_in->dwDataSize  = static_cast<CMP_DWORD>(data_size);
                 mipset_in->dwWidth     = static_cast<CMP_DWORD>(mip_width);
                 mipset_in->dwHeight    = static_cast<CMP_DWORD>(mip_height);
             }
@@ -223,9 +260,11 @@ auto convert_blp_to_dds_texture_amdc( // NOLINT
 
         // auto generate extra mipmaps up to 1x1 dimesion
         if (extra_mipmaps > 0) {
+            const auto& last_mipmap = texture.mipMaps()[mipmap_count - 1];
             const bool result = generate_extra_mipmaps(
                 *mipset_in,
-                texture.mipMaps()[mipmap_count - 1],
+                static_cast<int>(last_mipmap.width()),
+                static_cast<int>(last_mipmap.height()),
                 mipmap_count - 1);
 
             if (!result) {
@@ -233,37 +272,72 @@ auto convert_blp_to_dds_texture_amdc( // NOLINT
             }
         }
 
+        return compress_mipset(*mipset_in, format_map.at(compression));
+    } catch (std::exception &e) {
+        return std::unexpected(e.what());
+	}
+}
 
-        // Do compression
-        KernelOptions options = {};
-        options.encodeWith    = CMP_Compute_type::CMP_CPU;
-        options.format        = format_map.at(compression);  // Destination format (e.g., BC1, BC3, BC7)
-        options.fquality      = 1.0F;                           // Quality level (0.0 to 1.0)
-        options.threads       = 0;
+auto convert_blp_to_dds_texture_amdc(
+    const FileData& blp_file,
+    const Compression& compression,
+    bool regen_mipmaps,
+    std::pmr::memory_resource* memory
+)-> std::expected<FileData, ErrorMessage>
+{
+    return convert_blp_to_dds_texture_amdc(std::as_bytes(std::span(blp_file)), compression, regen_mipmaps, memory);
+}
+
+auto convert_rgba_to_dds_texture_amdc(
+    const RgbaImage& image,
+    const Compression& compression,
+    size_t mipmap_levels
+)-> std::expected<FileData, ErrorMessage>
+{
+    if (image.width == 0 || image.height == 0 || image.pixels.size() != static_cast<size_t>(image.width) * image.height) {
+        return std::unexpected("Image pixel buffer does not match its dimensions.");
+    }
+
+	try	{
+        CMP_InitFramework();
+
+	    const int image_width = static_cast<int>(image.width);
+	    const int image_height = static_cast<int>(image.height);
 
-        if (options.format == CMP_FORMAT_BC1) {
-            options.bc15.useAlphaThreshold  = true; // NOLINT(cppcoreguidelines-pro-type-union-access)
-            options.bc15.alphaThreshold     = 1;    // NOLINT(cppcoreguidelines-pro-type-union-access)
+        const MipSetPtr mipset_in(new CMP_MipSet{});
+
+        if (!g_CMIPS.AllocateMipSet(mipset_in.get(), CF_8bit, TDT_ARGB, TT_2D, image_width, image_height, 1)) {
+            return std::unexpected("Compressionator: Error allocating Compressionator::MipSet");
         }
 
-        const MipSetPtr mipset_out(new CMP_MipSet{});
+        const auto max_mipmaps = static_cast<size_t>(mipset_in->m_nMaxMipLevels);
+        const auto level_count = mipmap_levels == 0 ? max_mipmaps : std::min(mipmap_levels, max_mipmaps);
 
-        auto dont_stop_callback = [] (CMP_FLOAT /*fProgress*/, CMP_DWORD_PTR /*pUser1*/, CMP_DWORD_PTR /*pUser2*/) -> bool {
-            return false;
-        };
+        mipset_in->m_nMipLevels = static_cast<CMP_INT>(level_count);
+        mipset_in->m_format     = CMP_FORMAT_RGBA_8888;
 
-        // Perform compression CMP_CalculateBufferSize()
-        if (CMP_ProcessTexture(mipset_in.get(), mipset_out.get(), options, dont_stop_callback) != CMP_OK) {
-            return std::unexpected("Compressionator: Error processing texture.");
+        CMP_MipLevel* mip_level_ptr = g_CMIPS.GetMipLevel(mipset_in.get(), 0);
+        if (!g_CMIPS.AllocateMipLevelData(mip_level_ptr, image_width, image_height, CF_8bit, TDT_ARGB)) {
+            return std::unexpected("Compressionator: Error allocating MipLevelData");
         }
 
-        return persist_dds_dx10(*mipset_out);
+        const size_t data_size = image.pixels.size() * sizeof(uint32_t);
+        CMP_BYTE* data_ptr = mip_level_ptr->m_pbData; // NOLINT(cppcoreguidelines-pro-type-union-access)
+        memcpy(data_ptr, image.pixels.data(), data_size);
+
+        mipset_in->pData       = data_ptr;
+        mipset_in->dwDataSize  = static_cast<CMP_DWORD>(data_size);
+        mipset_in->dwWidth     = static_cast<CMP_DWORD>(image_width);
+        mipset_in->dwHeight    = static_cast<CMP_DWORD>(image_height);
+
+        if (level_count > 1 && !generate_extra_mipmaps(*mipset_in, image_width, image_height, 0)) {
+            return std::unexpected("Compressionator: Error generating extra mipmaps.");
+        }
+
+        return compress_mipset(*mipset_in, format_map.at(compression));
     } catch (std::exception &e) {
         return std::unexpected(e.what());
 	}
 }
 
 } // namespace assmpq::blp
-
-
-
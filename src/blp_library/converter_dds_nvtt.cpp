@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <expected>
+#include <memory_resource>
+#include <span>
 #include <spanstream>
 
 #include <spdlog/spdlog.h>
@@ -11,6 +14,12 @@
 
 namespace assmpq::blp {
 
+static const std::unordered_map<Compression, nvtt::Format> format_map = {
+    { Compression::DDS_BC1, nvtt::Format_BC1 },
+    { Compression::DDS_BC3, nvtt::Format_BC3 },
+    { Compression::DDS_BC7, nvtt::Format_BC7 },
+};
+
 class MemoryOutputHandler : public nvtt::OutputHandler
 {
     static constexpr size_t kDDSHeadetSize = 148;
@@ -19,15 +28,15 @@ public:
         dds_data.reserve(estimated_size + kDDSHeadetSize);
     }
 
-    // This vector will store the DDS data
-    std::vector<char> dds_data;
+    // The DDS data is written straight into the returned buffer
+    FileData dds_data;
 
     // The begin method is called at the start of the compression process.
     // It can be used to prepare the output buffer and optionally write the DDS header.
     void beginImage(int /*size*/, int /*width*/, int /*height*/, int /*depth*/, int /*faceCount*/, int /*mipmapCount*/) override {}
 
     // The writeData method is called to write compressed data chunks to the output.
-    // We append the data to our vector.
+    // We append the data to our buffer.
     bool writeData(const void * data, int size) override
     {
         const auto* bytes = static_cast<const unsigned char*>(data);
@@ -47,19 +56,16 @@ static auto generate_extra_mipmaps(
     const nvtt::OutputOptions& output_options,
     const wc3lib::blp::Blp& texture,
     const wc3lib::blp::Blp::MipMap& last_mipmap,
-    const size_t last_mipmap_idx
+    const size_t last_mipmap_idx,
+    std::pmr::memory_resource* memory
 )-> bool
 {
     nvtt::Surface surface;
     size_t mip_idx = last_mipmap_idx;
 
-    std::vector<uint32_t> mipmap_color_buffer;
-    if (texture.compression() == wc3lib::blp::Blp::Compression::Paletted) {
-        const auto& palette = texture.palette();
-        mipmap_color_buffer = get_paletted_mipmap_buffer_rgba(last_mipmap, palette);
-    } else {
-        mipmap_color_buffer = get_mipmap_buffer_rgba(last_mipmap);
-    }
+    const auto mipmap_color_buffer = texture.compression() == wc3lib::blp::Blp::Compression::Paletted
+        ? get_paletted_mipmap_buffer_rgba(last_mipmap, texture.palette(), memory)
+        : get_mipmap_buffer_rgba(last_mipmap, memory);
 
     const int mip_width = static_cast<int>(last_mipmap.width());
     const int mip_height = static_cast<int>(last_mipmap.height());
@@ -82,21 +88,16 @@ static auto generate_extra_mipmaps(
 }
 
 auto convert_blp_to_dds_texture_nvtt(
-    const FileData& blp_file,
+    std::span<const std::byte> blp_file,
     const Compression& compression,
-    bool regen_mipmaps
+    bool regen_mipmaps,
+    std::pmr::memory_resource* memory
 )-> std::expected<FileData, ErrorMessage>
 {
     wc3lib::blp::Blp texture;
 
-    static const std::unordered_map<Compression, nvtt::Format> format_map = {
-        { Compression::DDS_BC1, nvtt::Format_BC1 },
-        { Compression::DDS_BC3, nvtt::Format_BC3 },
-        { Compression::DDS_BC7, nvtt::Format_BC7 },
-    };
-
 	try	{
-        std::ispanstream input(blp_file);
+        std::ispanstream input(as_chars(blp_file));
         texture.read(input);
 
         nvtt::CompressionOptions compression_options;
@@ -151,13 +152,9 @@ auto convert_blp_to_dds_texture_nvtt(
                 const int mip_width = static_cast<int>(mipmap.width());
 	            const int mip_height = static_cast<int>(mipmap.height());
 
-                std::vector<float> mipmap_color_buffer;
-                if (texture.compression() == wc3lib::blp::Blp::Compression::Paletted) {
-                    const auto& palette = texture.palette();
-                    mipmap_color_buffer = get_paletted_mipmap_buffer_float(mipmap, palette);
-                } else {
-                    mipmap_color_buffer = get_mipmap_buffer_float(mipmap);
-                }
+                const auto mipmap_color_buffer = texture.compression() == wc3lib::blp::Blp::Compression::Paletted
+                    ? get_paletted_mipmap_buffer_float(mipmap, texture.palette(), memory)
+                    : get_mipmap_buffer_float(mipmap, memory);
 
                 // Feed the custom data for the current mip level
                 // The library will compress this data and write the compressed blocks to the output handler
@@ -181,7 +178,8 @@ auto convert_blp_to_dds_texture_nvtt(
                     output_options,
                     texture,
                     texture.mipMaps()[mipmap_count - 1],
-                    mipmap_count - 1
+                    mipmap_count - 1,
+                    memory
                 );
 
                 if (!result) {
@@ -190,12 +188,77 @@ auto convert_blp_to_dds_texture_nvtt(
             }
         }
 
-        return output_handler.dds_data;
+        return std::move(output_handler.dds_data);
     } catch (std::exception &e) {
         return std::unexpected(e.what());
 	}
 }
 
+auto convert_blp_to_dds_texture_nvtt(
+    const FileData& blp_file,
+    const Compression& compression,
+    bool regen_mipmaps,
+    std::pmr::memory_resource* memory
+)-> std::expected<FileData, ErrorMessage>
+{
+    return convert_blp_to_dds_texture_nvtt(std::as_bytes(std::span(blp_file)), compression, regen_mipmaps, memory);
+}
+
+auto convert_rgba_to_dds_texture_nvtt(
+    const RgbaImage& image,
+    const Compression& compression,
+    size_t mipmap_levels
+)-> std::expected<FileData, ErrorMessage>
+{
+    if (image.width == 0 || image.height == 0 || image.pixels.size() != static_cast<size_t>(image.width) * image.height) {
+        return std::unexpected("Image pixel buffer does not match its dimensions.");
+    }
+
+	try	{
+        nvtt::CompressionOptions compression_options;
+        compression_options.setFormat(format_map.at(compression));
+        compression_options.setQuality(nvtt::Quality_Normal);
+
+        const nvtt::Context context;
+
+	    const int image_width = static_cast<int>(image.width);
+	    const int image_height = static_cast<int>(image.height);
+
+        nvtt::Surface surface;
+        if (!surface.setImage(nvtt::InputFormat_BGRA_8UB, image_width, image_height, 1, image.pixels.data())) {
+            return std::unexpected("Error setting image data to nvtt::Surface.");
+        }
+        // The pixels hold R in the lowest byte, the red and blue channels come in swapped
+        surface.swizzle(2, 1, 0, 3);
+
+        const auto max_mipmaps = static_cast<size_t>(surface.countMipmaps());
+        const int level_count = static_cast<int>(mipmap_levels == 0 ? max_mipmaps : std::min(mipmap_levels, max_mipmaps));
+
+        const int estimated_size = context.estimateSize(surface, level_count, compression_options);
+        MemoryOutputHandler output_handler(static_cast<size_t>(estimated_size));
+
+        nvtt::OutputOptions output_options;
+        output_options.setContainer(nvtt::Container_DDS10);
+        output_options.setOutputHandler(&output_handler);
+
+        if (!context.outputHeader(surface, level_count, compression_options, output_options)) {
+            return std::unexpected("Error writing DDS header.");
+        }
+
+        for (int mip_idx = 0; mip_idx < level_count; ++mip_idx) {
+            if (mip_idx > 0 && !surface.buildNextMipmap(nvtt::MipmapFilter_Triangle, 1)) {
+                return std::unexpected("Error generating extra mipmaps.");
+            }
+            if (!context.compress(surface, 0, mip_idx, compression_options, output_options)) {
+                return std::unexpected("Error compressing texture.");
+            }
+        }
+
+        return std::move(output_handler.dds_data);
+    } catch (std::exception &e) {
+        return std::unexpected(e.what());
+	}
+}
 
 } // namespace assmpq::blp
 
@@ -2,6 +2,9 @@
 #include <expected>
 #include <spanstream>
 #include <format>
+#include <memory>
+#include <memory_resource>
+#include <span>
 
 #include <nvtt/nvtt.h>
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -9,100 +12,102 @@
 
 #include <blp/blp.hpp>
 #include "assets_mpq_importer/blp.hpp"
+#include "utils_blp.hpp"
 
 
 namespace assmpq::blp {
 
-// NOLINTNEXTLINE
-static void write_to_vector(void* context, void* data, int size) {
-    auto* buffer = static_cast<std::vector<unsigned char>*>(context);
-    auto* bytes = static_cast<unsigned char*>(data);
-    auto bytes_size = static_cast<size_t>(size);
+auto decode_blp_to_rgba_image(std::span<const std::byte> blp_file, size_t mipmap_idx)-> std::expected<RgbaImage, ErrorMessage>
+{
+    wc3lib::blp::Blp texture;
+
+	try	{
+        std::ispanstream input(as_chars(blp_file));
+        texture.read(input);
+
+        if (mipmap_idx >= texture.mipMaps().size()) {
+            return std::unexpected(std::format("Mipmap index {} is out of range.", mipmap_idx));
+        }
+
+        // Decoded by the helpers the converters share, then copied into the buffer the image owns
+        const auto& mipmap = texture.mipMaps()[mipmap_idx];
+        const auto pixels = texture.compression() == wc3lib::blp::Blp::Compression::Paletted
+            ? get_paletted_mipmap_buffer_rgba(mipmap, texture.palette(), std::pmr::get_default_resource())
+            : get_mipmap_buffer_rgba(mipmap, std::pmr::get_default_resource());
 
-    const std::span<unsigned char> data_span(bytes, bytes_size);
-    buffer->insert(buffer->end(), data_span.begin(), data_span.end());
+        return RgbaImage { .width = mipmap.width(), .height = mipmap.height(), .pixels = std::vector<uint32_t>(pixels.begin(), pixels.end()) };
+    } catch (std::exception &e) {
+        return std::unexpected(e.what());
+	}
 }
 
-static auto fill_rgba_pixel_buffer(const wc3lib::blp::Blp::MipMap& mipmap)-> std::vector<uint32_t>
+auto decode_blp_to_rgba_image(const FileData& blp_file, size_t mipmap_idx)-> std::expected<RgbaImage, ErrorMessage>
 {
-    const uint32_t width = mipmap.width();
-    const uint32_t height = mipmap.height();
-
-    std::vector<uint32_t> pixel_buffer(static_cast<size_t>(width) * height);
-    for (uint32_t iy = 0; iy < height; ++iy) {
-        for (uint32_t ix = 0; ix < width; ++ix) {
-            const auto& color = mipmap.colorAt(ix, iy);
-            const uint32_t rgba = color.rgba();
-            pixel_buffer[(iy * width) + ix] = std::byteswap(rgba);
-        }
+    return decode_blp_to_rgba_image(std::as_bytes(std::span(blp_file)), mipmap_idx);
+}
+
+// Encode tightly packed RGBA8 pixels, the caller checks the buffer against the dimensions
+static auto encode_png_image(uint32_t width, uint32_t height, std::span<const uint32_t> pixels)-> std::expected<FileData, ErrorMessage>
+{
+    // stb encodes into a buffer of its own, which is adopted instead of copied
+    int png_size = 0;
+    unsigned char* png_data = stbi_write_png_to_mem(
+        reinterpret_cast<const unsigned char*>(pixels.data()), // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        static_cast<int>(width) * kRgbaChannels,
+        static_cast<int>(width),
+        static_cast<int>(height),
+        kRgbaChannels,
+        &png_size);
+
+    if (png_data == nullptr) {
+        return std::unexpected("Error writing PNG image.");
     }
 
-    return pixel_buffer;
+    struct StbDeleter {
+        void operator()(unsigned char* data) const { STBIW_FREE(data); } // NOLINT(cppcoreguidelines-no-malloc)
+    };
+    return FileData::adopt(
+        std::span(reinterpret_cast<char*>(png_data), static_cast<size_t>(png_size)), // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        std::unique_ptr<unsigned char, StbDeleter>(png_data));
 }
 
-static auto fill_palette_pixel_buffer(
-    const wc3lib::blp::Blp::MipMap& mipmap,
-    const wc3lib::blp::Blp::ColorPtr& palette)-> std::vector<uint32_t>
+auto convert_rgba_to_png_image(const RgbaImage& image)-> std::expected<FileData, ErrorMessage>
 {
-    const uint32_t width = mipmap.width();
-    const uint32_t height = mipmap.height();
-
-    std::vector<uint32_t> pixel_buffer(static_cast<size_t>(width) * height);
-    for (uint32_t iy = 0; iy < height; ++iy) {
-        for (uint32_t ix = 0; ix < width; ++ix) {
-            const auto& color = mipmap.colorAt(ix, iy);
-            const uint32_t rgba = color.paletteColor(palette.get());
-            pixel_buffer[(iy * width) + ix] = std::byteswap(rgba);
-        }
+    if (image.pixels.size() != static_cast<size_t>(image.width) * image.height) {
+        return std::unexpected("Image pixel buffer does not match its dimensions.");
     }
-
-    return pixel_buffer;
+    return encode_png_image(image.width, image.height, image.pixels);
 }
 
-auto convert_blp_to_png_image(const FileData& blp_file, size_t mipmap_idx)-> std::expected<FileData, ErrorMessage>
+auto convert_blp_to_png_image(std::span<const std::byte> blp_file, size_t mipmap_idx, std::pmr::memory_resource* memory)-> std::expected<FileData, ErrorMessage>
 {
     wc3lib::blp::Blp texture;
 
 	try	{
-        std::ispanstream input(blp_file);
+        std::ispanstream input(as_chars(blp_file));
         texture.read(input);
 
         if (mipmap_idx >= texture.mipMaps().size()) {
             return std::unexpected(std::format("Mipmap index {} is out of range.", mipmap_idx));
         }
 
+        // The pixels only live until they are encoded, unlike the ones of decode_blp_to_rgba_image
         const auto& mipmap = texture.mipMaps()[mipmap_idx];
-	    const uint32_t width = mipmap.width();
-	    const uint32_t height = mipmap.height();
-
-        std::vector<uint32_t> pixel_buffer;
-        if (texture.compression() == wc3lib::blp::Blp::Compression::Paletted) {
-            const auto& palette = texture.palette();
-            pixel_buffer = fill_palette_pixel_buffer(mipmap, palette);
-        } else {
-            pixel_buffer = fill_rgba_pixel_buffer(mipmap);
-        }
-
-        std::vector<char> png_buffer;
-
-        // Use stb_image_write to write the PNG to the memory buffer via the callback
-        // The stride_bytes parameter is the pitch, which can be width * channels for tightly packed data
-        stbi_write_png_to_func(
-            write_to_vector,
-            &png_buffer,
-            static_cast<int>(width),
-            static_cast<int>(height),
-            kRgbaChannels,
-            pixel_buffer.data(),
-            static_cast<int>(width) * kRgbaChannels);
-
-        return png_buffer;
+        const auto pixels = texture.compression() == wc3lib::blp::Blp::Compression::Paletted
+            ? get_paletted_mipmap_buffer_rgba(mipmap, texture.palette(), memory)
+            : get_mipmap_buffer_rgba(mipmap, memory);
 
+        return encode_png_image(mipmap.width(), mipmap.height(), pixels);
     } catch (std::exception &e) {
         return std::unexpected(e.what());
 	}
 }
 
+auto convert_blp_to_png_image(const FileData& blp_file, size_t mipmap_idx, std::pmr::memory_resource* memory)-> std::expected<FileData, ErrorMessage>
+{
+    return convert_blp_to_png_image(std::as_bytes(std::span(blp_file)), mipmap_idx, memory);
+}
+
 } // namespace assmpq::blp
 
 
@@ -1,4 +1,6 @@
 #include <bit>
+#include <memory_resource>
+#include <vector>
 #include <blp/blp.hpp>
 #include "assets_mpq_importer/blp.hpp"
 
@@ -19,12 +21,12 @@ inline auto get_color(uint32_t rgba)-> float
     return static_cast<float>((rgba >> static_cast<uint8_t>(SHIFT)) & kByteMask) / kColorBase;
 }
 
-auto get_mipmap_buffer_rgba(const wc3lib::blp::Blp::MipMap& mipmap)
-    -> std::vector<uint32_t>
+auto get_mipmap_buffer_rgba(const wc3lib::blp::Blp::MipMap& mipmap, std::pmr::memory_resource* memory)
+    -> std::pmr::vector<uint32_t>
 {
     const size_t width = mipmap.width();
     const size_t height = mipmap.height();
-    std::vector<uint32_t> colors_buffer(width * height * kRgbaChannels);
+    std::pmr::vector<uint32_t> colors_buffer(width * height, memory);
 
     for (uint32_t iy = 0; iy < height; ++iy) {
         for (uint32_t ix = 0; ix < width; ++ix) {
@@ -39,13 +41,14 @@ auto get_mipmap_buffer_rgba(const wc3lib::blp::Blp::MipMap& mipmap)
 
 auto get_paletted_mipmap_buffer_rgba(
     const wc3lib::blp::Blp::MipMap& mipmap,
-    const  wc3lib::blp::Blp::ColorPtr& palette)
-    -> std::vector<uint32_t>
+    const  wc3lib::blp::Blp::ColorPtr& palette,
+    std::pmr::memory_resource* memory)
+    -> std::pmr::vector<uint32_t>
 {
     const size_t width = mipmap.width();
     const size_t height = mipmap.height();
 
-    std::vector<uint32_t> colors_buffer(width * height * kRgbaChannels);
+    std::pmr::vector<uint32_t> colors_buffer(width * height, memory);
 
     for (uint32_t iy = 0; iy < height; ++iy) {
         for (uint32_t ix = 0; ix < width; ++ix) {
@@ -58,12 +61,12 @@ auto get_paletted_mipmap_buffer_rgba(
     return colors_buffer;
 }
 
-auto get_mipmap_buffer_float(const wc3lib::blp::Blp::MipMap& mipmap)
-    -> std::vector<float>
+auto get_mipmap_buffer_float(const wc3lib::blp::Blp::MipMap& mipmap, std::pmr::memory_resource* memory)
+    -> std::pmr::vector<float>
 {
     const size_t width = mipmap.width();
     const size_t height = mipmap.height();
-    std::vector<float> colors_buffer(width * height * kRgbaChannels);
+    std::pmr::vector<float> colors_buffer(width * height * kRgbaChannels, memory);
 
     const size_t offset_r = width * height * 0;
     const size_t offset_g = width * height * 1;
@@ -87,13 +90,14 @@ auto get_mipmap_buffer_float(const wc3lib::blp::Blp::MipMap& mipmap)
 
 auto get_paletted_mipmap_buffer_float(
     const wc3lib::blp::Blp::MipMap& mipmap,
-    const  wc3lib::blp::Blp::ColorPtr& palette)
-    -> std::vector<float>
+    const  wc3lib::blp::Blp::ColorPtr& palette,
+    std::pmr::memory_resource* memory)
+    -> std::pmr::vector<float>
 {
     const size_t width = mipmap.width();
     const size_t height = mipmap.height();
 
-    std::vector<float> colors_buffer(width * height * kRgbaChannels);
+    std::pmr::vector<float> colors_buffer(width * height * kRgbaChannels, memory);
 
     const size_t offset_r = width * height * 0;
     const size_t offset_g = width * height * 1;
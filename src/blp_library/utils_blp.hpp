@@ -1,6 +1,7 @@
 #ifndef ASSMPQ_UTILS_BLP_H_
 #define ASSMPQ_UTILS_BLP_H_
 
+#include <memory_resource>
 #include <vector>
 #include <blp/blp.hpp>
 
@@ -13,9 +14,10 @@ namespace assmpq::blp {
  * Each color value is byte-swapped for proper endianness.
  *
  * @param mipmap The BLP mipmap to extract color data from
- * @return std::vector<uint32_t> A vector containing the RGBA color data
+ * @param memory Resource the buffer is allocated from
+ * @return std::pmr::vector<uint32_t> A vector containing one RGBA color per pixel
  */
-auto get_mipmap_buffer_rgba(const wc3lib::blp::Blp::MipMap& mipmap)-> std::vector<uint32_t>;
+auto get_mipmap_buffer_rgba(const wc3lib::blp::Blp::MipMap& mipmap, std::pmr::memory_resource* memory)-> std::pmr::vector<uint32_t>;
 
 /**
  * @brief Extracts RGBA color data from a paletted BLP mipmap using a color palette.
@@ -26,11 +28,13 @@ auto get_mipmap_buffer_rgba(const wc3lib::blp::Blp::MipMap& mipmap)-> std::vecto
  *
  * @param mipmap The paletted BLP mipmap to extract color data from
  * @param palette The color palette to use for converting palette indices to RGBA values
- * @return std::vector<uint32_t> A vector containing the RGBA color data
+ * @param memory Resource the buffer is allocated from
+ * @return std::pmr::vector<uint32_t> A vector containing one RGBA color per pixel
  */
 auto get_paletted_mipmap_buffer_rgba(
     const wc3lib::blp::Blp::MipMap& mipmap,
-    const  wc3lib::blp::Blp::ColorPtr& palette)-> std::vector<uint32_t>;
+    const  wc3lib::blp::Blp::ColorPtr& palette,
+    std::pmr::memory_resource* memory)-> std::pmr::vector<uint32_t>;
 
 /**
  * @brief Extracts RGBA color data from a BLP mipmap as floating point values.
@@ -39,9 +43,10 @@ auto get_paletted_mipmap_buffer_rgba(
  * floating point values in the range [0, 1] for each of RGBA components.
  *
  * @param mipmap The BLP mipmap to extract color data from
- * @return std::vector<float> A vector containing the RGBA color data as floating point values
+ * @param memory Resource the buffer is allocated from
+ * @return std::pmr::vector<float> A vector containing the RGBA color data as floating point values
  */
-auto get_mipmap_buffer_float(const wc3lib::blp::Blp::MipMap& mipmap)-> std::vector<float>;
+auto get_mipmap_buffer_float(const wc3lib::blp::Blp::MipMap& mipmap, std::pmr::memory_resource* memory)-> std::pmr::vector<float>;
 
 /**
  * @brief Extracts RGBA color data from a paletted BLP mipmap as floating point values.
@@ -52,11 +57,13 @@ auto get_mipmap_buffer_float(const wc3lib::blp::Blp::MipMap& mipmap)-> std::vect
  *
  * @param mipmap The paletted BLP mipmap to extract color data from
  * @param palette The color palette to use for converting palette indices to RGBA values
- * @return std::vector<float> A vector containing the RGBA color data as floating point values
+ * @param memory Resource the buffer is allocated from
+ * @return std::pmr::vector<float> A vector containing the RGBA color data as floating point values
  */
 auto get_paletted_mipmap_buffer_float(
     const wc3lib::blp::Blp::MipMap& mipmap,
-    const  wc3lib::blp::Blp::ColorPtr& palette)-> std::vector<float>;
+    const  wc3lib::blp::Blp::ColorPtr& palette,
+    std::pmr::memory_resource* memory)-> std::pmr::vector<float>;
 
 } // namespace assmpq::blp
 
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+
+#include "atlas.hpp"
+#include "assets_mpq_importer/mpq.hpp"
+#include "assets_mpq_importer/blp.hpp"
+
+namespace assmpq::importer {
+
+// Keep sprites on BC block boundaries
+static constexpr uint32_t kBlockSize = 4;
+
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height)
+    : width_(width), height_(height), skyline_{ { .x = 0, .y = 0, .width = width } }
+{
+}
+
+// Returns the top position of the rectangle if it fits starting at the node
+auto SkylinePacker::fit(size_t node_idx, uint32_t width, uint32_t height) const-> std::optional<uint32_t>
+{
+    const uint32_t pos_x = skyline_[node_idx].x;
+    if (pos_x + width > width_) {
+        return std::nullopt;
+    }
+
+    uint32_t pos_y = 0;
+    uint32_t width_left = width;
+    for (size_t idx = node_idx; width_left > 0 && idx < skyline_.size(); ++idx) {
+        pos_y = std::max(pos_y, skyline_[idx].y);
+        if (pos_y + height > height_) {
+            return std::nullopt;
+        }
+        width_left -= std::min(width_left, skyline_[idx].width);
+    }
+
+    return pos_y;
+}
+
+void SkylinePacker::add_level(size_t node_idx, const AtlasRect& rect)
+{
+    skyline_.insert(
+        skyline_.begin() + static_cast<std::ptrdiff_t>(node_idx),
+        SkylineNode{ .x = rect.x, .y = rect.y + rect.height, .width = rect.width });
+
+    // Trim the segments shadowed by the new one
+    for (size_t idx = node_idx + 1; idx < skyline_.size();) {
+        const auto& prev = skyline_[idx - 1];
+        auto& node = skyline_[idx];
+        const uint32_t prev_right = prev.x + prev.width;
+        if (node.x >= prev_right) {
+            break;
+        }
+
+        const uint32_t shrink = prev_right - node.x;
+        if (node.width <= shrink) {
+            skyline_.erase(skyline_.begin() + static_cast<std::ptrdiff_t>(idx));
+            continue;
+        }
+
+        node.x += shrink;
+        node.width -= shrink;
+        break;
+    }
+
+    // Merge neighbour segments at the same height
+    for (size_t idx = 1; idx < skyline_.size();) {
+        if (skyline_[idx - 1].y == skyline_[idx].y) {
+            skyline_[idx - 1].width += skyline_[idx].width;
+            skyline_.erase(skyline_.begin() + static_cast<std::ptrdiff_t>(idx));
+        } else {
+            ++idx;
+        }
+    }
+}
+
+auto SkylinePacker::insert(uint32_t width, uint32_t height)-> std::optional<AtlasRect>
+{
+    std::optional<AtlasRect> best_rect;
+    size_t best_idx = 0;
+    uint32_t best_bottom = std::numeric_limits<uint32_t>::max();
+    uint32_t best_width = std::numeric_limits<uint32_t>::max();
+
+    for (size_t idx = 0; idx < skyline_.size(); ++idx) {
+        const auto pos_y = fit(idx, width, height);
+        if (!pos_y.has_value()) {
+            continue;
+        }
+
+        const uint32_t bottom = pos_y.value() + height;
+        if (bottom < best_bottom || (bottom == best_bottom && skyline_[idx].width < best_width)) {
+            best_bottom = bottom;
+            best_width = skyline_[idx].width;
+            best_idx = idx;
+            best_rect = AtlasRect{ .x = skyline_[idx].x, .y = pos_y.value(), .width = width, .height = height };
+        }
+    }
+
+    if (best_rect.has_value()) {
+        add_level(best_idx, best_rect.value());
+        used_width_ = std::max(used_width_, best_rect->x + best_rect->width);
+        used_height_ = std::max(used_height_, best_rect->y + best_rect->height);
+    }
+
+    return best_rect;
+}
+
+namespace {
+
+struct AtlasSprite {
+    std::string filename;
+    assmpq::blp::RgbaImage image;
+    size_t page = 0;
+    AtlasRect rect;
+};
+
+struct AtlasPage {
+    SkylinePacker packer;
+    assmpq::blp::RgbaImage image;
+};
+
+// Copy the sprite into the page and extrude its border pixels into the padding area,
+// so bilinear filtering and the first mip levels never sample the neighbour sprites
+void blit_extruded(assmpq::blp::RgbaImage& page, const assmpq::blp::RgbaImage& sprite, uint32_t pos_x, uint32_t pos_y, uint32_t padding)
+{
+    const auto sprite_width = static_cast<int64_t>(sprite.width);
+    const auto sprite_height = static_cast<int64_t>(sprite.height);
+    const auto pad = static_cast<int64_t>(padding);
+
+    for (int64_t dst_y = -pad; dst_y < sprite_height + pad; ++dst_y) {
+        const int64_t src_y = std::clamp<int64_t>(dst_y, 0, sprite_height - 1);
+        const auto page_row = static_cast<size_t>(pos_y + dst_y) * page.width;
+        for (int64_t dst_x = -pad; dst_x < sprite_width + pad; ++dst_x) {
+            const int64_t src_x = std::clamp<int64_t>(dst_x, 0, sprite_width - 1);
+            page.pixels[page_row + static_cast<size_t>(pos_x + dst_x)] =
+                sprite.pixels[static_cast<size_t>((src_y * sprite_width) + src_x)];
+        }
+    }
+}
+
+auto encode_page(const assmpq::blp::RgbaImage& page, size_t mipmap_levels, const ProgramOptions& popt)
+    -> std::expected<assmpq::FileData, assmpq::ErrorMessage>
+{
+    if (popt.is_dds && popt.is_nvtt) {
+        return assmpq::blp::convert_rgba_to_dds_texture_nvtt(page, popt.compression, mipmap_levels);
+    } else if (popt.is_dds) {
+        return assmpq::blp::convert_rgba_to_dds_texture_amdc(page, popt.compression, mipmap_levels);
+    } else {
+        return assmpq::blp::convert_rgba_to_png_image(page);
+    }
+}
+
+auto align_up(uint32_t value, uint32_t alignment)-> uint32_t
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+auto import_atlas(const ProgramOptions& popt, const assmpq::mpq::ArchiveChain* archive_chain, OutputWriter& output_writer)-> std::unordered_set<std::string>
+{
+    std::unordered_set<std::string> atlased_files;
+
+    assmpq::mpq::ArchiveEntries list_files;
+    const auto list_file = [&list_files](const assmpq::mpq::FileEntry& entry) {
+        list_files.push_back(entry);
+    };
+    const auto listed_count = archive_chain == nullptr
+        ? assmpq::mpq::for_each_mpq_file(popt.input_mpq_file, list_file, popt.atlas_pattern, true)
+        : archive_chain->for_each_file(list_file, popt.atlas_pattern);
+    if (!listed_count.has_value()) {
+        spdlog::error("Error extracting list file from MPQ archive: {}", listed_count.error());
+        return atlased_files;
+    }
+
+    const uint32_t padding = popt.atlas_padding;
+    const uint32_t atlas_size = std::bit_floor(popt.atlas_size);
+
+    std::vector<AtlasSprite> sprites;
+    for (const auto& file : list_files) {
+        const auto extracted_file = archive_chain == nullptr
+            ? assmpq::mpq::extract_mpq_file(popt.input_mpq_file, file.filename)
+            : archive_chain->extract_file(file.filename);
+        if (!extracted_file.has_value()) {
+            spdlog::error("File extraction error: {}", extracted_file.error());
+            continue;
+        }
+
+        auto image = assmpq::blp::decode_blp_to_rgba_image(extracted_file.value());
+        if (!image.has_value()) {
+            spdlog::warn("Atlas skips {}: {}", file.filename, image.error());
+            continue;
+        }
+
+        if (image->width + (2 * padding) > atlas_size || image->height + (2 * padding) > atlas_size) {
+            spdlog::warn("Atlas skips {}: image is larger than the atlas page.", file.filename);
+            continue;
+        }
+
+        sprites.push_back(AtlasSprite{ .filename = file.filename, .image = std::move(image.value()), .page = 0, .rect = {} });
+    }
+
+    if (sprites.empty()) {
+        spdlog::warn("No textures matched the atlas pattern: {}", popt.atlas_pattern);
+        return atlased_files;
+    }
+
+    // Tallest first gives the skyline a flat contour to build on
+    std::ranges::stable_sort(sprites, [](const AtlasSprite& lhs, const AtlasSprite& rhs) {
+        return std::tie(rhs.image.height, rhs.image.width) < std::tie(lhs.image.height, lhs.image.width);
+    });
+
+    std::vector<AtlasPage> pages;
+    for (auto& sprite : sprites) {
+        const uint32_t cell_width = align_up(sprite.image.width + (2 * padding), kBlockSize);
+        const uint32_t cell_height = align_up(sprite.image.height + (2 * padding), kBlockSize);
+
+        std::optional<AtlasRect> cell;
+        for (size_t page_idx = 0; page_idx < pages.size() && !cell.has_value(); ++page_idx) {
+            cell = pages[page_idx].packer.insert(cell_width, cell_height);
+            sprite.page = page_idx;
+        }
+
+        if (!cell.has_value()) {
+            pages.push_back(AtlasPage{ .packer = SkylinePacker(atlas_size, atlas_size), .image = {} });
+            cell = pages.back().packer.insert(cell_width, cell_height);
+            sprite.page = pages.size() - 1;
+        }
+
+        sprite.rect = AtlasRect{
+            .x = cell->x + padding,
+            .y = cell->y + padding,
+            .width = sprite.image.width,
+            .height = sprite.image.height };
+    }
+
+    // Shrink every page to the power of two covering its packed area
+    for (auto& page : pages) {
+        page.image.width = std::bit_ceil(page.packer.used_width());
+        page.image.height = std::bit_ceil(page.packer.used_height());
+        page.image.pixels.assign(static_cast<size_t>(page.image.width) * page.image.height, 0);
+    }
+
+    for (const auto& sprite : sprites) {
+        blit_extruded(pages[sprite.page].image, sprite.image, sprite.rect.x, sprite.rect.y, padding);
+    }
+
+    // Mip level N halves the padding N times, stop while it still covers at least one texel
+    const size_t mipmap_levels = padding == 0 ? 1 : static_cast<size_t>(std::bit_width(padding));
+
+    // Every page is encoded before the first one is written, a failed page leaves no partial atlas behind
+    std::vector<assmpq::FileData> encoded_pages;
+    encoded_pages.reserve(pages.size());
+    for (const auto& page : pages) {
+        auto encoded_page = encode_page(page.image, mipmap_levels, popt);
+        if (!encoded_page.has_value()) {
+            spdlog::error("Atlas page convertation error: {}", encoded_page.error());
+            return {};
+        }
+        encoded_pages.push_back(std::move(encoded_page.value()));
+    }
+
+    nlohmann::ordered_json atlas_doc;
+    for (size_t page_idx = 0; page_idx < pages.size(); ++page_idx) {
+        const auto& page = pages[page_idx].image;
+        const std::string page_filename = std::format("{}_{}.{}", popt.atlas_name, page_idx, popt.is_dds ? "dds" : "png");
+
+        output_writer.write(page_filename, std::move(encoded_pages[page_idx]));
+
+        atlas_doc["pages"].push_back({
+            { "file", page_filename },
+            { "width", page.width },
+            { "height", page.height } });
+    }
+
+    for (const auto& sprite : sprites) {
+        const auto& page = pages[sprite.page].image;
+        const auto page_width = static_cast<double>(page.width);
+        const auto page_height = static_cast<double>(page.height);
+
+        auto archived_filename = sprite.filename;
+        std::ranges::replace(archived_filename, '\\', '/');
+
+        atlas_doc["sprites"][archived_filename] = {
+            { "page", sprite.page },
+            { "x", sprite.rect.x },
+            { "y", sprite.rect.y },
+            { "width", sprite.rect.width },
+            { "height", sprite.rect.height },
+            { "u0", sprite.rect.x / page_width },
+            { "v0", sprite.rect.y / page_height },
+            { "u1", (sprite.rect.x + sprite.rect.width) / page_width },
+            { "v1", (sprite.rect.y + sprite.rect.height) / page_height } };
+
+        atlased_files.insert(sprite.filename);
+    }
+
+    const std::string atlas_json = atlas_doc.dump(2);
+    output_writer.write(popt.atlas_name + ".json", assmpq::FileData(atlas_json.begin(), atlas_json.end()));
+
+    spdlog::info("Atlas {}: {} textures packed into {} pages.", popt.atlas_name, sprites.size(), pages.size());
+
+    return atlased_files;
+}
+
+} // namespace assmpq::importer
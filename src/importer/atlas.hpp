@@ -0,0 +1,76 @@
+#ifndef ASSMPQ_IMPORTER_ATLAS_H_
+#define ASSMPQ_IMPORTER_ATLAS_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "assets_mpq_importer/mpq.hpp"
+#include "importer.hpp"
+#include "writer.hpp"
+
+namespace assmpq::importer {
+
+/// @brief Rectangle placed on an atlas page, in pixels
+struct AtlasRect {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+/**
+ * @brief Skyline bottom-left rectangle packer
+ * @details Keeps the upper contour of the packed area as a list of horizontal segments
+ * and places every new rectangle at the lowest (then leftmost) position it fits.
+ */
+class SkylinePacker {
+public:
+    SkylinePacker(uint32_t width, uint32_t height);
+
+    /**
+     * @brief Reserve a rectangle on the page
+     * @param width Rectangle width
+     * @param height Rectangle height
+     * @return Placed rectangle or std::nullopt if the page has no room left
+     */
+    [[nodiscard]] auto insert(uint32_t width, uint32_t height)-> std::optional<AtlasRect>;
+
+    /// @brief Right edge of the rightmost packed rectangle
+    [[nodiscard]] auto used_width() const-> uint32_t { return used_width_; }
+    /// @brief Bottom edge of the lowest packed rectangle
+    [[nodiscard]] auto used_height() const-> uint32_t { return used_height_; }
+
+private:
+    struct SkylineNode {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    [[nodiscard]] auto fit(size_t node_idx, uint32_t width, uint32_t height) const-> std::optional<uint32_t>;
+    void add_level(size_t node_idx, const AtlasRect& rect);
+
+    uint32_t width_;
+    uint32_t height_;
+    uint32_t used_width_ = 0;
+    uint32_t used_height_ = 0;
+    std::vector<SkylineNode> skyline_;
+};
+
+/**
+ * @brief Pack BLP textures matching the atlas pattern into compressed atlas pages
+ * @details Every page is written once as DDS or PNG (following the texture options)
+ * together with a JSON UV lookup table named after the atlas.
+ * @param popt Program options containing atlas settings
+ * @param archive_chain Patch chain the textures are read from, the input archive alone if null
+ * @param output_writer Writer receiving the pages and the lookup table
+ * @return Archived file names which were placed into the atlas
+ */
+auto import_atlas(const ProgramOptions& popt, const assmpq::mpq::ArchiveChain* archive_chain, OutputWriter& output_writer)-> std::unordered_set<std::string>;
+
+} // namespace assmpq::importer
+
+#endif  /// ASSMPQ_IMPORTER_ATLAS_H_
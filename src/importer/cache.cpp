@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+
+#include "cache.hpp"
+#include "dedup.hpp"
+
+namespace assmpq::importer {
+
+ImportCache::ImportCache(const ProgramOptions& popt)
+    : popt_(popt), options_key_(make_options_key(popt))
+{
+    // Recorded outputs are loose files, a pack is always built from scratch
+    if (popt_.is_force || !popt_.pack_file.empty()) {
+        return;
+    }
+
+    std::ifstream input_file(popt_.output_folder / kImportCacheFilename);
+    if (!input_file.is_open()) {
+        return;
+    }
+
+    try {
+        const auto cache_doc = nlohmann::json::parse(input_file);
+
+        // Outputs made with other options are stale as a whole
+        if (cache_doc.at("options").get<std::string>() != options_key_) {
+            spdlog::info("Conversion options changed, import cache is invalidated.");
+            return;
+        }
+
+        for (const auto& [archived_filename, entry] : cache_doc.at("entries").items()) {
+            CachedImport cache_entry{
+                .source_key = entry.at("source").get<std::string>(),
+                .content_hash = entry.at("content").get<std::string>(),
+                .outputs = {} };
+            for (const auto& output : entry.at("outputs")) {
+                cache_entry.outputs.push_back(CachedOutput{
+                    .output_path = output.at("path").get<std::string>(),
+                    .content_hash = output.at("hash").get<std::string>(),
+                    .size = output.at("size").get<uintmax_t>() });
+            }
+            entries_.emplace(archived_filename, std::move(cache_entry));
+        }
+    } catch (const nlohmann::json::exception& e) {
+        spdlog::warn("Import cache is damaged and will be rebuilt: {}", e.what());
+        entries_.clear();
+    }
+}
+
+auto ImportCache::find_up_to_date(const std::filesystem::path& archived_file_path, const std::string& source_key) const
+    -> const CachedImport*
+{
+    const auto entry = entries_.find(archived_file_path.generic_string());
+    if (entry == entries_.end() || entry->second.source_key != source_key) {
+        return nullptr;
+    }
+
+    // An output rewritten through a link or edited in place keeps its size, so the content is hashed as well
+    const bool outputs_valid = std::ranges::all_of(entry->second.outputs, [this](const CachedOutput& output) {
+        const auto output_filename = popt_.output_folder / output.output_path;
+        std::error_code error;
+        const auto size = std::filesystem::file_size(output_filename, error);
+        return !error && size == output.size && make_file_content_hash(output_filename) == output.content_hash;
+    });
+
+    return outputs_valid ? &entry->second : nullptr;
+}
+
+void ImportCache::update(const std::filesystem::path& archived_file_path, CachedImport cached_import)
+{
+    if (cached_import.outputs.empty()) {
+        entries_.erase(archived_file_path.generic_string());
+        return;
+    }
+
+    entries_.insert_or_assign(archived_file_path.generic_string(), std::move(cached_import));
+}
+
+auto ImportCache::save() const-> bool
+{
+    nlohmann::ordered_json cache_doc;
+    cache_doc["options"] = options_key_;
+    cache_doc["entries"] = nlohmann::ordered_json::object();
+
+    for (const auto& [archived_filename, entry] : entries_) {
+        auto& entry_doc = cache_doc["entries"][archived_filename];
+        entry_doc["source"] = entry.source_key;
+        entry_doc["content"] = entry.content_hash;
+        entry_doc["outputs"] = nlohmann::ordered_json::array();
+        for (const auto& output : entry.outputs) {
+            entry_doc["outputs"].push_back({
+                { "path", output.output_path.generic_string() },
+                { "hash", output.content_hash },
+                { "size", output.size } });
+        }
+    }
+
+    const std::string cache_json = cache_doc.dump(2);
+    return import_save(assmpq::FileData(cache_json.begin(), cache_json.end()), kImportCacheFilename, popt_);
+}
+
+} // namespace assmpq::importer
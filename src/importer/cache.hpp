@@ -0,0 +1,76 @@
+#ifndef ASSMPQ_IMPORTER_CACHE_H_
+#define ASSMPQ_IMPORTER_CACHE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "importer.hpp"
+
+namespace assmpq::importer {
+
+/// @brief Import cache file name in the output folder
+inline constexpr auto kImportCacheFilename = "import_cache.json";
+
+/// @brief Output file recorded in the import cache
+struct CachedOutput {
+    std::filesystem::path output_path;     ///< Path relative to the output folder
+    std::string content_hash;              ///< Digest of the saved content
+    uintmax_t size = 0;                    ///< Saved file size in bytes
+};
+
+/// @brief Import of an archived file recorded in the import cache
+struct CachedImport {
+    std::string source_key;                ///< Archive metadata of the stored copy, see mpq_file_source_key
+    std::string content_hash;              ///< Digest of the extracted payload, empty if it was streamed to disk
+    std::vector<CachedOutput> outputs;     ///< Saved outputs
+};
+
+/**
+ * @brief Persistent incremental import cache
+ * @details Maps every archived file to the archive metadata of its stored copy, the conversion
+ * options key and the saved outputs. The manifest lives in the output folder, so
+ * re-runs skip files whose stored copy and options did not change without extracting them.
+ */
+class ImportCache {
+public:
+    /**
+     * @brief Load the cache manifest from the output folder
+     * @param popt Program options, the manifest is ignored if force flag or pack file is set
+     */
+    explicit ImportCache(const ProgramOptions& popt);
+
+    /**
+     * @brief Find the up to date import of the archived file
+     * @details Outputs are validated by their size and the digest of their saved content.
+     * @param archived_file_path The original file path in the archive
+     * @param source_key Key of the stored copy made by mpq_file_source_key
+     * @return Cached import if the file can be skipped, nullptr otherwise
+     */
+    [[nodiscard]] auto find_up_to_date(const std::filesystem::path& archived_file_path, const std::string& source_key) const
+        -> const CachedImport*;
+
+    /**
+     * @brief Record the import of the archived file
+     * @param archived_file_path The original file path in the archive
+     * @param cached_import Source key, payload digest and saved outputs, the entry is removed when there are no outputs
+     */
+    void update(const std::filesystem::path& archived_file_path, CachedImport cached_import);
+
+    /**
+     * @brief Write the manifest to the output folder
+     * @return true if the manifest was saved successfully, false otherwise
+     */
+    auto save() const-> bool;
+
+private:
+    const ProgramOptions& popt_;
+    std::string options_key_;
+    std::unordered_map<std::string, CachedImport> entries_;
+};
+
+} // namespace assmpq::importer
+
+#endif  /// ASSMPQ_IMPORTER_CACHE_H_
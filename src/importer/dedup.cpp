@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cctype>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <string_view>
+#include <system_error>
+#include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+#include <xxhash.h>
+
+#include <internal_use_only/config.hpp>
+#include "dedup.hpp"
+
+namespace assmpq::importer {
+
+auto make_content_hash(const assmpq::FileData& file_data)-> std::string
+{
+    const XXH128_hash_t digest = XXH3_128bits(file_data.data(), file_data.size());
+    return std::format("{:016x}{:016x}", digest.high64, digest.low64);
+}
+
+auto make_file_content_hash(const std::filesystem::path& file_path)-> std::optional<std::string>
+{
+    constexpr size_t kReadBufferSize = 1024ULL * 1024;
+
+    std::ifstream input_file(file_path, std::ios::in | std::ios::binary);
+    const std::unique_ptr<XXH3_state_t, decltype(&XXH3_freeState)> state(XXH3_createState(), XXH3_freeState);
+    if (!input_file || state == nullptr || XXH3_128bits_reset(state.get()) != XXH_OK) {
+        return std::nullopt;
+    }
+
+    std::vector<char> buffer(kReadBufferSize);
+    while (input_file) {
+        input_file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        XXH3_128bits_update(state.get(), buffer.data(), static_cast<size_t>(input_file.gcount()));
+    }
+    if (input_file.bad()) {
+        return std::nullopt;
+    }
+
+    const XXH128_hash_t digest = XXH3_128bits_digest(state.get());
+    return std::format("{:016x}{:016x}", digest.high64, digest.low64);
+}
+
+auto make_content_key(const std::string& content_hash, const std::filesystem::path& archived_file_path)-> std::string
+{
+    auto extension = archived_file_path.extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char chr) { return static_cast<char>(std::tolower(chr)); });
+
+    return content_hash + extension;
+}
+
+auto make_duplicate_path(const std::filesystem::path& original_path, const std::filesystem::path& archived_file_path)-> std::filesystem::path
+{
+    auto duplicate_path = archived_file_path;
+    duplicate_path.replace_extension(original_path.extension());
+    return duplicate_path;
+}
+
+auto make_options_key(const ProgramOptions& popt)-> std::string
+{
+    return std::format("version={};extract={};dds={};nvtt={};compression={};regen={};w3e_only={}",
+        assets_mpq_importer::cmake::project_version,
+        popt.is_extract,
+        popt.is_dds,
+        popt.is_nvtt,
+        static_cast<int>(popt.compression),
+        popt.is_regen_mipmaps,
+        popt.is_w3e_only);
+}
+
+DedupIndex::DedupIndex(const ProgramOptions& popt)
+    : popt_(popt), options_key_(make_options_key(popt))
+{
+    // Recorded outputs are loose files, a pack is always built from scratch
+    std::ifstream input_file(popt_.output_folder / kDedupIndexFilename);
+    if (popt_.is_force || !popt_.pack_file.empty() || !input_file.is_open()) {
+        return;
+    }
+
+    try {
+        const auto index_doc = nlohmann::json::parse(input_file);
+
+        for (const auto& [alias, original] : index_doc.at("aliases").items()) {
+            aliases_.emplace(alias, original.get<std::string>());
+        }
+
+        if (index_doc.at("options").get<std::string>() != options_key_) {
+            spdlog::info("Conversion options changed, previous dedup entries are ignored.");
+            return;
+        }
+
+        for (const auto& [content_key, outputs] : index_doc.at("entries").items()) {
+            auto& entry = entries_[content_key];
+            entry.is_loaded = true;
+            for (const auto& output : outputs) {
+                entry.output_paths.emplace_back(output.get<std::string>());
+            }
+        }
+    } catch (const nlohmann::json::exception& e) {
+        spdlog::warn("Dedup index is damaged and will be rebuilt: {}", e.what());
+        entries_.clear();
+        aliases_.clear();
+    }
+}
+
+auto DedupIndex::find(const std::string& content_key) const-> const std::vector<std::filesystem::path>*
+{
+    const auto entry = entries_.find(content_key);
+    if (entry == entries_.end()) {
+        return nullptr;
+    }
+
+    // The original copy could have been removed since the index was written
+    const bool originals_exist = !entry->second.is_loaded || std::ranges::all_of(entry->second.output_paths, [this](const auto& original_path) {
+        return std::filesystem::exists(popt_.output_folder / original_path);
+    });
+
+    return originals_exist ? &entry->second.output_paths : nullptr;
+}
+
+void DedupIndex::add(const std::string& content_key, std::vector<std::filesystem::path> output_paths)
+{
+    entries_.insert_or_assign(content_key, DedupEntry{ .output_paths = std::move(output_paths), .is_loaded = false });
+}
+
+auto DedupIndex::link_duplicate(const std::vector<std::filesystem::path>& original_paths, const std::filesystem::path& archived_file_path)-> bool
+{
+    for (const auto& original_path : original_paths) {
+        const auto duplicate_path = make_duplicate_path(original_path, archived_file_path);
+        if (duplicate_path == original_path) {
+            continue;
+        }
+
+        if (popt_.dedup == DedupMode::Manifest) {
+            aliases_.insert_or_assign(duplicate_path.generic_string(), original_path.generic_string());
+            spdlog::info("File {} aliased to {}.", duplicate_path.string(), original_path.string());
+            continue;
+        }
+
+        const auto target = popt_.output_folder / original_path;
+        const auto link = popt_.output_folder / duplicate_path;
+
+        std::error_code error;
+        if (std::filesystem::equivalent(target, link, error)) {
+            continue;
+        }
+
+        std::filesystem::create_directories(link.parent_path(), error);
+        std::filesystem::remove(link, error);
+
+        if (popt_.dedup == DedupMode::Hardlink) {
+            std::filesystem::create_hard_link(target, link, error);
+        } else {
+            std::filesystem::create_symlink(std::filesystem::relative(target, link.parent_path()), link, error);
+        }
+
+        // Links are not available on every filesystem, fall back to a plain copy
+        if (error) {
+            spdlog::warn("File {} link error: {}, copying instead.", link.string(), error.message());
+            if (!std::filesystem::copy_file(target, link, std::filesystem::copy_options::overwrite_existing, error)) {
+                spdlog::error("File write error: {}", link.string());
+                return false;
+            }
+        }
+
+        spdlog::info("File {} linked to {}.", link.string(), target.string());
+    }
+
+    return true;
+}
+
+auto DedupIndex::save() const-> bool
+{
+    nlohmann::ordered_json index_doc;
+    index_doc["options"] = options_key_;
+    index_doc["entries"] = nlohmann::ordered_json::object();
+    index_doc["aliases"] = aliases_;
+
+    for (const auto& [content_key, entry] : entries_) {
+        auto& outputs = index_doc["entries"][content_key];
+        for (const auto& output_path : entry.output_paths) {
+            outputs.push_back(output_path.generic_string());
+        }
+    }
+
+    const std::string index_json = index_doc.dump(2);
+    return import_save(assmpq::FileData(index_json.begin(), index_json.end()), kDedupIndexFilename, popt_);
+}
+
+} // namespace assmpq::importer
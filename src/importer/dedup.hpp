@@ -0,0 +1,113 @@
+#ifndef ASSMPQ_IMPORTER_DEDUP_H_
+#define ASSMPQ_IMPORTER_DEDUP_H_
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "importer.hpp"
+
+namespace assmpq::importer {
+
+/// @brief Dedup manifest file name in the output folder
+inline constexpr auto kDedupIndexFilename = "dedup_index.json";
+
+/**
+ * @brief Hash extracted or converted file content
+ * @param file_data File content
+ * @return XXH3-128 digest as a hex string
+ */
+auto make_content_hash(const assmpq::FileData& file_data)-> std::string;
+
+/**
+ * @brief Hash the content of a saved file without loading it whole
+ * @param file_path Path to the file
+ * @return Same digest as make_content_hash of the file content, nothing if the file cannot be read
+ */
+auto make_file_content_hash(const std::filesystem::path& file_path)-> std::optional<std::string>;
+
+/**
+ * @brief Build the content key of an extracted payload
+ * @details Payload digest followed by the lowercase source extension,
+ * so identical bytes routed to different converters never alias.
+ * @param content_hash Digest made by make_content_hash
+ * @param archived_file_path The original file path in the archive
+ * @return Content key string
+ */
+auto make_content_key(const std::string& content_hash, const std::filesystem::path& archived_file_path)-> std::string;
+
+/**
+ * @brief Build the output path of a duplicate payload
+ * @details Every converter names its output after the archived file, only the extension differs.
+ * @param original_path Output of the first imported copy
+ * @param archived_file_path The duplicate file path in the archive
+ * @return Duplicate output path relative to the output folder
+ */
+auto make_duplicate_path(const std::filesystem::path& original_path, const std::filesystem::path& archived_file_path)-> std::filesystem::path;
+
+/**
+ * @brief Build the key of the conversion options affecting output content
+ * @param popt Program options
+ * @return Options key string
+ */
+auto make_options_key(const ProgramOptions& popt)-> std::string;
+
+/**
+ * @brief Content addressed index of imported payloads
+ * @details Persisted in the output folder, so identical payloads are converted once
+ * across all archives and maps imported into the same folder. Entries recorded
+ * with other conversion options are discarded on load.
+ */
+class DedupIndex {
+public:
+    explicit DedupIndex(const ProgramOptions& popt);
+
+    /**
+     * @brief Find the outputs of an already imported identical payload
+     * @details Outputs recorded by previous runs are checked to still exist, outputs of
+     * the current run may still be queued for writing and are trusted.
+     * @param content_key Key made by make_content_key
+     * @return Output paths relative to the output folder or nullptr if the payload has to be converted
+     */
+    [[nodiscard]] auto find(const std::string& content_key) const-> const std::vector<std::filesystem::path>*;
+
+    /**
+     * @brief Register the outputs of a converted payload
+     * @param content_key Key made by make_content_key
+     * @param output_paths Saved output paths relative to the output folder
+     */
+    void add(const std::string& content_key, std::vector<std::filesystem::path> output_paths);
+
+    /**
+     * @brief Materialize the outputs of a duplicate payload as links or manifest aliases
+     * @details Must run after the original outputs are written.
+     * @param original_paths Outputs of the first imported copy
+     * @param archived_file_path The duplicate file path in the archive
+     * @return true if every output was linked, false otherwise
+     */
+    auto link_duplicate(const std::vector<std::filesystem::path>& original_paths, const std::filesystem::path& archived_file_path)-> bool;
+
+    /**
+     * @brief Write the index to the output folder
+     * @return true if the index was saved successfully, false otherwise
+     */
+    auto save() const-> bool;
+
+private:
+    const ProgramOptions& popt_;
+    std::string options_key_;
+    struct DedupEntry {
+        std::vector<std::filesystem::path> output_paths;
+        bool is_loaded = false;
+    };
+
+    std::unordered_map<std::string, DedupEntry> entries_;
+    std::map<std::string, std::string> aliases_;
+};
+
+} // namespace assmpq::importer
+
+#endif  /// ASSMPQ_IMPORTER_DEDUP_H_
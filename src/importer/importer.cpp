@@ -1,5 +1,8 @@
 #include <fstream>
+#include <memory_resource>
+#include <optional>
 #include <filesystem>
+#include <system_error>
 #include <spdlog/spdlog.h>
 #include "importer.hpp"
 
@@ -9,6 +12,12 @@
 
 namespace assmpq::importer {
 
+JobArena::JobArena(size_t capacity)
+    : block_(std::make_unique_for_overwrite<std::byte[]>(capacity)), // NOLINT(cppcoreguidelines-avoid-c-arrays)
+      arena_(block_.get(), capacity)
+{
+}
+
 /**
  * @brief Save file data to the specified output path
  * @param file_data The file data to save
@@ -21,6 +30,10 @@ auto import_save(const assmpq::FileData& file_data, const std::filesystem::path&
     auto output_filename = popt.output_folder / archived_file_path;
 
     std::filesystem::create_directories(output_filename.parent_path());
+
+    // A dedup link is replaced instead of being written through
+    std::error_code error;
+    std::filesystem::remove(output_filename, error);
     std::ofstream output_file(output_filename, std::ios::out | std::ios::binary);
     if (!output_file) {
         spdlog::error("File write error: {}", output_filename.string());
@@ -41,28 +54,29 @@ auto import_save(const assmpq::FileData& file_data, const std::filesystem::path&
  * @param file_data The BLP file data to convert
  * @param archived_file_path The original file path in the archive
  * @param popt Program options containing conversion settings
- * @return true if conversion and save was successful, false otherwise
+ * @param memory Resource for the temporaries of the conversion
+ * @return Converted file or std::nullopt if conversion failed
  */
-auto import_blp(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool
+auto import_blp(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt, std::pmr::memory_resource* memory)-> std::optional<ImportedFile>
 {
-    const auto converted_file_data = [&file_data, &popt]() {
+    auto converted_file_data = [&file_data, &popt, memory]() {
         if (popt.is_dds && popt.is_nvtt) {
-            return assmpq::blp::convert_blp_to_dds_texture_nvtt(file_data, popt.compression, popt.is_regen_mipmaps);
+            return assmpq::blp::convert_blp_to_dds_texture_nvtt(file_data, popt.compression, popt.is_regen_mipmaps, memory);
         } else if (popt.is_dds) {
-            return assmpq::blp::convert_blp_to_dds_texture_amdc(file_data, popt.compression, popt.is_regen_mipmaps);
+            return assmpq::blp::convert_blp_to_dds_texture_amdc(file_data, popt.compression, popt.is_regen_mipmaps, memory);
         } else {
-            return assmpq::blp::convert_blp_to_png_image(file_data);
+            return assmpq::blp::convert_blp_to_png_image(file_data, 0, memory);
         }
     }();
 
     if (!converted_file_data.has_value()) {
         spdlog::error("File convertation error: {}", archived_file_path.string());
-        return false;
+        return std::nullopt;
     }
 
     auto output_path = archived_file_path;
     output_path.replace_extension(popt.is_dds ? "dds" : "png");
-    return import_save(converted_file_data.value(), output_path, popt);
+    return ImportedFile{ .output_path = output_path, .file_data = std::move(converted_file_data.value()) };
 }
 
 /**
@@ -70,19 +84,19 @@ auto import_blp(const assmpq::FileData& file_data, const std::filesystem::path&
  * @param file_data The MDX file data to convert
  * @param archived_file_path The original file path in the archive
  * @param popt Program options
- * @return true if conversion and save was successful, false otherwise
+ * @return Converted file or std::nullopt if conversion failed
  */
-auto import_mdx(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool
+auto import_mdx(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& /*popt*/, std::pmr::memory_resource* /*memory*/)-> std::optional<ImportedFile>
 {
-    const auto converted_file_data = assmpq::mdlx::convert_mdlx_to_obj_mesh(archived_file_path.stem().string(), file_data);
+    auto converted_file_data = assmpq::mdlx::convert_mdlx_to_obj_mesh(archived_file_path.stem().string(), file_data);
     if (!converted_file_data.has_value()) {
         spdlog::error("File convertation error: {}", archived_file_path.string());
-        return false;
+        return std::nullopt;
     }
 
     auto output_path = archived_file_path;
     output_path.replace_extension("obj");
-    return import_save(converted_file_data.value(), output_path, popt);
+    return ImportedFile{ .output_path = output_path, .file_data = std::move(converted_file_data.value()) };
 }
 
 /**
@@ -90,19 +104,19 @@ auto import_mdx(const assmpq::FileData& file_data, const std::filesystem::path&
  * @param file_data The map file data to extract
  * @param archived_file_path The original file path in the archive
  * @param popt Program options
- * @return true if extraction and save was successful, false otherwise
+ * @return Extracted file or std::nullopt if extraction failed or skipped
  */
-auto import_w3e(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool
+auto import_w3e(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& /*popt*/, std::pmr::memory_resource* /*memory*/)-> std::optional<ImportedFile>
 {
-    const auto extracted_file_data = assmpq::w3m::extract_w3e_file(file_data);
+    auto extracted_file_data = assmpq::w3m::extract_w3e_file(file_data);
     if (!extracted_file_data.has_value()) {
         spdlog::error("File convertation error: {}", archived_file_path.string());
-        return false;
+        return std::nullopt;
     }
 
     auto output_path = archived_file_path;
     output_path.replace_extension("w3e");
-    return import_save(extracted_file_data.value(), output_path, popt);
+    return ImportedFile{ .output_path = output_path, .file_data = std::move(extracted_file_data.value()) };
 }
 
 /**
@@ -110,23 +124,23 @@ auto import_w3e(const assmpq::FileData& file_data, const std::filesystem::path&
  * @param file_data The map file data to extract
  * @param archived_file_path The original file path in the archive
  * @param popt Program options
- * @return true if extraction and save was successful, false otherwise
+ * @return Extracted file or std::nullopt if extraction failed or skipped
  */
-auto import_shd(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool
+auto import_shd(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt, std::pmr::memory_resource* /*memory*/)-> std::optional<ImportedFile>
 {
     if (popt.is_w3e_only) {
-        return true;
+        return std::nullopt;
     }
 
-    const auto extracted_file_data = assmpq::w3m::extract_shd_file(file_data);
+    auto extracted_file_data = assmpq::w3m::extract_shd_file(file_data);
     if (!extracted_file_data.has_value()) {
         spdlog::error("File convertation error: {}", archived_file_path.string());
-        return false;
+        return std::nullopt;
     }
 
     auto output_path = archived_file_path;
     output_path.replace_extension("shd");
-    return import_save(extracted_file_data.value(), output_path, popt);
+    return ImportedFile{ .output_path = output_path, .file_data = std::move(extracted_file_data.value()) };
 }
 
 /**
@@ -134,23 +148,23 @@ auto import_shd(const assmpq::FileData& file_data, const std::filesystem::path&
  * @param file_data The map file data to extract
  * @param archived_file_path The original file path in the archive
  * @param popt Program options
- * @return true if extraction and save was successful, false otherwise
+ * @return Extracted file or std::nullopt if extraction failed or skipped
  */
-auto import_wpm(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool
+auto import_wpm(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt, std::pmr::memory_resource* /*memory*/)-> std::optional<ImportedFile>
 {
     if (popt.is_w3e_only) {
-        return true;
+        return std::nullopt;
     }
 
-    const auto extracted_file_data = assmpq::w3m::extract_wpm_file(file_data);
+    auto extracted_file_data = assmpq::w3m::extract_wpm_file(file_data);
     if (!extracted_file_data.has_value()) {
         spdlog::error("File convertation error: {}", archived_file_path.string());
-        return false;
+        return std::nullopt;
     }
 
     auto output_path = archived_file_path;
     output_path.replace_extension("wpm");
-    return import_save(extracted_file_data.value(), output_path, popt);
+    return ImportedFile{ .output_path = output_path, .file_data = std::move(extracted_file_data.value()) };
 }
 
 /**
@@ -158,23 +172,23 @@ auto import_wpm(const assmpq::FileData& file_data, const std::filesystem::path&
  * @param file_data The map file data to extract
  * @param archived_file_path The original file path in the archive
  * @param popt Program options
- * @return true if extraction and save was successful, false otherwise
+ * @return Extracted file or std::nullopt if extraction failed or skipped
  */
-auto import_doo(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool
+auto import_doo(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt, std::pmr::memory_resource* /*memory*/)-> std::optional<ImportedFile>
 {
     if (popt.is_w3e_only) {
-        return true;
+        return std::nullopt;
     }
 
-    const auto extracted_file_data = assmpq::w3m::extract_doo_file(file_data);
+    auto extracted_file_data = assmpq::w3m::extract_doo_file(file_data);
     if (!extracted_file_data.has_value()) {
         spdlog::error("File convertation error: {}", archived_file_path.string());
-        return false;
+        return std::nullopt;
     }
 
     auto output_path = archived_file_path;
     output_path.replace_extension("doo");
-    return import_save(extracted_file_data.value(), output_path, popt);
+    return ImportedFile{ .output_path = output_path, .file_data = std::move(extracted_file_data.value()) };
 }
 
 } // namespace assmpq::importer
@@ -1,36 +1,101 @@
 #ifndef ASSMPQ_IMPORTER_H_
 #define ASSMPQ_IMPORTER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
 #include "assets_mpq_importer/blp.hpp"
 
 namespace assmpq::importer {
 
+/// @brief Duplicate payload handling mode
+enum class DedupMode : uint8_t {
+    None,       ///< Convert every copy
+    Hardlink,   ///< Hard link duplicates to the first converted copy
+    Symlink,    ///< Symbolic link duplicates to the first converted copy
+    Manifest,   ///< Record duplicates as aliases in the dedup manifest
+};
+
 /// @brief Structure to hold command line options for the MPQ importer
 /// @details Contains all configuration parameters that can be set by the user
 /// through command line arguments
 struct ProgramOptions {
     std::filesystem::path input_mpq_file; ///< Path to the input MPQ archive file
+    std::filesystem::path base_mpq_file;  ///< Path to the previous archive version, only changed files are imported
+    std::vector<std::filesystem::path> patch_mpq_files; ///< Patch archives overriding the input archive, the last one wins
     std::filesystem::path output_folder;   ///< Path to the output folder for extracted files
+    std::filesystem::path pack_file;       ///< Godot PCK file receiving every output instead of the output folder
+    std::filesystem::path mpq_file;        ///< MPQ archive receiving the output folder once the import is done
+    std::filesystem::path dictionary_file; ///< Listfile naming the files of an archive without its own listfile
+    std::filesystem::path index_file;      ///< Sidecar index of the input archive, reused while the archive is unchanged
     std::string pattern;                   ///< File filter pattern for extraction
+    std::string exclude_pattern;           ///< File filter patterns skipped on extraction
+    std::string atlas_pattern;             ///< File filter pattern for BLP textures packed into atlas pages
+    std::string atlas_name = "atlas";      ///< Base name of the atlas pages and UV lookup table
+    uint32_t atlas_size = 2048;            ///< Maximum atlas page width and height
+    uint32_t atlas_padding = 4;            ///< Extruded border around every atlas sprite
     assmpq::blp::Compression compression = assmpq::blp::Compression::DDS_BC3; ///< DDS compression format
     bool is_nvtt = false;                 ///< Flag to use Nvidia Texture Tools compressor
     bool is_dds = false;                  ///< Flag to convert BLP textures to DDS format
     bool is_regen_mipmaps = true;          ///< Flag to regenerate mipmaps from first level
     bool is_extract = false;                ///< Flag to extract files without conversion
     bool is_w3e_only = true;                ///< Flag to extract files without conversion
+    DedupMode dedup = DedupMode::None;      ///< Identical payload deduplication mode
+    bool is_force = false;                  ///< Flag to ignore the import cache and convert everything
+    bool is_verify = false;                 ///< Flag to verify the archive checksums before importing
     bool is_verbose = false;                ///< Flag to enable verbose output
 };
 
-using  import_func_t = bool(*)(const assmpq::FileData&, const std::filesystem::path&, const ProgramOptions&);
+/// @brief Converted file ready to be saved
+struct ImportedFile {
+    std::filesystem::path output_path;     ///< Path relative to the output folder
+    assmpq::FileData file_data;            ///< Converted file content
+};
+
+/**
+ * @brief Monotonic arena for the temporaries of one conversion job
+ * @details Owned by the thread converting the files and reset before every job. Allocations are
+ * bumped out of a block reserved once, so decoding and encoding a file neither contend on the
+ * global allocator nor fault in fresh pages. A job outgrowing the block spills to the heap until
+ * the next reset. Converted files outlive the job and are never allocated from the arena.
+ */
+class JobArena {
+public:
+    static constexpr size_t kDefaultCapacity = 64ULL * 1024 * 1024;
+
+    /// @brief Reserve the block, its pages are touched only once a job needs them
+    explicit JobArena(size_t capacity = kDefaultCapacity);
+
+    JobArena(const JobArena&) = delete;
+    JobArena(JobArena&&) = delete;
+    auto operator=(const JobArena&)-> JobArena& = delete;
+    auto operator=(JobArena&&)-> JobArena& = delete;
+    ~JobArena() = default;
+
+    /// @brief Resource handed to the conversion functions
+    [[nodiscard]] auto resource() noexcept-> std::pmr::memory_resource* { return &arena_; }
+
+    /// @brief Drop every allocation of the previous job, the reserved block is kept
+    void reset() noexcept { arena_.release(); }
+
+private:
+    std::unique_ptr<std::byte[]> block_; // NOLINT(cppcoreguidelines-avoid-c-arrays)
+    std::pmr::monotonic_buffer_resource arena_;
+};
+
+using  import_func_t = std::optional<ImportedFile>(*)(const assmpq::FileData&, const std::filesystem::path&, const ProgramOptions&, std::pmr::memory_resource*);
 
 auto import_save(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool;
-auto import_blp(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool;
-auto import_mdx(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool;
-auto import_w3e(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool;
-auto import_shd(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool;
-auto import_wpm(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool;
-auto import_doo(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt)-> bool;
+auto import_blp(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt, std::pmr::memory_resource* memory)-> std::optional<ImportedFile>;
+auto import_mdx(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt, std::pmr::memory_resource* memory)-> std::optional<ImportedFile>;
+auto import_w3e(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt, std::pmr::memory_resource* memory)-> std::optional<ImportedFile>;
+auto import_shd(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt, std::pmr::memory_resource* memory)-> std::optional<ImportedFile>;
+auto import_wpm(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt, std::pmr::memory_resource* memory)-> std::optional<ImportedFile>;
+auto import_doo(const assmpq::FileData& file_data, const std::filesystem::path& archived_file_path, const ProgramOptions& popt, std::pmr::memory_resource* memory)-> std::optional<ImportedFile>;
 
 } // namespace assmpq::importer
 
@@ -1,5 +1,10 @@
 #include <exception>
 #include <filesystem>
+#include <optional>
+#include <ranges>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
 #include <fmt/base.h>
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
@@ -7,7 +12,14 @@
 
 #include <internal_use_only/config.hpp>
 #include "assets_mpq_importer/mpq.hpp"
+#include "assets_mpq_importer/glob.hpp"
 #include "importer.hpp"
+#include "atlas.hpp"
+#include "dedup.hpp"
+#include "cache.hpp"
+#include "writer.hpp"
+#include "pack.hpp"
+#include "mpq_output.hpp"
 
 using assmpq::importer::import_blp;
 using assmpq::importer::import_mdx;
@@ -15,6 +27,19 @@ using assmpq::importer::import_w3e;
 using assmpq::importer::import_shd;
 using assmpq::importer::import_wpm;
 using assmpq::importer::import_doo;
+using assmpq::importer::import_atlas;
+using assmpq::importer::make_content_hash;
+using assmpq::importer::make_file_content_hash;
+using assmpq::importer::make_content_key;
+using assmpq::importer::make_duplicate_path;
+using assmpq::importer::CachedImport;
+using assmpq::importer::CachedOutput;
+using assmpq::importer::ImportCache;
+using assmpq::importer::OutputWriter;
+using assmpq::importer::PackWriter;
+using assmpq::importer::DedupIndex;
+using assmpq::importer::DedupMode;
+using assmpq::importer::JobArena;
 
 auto main(int argc, char* argv[])-> int
 {
@@ -23,6 +48,8 @@ auto main(int argc, char* argv[])-> int
             "{} version {} importer\n"
             "* Extract and convert files from MPQ archive.\n"
             "* Convert MDX meshes to Wavefront OBJ, convert BLP textures to PNG or DDS(BC1,BC3,BC7) with mipmaps.\n"
+            "* Pack small BLP textures into atlas pages with a UV lookup table.\n"
+            "* Write every output into a single Godot PCK file.\n"
             "* Extract and save w3e map files.\n",
             assets_mpq_importer::cmake::project_name, assets_mpq_importer::cmake::project_version);
 
@@ -33,9 +60,28 @@ auto main(int argc, char* argv[])-> int
         app.add_option("-i,--input", popt.input_mpq_file, "Input MPQ archive file name.")
             ->required()
             ->check(CLI::ExistingFile);
+        auto* base_option = app.add_option("-b,--base", popt.base_mpq_file, "Previous MPQ archive version. Import only files added or changed since it.")
+            ->check(CLI::ExistingFile);
         app.add_option("-o,--output", popt.output_folder, "Output folder.")
             ->check(CLI::ExistingDirectory);
-        app.add_option("-f,--filter", popt.pattern, "File extraction filter.");
+        auto* pack_option = app.add_option("-p,--pack", popt.pack_file, "Write every output into a single Godot PCK file instead of the output folder.");
+        app.add_option("--mpq", popt.mpq_file, "Pack the output folder into a new MPQ archive once the import is done.")
+            ->excludes(pack_option);
+        app.add_option("--dictionary", popt.dictionary_file, "Listfile naming the files of an archive without one, indexed once into <file>.idx.")
+            ->check(CLI::ExistingFile);
+        auto* index_option = app.add_option("--index", popt.index_file, "Sidecar index of the input archive. Rebuilt when the archive changes, lists files without opening it otherwise.");
+        app.add_option("--patch", popt.patch_mpq_files, "Patch archive overriding the input archive and the patches given before it, may be repeated. Only the winning copy of a file is imported.")
+            ->check(CLI::ExistingFile)
+            ->excludes(base_option)
+            ->excludes(index_option);
+        app.add_option("-f,--filter", popt.pattern, "File extraction filter, glob patterns separated by ';', '!' excludes.");
+        app.add_option("-x,--exclude", popt.exclude_pattern, "Skip files matching the glob patterns separated by ';'.");
+        app.add_option("--atlas", popt.atlas_pattern, "Pack BLP textures matching the filter into atlas pages.");
+        app.add_option("--atlas-name", popt.atlas_name, "Atlas pages and UV table base name, 'atlas' by default.");
+        app.add_option("--atlas-size", popt.atlas_size, "Maximum atlas page size, 2048 by default.")
+            ->check(CLI::Range(64U, 16384U));
+        app.add_option("--atlas-padding", popt.atlas_padding, "Extruded border around atlas sprites, 4 by default.")
+            ->check(CLI::Range(0U, 64U));
 
         static const std::map<std::string, assmpq::blp::Compression> compression_map = {
             { "bc1", assmpq::blp::Compression::DDS_BC1 },
@@ -51,56 +97,358 @@ auto main(int argc, char* argv[])-> int
         app.add_flag("-d,--dds", popt.is_dds, "Convert BLP textures to DDS format. Convert to PNG if not present.");
         app.add_flag("-e,--extract", popt.is_extract, "Don't convert the files. Just extract everything.");
         app.add_flag("-w,--w3e", popt.is_w3e_only, "Extract w3e map files only from w3m/w3x maps.");
+
+        static const std::map<std::string, DedupMode> dedup_map = {
+            { "none", DedupMode::None },
+            { "hardlink", DedupMode::Hardlink },
+            { "symlink", DedupMode::Symlink },
+            { "manifest", DedupMode::Manifest }
+        };
+        app.add_option("--dedup", popt.dedup, "Convert identical files once, store copies as hardlink, symlink or manifest alias. None by default.")
+            ->transform(CLI::CheckedTransformer(dedup_map, CLI::ignore_case))
+            ->default_val("none");
+
+        app.add_flag("--force", popt.is_force, "Ignore the import cache and convert every file again.");
+        app.add_flag("--verify", popt.is_verify, "Verify the archive checksums before importing, stop at the first corrupted file.");
         app.add_flag("--verbose", popt.is_verbose, "Enable verbose output.");
 
         CLI11_PARSE(app, argc, argv);
 
+        // Excludes are compiled together with the filter
+        for (const auto exclude : std::views::split(popt.exclude_pattern, ';')) {
+            if (!exclude.empty()) {
+                popt.pattern += fmt::format(";!{}", std::string_view(exclude));
+            }
+        }
+
+        for (const auto& pattern : { popt.pattern, popt.atlas_pattern }) {
+            if (const auto filter = assmpq::mpq::GlobFilter::compile(pattern); !filter.has_value()) {
+                spdlog::error("Filter error: {}", filter.error());
+                return 1;
+            }
+        }
+
         spdlog::info("MPQ archive: {}", popt.input_mpq_file.string());
 
-        const auto list_files = assmpq::mpq::list_mpq_files(popt.input_mpq_file, popt.pattern);
-        if (!list_files.has_value()) {
-            spdlog::error("Error extracting list file from MPQ archive: {}", list_files.error());
-            return 1;
+        std::filesystem::path dictionary_index;
+        if (!popt.dictionary_file.empty()) {
+            dictionary_index = popt.dictionary_file;
+            dictionary_index += ".idx";
+
+            // The index is rebuilt only when the listfile is newer than it
+            std::error_code error;
+            const auto index_time = std::filesystem::last_write_time(dictionary_index, error);
+            if (error || index_time < std::filesystem::last_write_time(popt.dictionary_file)) {
+                const auto name_count = assmpq::mpq::build_name_dictionary({ popt.dictionary_file }, dictionary_index);
+                if (!name_count.has_value()) {
+                    spdlog::error("Error building name dictionary: {}", name_count.error());
+                    return 1;
+                }
+                spdlog::info("Name dictionary {} built: {} names.", dictionary_index.string(), name_count.value());
+            }
         }
 
-        for (const auto& file : list_files.value()) {
-            spdlog::info("File processing: {}", file.filename);
+        // Patches are listed after the input archive, the last one has the highest priority
+        std::vector<std::filesystem::path> archive_paths { popt.input_mpq_file };
+        archive_paths.insert(archive_paths.end(), popt.patch_mpq_files.begin(), popt.patch_mpq_files.end());
 
-            const auto extracted_file = assmpq::mpq::extract_mpq_file(popt.input_mpq_file, file.filename);
-            if (!extracted_file.has_value()) {
-                spdlog::error("File extraction error: {}", extracted_file.error());
-                continue;
+        if (popt.is_verify) {
+            for (const auto& archive_path : archive_paths) {
+                const auto report = assmpq::mpq::verify_mpq_archive(archive_path, true, dictionary_index);
+                if (!report.has_value()) {
+                    spdlog::error("Error verifying MPQ archive {}: {}", archive_path.string(), report.error());
+                    return 1;
+                }
+
+                for (const auto& failure : report->failures) {
+                    spdlog::error("Corrupted file {}: {}", failure.filename, failure.reason);
+                }
+                if (!report->is_valid()) {
+                    return 1;
+                }
+
+                constexpr double kMegabyte = 1024.0 * 1024.0;
+                spdlog::info("Archive {} verified: {} files, {} checksums, {} without checksums, {} encrypted files of unknown name skipped.",
+                    archive_path.string(), report->verified_count, report->checksum_count, report->unchecked_count, report->skipped_count);
+                spdlog::info("Verified {:.1f} MB in {:.2f} s, {:.1f} MB/s.",
+                    static_cast<double>(report->byte_count) / kMegabyte, report->seconds,
+                    report->seconds > 0.0 ? static_cast<double>(report->byte_count) / kMegabyte / report->seconds : 0.0);
+            }
+        }
+
+        std::optional<assmpq::mpq::ArchiveChain> archive_chain;
+        if (!popt.patch_mpq_files.empty()) {
+            auto opened_chain = assmpq::mpq::ArchiveChain::open(archive_paths, dictionary_index);
+            if (!opened_chain.has_value()) {
+                spdlog::error("Error indexing MPQ archive chain: {}", opened_chain.error());
+                return 1;
+            }
+            archive_chain = std::move(opened_chain.value());
+            spdlog::info("Archive chain of {} archives: {} files, {} overridden copies skipped.",
+                archive_paths.size(), archive_chain->file_count(), archive_chain->overridden_count());
+        }
+
+        std::unordered_set<std::string> changed_files;
+        if (!popt.base_mpq_file.empty()) {
+            const auto archive_diff = assmpq::mpq::diff_mpq_archives(popt.base_mpq_file, popt.input_mpq_file, popt.pattern);
+            if (!archive_diff.has_value()) {
+                spdlog::error("Error comparing MPQ archives: {}", archive_diff.error());
+                return 1;
+            }
+
+            for (const auto& entry : archive_diff.value()) {
+                if (entry.change == assmpq::mpq::FileChange::Removed) {
+                    spdlog::info("File removed: {}", entry.filename);
+                } else {
+                    changed_files.insert(entry.filename);
+                }
+            }
+            spdlog::info("Files changed since {}: {}", popt.base_mpq_file.string(), changed_files.size());
+        }
+
+        std::optional<PackWriter> pack_writer;
+        if (!popt.pack_file.empty()) {
+            pack_writer.emplace(popt.pack_file);
+            if (!pack_writer->is_open()) {
+                return 1;
+            }
+        }
+
+        DedupIndex dedup_index(popt);
+        ImportCache import_cache(popt);
+        OutputWriter output_writer(popt, pack_writer ? &pack_writer.value() : nullptr);
+
+        std::unordered_set<std::string> atlased_files;
+        if (!popt.atlas_pattern.empty() && !popt.is_extract) {
+            atlased_files = import_atlas(popt, archive_chain ? &archive_chain.value() : nullptr, output_writer);
+        }
+
+        // Files are converted on this thread only, one arena serves all of them
+        JobArena job_arena;
+
+        // Outputs of the payloads seen in this run by content key, the cache entry of a duplicate lists its links to them
+        std::unordered_map<std::string, std::vector<CachedOutput>> dedup_outputs;
+
+        // Plain extraction writes every file straight from the archive, without holding it in memory
+        const bool is_streamed_extract = popt.is_extract && popt.dedup == DedupMode::None && !pack_writer.has_value();
+
+        // Files are processed while the archive is still being listed
+        const auto process_file = [&](const assmpq::mpq::FileEntry& file) {
+            if (atlased_files.contains(file.filename)) {
+                return;
+            }
+
+            if (!popt.base_mpq_file.empty() && !changed_files.contains(file.filename)) {
+                return;
             }
 
+            spdlog::info("File processing: {}", file.filename);
+
             auto archived_filename = file.filename;
             std::ranges::replace(archived_filename, '\\', '/');
 
             const std::filesystem::path archived_file_path = archived_filename;
-            if (popt.is_extract) {
-                import_save(extracted_file.value(), archived_file_path, popt);
-                continue;
-            }
-
-            static const std::unordered_map<std::string, std::vector<assmpq::importer::import_func_t>> importers_mapper = {
-                { ".blp", { import_blp }},
-                { ".BLP", { import_blp }},
-                { ".mdx", { import_mdx }},
-                { ".MDX", { import_mdx }},
-                { ".w3m", { import_w3e, import_shd, import_wpm, import_doo }},
-                { ".W3M", { import_w3e, import_shd, import_wpm, import_doo }},
-                { ".w3x", { import_w3e, import_shd, import_wpm, import_doo }},
-                { ".W3X", { import_w3e, import_shd, import_wpm, import_doo }},
+
+            const auto source_key = archive_chain.has_value()
+                ? archive_chain->source_key(file.filename)
+                : assmpq::mpq::mpq_file_source_key(popt.input_mpq_file, file.filename);
+            if (!source_key.has_value()) {
+                spdlog::error("File extraction error: {}", source_key.error());
+                return;
+            }
+
+            // Decided from the archive metadata, an unchanged file is not extracted at all
+            if (const auto* cached_import = import_cache.find_up_to_date(archived_file_path, source_key.value()); cached_import != nullptr) {
+                if (popt.dedup != DedupMode::None && !cached_import->content_hash.empty()) {
+                    const auto content_key = make_content_key(cached_import->content_hash, archived_file_path);
+                    if (dedup_index.find(content_key) == nullptr) {
+                        dedup_index.add(content_key, cached_import->outputs
+                            | std::views::transform(&CachedOutput::output_path)
+                            | std::ranges::to<std::vector<std::filesystem::path>>());
+                        dedup_outputs.try_emplace(content_key, cached_import->outputs);
+                    }
+                }
+
+                spdlog::info("File {} is up to date.", archived_file_path.string());
+                return;
+            }
+
+            if (is_streamed_extract) {
+                const auto output_filename = popt.output_folder / archived_file_path;
+                std::error_code error;
+                std::filesystem::create_directories(output_filename.parent_path(), error);
+
+                const auto written_size = archive_chain.has_value()
+                    ? archive_chain->extract_file_to(file.filename, output_filename)
+                    : assmpq::mpq::extract_mpq_file_to(popt.input_mpq_file, file.filename, output_filename);
+                if (!written_size.has_value()) {
+                    spdlog::error("File extraction error: {}", written_size.error());
+                    return;
+                }
+
+                // The payload never passes through memory, the output is hashed back from the page cache for the next run to validate it
+                auto output_hash = make_file_content_hash(output_filename);
+                CachedImport cached_import{ .source_key = source_key.value(), .content_hash = {}, .outputs = {} };
+                if (output_hash.has_value()) {
+                    cached_import.outputs.push_back(CachedOutput{
+                        .output_path = archived_file_path, .content_hash = std::move(output_hash.value()), .size = written_size.value() });
+                }
+                import_cache.update(archived_file_path, std::move(cached_import));
+
+                spdlog::info("File {} saved.", output_filename.string());
+                return;
+            }
+
+            auto extracted_file = archive_chain.has_value()
+                ? archive_chain->extract_file(file.filename)
+                : assmpq::mpq::extract_mpq_file(popt.input_mpq_file, file.filename);
+            if (!extracted_file.has_value()) {
+                spdlog::error("File extraction error: {}", extracted_file.error());
+                return;
+            }
+
+            const auto content_hash = make_content_hash(extracted_file.value());
+            const auto content_key = make_content_key(content_hash, archived_file_path);
+
+            if (popt.dedup != DedupMode::None) {
+                if (const auto* original_paths = dedup_index.find(content_key); original_paths != nullptr) {
+                    // Queued behind the original outputs, which may not be written yet
+                    if (pack_writer.has_value()) {
+                        output_writer.post([&pack_writer, original_paths = *original_paths, archived_file_path] {
+                            for (const auto& original_path : original_paths) {
+                                pack_writer->add_alias(make_duplicate_path(original_path, archived_file_path), original_path);
+                            }
+                        });
+                    } else {
+                        output_writer.post([&dedup_index, original_paths = *original_paths, archived_file_path] {
+                            dedup_index.link_duplicate(original_paths, archived_file_path);
+                        });
+                    }
+
+                    // Originals imported by an earlier run are hashed back from the output folder
+                    std::vector<CachedOutput> linked_outputs;
+                    const auto imported_outputs = dedup_outputs.find(content_key);
+                    for (const auto& original_path : *original_paths) {
+                        CachedOutput linked_output{ .output_path = make_duplicate_path(original_path, archived_file_path), .content_hash = {}, .size = 0 };
+                        if (imported_outputs != dedup_outputs.end()) {
+                            const auto original = std::ranges::find(imported_outputs->second, original_path, &CachedOutput::output_path);
+                            if (original != imported_outputs->second.end()) {
+                                linked_output.content_hash = original->content_hash;
+                                linked_output.size = original->size;
+                            }
+                        }
+                        if (linked_output.content_hash.empty()) {
+                            std::error_code error;
+                            const auto original_file = popt.output_folder / original_path;
+                            auto original_hash = make_file_content_hash(original_file);
+                            linked_output.size = std::filesystem::file_size(original_file, error);
+                            if (!original_hash.has_value() || error) {
+                                linked_outputs.clear();
+                                break;
+                            }
+                            linked_output.content_hash = std::move(original_hash.value());
+                        }
+                        linked_outputs.push_back(std::move(linked_output));
+                    }
+                    import_cache.update(archived_file_path, CachedImport{
+                        .source_key = source_key.value(), .content_hash = content_hash, .outputs = std::move(linked_outputs) });
+                    return;
+                }
+            }
+
+            std::vector<std::filesystem::path> saved_paths;
+            std::vector<CachedOutput> cached_outputs;
+            // Outputs are recorded before they hit the disk, a failed write leaves a size
+            // mismatch which invalidates the cache entry on the next run
+            const auto save_output = [&](assmpq::FileData file_data, const std::filesystem::path& output_path) {
+                saved_paths.push_back(output_path);
+                cached_outputs.push_back(CachedOutput{
+                    .output_path = output_path,
+                    .content_hash = make_content_hash(file_data),
+                    .size = file_data.size() });
+                output_writer.write(output_path, std::move(file_data));
             };
 
-            if (!importers_mapper.contains(archived_file_path.extension().string())) {
-                spdlog::warn("Importer not found for extension: {}", archived_file_path.extension().string());
-                continue;
+            if (popt.is_extract) {
+                save_output(std::move(extracted_file.value()), archived_file_path);
+            } else {
+                static const std::unordered_map<std::string, std::vector<assmpq::importer::import_func_t>> importers_mapper = {
+                    { ".blp", { import_blp }},
+                    { ".BLP", { import_blp }},
+                    { ".mdx", { import_mdx }},
+                    { ".MDX", { import_mdx }},
+                    { ".w3m", { import_w3e, import_shd, import_wpm, import_doo }},
+                    { ".W3M", { import_w3e, import_shd, import_wpm, import_doo }},
+                    { ".w3x", { import_w3e, import_shd, import_wpm, import_doo }},
+                    { ".W3X", { import_w3e, import_shd, import_wpm, import_doo }},
+                };
+
+                if (!importers_mapper.contains(archived_file_path.extension().string())) {
+                    spdlog::warn("Importer not found for extension: {}", archived_file_path.extension().string());
+                    return;
+                }
+
+                // The temporaries of the previous file are dropped at once, the outputs are not in the arena
+                job_arena.reset();
+
+                const auto& coverterters = importers_mapper.at(archived_file_path.extension().string());
+                for(const auto& coverter_fn : coverterters) {
+                    auto imported_file = coverter_fn(extracted_file.value(), archived_file_path, popt, job_arena.resource());
+                    if (imported_file.has_value()) {
+                        save_output(std::move(imported_file->file_data), imported_file->output_path);
+                    }
+                }
+            }
+
+            if (popt.dedup != DedupMode::None && !saved_paths.empty()) {
+                dedup_index.add(content_key, std::move(saved_paths));
+                dedup_outputs.insert_or_assign(content_key, cached_outputs);
+            }
+            import_cache.update(archived_file_path, CachedImport{
+                .source_key = source_key.value(), .content_hash = content_hash, .outputs = std::move(cached_outputs) });
+        };
+
+        // A patch chain visits the winning copy of every file only
+        auto processed_count = archive_chain.has_value()
+            ? archive_chain->for_each_file(process_file, popt.pattern)
+            : popt.index_file.empty()
+                ? assmpq::mpq::for_each_mpq_file(popt.input_mpq_file, process_file, popt.pattern, false, dictionary_index)
+                : assmpq::mpq::for_each_mpq_sidecar_file(popt.input_mpq_file, popt.index_file, process_file, popt.pattern);
+        if (!popt.index_file.empty() && !processed_count.has_value()) {
+            // A missing or stale sidecar fails before visiting any file, so it is rebuilt and walked again
+            spdlog::info("Sidecar index {} rebuilt: {}", popt.index_file.string(), processed_count.error());
+            if (const auto indexed_count = assmpq::mpq::write_mpq_sidecar(popt.input_mpq_file, popt.index_file, dictionary_index); !indexed_count.has_value()) {
+                spdlog::error("Error writing sidecar index: {}", indexed_count.error());
+                return 1;
             }
+            processed_count = assmpq::mpq::for_each_mpq_sidecar_file(popt.input_mpq_file, popt.index_file, process_file, popt.pattern);
+        }
+        if (!processed_count.has_value()) {
+            spdlog::error("Error extracting list file from MPQ archive: {}", processed_count.error());
+            return 1;
+        }
+
+        if (const auto failed_writes = output_writer.flush(); failed_writes > 0) {
+            spdlog::error("Files failed to write: {}", failed_writes);
+        }
+
+        if (pack_writer.has_value()) {
+            return pack_writer->finish() ? 0 : 1;
+        }
+
+        import_cache.save();
+
+        if (popt.dedup != DedupMode::None) {
+            dedup_index.save();
+        }
 
-            auto coverterters = importers_mapper.at(archived_file_path.extension().string());
-            for(const auto& coverter_fn : coverterters) {
-                coverter_fn(extracted_file.value(), archived_file_path, popt);
+        if (!popt.mpq_file.empty()) {
+            const auto file_count = write_output_mpq(popt);
+            if (!file_count.has_value()) {
+                spdlog::error("MPQ write error: {}", file_count.error());
+                return 1;
             }
+            spdlog::info("MPQ {} saved: {} files.", popt.mpq_file.string(), file_count.value());
         }
     } catch (const std::exception &e) {
         spdlog::error("Unhandled exception in main: {}", e.what());
@@ -0,0 +1,79 @@
+#include <format>
+#include <fstream>
+#include <system_error>
+#include <utility>
+
+#include <assets_mpq_importer/mpq.hpp>
+#include "cache.hpp"
+#include "dedup.hpp"
+#include "mpq_output.hpp"
+
+namespace assmpq::importer {
+
+namespace {
+
+// Formats which are compressed already are stored as they are
+constexpr auto kStoredFilesMask = "*.png;*.jpg;*.blp;*.mp3;*.ogg;*.wav";
+
+auto read_output_file(const std::filesystem::path& file_path)-> std::expected<assmpq::FileData, assmpq::ErrorMessage>
+{
+    std::error_code error;
+    const auto file_size = std::filesystem::file_size(file_path, error);
+    std::ifstream input_file(file_path, std::ios::in | std::ios::binary);
+    if (error || !input_file.is_open()) {
+        return std::unexpected(std::format("File read error: {}", file_path.string()));
+    }
+
+    assmpq::FileData file_data(static_cast<size_t>(file_size));
+    input_file.read(file_data.data(), static_cast<std::streamsize>(file_data.size()));
+    if (input_file.fail()) {
+        return std::unexpected(std::format("File read error: {}", file_path.string()));
+    }
+    return file_data;
+}
+
+} // namespace
+
+auto write_output_mpq(const ProgramOptions& popt)-> std::expected<size_t, assmpq::ErrorMessage>
+{
+    std::error_code error;
+    const auto mpq_file = std::filesystem::weakly_canonical(popt.mpq_file, error);
+
+    const assmpq::mpq::ArchiveWriteOptions options {
+        .compression_rules = { { .mask = kStoredFilesMask, .compression = assmpq::mpq::FileCompression::None } },
+    };
+    auto writer = assmpq::mpq::ArchiveWriter::open(popt.mpq_file, options);
+    if (!writer.has_value()) {
+        return std::unexpected(writer.error());
+    }
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(popt.output_folder, error)) {
+        if (!entry.is_regular_file(error)) {
+            continue;
+        }
+
+        // The importer bookkeeping and the archive itself stay out of the archive
+        const auto& file_path = entry.path();
+        if ((file_path.parent_path() == popt.output_folder &&
+                (file_path.filename() == kImportCacheFilename || file_path.filename() == kDedupIndexFilename)) ||
+            std::filesystem::weakly_canonical(file_path, error) == mpq_file) {
+            continue;
+        }
+
+        auto file_data = read_output_file(file_path);
+        if (!file_data.has_value()) {
+            return std::unexpected(file_data.error());
+        }
+        auto added = writer->add({ .filename = file_path.lexically_relative(popt.output_folder).generic_string(), .data = std::move(file_data.value()) });
+        if (!added.has_value()) {
+            return std::unexpected(added.error());
+        }
+    }
+    if (error) {
+        return std::unexpected(std::format("Output folder read error: {}", error.message()));
+    }
+
+    return writer->finish();
+}
+
+} // namespace assmpq::importer
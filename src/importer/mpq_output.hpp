@@ -0,0 +1,24 @@
+#ifndef ASSMPQ_IMPORTER_MPQ_OUTPUT_H_
+#define ASSMPQ_IMPORTER_MPQ_OUTPUT_H_
+
+#include <cstddef>
+#include <expected>
+
+#include "importer.hpp"
+
+namespace assmpq::importer {
+
+/**
+ * @brief Pack the output folder into an MPQ archive
+ * @details Every file below the output folder is stored under its relative path, except
+ * the import cache and the dedup manifest. Files are read and handed to the archive writer
+ * one at a time, so the output folder is never held in memory as a whole. Already compressed
+ * formats (PNG, JPEG, BLP and sounds) are stored as they are, everything else is deflated.
+ * @param popt Program options containing the output folder and the MPQ file
+ * @return Expected containing the number of stored files or an error message
+ */
+auto write_output_mpq(const ProgramOptions& popt)-> std::expected<size_t, assmpq::ErrorMessage>;
+
+} // namespace assmpq::importer
+
+#endif  /// ASSMPQ_IMPORTER_MPQ_OUTPUT_H_
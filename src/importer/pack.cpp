@@ -0,0 +1,187 @@
+#include <fstream>
+#include <span>
+#include <system_error>
+#include <utility>
+#include <spdlog/spdlog.h>
+
+#include <assets_mpq_importer/mpq.hpp>
+#include "pack.hpp"
+
+namespace assmpq::importer {
+
+namespace {
+
+constexpr uint32_t kPackMagic = 0x43504447;    // "GDPC"
+constexpr uint32_t kPackFormatVersion = 2;
+// Oldest engine version reading the format, newer 4.x releases accept it as well
+constexpr uint32_t kEngineVersionMajor = 4;
+constexpr uint32_t kEngineVersionMinor = 0;
+constexpr uint32_t kEngineVersionPatch = 0;
+constexpr uint32_t kReservedFields = 16;
+constexpr uint64_t kAlignment = 16;
+
+constexpr auto kResourcePrefix = "res://";
+
+void put_u32(assmpq::FileData& buffer, uint32_t value)
+{
+    for (size_t idx = 0; idx < sizeof(value); ++idx) {
+        buffer.push_back(static_cast<char>(value >> (8 * idx)));
+    }
+}
+
+void put_u64(assmpq::FileData& buffer, uint64_t value)
+{
+    for (size_t idx = 0; idx < sizeof(value); ++idx) {
+        buffer.push_back(static_cast<char>(value >> (8 * idx)));
+    }
+}
+
+auto align_up(uint64_t value)-> uint64_t
+{
+    return (value + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+} // namespace
+
+PackWriter::PackWriter(std::filesystem::path pack_file)
+    : pack_file_(std::move(pack_file))
+{
+    data_file_ = pack_file_;
+    data_file_ += ".tmp";
+    data_stream_.open(data_file_, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!data_stream_) {
+        spdlog::error("File write error: {}", data_file_.string());
+    }
+}
+
+PackWriter::~PackWriter()
+{
+    if (!is_finished_) {
+        data_stream_.close();
+        std::error_code error;
+        std::filesystem::remove(data_file_, error);
+    }
+}
+
+auto PackWriter::is_open() const-> bool
+{
+    return data_stream_.is_open();
+}
+
+auto PackWriter::add(const std::filesystem::path& output_path, const assmpq::FileData& file_data)-> bool
+{
+    const uint64_t offset = align_up(data_size_);
+    static constexpr std::array<char, kAlignment> kZeroPadding {};
+    data_stream_.write(kZeroPadding.data(), static_cast<std::streamsize>(offset - data_size_));
+    data_stream_.write(file_data.data(), static_cast<std::streamsize>(file_data.size()));
+    if (!data_stream_) {
+        spdlog::error("Pack write error: {}", output_path.string());
+        return false;
+    }
+    data_size_ = offset + file_data.size();
+
+    upsert_entry(PackEntry{
+        .path = kResourcePrefix + output_path.generic_string(),
+        .offset = offset,
+        .size = file_data.size(),
+        .md5 = assmpq::mpq::md5_digest(file_data) });
+
+    spdlog::info("File {} packed.", output_path.string());
+
+    return true;
+}
+
+auto PackWriter::add_alias(const std::filesystem::path& alias_path, const std::filesystem::path& original_path)-> bool
+{
+    const auto original = entry_index_.find(kResourcePrefix + original_path.generic_string());
+    if (original == entry_index_.end()) {
+        spdlog::error("Pack alias error: {} is not packed.", original_path.string());
+        return false;
+    }
+
+    auto alias = entries_[original->second];
+    alias.path = kResourcePrefix + alias_path.generic_string();
+    upsert_entry(std::move(alias));
+
+    spdlog::info("File {} aliased to {}.", alias_path.string(), original_path.string());
+
+    return true;
+}
+
+auto PackWriter::finish()-> bool
+{
+    data_stream_.close();
+    if (data_stream_.fail()) {
+        spdlog::error("File write error: {}", data_file_.string());
+        return false;
+    }
+
+    assmpq::FileData header;
+    put_u32(header, kPackMagic);
+    put_u32(header, kPackFormatVersion);
+    put_u32(header, kEngineVersionMajor);
+    put_u32(header, kEngineVersionMinor);
+    put_u32(header, kEngineVersionPatch);
+    put_u32(header, 0); // pack flags
+
+    const size_t file_base_pos = header.size();
+    put_u64(header, 0); // file base, patched once the directory size is known
+    for (uint32_t idx = 0; idx < kReservedFields; ++idx) {
+        put_u32(header, 0);
+    }
+    put_u32(header, static_cast<uint32_t>(entries_.size()));
+
+    for (const auto& entry : entries_) {
+        // Path lengths are padded to 4 bytes with zeros
+        const size_t padded_length = (entry.path.size() + 3) & ~size_t { 3 };
+        put_u32(header, static_cast<uint32_t>(padded_length));
+        header.insert(header.end(), entry.path.begin(), entry.path.end());
+        header.resize(header.size() + (padded_length - entry.path.size()), 0);
+        put_u64(header, entry.offset);
+        put_u64(header, entry.size);
+        header.insert(header.end(), entry.md5.begin(), entry.md5.end());
+        put_u32(header, 0); // file flags
+    }
+
+    const uint64_t file_base = align_up(header.size());
+    header.resize(file_base, 0);
+    for (size_t idx = 0; idx < sizeof(file_base); ++idx) {
+        header[file_base_pos + idx] = static_cast<char>(file_base >> (8 * idx));
+    }
+
+    std::ofstream pack_stream(pack_file_, std::ios::out | std::ios::binary | std::ios::trunc);
+    pack_stream.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    std::ifstream data_stream(data_file_, std::ios::in | std::ios::binary);
+    if (data_size_ > 0) {
+        pack_stream << data_stream.rdbuf();
+    }
+    data_stream.close();
+
+    if (!pack_stream) {
+        spdlog::error("File write error: {}", pack_file_.string());
+        return false;
+    }
+    pack_stream.close();
+
+    std::error_code error;
+    std::filesystem::remove(data_file_, error);
+    is_finished_ = true;
+
+    spdlog::info("Pack {} saved: {} files.", pack_file_.string(), entries_.size());
+
+    return true;
+}
+
+void PackWriter::upsert_entry(PackEntry entry)
+{
+    // A path written twice keeps the latest content, the earlier data becomes unreferenced
+    const auto [index, is_inserted] = entry_index_.try_emplace(entry.path, entries_.size());
+    if (is_inserted) {
+        entries_.push_back(std::move(entry));
+    } else {
+        entries_[index->second] = std::move(entry);
+    }
+}
+
+} // namespace assmpq::importer
@@ -0,0 +1,86 @@
+#ifndef ASSMPQ_IMPORTER_PACK_H_
+#define ASSMPQ_IMPORTER_PACK_H_
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "importer.hpp"
+
+namespace assmpq::importer {
+
+/**
+ * @brief Godot 4 PCK (pack format version 2) writer
+ * @details File contents are streamed into a temporary data file as they arrive, every
+ * file starts at a 16 byte boundary. The header and the directory (res:// path, offset,
+ * size and MD5 of every file) are written once all files are known, followed by the data.
+ */
+class PackWriter {
+public:
+    /**
+     * @brief Open the temporary data file next to the pack file
+     * @param pack_file Path of the resulting pack file
+     */
+    explicit PackWriter(std::filesystem::path pack_file);
+    ~PackWriter();
+
+    PackWriter(const PackWriter&) = delete;
+    PackWriter(PackWriter&&) = delete;
+    auto operator=(const PackWriter&)-> PackWriter& = delete;
+    auto operator=(PackWriter&&)-> PackWriter& = delete;
+
+    /**
+     * @brief Check the temporary data file was opened
+     * @return true if files can be added, false otherwise
+     */
+    [[nodiscard]] auto is_open() const-> bool;
+
+    /**
+     * @brief Append a file to the pack
+     * @param output_path Path relative to the pack root, stored as res://output_path
+     * @param file_data File content
+     * @return true if the content was written, false otherwise
+     */
+    auto add(const std::filesystem::path& output_path, const assmpq::FileData& file_data)-> bool;
+
+    /**
+     * @brief Add a directory entry sharing the content of an already added file
+     * @param alias_path Path of the new entry relative to the pack root
+     * @param original_path Path of the added file
+     * @return true if the original file was found, false otherwise
+     */
+    auto add_alias(const std::filesystem::path& alias_path, const std::filesystem::path& original_path)-> bool;
+
+    /**
+     * @brief Write the header, the directory and the data into the pack file
+     * @return true if the pack file was saved successfully, false otherwise
+     */
+    auto finish()-> bool;
+
+private:
+    struct PackEntry {
+        std::string path;
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        std::array<uint8_t, 16> md5 {};
+    };
+
+    void upsert_entry(PackEntry entry);
+
+    std::filesystem::path pack_file_;
+    std::filesystem::path data_file_;
+    std::ofstream data_stream_;
+    uint64_t data_size_ = 0;
+    bool is_finished_ = false;
+    std::vector<PackEntry> entries_;
+    std::unordered_map<std::string, size_t> entry_index_;
+};
+
+} // namespace assmpq::importer
+
+#endif  /// ASSMPQ_IMPORTER_PACK_H_
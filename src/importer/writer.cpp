@@ -0,0 +1,202 @@
+#include <cerrno>
+#include <exception>
+#include <fstream>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "writer.hpp"
+
+namespace assmpq::importer {
+
+// Large DDS outputs get their extents reserved up front to limit fragmentation
+static constexpr size_t kPreallocateThreshold = 1024ULL * 1024;
+
+OutputWriter::OutputWriter(const ProgramOptions& popt, PackWriter* pack_writer, size_t max_pending_bytes)
+    : popt_(popt), pack_writer_(pack_writer), max_pending_bytes_(max_pending_bytes)
+{
+    thread_ = std::thread(&OutputWriter::run, this);
+}
+
+OutputWriter::~OutputWriter()
+{
+    {
+        const std::scoped_lock lock(mutex_);
+        is_stopping_ = true;
+    }
+    queue_cv_.notify_all();
+    thread_.join();
+}
+
+void OutputWriter::write(std::filesystem::path output_path, assmpq::FileData file_data)
+{
+    std::unique_lock lock(mutex_);
+
+    // A single file larger than the limit still passes once the queue is empty
+    space_cv_.wait(lock, [this, &file_data] {
+        return pending_bytes_ == 0 || pending_bytes_ + file_data.size() <= max_pending_bytes_;
+    });
+
+    pending_bytes_ += file_data.size();
+    queue_.push_back(OutputTask{ .output_path = std::move(output_path), .file_data = std::move(file_data), .action = {} });
+    lock.unlock();
+
+    queue_cv_.notify_one();
+}
+
+void OutputWriter::post(std::function<void()> action)
+{
+    {
+        const std::scoped_lock lock(mutex_);
+        queue_.push_back(OutputTask{ .output_path = {}, .file_data = {}, .action = std::move(action) });
+    }
+    queue_cv_.notify_one();
+}
+
+auto OutputWriter::flush()-> size_t
+{
+    std::unique_lock lock(mutex_);
+    space_cv_.wait(lock, [this] { return queue_.empty() && !is_busy_; });
+    return failed_writes_;
+}
+
+void OutputWriter::run()
+{
+    std::vector<OutputTask> batch;
+
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            queue_cv_.wait(lock, [this] { return !queue_.empty() || is_stopping_; });
+            if (queue_.empty()) {
+                return;
+            }
+
+            // Take everything queued so far, producers are locked out once per batch
+            batch.assign(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.end()));
+            queue_.clear();
+            is_busy_ = true;
+        }
+
+        size_t batch_failed = 0;
+        size_t batch_bytes = 0;
+        for (const auto& task : batch) {
+            if (task.action) {
+                try {
+                    task.action();
+                } catch (const std::exception& e) {
+                    spdlog::error("Output task error: {}", e.what());
+                }
+                continue;
+            }
+
+            batch_bytes += task.file_data.size();
+            if (!write_file(task)) {
+                ++batch_failed;
+            }
+        }
+        batch.clear();
+
+        {
+            const std::scoped_lock lock(mutex_);
+            pending_bytes_ -= batch_bytes;
+            failed_writes_ += batch_failed;
+            is_busy_ = false;
+        }
+        space_cv_.notify_all();
+    }
+}
+
+auto OutputWriter::ensure_directory(const std::filesystem::path& directory)-> bool
+{
+    if (directory.empty() || created_directories_.contains(directory.string())) {
+        return true;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        spdlog::error("Directory create error: {} {}", directory.string(), error.message());
+        return false;
+    }
+
+    created_directories_.insert(directory.string());
+    return true;
+}
+
+auto OutputWriter::write_file(const OutputTask& task)-> bool
+{
+    if (pack_writer_ != nullptr) {
+        return pack_writer_->add(task.output_path, task.file_data);
+    }
+
+    const auto output_filename = popt_.output_folder / task.output_path;
+    if (!ensure_directory(output_filename.parent_path())) {
+        return false;
+    }
+
+    // A dedup hard link or symlink left by a previous run is replaced, not written through to the file it shares
+    std::error_code error;
+    std::filesystem::remove(output_filename, error);
+    if (error) {
+        spdlog::error("File write error: {} {}", output_filename.string(), error.message());
+        return false;
+    }
+
+#if defined(__linux__)
+    const int output_fd = ::open(output_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (output_fd < 0) {
+        spdlog::error("File write error: {}", output_filename.string());
+        return false;
+    }
+
+    if (task.file_data.size() >= kPreallocateThreshold) {
+        // Best effort, unsupported filesystems just skip the reservation
+        ::posix_fallocate(output_fd, 0, static_cast<off_t>(task.file_data.size()));
+    }
+
+    const char* data_ptr = task.file_data.data();
+    size_t bytes_left = task.file_data.size();
+    while (bytes_left > 0) {
+        const ssize_t written = ::write(output_fd, data_ptr, bytes_left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        data_ptr += written; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        bytes_left -= static_cast<size_t>(written);
+    }
+
+    const bool is_closed = ::close(output_fd) == 0;
+    if (bytes_left > 0 || !is_closed) {
+        spdlog::error("File write error: {}", output_filename.string());
+        return false;
+    }
+#else
+    std::ofstream output_file(output_filename, std::ios::out | std::ios::binary);
+    if (!output_file) {
+        spdlog::error("File write error: {}", output_filename.string());
+        return false;
+    }
+
+    output_file.write(task.file_data.data(), static_cast<std::streamsize>(task.file_data.size()));
+    if (!output_file) {
+        spdlog::error("File write error: {}", output_filename.string());
+        return false;
+    }
+#endif
+
+    spdlog::info("File {} saved.", output_filename.string());
+
+    return true;
+}
+
+} // namespace assmpq::importer
@@ -0,0 +1,96 @@
+#ifndef ASSMPQ_IMPORTER_WRITER_H_
+#define ASSMPQ_IMPORTER_WRITER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include "importer.hpp"
+#include "pack.hpp"
+
+namespace assmpq::importer {
+
+/**
+ * @brief Asynchronous output writer
+ * @details Owns a dedicated I/O thread which drains queued writes in batches, so conversion
+ * never waits for the disk unless the pending data exceeds the memory limit. Created
+ * directories are cached and large files are preallocated where the platform allows it.
+ * When a pack writer is given, files are appended to the pack instead of the output folder.
+ * Tasks are executed in the order they were queued.
+ */
+class OutputWriter {
+public:
+    static constexpr size_t kDefaultMaxPendingBytes = 256ULL * 1024 * 1024;
+
+    /**
+     * @brief Start the writer thread
+     * @param popt Program options containing the output folder
+     * @param pack_writer Pack receiving the files instead of the output folder, may be nullptr
+     * @param max_pending_bytes Queued data limit, producers block while it is exceeded
+     */
+    explicit OutputWriter(const ProgramOptions& popt, PackWriter* pack_writer = nullptr, size_t max_pending_bytes = kDefaultMaxPendingBytes);
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter(OutputWriter&&) = delete;
+    auto operator=(const OutputWriter&)-> OutputWriter& = delete;
+    auto operator=(OutputWriter&&)-> OutputWriter& = delete;
+
+    /**
+     * @brief Queue a file write
+     * @param output_path Path relative to the output folder
+     * @param file_data File content, moved into the queue
+     */
+    void write(std::filesystem::path output_path, assmpq::FileData file_data);
+
+    /**
+     * @brief Queue an action executed on the writer thread after all previously queued tasks
+     * @param action Action to execute
+     */
+    void post(std::function<void()> action);
+
+    /**
+     * @brief Wait until every queued task is done
+     * @return Number of failed writes since the writer was started
+     */
+    auto flush()-> size_t;
+
+private:
+    struct OutputTask {
+        std::filesystem::path output_path;
+        assmpq::FileData file_data;
+        std::function<void()> action;
+    };
+
+    void run();
+    auto write_file(const OutputTask& task)-> bool;
+    auto ensure_directory(const std::filesystem::path& directory)-> bool;
+
+    const ProgramOptions& popt_;
+    PackWriter* pack_writer_;
+    const size_t max_pending_bytes_;
+
+    std::mutex mutex_;
+    std::condition_variable queue_cv_;
+    std::condition_variable space_cv_;
+    std::deque<OutputTask> queue_;
+    size_t pending_bytes_ = 0;
+    size_t failed_writes_ = 0;
+    bool is_busy_ = false;
+    bool is_stopping_ = false;
+
+    // Touched by the writer thread only
+    std::unordered_set<std::string> created_directories_;
+
+    std::thread thread_;
+};
+
+} // namespace assmpq::importer
+
+#endif  /// ASSMPQ_IMPORTER_WRITER_H_
@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <expected>
+#include <memory>
+#include <span>
 #include <spanstream>
 #include <spdlog/spdlog.h>
 #include <mdlx/mdlx.hpp>
@@ -128,12 +130,15 @@ static void process_scene(const wc3lib::mdlx::Mdlx& model, aiScene& scene, const
 }
 // NOLINTEND(cppcoreguidelines-owning-memory, cppcoreguidelines-pro-bounds-pointer-arithmetic, cppcoreguidelines-pro-bounds-constant-array-index)
 
-auto convert_mdlx_to_obj_mesh(const std::string& mesh_name, const FileData& mdx_file)-> std::expected<FileData, ErrorMessage>
+auto convert_mdlx_to_obj_mesh(
+    const std::string& mesh_name,
+    std::span<const std::byte> mdx_file
+)-> std::expected<FileData, ErrorMessage>
 {
 	wc3lib::mdlx::Mdlx model;
 
     try {
-        std::ispanstream input(mdx_file);
+        std::ispanstream input(as_chars(mdx_file));
         model.read(input);
 
     	aiScene scene;
@@ -141,19 +146,25 @@ auto convert_mdlx_to_obj_mesh(const std::string& mesh_name, const FileData& mdx_
         process_scene(model, scene, mesh_name);
 
         Assimp::Exporter exporter;
-        const aiExportDataBlob* blob = exporter.ExportToBlob(&scene, "obj");
-        if (blob == nullptr) {
+        if (exporter.ExportToBlob(&scene, "obj") == nullptr) {
             return std::unexpected(std::format("Error exporting scene: {}", exporter.GetErrorString()));
         }
 
-        std::vector<char> output_buffer(blob->size);
-        std::ospanstream output(output_buffer, std::ios::out | std::ios::binary);
-        output.write(static_cast<const char*>(blob->data), static_cast<std::streamsize>(blob->size));
-
-        return output_buffer;
+        // The exported blob is adopted, the mesh is not copied out of it
+        std::unique_ptr<const aiExportDataBlob> blob(exporter.GetOrphanedBlob());
+        const std::span<char> blob_data(static_cast<char*>(blob->data), blob->size);
+        return FileData::adopt(blob_data, std::move(blob));
     } catch (std::exception &e) {
         return std::unexpected(e.what());
 	}
 }
 
+auto convert_mdlx_to_obj_mesh(
+    const std::string& mesh_name,
+    const FileData& mdx_file
+)-> std::expected<FileData, ErrorMessage>
+{
+    return convert_mdlx_to_obj_mesh(mesh_name, std::as_bytes(std::span(mdx_file)));
+}
+
 } // namespace assmpq::mdlx
@@ -17,6 +17,7 @@
 #include <regex>
 
 #include <internal_use_only/config.hpp>
+#include "assets_mpq_importer/glob.hpp"
 #include "merger.hpp"
 
 /**
@@ -29,6 +30,7 @@ struct ProgramOptions {
     std::filesystem::path input_folder;  ///< Input directory with cliff/ramp obj meshes
     std::filesystem::path output_folder;   ///< Output folder for merged meshes and JSON files
     std::string filename_pattern;         ///< Regex template for mesh filenames
+    std::string file_filter;              ///< Glob patterns selecting the input mesh files
     std::string geoset_name;              ///< Input geoset name
     std::optional<float> scale_factor;     ///< Optional mesh scale factor
     bool is_append = false;               ///< Append keys to existing JSON file
@@ -145,6 +147,7 @@ auto main(int argc, char* argv[])-> int
 
         app.add_option("-p,--pattern", popt.filename_pattern, "Regex template for mesh filenames. "
             "Used to obtain a filename key part: CityCliffsBABC0.mdx -> BABC0.");
+        app.add_option("-f,--filter", popt.file_filter, "Input mesh files filter, glob patterns separated by ';', '!' excludes.");
         app.add_option("-n,--name", popt.geoset_name, "Output geoset name.");
 
         app.add_option("-s,--scale", popt.scale_factor, "Mesh scale factor.");
@@ -182,9 +185,18 @@ auto main(int argc, char* argv[])-> int
         const std::regex match_regex(popt.filename_pattern, std::regex::icase);
         std::smatch matches;
 
+        const auto file_filter = assmpq::mpq::GlobFilter::compile(popt.file_filter);
+        if (!file_filter.has_value()) {
+            spdlog::error("Filter error: {}", file_filter.error());
+            return 1;
+        }
+
         // sort mesh file names
         std::vector<std::filesystem::directory_entry> sorted_entries;
-        std::ranges::copy(std::filesystem::directory_iterator(popt.input_folder), std::back_inserter(sorted_entries));
+        std::ranges::copy_if(std::filesystem::directory_iterator(popt.input_folder), std::back_inserter(sorted_entries),
+            [&file_filter](const std::filesystem::directory_entry& entry) {
+                return file_filter->matches(entry.path().filename().string());
+            });
         std::ranges::sort(sorted_entries,
             [](const std::filesystem::directory_entry& first, const std::filesystem::directory_entry& second) {
                 return first.path().filename() < second.path().filename();
@@ -0,0 +1,595 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ASSMPQ_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include <xxhash.h>
+
+#include "archive_index.hpp"
+
+namespace assmpq::mpq {
+
+namespace {
+
+constexpr uint32_t kUserDataMagic = 0x1B51504D;     // "MPQ\x1B"
+constexpr uint64_t kHeaderAlignment = 512;
+constexpr size_t kCryptTableSize = 0x500;
+// Largest header of the known format versions
+constexpr uint32_t kMaxHeaderSize = 0xD0;
+// Archives whose index stays in the open_cached cache
+constexpr size_t kCachedIndexCount = 8;
+
+constexpr auto kCryptTable = [] {
+    std::array<uint32_t, kCryptTableSize> table {};
+    uint32_t seed = 0x00100001;
+    for (uint32_t index1 = 0; index1 < 0x100; ++index1) {
+        for (uint32_t index2 = index1, idx = 0; idx < 5; ++idx, index2 += 0x100) {
+            seed = ((seed * 125) + 3) % 0x2AAAAB;
+            const uint32_t high = (seed & 0xFFFF) << 0x10;
+            seed = ((seed * 125) + 3) % 0x2AAAAB;
+            const uint32_t low = seed & 0xFFFF;
+            table[index2] = high | low;
+        }
+    }
+    return table;
+}();
+
+constexpr auto kNormalizedChars = [] {
+    std::array<uint8_t, 256> table {};
+    for (size_t idx = 0; idx < table.size(); ++idx) {
+        auto ch = static_cast<uint8_t>(idx);
+        if (ch >= 'a' && ch <= 'z') {
+            ch = static_cast<uint8_t>(ch - ('a' - 'A'));
+        } else if (ch == '/') {
+            ch = '\\';
+        }
+        table[idx] = ch;
+    }
+    return table;
+}();
+
+// Names are normalized and hashed in chunks of this size
+constexpr size_t kNameChunkSize = 256;
+
+// Uppercase ASCII letters and turn '/' into '\', 16 characters at a time where SSE2 is available
+void normalize_name(std::string_view filename, std::span<uint8_t> output)
+{
+    size_t pos = 0;
+#if defined(ASSMPQ_HAS_SSE2)
+    const __m128i before_lower = _mm_set1_epi8('a' - 1);
+    const __m128i after_lower = _mm_set1_epi8('z' + 1);
+    const __m128i case_bit = _mm_set1_epi8('a' - 'A');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i slash_to_backslash = _mm_set1_epi8('/' ^ '\\');
+
+    for (; pos + 16 <= filename.size(); pos += 16) {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(filename.data() + pos)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        // Bytes above 0x7F compare as negative and are never treated as lowercase
+        const __m128i is_lower = _mm_and_si128(_mm_cmpgt_epi8(chars, before_lower), _mm_cmplt_epi8(chars, after_lower));
+        chars = _mm_sub_epi8(chars, _mm_and_si128(is_lower, case_bit));
+        chars = _mm_xor_si128(chars, _mm_and_si128(_mm_cmpeq_epi8(chars, slash), slash_to_backslash));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output.data() + pos), chars); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+#endif
+
+    for (; pos < filename.size(); ++pos) {
+        output[pos] = kNormalizedChars[static_cast<unsigned char>(filename[pos])];
+    }
+}
+
+/// Cipher state of one encrypted block, the key schedule does not depend on the data
+struct CryptState {
+    uint32_t key = 0;
+    uint32_t seed = 0xEEEEEEEE;
+};
+
+// One word of the MPQ cipher, advances the state
+auto decrypt_word(uint32_t word, CryptState& state)-> uint32_t
+{
+    state.seed += kCryptTable[0x400 + (state.key & 0xFF)];
+    const uint32_t plain = word ^ (state.key + state.seed);
+
+    state.key = ((~state.key << 0x15) + 0x11111111) | (state.key >> 0x0B);
+    state.seed = plain + state.seed + (state.seed << 5) + 3;
+    return plain;
+}
+
+// One word of the MPQ cipher applied the other way, advances the state like decrypt_word
+auto encrypt_word(uint32_t word, CryptState& state)-> uint32_t
+{
+    state.seed += kCryptTable[0x400 + (state.key & 0xFF)];
+    const uint32_t cipher = word ^ (state.key + state.seed);
+
+    state.key = ((~state.key << 0x15) + 0x11111111) | (state.key >> 0x0B);
+    state.seed = word + state.seed + (state.seed << 5) + 3;
+    return cipher;
+}
+
+// Decrypt the words of data starting at word first_word, the state must belong to that word
+void decrypt_words(std::span<char> data, size_t first_word, CryptState& state)
+{
+    const size_t word_count = data.size() / sizeof(uint32_t);
+    for (size_t word_idx = first_word; word_idx < word_count; ++word_idx) {
+        uint32_t word = 0;
+        std::memcpy(&word, data.data() + (word_idx * sizeof(uint32_t)), sizeof(word)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        word = decrypt_word(word, state);
+        std::memcpy(data.data() + (word_idx * sizeof(uint32_t)), &word, sizeof(word)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+}
+
+#if defined(ASSMPQ_HAS_SSE2)
+constexpr size_t kCryptLanes = 4;
+
+// Transpose a 4x4 block of words, rows become columns
+void transpose_words(__m128i& row0, __m128i& row1, __m128i& row2, __m128i& row3)
+{
+    const __m128i low01 = _mm_unpacklo_epi32(row0, row1);
+    const __m128i low23 = _mm_unpacklo_epi32(row2, row3);
+    const __m128i high01 = _mm_unpackhi_epi32(row0, row1);
+    const __m128i high23 = _mm_unpackhi_epi32(row2, row3);
+    row0 = _mm_unpacklo_epi64(low01, low23);
+    row1 = _mm_unpackhi_epi64(low01, low23);
+    row2 = _mm_unpacklo_epi64(high01, high23);
+    row3 = _mm_unpackhi_epi64(high01, high23);
+}
+
+// Decrypt four blocks side by side, one per lane, while all of them have words left; the rest goes word by word
+void decrypt_lanes(std::span<const CryptBlock> blocks)
+{
+    size_t lane_words = std::numeric_limits<size_t>::max();
+    for (const CryptBlock& block : blocks) {
+        lane_words = std::min(lane_words, block.data.size() / sizeof(uint32_t));
+    }
+    lane_words -= lane_words % kCryptLanes;
+
+    alignas(16) std::array<uint32_t, kCryptLanes> keys {};
+    alignas(16) std::array<uint32_t, kCryptLanes> seeds {};
+    for (size_t lane = 0; lane < kCryptLanes; ++lane) {
+        keys[lane] = blocks[lane].key;
+        seeds[lane] = CryptState {}.seed;
+    }
+
+    __m128i key = _mm_load_si128(reinterpret_cast<const __m128i*>(keys.data())); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    __m128i seed = _mm_load_si128(reinterpret_cast<const __m128i*>(seeds.data())); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    const __m128i key_add = _mm_set1_epi32(0x11111111);
+    const __m128i seed_add = _mm_set1_epi32(3);
+    const __m128i all_bits = _mm_set1_epi32(-1);
+    const uint32_t* key_table = kCryptTable.data() + 0x400; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    const auto decrypt_step = [&](__m128i word) {
+        // SSE2 has no gather, the crypt table is read per lane
+        _mm_store_si128(reinterpret_cast<__m128i*>(keys.data()), key); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        seed = _mm_add_epi32(seed, _mm_set_epi32(
+            static_cast<int>(key_table[keys[3] & 0xFF]), static_cast<int>(key_table[keys[2] & 0xFF]), // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            static_cast<int>(key_table[keys[1] & 0xFF]), static_cast<int>(key_table[keys[0] & 0xFF]))); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const __m128i plain = _mm_xor_si128(word, _mm_add_epi32(key, seed));
+
+        key = _mm_or_si128(_mm_add_epi32(_mm_slli_epi32(_mm_xor_si128(key, all_bits), 0x15), key_add), _mm_srli_epi32(key, 0x0B));
+        seed = _mm_add_epi32(_mm_add_epi32(plain, seed), _mm_add_epi32(_mm_slli_epi32(seed, 5), seed_add));
+        return plain;
+    };
+    const auto lane_data = [&](size_t lane, size_t word_idx) {
+        return reinterpret_cast<__m128i*>(blocks[lane].data.data() + (word_idx * sizeof(uint32_t))); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    };
+
+    for (size_t word_idx = 0; word_idx < lane_words; word_idx += kCryptLanes) {
+        // Four words of every block, transposed so that each vector holds one word position of all blocks
+        __m128i words0 = _mm_loadu_si128(lane_data(0, word_idx));
+        __m128i words1 = _mm_loadu_si128(lane_data(1, word_idx));
+        __m128i words2 = _mm_loadu_si128(lane_data(2, word_idx));
+        __m128i words3 = _mm_loadu_si128(lane_data(3, word_idx));
+        transpose_words(words0, words1, words2, words3);
+
+        words0 = decrypt_step(words0);
+        words1 = decrypt_step(words1);
+        words2 = decrypt_step(words2);
+        words3 = decrypt_step(words3);
+
+        transpose_words(words0, words1, words2, words3);
+        _mm_storeu_si128(lane_data(0, word_idx), words0);
+        _mm_storeu_si128(lane_data(1, word_idx), words1);
+        _mm_storeu_si128(lane_data(2, word_idx), words2);
+        _mm_storeu_si128(lane_data(3, word_idx), words3);
+    }
+
+    _mm_store_si128(reinterpret_cast<__m128i*>(keys.data()), key); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    _mm_store_si128(reinterpret_cast<__m128i*>(seeds.data()), seed); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    for (size_t lane = 0; lane < kCryptLanes; ++lane) {
+        CryptState state{ .key = keys[lane], .seed = seeds[lane] };
+        decrypt_words(blocks[lane].data, lane_words, state);
+    }
+}
+#endif
+
+template<typename T>
+auto read_struct(std::istream& stream, uint64_t offset, T& value)-> bool
+{
+    stream.seekg(static_cast<std::streamoff>(offset));
+    stream.read(reinterpret_cast<char*>(&value), sizeof(value)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    return stream.good();
+}
+
+// Tables of protected maps may claim more entries than the file holds, such tails are dropped
+template<typename Entry>
+auto read_table(std::ifstream& stream, uint64_t offset, uint32_t entries, uint64_t file_size, std::string_view key_name)
+    -> std::vector<Entry>
+{
+    if (offset >= file_size) {
+        return {};
+    }
+
+    const uint64_t available_entries = (file_size - offset) / sizeof(Entry);
+    const auto entry_count = static_cast<size_t>(std::min<uint64_t>(entries, available_entries));
+
+    // Entries are plain words, the table is read and decrypted in place
+    std::vector<Entry> table(entry_count);
+    const std::span<char> bytes(reinterpret_cast<char*>(table.data()), entry_count * sizeof(Entry)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.seekg(static_cast<std::streamoff>(offset));
+    stream.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!stream.good()) {
+        return {};
+    }
+
+    decrypt_block(bytes, hash_string(key_name, HashType::FileKey));
+    return table;
+}
+
+// Hash of the header bytes, the header holds the positions and sizes of both tables
+auto hash_header(std::istream& stream, uint64_t header_offset)-> std::optional<uint64_t>
+{
+    ArchiveHeader header;
+    if (!read_struct(stream, header_offset, header) || header.magic != ArchiveHeader::kMagic) {
+        return std::nullopt;
+    }
+
+    std::vector<char> header_data(std::clamp<uint32_t>(header.header_size, sizeof(header), kMaxHeaderSize));
+    stream.seekg(static_cast<std::streamoff>(header_offset));
+    stream.read(header_data.data(), static_cast<std::streamsize>(header_data.size()));
+    if (stream.gcount() < static_cast<std::streamsize>(sizeof(header))) {
+        return std::nullopt;
+    }
+    stream.clear();
+
+    return XXH3_64bits(header_data.data(), static_cast<size_t>(stream.gcount()));
+}
+
+} // namespace
+
+auto hash_string(std::string_view filename, HashType hash_type)-> uint32_t
+{
+    const auto type_offset = static_cast<uint32_t>(hash_type);
+
+    uint32_t seed1 = 0x7FED7FED;
+    uint32_t seed2 = 0xEEEEEEEE;
+    for (const char name_ch : filename) {
+        const uint32_t ch = kNormalizedChars[static_cast<unsigned char>(name_ch)];
+        seed1 = kCryptTable[type_offset + ch] ^ (seed1 + seed2);
+        seed2 = ch + seed1 + seed2 + (seed2 << 5) + 3;
+    }
+
+    return seed1;
+}
+
+auto hash_name(std::string_view filename)-> NameHashes
+{
+    static constexpr auto kOffsetType = static_cast<uint32_t>(HashType::TableOffset);
+    static constexpr auto kNameAType = static_cast<uint32_t>(HashType::NameA);
+    static constexpr auto kNameBType = static_cast<uint32_t>(HashType::NameB);
+
+    // Three independent chains per character keep the table loads overlapped
+    uint32_t offset_seed1 = 0x7FED7FED;
+    uint32_t offset_seed2 = 0xEEEEEEEE;
+    uint32_t name_a_seed1 = 0x7FED7FED;
+    uint32_t name_a_seed2 = 0xEEEEEEEE;
+    uint32_t name_b_seed1 = 0x7FED7FED;
+    uint32_t name_b_seed2 = 0xEEEEEEEE;
+
+    std::array<uint8_t, kNameChunkSize> normalized {};
+    while (!filename.empty()) {
+        const auto chunk = filename.substr(0, normalized.size());
+        filename.remove_prefix(chunk.size());
+        normalize_name(chunk, normalized);
+
+        for (const uint32_t ch : std::span(normalized).first(chunk.size())) {
+            offset_seed1 = kCryptTable[kOffsetType + ch] ^ (offset_seed1 + offset_seed2);
+            name_a_seed1 = kCryptTable[kNameAType + ch] ^ (name_a_seed1 + name_a_seed2);
+            name_b_seed1 = kCryptTable[kNameBType + ch] ^ (name_b_seed1 + name_b_seed2);
+            offset_seed2 = ch + offset_seed1 + offset_seed2 + (offset_seed2 << 5) + 3;
+            name_a_seed2 = ch + name_a_seed1 + name_a_seed2 + (name_a_seed2 << 5) + 3;
+            name_b_seed2 = ch + name_b_seed1 + name_b_seed2 + (name_b_seed2 << 5) + 3;
+        }
+    }
+
+    return NameHashes{ .table_offset = offset_seed1, .name_a = name_a_seed1, .name_b = name_b_seed1 };
+}
+
+void hash_names(std::span<const std::string> filenames, std::span<NameHashes> name_hashes)
+{
+    for (size_t idx = 0; idx < filenames.size() && idx < name_hashes.size(); ++idx) {
+        name_hashes[idx] = hash_name(filenames[idx]);
+    }
+}
+
+auto file_key(std::string_view filename, const BlockEntry& block)-> uint32_t
+{
+    const size_t separator = filename.find_last_of("\\/");
+    if (separator != std::string_view::npos) {
+        filename.remove_prefix(separator + 1);
+    }
+
+    uint32_t key = hash_string(filename, HashType::FileKey);
+    if ((block.flags & ArchiveIndex::kBlockFixKey) != 0) {
+        key = (key + block.offset) ^ block.file_size;
+    }
+    return key;
+}
+
+auto read_sector_offsets(std::istream& stream, uint64_t data_offset, uint32_t sector_size, const BlockEntry& block, std::string_view filename)
+    -> std::vector<uint32_t>
+{
+    const uint32_t key = (block.flags & ArchiveIndex::kBlockEncrypted) != 0 ? file_key(filename, block) : 0;
+    return read_sector_offsets(stream, data_offset, sector_size, block, key);
+}
+
+auto read_sector_offsets(std::istream& stream, uint64_t data_offset, uint32_t sector_size, const BlockEntry& block, uint32_t key)
+    -> std::vector<uint32_t>
+{
+    if ((block.flags & (ArchiveIndex::kBlockImploded | ArchiveIndex::kBlockCompressed)) == 0
+        || (block.flags & ArchiveIndex::kBlockSingleUnit) != 0
+        || sector_size == 0) {
+        return {};
+    }
+
+    const size_t sector_count = (size_t { block.file_size } + sector_size - 1) / sector_size;
+    const size_t offset_count = sector_count + 1 + ((block.flags & ArchiveIndex::kBlockSectorCrc) != 0 ? 1 : 0);
+
+    std::vector<uint32_t> sector_offsets(offset_count);
+    stream.seekg(static_cast<std::streamoff>(data_offset));
+    stream.read(reinterpret_cast<char*>(sector_offsets.data()), static_cast<std::streamsize>(offset_count * sizeof(uint32_t))); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (!stream.good()) {
+        stream.clear();
+        return {};
+    }
+
+    if ((block.flags & ArchiveIndex::kBlockEncrypted) != 0) {
+        decrypt_block(sector_offsets, key - 1);
+    }
+
+    // The first sector starts right behind the table, offsets grow and stay inside the block
+    const auto table_size = static_cast<uint32_t>(offset_count * sizeof(uint32_t));
+    if (sector_offsets.front() != table_size
+        || !std::ranges::is_sorted(sector_offsets)
+        || sector_offsets.back() > block.compressed_size) {
+        return {};
+    }
+
+    return sector_offsets;
+}
+
+auto read_archive_key(const std::filesystem::path& archive_path)-> std::optional<ArchiveKey>
+{
+    std::error_code error;
+    ArchiveKey key;
+    key.path = std::filesystem::weakly_canonical(archive_path, error).generic_string();
+    key.size = std::filesystem::file_size(archive_path, error);
+    if (error) {
+        return std::nullopt;
+    }
+    key.time = std::filesystem::last_write_time(archive_path, error).time_since_epoch().count();
+    if (error) {
+        return std::nullopt;
+    }
+    return key;
+}
+
+void decrypt_block(std::span<uint32_t> data, uint32_t key)
+{
+    CryptState state{ .key = key };
+    for (auto& word : data) {
+        word = decrypt_word(word, state);
+    }
+}
+
+void decrypt_block(std::span<char> data, uint32_t key)
+{
+    CryptState state{ .key = key };
+    decrypt_words(data, 0, state);
+}
+
+void encrypt_block(std::span<char> data, uint32_t key)
+{
+    CryptState state{ .key = key };
+    for (size_t word_idx = 0; word_idx < data.size() / sizeof(uint32_t); ++word_idx) {
+        uint32_t word = 0;
+        std::memcpy(&word, data.data() + (word_idx * sizeof(uint32_t)), sizeof(word)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        word = encrypt_word(word, state);
+        std::memcpy(data.data() + (word_idx * sizeof(uint32_t)), &word, sizeof(word)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+}
+
+void decrypt_blocks(std::span<const CryptBlock> blocks)
+{
+    size_t block_idx = 0;
+#if defined(ASSMPQ_HAS_SSE2)
+    for (; block_idx + kCryptLanes <= blocks.size(); block_idx += kCryptLanes) {
+        decrypt_lanes(blocks.subspan(block_idx, kCryptLanes));
+    }
+#endif
+
+    for (; block_idx < blocks.size(); ++block_idx) {
+        decrypt_block(blocks[block_idx].data, blocks[block_idx].key);
+    }
+}
+
+auto ArchiveIndex::open(const std::filesystem::path& archive_path)-> std::expected<ArchiveIndex, ErrorMessage>
+{
+    std::error_code error;
+    const uint64_t file_size = std::filesystem::file_size(archive_path, error);
+    std::ifstream stream(archive_path, std::ios::in | std::ios::binary);
+    if (error || !stream.is_open()) {
+        return std::unexpected("Archive open error.");
+    }
+
+    // The header starts at a 512 byte boundary, maps keep their own header in front of it
+    ArchiveIndex index;
+    ArchiveHeader header;
+    bool is_found = false;
+    for (uint64_t offset = 0; offset + sizeof(header) <= file_size && !is_found; offset += kHeaderAlignment) {
+        uint32_t magic = 0;
+        if (!read_struct(stream, offset, magic)) {
+            break;
+        }
+
+        uint64_t header_offset = offset;
+        if (magic == kUserDataMagic) {
+            std::array<uint32_t, 3> user_data {};
+            if (!read_struct(stream, offset, user_data)) {
+                break;
+            }
+            header_offset = offset + user_data[2];
+        } else if (magic != ArchiveHeader::kMagic) {
+            continue;
+        }
+
+        is_found = header_offset + sizeof(header) <= file_size
+            && read_struct(stream, header_offset, header)
+            && header.magic == ArchiveHeader::kMagic;
+        index.archive_offset_ = header_offset;
+    }
+
+    if (!is_found) {
+        return std::unexpected("MPQ header not found.");
+    }
+
+    uint64_t hash_table_offset = header.hash_table_offset;
+    uint64_t block_table_offset = header.block_table_offset;
+    // Format version 1 headers append the high 16 bits of both table offsets
+    std::array<uint16_t, 2> offsets_high {};
+    if (header.format_version >= 1 && header.header_size >= sizeof(header) + 12
+        && read_struct(stream, index.archive_offset_ + sizeof(header) + sizeof(uint64_t), offsets_high)) {
+        hash_table_offset += uint64_t { offsets_high[0] } << 32;
+        block_table_offset += uint64_t { offsets_high[1] } << 32;
+    }
+
+    index.sector_size_ = 512U << header.sector_size_shift;
+    index.hash_table_ = read_table<HashEntry>(
+        stream, index.archive_offset_ + hash_table_offset, header.hash_table_entries, file_size, "(hash table)");
+    index.block_table_ = read_table<BlockEntry>(
+        stream, index.archive_offset_ + block_table_offset, header.block_table_entries, file_size, "(block table)");
+
+    if (index.hash_table_.empty()) {
+        return std::unexpected("Hash table not found.");
+    }
+    index.hash_table_entries_ = header.hash_table_entries;
+
+    index.header_hash_ = hash_header(stream, index.archive_offset_).value_or(0);
+
+    return index;
+}
+
+auto ArchiveIndex::open_cached(const std::filesystem::path& archive_path)
+    -> std::expected<std::shared_ptr<const ArchiveIndex>, ErrorMessage>
+{
+    using CachedIndex = std::pair<ArchiveKey, std::shared_ptr<const ArchiveIndex>>;
+    static std::mutex mutex;
+    static std::vector<CachedIndex> cached_indexes;     // Most recently used last
+
+    const auto archive_key = read_archive_key(archive_path);
+    if (!archive_key.has_value()) {
+        return std::unexpected("Archive open error.");
+    }
+
+    {
+        const std::lock_guard lock(mutex);
+        const auto cached = std::ranges::find(cached_indexes, archive_key.value(), &CachedIndex::first);
+        if (cached != cached_indexes.end()) {
+            std::rotate(cached, cached + 1, cached_indexes.end());
+            return cached_indexes.back().second;
+        }
+    }
+
+    // Opened outside the lock, a thread losing the race adds a second copy that ages out
+    auto index = open(archive_path);
+    if (!index.has_value()) {
+        return std::unexpected(index.error());
+    }
+    auto shared_index = std::make_shared<const ArchiveIndex>(std::move(index.value()));
+
+    const std::lock_guard lock(mutex);
+    if (cached_indexes.size() == kCachedIndexCount) {
+        cached_indexes.erase(cached_indexes.begin());
+    }
+    cached_indexes.emplace_back(archive_key.value(), shared_index);
+    return shared_index;
+}
+
+auto ArchiveIndex::read_header_hash(const std::filesystem::path& archive_path, uint64_t archive_offset)-> std::optional<uint64_t>
+{
+    std::ifstream stream(archive_path, std::ios::in | std::ios::binary);
+    if (!stream.is_open()) {
+        return std::nullopt;
+    }
+    return hash_header(stream, archive_offset);
+}
+
+auto ArchiveIndex::read_sector_offsets(std::istream& stream, const BlockEntry& block, std::string_view filename) const-> std::vector<uint32_t>
+{
+    return assmpq::mpq::read_sector_offsets(stream, archive_offset_ + block.offset, sector_size_, block, filename);
+}
+
+auto ArchiveIndex::find_block_index(std::string_view filename) const-> std::optional<uint32_t>
+{
+    return find_block_index(hash_name(filename));
+}
+
+auto ArchiveIndex::find_block_index(const NameHashes& name_hashes) const-> std::optional<uint32_t>
+{
+    // Slots follow the power of two entry count of the header, a table cut short by the file end
+    // keeps its positions and the missing tail ends the probe like an empty entry
+    const size_t table_size = hash_table_entries_;
+    const uint32_t name_a = name_hashes.name_a;
+    const uint32_t name_b = name_hashes.name_b;
+
+    std::optional<uint32_t> found_index;
+    size_t entry_idx = name_hashes.table_offset & (table_size - 1);
+    for (size_t probe = 0; probe < table_size; ++probe) {
+        if (entry_idx >= hash_table_.size()) {
+            break;
+        }
+
+        const HashEntry& entry = hash_table_[entry_idx];
+        if (entry.block_index == kHashEntryEmpty) {
+            break;
+        }
+
+        if (entry.name_a == name_a && entry.name_b == name_b
+            && entry.block_index < block_table_.size() && (block_table_[entry.block_index].flags & kBlockExists) != 0) {
+            if (entry.locale == 0) {
+                return entry.block_index;
+            }
+            found_index = found_index.value_or(entry.block_index);
+        }
+
+        entry_idx = entry_idx + 1 == table_size ? 0 : entry_idx + 1;
+    }
+
+    return found_index;
+}
+
+auto ArchiveIndex::find_block(std::string_view filename) const-> const BlockEntry*
+{
+    const auto block_index = find_block_index(filename);
+    return block_index.has_value() ? &block_table_[block_index.value()] : nullptr;
+}
+
+} // namespace assmpq::mpq
@@ -0,0 +1,279 @@
+#ifndef ASSMPQ_MPQ_ARCHIVE_INDEX_H_
+#define ASSMPQ_MPQ_ARCHIVE_INDEX_H_
+
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "assets_mpq_importer/assmpq.hpp"
+
+namespace assmpq::mpq {
+
+/// @brief Hash table entry, mirrors the decrypted on-disk layout
+struct HashEntry {
+    uint32_t name_a = 0;            ///< Name hash of type A
+    uint32_t name_b = 0;            ///< Name hash of type B
+    uint16_t locale = 0;
+    uint16_t platform = 0;
+    uint32_t block_index = 0;       ///< Block table index or one of the free markers
+};
+
+/// @brief Block table entry, mirrors the decrypted on-disk layout
+struct BlockEntry {
+    uint32_t offset = 0;            ///< File data offset relative to the archive start
+    uint32_t compressed_size = 0;
+    uint32_t file_size = 0;
+    uint32_t flags = 0;
+};
+
+static_assert(sizeof(HashEntry) == 16 && sizeof(BlockEntry) == 16);
+
+/// @brief Archive header of format version 0, mirrors the on-disk layout
+struct ArchiveHeader {
+    static constexpr uint32_t kMagic = 0x1A51504D;     ///< "MPQ\x1A"
+
+    uint32_t magic = 0;
+    uint32_t header_size = 0;
+    uint32_t archive_size = 0;
+    uint16_t format_version = 0;
+    uint16_t sector_size_shift = 0;     ///< Sectors are 512 << shift bytes
+    uint32_t hash_table_offset = 0;     ///< Relative to the header
+    uint32_t block_table_offset = 0;    ///< Relative to the header
+    uint32_t hash_table_entries = 0;
+    uint32_t block_table_entries = 0;
+};
+
+static_assert(sizeof(ArchiveHeader) == 32);
+
+/// @brief Version of the "(attributes)" file and the flags of the record kinds it stores
+constexpr uint32_t kAttributesVersion = 100;
+constexpr uint32_t kAttributesCrc32 = 0x00000001;
+constexpr uint32_t kAttributesFileTime = 0x00000002;
+constexpr uint32_t kAttributesMd5 = 0x00000004;
+
+/// @brief MD5 record of the "(attributes)" file, made by md5_digest
+using Md5Digest = std::array<uint8_t, 16>;
+
+/// @brief Kind of the MPQ string hash, selects the crypt table slice
+enum class HashType : uint32_t {
+    TableOffset = 0x000,
+    NameA = 0x100,
+    NameB = 0x200,
+    FileKey = 0x300,
+};
+
+/// @brief The three name hashes a hash table lookup needs
+struct NameHashes {
+    uint32_t table_offset = 0;      ///< Start slot of the probing
+    uint32_t name_a = 0;
+    uint32_t name_b = 0;
+
+    bool operator==(const NameHashes& other) const = default;
+};
+
+/**
+ * @brief Hash a file name the way MPQ archives do
+ * @details Case-insensitive, '/' is hashed as '\'.
+ * @param filename File name in the archive
+ * @param hash_type Hash kind
+ * @return Hash value
+ */
+auto hash_string(std::string_view filename, HashType hash_type)-> uint32_t;
+
+/**
+ * @brief Compute all lookup hashes of a file name in one pass
+ * @param filename File name in the archive
+ * @return Name hashes, equal to three hash_string calls
+ */
+auto hash_name(std::string_view filename)-> NameHashes;
+
+/**
+ * @brief Compute the lookup hashes of a batch of file names
+ * @param filenames File names in the archive
+ * @param name_hashes Output, must be as long as filenames
+ */
+void hash_names(std::span<const std::string> filenames, std::span<NameHashes> name_hashes);
+
+/**
+ * @brief Encryption key of a file
+ * @details Derived from the name without its folders, adjusted by the block position for fixed key files.
+ * @param filename File name in the archive
+ * @param block Block table entry of the file
+ * @return Key of the first sector, the sector offset table uses the key minus one
+ */
+auto file_key(std::string_view filename, const BlockEntry& block)-> uint32_t;
+
+/**
+ * @brief Read the sector offset table of a file
+ * @param stream Archive stream
+ * @param data_offset File data position in the stream
+ * @param sector_size Sector size of the archive
+ * @param block Block table entry of the file
+ * @param filename File name, needed to decrypt the table of an encrypted file
+ * @return Sector offsets relative to the file data, the last one ends the data;
+ *         empty if the file is stored in one piece or the table is unreadable
+ */
+auto read_sector_offsets(std::istream& stream, uint64_t data_offset, uint32_t sector_size, const BlockEntry& block, std::string_view filename)
+    -> std::vector<uint32_t>;
+
+/**
+ * @brief Read the sector offset table of a file whose key is already known
+ * @param key File key made by file_key, used if the file is encrypted
+ * @return Sector offsets, see read_sector_offsets with a file name
+ */
+auto read_sector_offsets(std::istream& stream, uint64_t data_offset, uint32_t sector_size, const BlockEntry& block, uint32_t key)
+    -> std::vector<uint32_t>;
+
+/// @brief Identity of an archive file on disk, changes when the archive is rewritten
+struct ArchiveKey {
+    std::string path;               ///< Canonical path
+    uint64_t size = 0;
+    int64_t time = 0;               ///< Modification time in file clock ticks
+
+    bool operator==(const ArchiveKey& other) const = default;
+};
+
+/**
+ * @brief Read the identity of an archive file
+ * @param archive_path Path to the archive
+ * @return Archive key or nothing if the file is not accessible
+ */
+auto read_archive_key(const std::filesystem::path& archive_path)-> std::optional<ArchiveKey>;
+
+/**
+ * @brief Decrypt MPQ table or sector data in place
+ * @param data 32 bit words to decrypt
+ * @param key Encryption key
+ */
+void decrypt_block(std::span<uint32_t> data, uint32_t key);
+
+/**
+ * @brief Decrypt MPQ data stored as bytes in place
+ * @details Trailing bytes that do not fill a word are stored in the clear and left as they are.
+ * @param data Bytes to decrypt, no alignment needed
+ * @param key Encryption key
+ */
+void decrypt_block(std::span<char> data, uint32_t key);
+
+/**
+ * @brief Encrypt MPQ table or sector data in place, the inverse of decrypt_block
+ * @param data Bytes to encrypt, trailing bytes that do not fill a word are left in the clear
+ * @param key Encryption key
+ */
+void encrypt_block(std::span<char> data, uint32_t key);
+
+/// @brief Encrypted bytes and their key, one sector of a file
+struct CryptBlock {
+    std::span<char> data;
+    uint32_t key = 0;
+};
+
+/**
+ * @brief Decrypt independent blocks in place
+ * @details Same result as a decrypt_block call per block. The key schedule of a block is serial,
+ * so four blocks at a time share SSE2 lanes where available, the sectors of a file make such a batch.
+ * @param blocks Blocks to decrypt
+ */
+void decrypt_blocks(std::span<const CryptBlock> blocks);
+
+/**
+ * @brief Flat copy of the hash and block tables of an MPQ archive
+ * @details Tables are read and decrypted once, lookups hash the name and probe the
+ * open addressing table in place, the same way the game does.
+ */
+class ArchiveIndex {
+public:
+    static constexpr uint32_t kHashEntryEmpty = 0xFFFFFFFF;     ///< Never used, ends probing
+    static constexpr uint32_t kHashEntryDeleted = 0xFFFFFFFE;   ///< Freed, probing continues
+    static constexpr uint32_t kBlockImploded = 0x00000100;
+    static constexpr uint32_t kBlockCompressed = 0x00000200;
+    static constexpr uint32_t kBlockEncrypted = 0x00010000;
+    static constexpr uint32_t kBlockFixKey = 0x00020000;
+    static constexpr uint32_t kBlockSingleUnit = 0x01000000;
+    static constexpr uint32_t kBlockSectorCrc = 0x04000000;
+    static constexpr uint32_t kBlockExists = 0x80000000;
+
+    /**
+     * @brief Read the tables of an MPQ archive or a map containing one
+     * @param archive_path Path to the archive
+     * @return Expected containing the index or an error message
+     */
+    [[nodiscard]] static auto open(const std::filesystem::path& archive_path)-> std::expected<ArchiveIndex, ErrorMessage>;
+
+    /**
+     * @brief Shared index of an archive, kept for the archives opened last
+     * @details The cache is keyed by the archive identity, reopening an unchanged archive
+     * skips reading and decrypting its tables. A rewritten archive gets a new identity.
+     * @param archive_path Path to the archive
+     * @return Expected containing the index or an error message
+     */
+    [[nodiscard]] static auto open_cached(const std::filesystem::path& archive_path)
+        -> std::expected<std::shared_ptr<const ArchiveIndex>, ErrorMessage>;
+
+    /**
+     * @brief Hash the MPQ header at a known position
+     * @details Cheap check whether an archive still has the tables a saved index was made from.
+     * @param archive_path Path to the archive
+     * @param archive_offset Header position, see archive_offset()
+     * @return Header hash or nothing if there is no header at the position
+     */
+    [[nodiscard]] static auto read_header_hash(const std::filesystem::path& archive_path, uint64_t archive_offset)-> std::optional<uint64_t>;
+
+    /**
+     * @brief Find the block table index of a file
+     * @details The neutral locale wins if the file is stored in several locales,
+     * blocks without the exists flag are skipped.
+     * @param filename File name in the archive
+     * @return Block index or nothing if the file is not found
+     */
+    [[nodiscard]] auto find_block_index(std::string_view filename) const-> std::optional<uint32_t>;
+
+    /**
+     * @brief Find the block table index of a file by its precomputed hashes
+     * @param name_hashes Hashes made by hash_name or hash_names
+     * @return Block index or nothing if the file is not found
+     */
+    [[nodiscard]] auto find_block_index(const NameHashes& name_hashes) const-> std::optional<uint32_t>;
+
+    /**
+     * @brief Find the block table entry of a file
+     * @param filename File name in the archive
+     * @return Block entry or nullptr if the file is not found
+     */
+    [[nodiscard]] auto find_block(std::string_view filename) const-> const BlockEntry*;
+
+    /**
+     * @brief Read the sector offset table of a file of this archive
+     * @param stream Archive stream
+     * @param block Block table entry of the file
+     * @param filename File name, needed to decrypt the table of an encrypted file
+     * @return Sector offsets, see the free read_sector_offsets
+     */
+    [[nodiscard]] auto read_sector_offsets(std::istream& stream, const BlockEntry& block, std::string_view filename) const-> std::vector<uint32_t>;
+
+    [[nodiscard]] auto hash_table() const-> const std::vector<HashEntry>& { return hash_table_; }
+    [[nodiscard]] auto block_table() const-> const std::vector<BlockEntry>& { return block_table_; }
+    [[nodiscard]] auto archive_offset() const-> uint64_t { return archive_offset_; }
+    [[nodiscard]] auto sector_size() const-> uint32_t { return sector_size_; }
+    [[nodiscard]] auto header_hash() const-> uint64_t { return header_hash_; }
+
+private:
+    std::vector<HashEntry> hash_table_;
+    uint32_t hash_table_entries_ = 0;       ///< Entry count of the header, the read table may be shorter
+    std::vector<BlockEntry> block_table_;
+    uint64_t archive_offset_ = 0;
+    uint32_t sector_size_ = 0;
+    uint64_t header_hash_ = 0;
+};
+
+} // namespace assmpq::mpq
+
+#endif  /// ASSMPQ_MPQ_ARCHIVE_INDEX_H_
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <utility>
+
+#include "archive_sidecar.hpp"
+
+namespace assmpq::mpq {
+
+namespace {
+
+constexpr uint32_t kSidecarMagic = 0x4951504D;     // "MPQI"
+constexpr uint32_t kSidecarVersion = 1;
+
+/// @brief Sidecar file header, mirrors the on-disk layout
+struct SidecarHeader {
+    uint32_t magic = kSidecarMagic;
+    uint32_t version = kSidecarVersion;
+    uint64_t archive_size = 0;
+    int64_t archive_time = 0;           ///< Archive modification time in file clock ticks
+    uint64_t header_hash = 0;
+    uint64_t archive_offset = 0;        ///< MPQ header offset in the archive file
+    uint32_t sector_size = 0;
+    uint32_t path_size = 0;             ///< Archive path, stored behind the name blob
+    uint64_t entry_count = 0;
+    uint64_t sector_offset_count = 0;
+    uint64_t names_size = 0;
+};
+
+static_assert(sizeof(SidecarHeader) == 72);
+
+template<typename T>
+void write_span(std::ofstream& stream, std::span<const T> data)
+{
+    stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size_bytes())); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+} // namespace
+
+auto ArchiveSidecar::write(
+    const std::filesystem::path& sidecar_path,
+    const std::filesystem::path& archive_path,
+    const ArchiveIndex& index,
+    std::vector<File> files)
+    -> std::expected<size_t, ErrorMessage>
+{
+    const auto archive_key = read_archive_key(archive_path);
+    if (!archive_key.has_value()) {
+        return std::unexpected("Archive open error.");
+    }
+
+    std::ranges::sort(files, {}, &File::filename);
+
+    std::vector<SidecarEntry> entries;
+    std::vector<uint32_t> sector_offsets;
+    std::string names;
+    entries.reserve(files.size());
+    for (const auto& file : files) {
+        if (file.block_index >= index.block_table().size()) {
+            continue;
+        }
+        const BlockEntry& block = index.block_table()[file.block_index];
+
+        entries.push_back(SidecarEntry{
+            .data_offset = index.archive_offset() + block.offset,
+            .compressed_size = block.compressed_size,
+            .file_size = block.file_size,
+            .flags = block.flags,
+            .block_index = file.block_index,
+            .name_offset = static_cast<uint32_t>(names.size()),
+            .name_size = static_cast<uint32_t>(file.filename.size()),
+            .sector_offsets_begin = static_cast<uint32_t>(sector_offsets.size()),
+            .sector_offset_count = static_cast<uint32_t>(file.sector_offsets.size()) });
+
+        names += file.filename;
+        sector_offsets.insert(sector_offsets.end(), file.sector_offsets.begin(), file.sector_offsets.end());
+    }
+
+    if (names.size() > std::numeric_limits<uint32_t>::max() || sector_offsets.size() > std::numeric_limits<uint32_t>::max()) {
+        return std::unexpected("Archive is too large for a sidecar index.");
+    }
+
+    const SidecarHeader header{
+        .archive_size = archive_key->size,
+        .archive_time = archive_key->time,
+        .header_hash = index.header_hash(),
+        .archive_offset = index.archive_offset(),
+        .sector_size = index.sector_size(),
+        .path_size = static_cast<uint32_t>(archive_key->path.size()),
+        .entry_count = entries.size(),
+        .sector_offset_count = sector_offsets.size(),
+        .names_size = names.size() };
+
+    std::ofstream sidecar_stream(sidecar_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    write_span(sidecar_stream, std::span(&header, 1));
+    write_span<SidecarEntry>(sidecar_stream, entries);
+    write_span<uint32_t>(sidecar_stream, sector_offsets);
+    sidecar_stream.write(names.data(), static_cast<std::streamsize>(names.size()));
+    sidecar_stream.write(archive_key->path.data(), static_cast<std::streamsize>(archive_key->path.size()));
+    if (!sidecar_stream) {
+        return std::unexpected(std::format("Sidecar index write error: {}", sidecar_path.string()));
+    }
+
+    return entries.size();
+}
+
+auto ArchiveSidecar::open(const std::filesystem::path& sidecar_path, const std::filesystem::path& archive_path)
+    -> std::expected<ArchiveSidecar, ErrorMessage>
+{
+    ArchiveSidecar sidecar;
+
+    try {
+        sidecar.file_.open(sidecar_path.string());
+    } catch (const std::exception&) {
+        return std::unexpected(std::format("Sidecar index open error: {}", sidecar_path.string()));
+    }
+
+    SidecarHeader header;
+    const size_t file_size = sidecar.file_.size();
+    if (file_size < sizeof(header)) {
+        return std::unexpected(std::format("Invalid sidecar index: {}", sidecar_path.string()));
+    }
+    std::memcpy(static_cast<void*>(&header), sidecar.file_.data(), sizeof(header));
+
+    const uint64_t entries_offset = sizeof(header);
+    const uint64_t sector_offsets_offset = entries_offset + (header.entry_count * sizeof(SidecarEntry));
+    const uint64_t names_offset = sector_offsets_offset + (header.sector_offset_count * sizeof(uint32_t));
+    const uint64_t path_offset = names_offset + header.names_size;
+    if (header.magic != kSidecarMagic || header.version != kSidecarVersion
+        || header.entry_count > file_size || header.sector_offset_count > file_size
+        || path_offset + header.path_size != file_size) {
+        return std::unexpected(std::format("Invalid sidecar index: {}", sidecar_path.string()));
+    }
+
+    const char* data = sidecar.file_.data();
+    const std::string_view stored_path(data + path_offset, header.path_size); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    // Path, size and time are checked first, the header is read only if they still match
+    const auto archive_key = read_archive_key(archive_path);
+    if (!archive_key.has_value()
+        || archive_key->path != stored_path
+        || archive_key->size != header.archive_size
+        || archive_key->time != header.archive_time
+        || ArchiveIndex::read_header_hash(archive_path, header.archive_offset) != header.header_hash) {
+        return std::unexpected("Sidecar index is stale.");
+    }
+
+    // The mapping is page aligned and every section size is a multiple of its alignment, so they are read in place
+    sidecar.entries_ = std::span(reinterpret_cast<const SidecarEntry*>(data + entries_offset), header.entry_count); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    sidecar.sector_offsets_ = std::span(reinterpret_cast<const uint32_t*>(data + sector_offsets_offset), header.sector_offset_count); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    sidecar.names_ = std::string_view(data + names_offset, header.names_size); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    sidecar.sector_size_ = header.sector_size;
+    sidecar.archive_key_ = std::move(archive_key.value());
+
+    return sidecar;
+}
+
+auto ArchiveSidecar::name(const SidecarEntry& entry) const-> std::string_view
+{
+    if (uint64_t { entry.name_offset } + entry.name_size > names_.size()) {
+        return {};
+    }
+    return names_.substr(entry.name_offset, entry.name_size);
+}
+
+auto ArchiveSidecar::sector_offsets(const SidecarEntry& entry) const-> std::span<const uint32_t>
+{
+    if (uint64_t { entry.sector_offsets_begin } + entry.sector_offset_count > sector_offsets_.size()) {
+        return {};
+    }
+    return sector_offsets_.subspan(entry.sector_offsets_begin, entry.sector_offset_count);
+}
+
+} // namespace assmpq::mpq
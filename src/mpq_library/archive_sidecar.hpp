@@ -0,0 +1,92 @@
+#ifndef ASSMPQ_MPQ_ARCHIVE_SIDECAR_H_
+#define ASSMPQ_MPQ_ARCHIVE_SIDECAR_H_
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "assets_mpq_importer/assmpq.hpp"
+#include "archive_index.hpp"
+
+namespace assmpq::mpq {
+
+/// @brief Sidecar file record, mirrors the on-disk layout
+struct SidecarEntry {
+    uint64_t data_offset = 0;           ///< File data offset from the start of the archive file
+    uint32_t compressed_size = 0;
+    uint32_t file_size = 0;
+    uint32_t flags = 0;                 ///< Block table flags
+    uint32_t block_index = 0;
+    uint32_t name_offset = 0;           ///< Offset in the name blob
+    uint32_t name_size = 0;
+    uint32_t sector_offsets_begin = 0;  ///< First offset in the sector offset pool
+    uint32_t sector_offset_count = 0;   ///< Zero for files stored in one piece
+};
+
+static_assert(sizeof(SidecarEntry) == 40);
+
+/**
+ * @brief Memory-mapped index of an archive saved next to it
+ * @details Holds the resolved names, block entries and sector offset tables of an archive
+ * so later runs list it without opening the archive. The sidecar is keyed by the archive
+ * path, size, modification time and header hash, a mismatch makes it stale.
+ * Entries are sorted by name.
+ */
+class ArchiveSidecar {
+public:
+    /// @brief A resolved archive file, input of write
+    struct File {
+        std::string filename;
+        uint32_t block_index = 0;
+        std::vector<uint32_t> sector_offsets;
+    };
+
+    /**
+     * @brief Save the sidecar of an archive
+     * @param sidecar_path Sidecar file to write
+     * @param archive_path Indexed archive
+     * @param index Tables of the archive
+     * @param files Resolved files of the archive
+     * @return Expected containing the number of saved files or an error message
+     */
+    [[nodiscard]] static auto write(
+        const std::filesystem::path& sidecar_path,
+        const std::filesystem::path& archive_path,
+        const ArchiveIndex& index,
+        std::vector<File> files)
+        -> std::expected<size_t, ErrorMessage>;
+
+    /**
+     * @brief Map the sidecar of an archive
+     * @param sidecar_path Sidecar file
+     * @param archive_path Archive the sidecar must match
+     * @return Expected containing the sidecar or an error message, "Sidecar index is stale." if the archive changed
+     */
+    [[nodiscard]] static auto open(const std::filesystem::path& sidecar_path, const std::filesystem::path& archive_path)
+        -> std::expected<ArchiveSidecar, ErrorMessage>;
+
+    [[nodiscard]] auto name(const SidecarEntry& entry) const-> std::string_view;
+    [[nodiscard]] auto sector_offsets(const SidecarEntry& entry) const-> std::span<const uint32_t>;
+
+    [[nodiscard]] auto entries() const-> std::span<const SidecarEntry> { return entries_; }
+    [[nodiscard]] auto sector_size() const-> uint32_t { return sector_size_; }
+    [[nodiscard]] auto archive_key() const-> const ArchiveKey& { return archive_key_; }
+
+private:
+    boost::iostreams::mapped_file_source file_;
+    std::span<const SidecarEntry> entries_;
+    std::span<const uint32_t> sector_offsets_;
+    std::string_view names_;
+    uint32_t sector_size_ = 0;
+    ArchiveKey archive_key_;
+};
+
+} // namespace assmpq::mpq
+
+#endif  /// ASSMPQ_MPQ_ARCHIVE_SIDECAR_H_
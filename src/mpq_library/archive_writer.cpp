@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <zlib.h>
+
+#include "assets_mpq_importer/mpq.hpp"
+#include "assets_mpq_importer/glob.hpp"
+#include "archive_index.hpp"
+#include "sector_codec.hpp"
+#include "worker_pool.hpp"
+
+namespace assmpq::mpq {
+
+namespace {
+
+constexpr uint32_t kBaseSectorSize = 512;
+constexpr uint16_t kMaxSectorSizeShift = 15;
+constexpr uint32_t kSectorsPerJob = 64;             // Sectors compressed by a worker in one go
+constexpr size_t kMinHashTableSize = 16;
+
+/// File on its way into the archive, its sectors are compressed by whichever worker takes them
+struct StoredFile {
+    const ArchiveFile* file = nullptr;
+    SectorCompression compression = SectorCompression::Deflate;
+    bool is_compressed = false;                 ///< False for files stored as they are, they have no sector table
+    std::vector<std::vector<char>> sectors;     ///< Stored sectors of a compressed file
+    uint32_t crc32 = 0;
+    Md5Digest md5 {};
+};
+
+/// Unit of work of the compression pool: a run of sectors or the checksums of one file
+struct CompressionJob {
+    size_t file_idx = 0;
+    uint32_t first_sector = 0;
+    uint32_t last_sector = 0;                   ///< Equal to first_sector for a checksum job
+};
+
+auto sector_compression(FileCompression compression)-> SectorCompression
+{
+    return compression == FileCompression::Bzip2 ? SectorCompression::Bzip2 : SectorCompression::Deflate;
+}
+
+// Compression of a file, the first matching rule wins
+auto file_compression(std::string_view filename, std::span<const std::pair<GlobFilter, FileCompression>> rules, FileCompression fallback)
+    -> FileCompression
+{
+    const auto rule = std::ranges::find_if(rules, [filename](const auto& compression_rule) {
+        return compression_rule.first.matches(filename);
+    });
+    return rule != rules.end() ? rule->second : fallback;
+}
+
+void compress_sectors(StoredFile& stored_file, uint32_t sector_size, uint32_t first_sector, uint32_t last_sector)
+{
+    const std::span<const char> data = stored_file.file->data;
+    for (uint32_t sector_idx = first_sector; sector_idx < last_sector; ++sector_idx) {
+        const size_t sector_begin = size_t { sector_idx } * sector_size;
+        const auto sector = data.subspan(sector_begin, std::min<size_t>(sector_size, data.size() - sector_begin));
+        compress_sector(sector, stored_file.compression, stored_file.sectors[sector_idx]);
+    }
+}
+
+void compute_checksums(StoredFile& stored_file)
+{
+    const std::span<const char> data = stored_file.file->data;
+    stored_file.crc32 = static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(data.data()), static_cast<uInt>(data.size()))); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    stored_file.md5 = md5_digest(data);
+}
+
+// Run the jobs on the shared pool, each thread takes the next job until none is left
+void run_compression_jobs(std::span<StoredFile> stored_files, std::span<const CompressionJob> jobs, uint32_t sector_size, unsigned thread_count)
+{
+    std::atomic<size_t> next_job = 0;
+    const auto work = [&] {
+        for (size_t job_idx = next_job++; job_idx < jobs.size(); job_idx = next_job++) {
+            const CompressionJob& job = jobs[job_idx];
+            StoredFile& stored_file = stored_files[job.file_idx];
+            if (job.first_sector == job.last_sector) {
+                compute_checksums(stored_file);
+            } else {
+                compress_sectors(stored_file, sector_size, job.first_sector, job.last_sector);
+            }
+        }
+    };
+
+    const auto worker_count = static_cast<unsigned>(std::min<size_t>(thread_count, jobs.size()));
+    WorkerPool::instance().run(worker_count, worker_count, [&work](size_t) { work(); });
+}
+
+// Split the files into checksum and sector run jobs
+auto make_compression_jobs(std::span<StoredFile> stored_files, uint32_t sector_size)-> std::vector<CompressionJob>
+{
+    std::vector<CompressionJob> jobs;
+    for (size_t file_idx = 0; file_idx < stored_files.size(); ++file_idx) {
+        StoredFile& stored_file = stored_files[file_idx];
+        jobs.push_back(CompressionJob{ .file_idx = file_idx, .first_sector = 0, .last_sector = 0 });
+        if (!stored_file.is_compressed) {
+            continue;
+        }
+
+        const auto sector_count = static_cast<uint32_t>((stored_file.file->data.size() + sector_size - 1) / sector_size);
+        stored_file.sectors.resize(sector_count);
+        for (uint32_t first_sector = 0; first_sector < sector_count; first_sector += kSectorsPerJob) {
+            jobs.push_back(CompressionJob{ .file_idx = file_idx, .first_sector = first_sector, .last_sector = std::min(first_sector + kSectorsPerJob, sector_count) });
+        }
+    }
+    return jobs;
+}
+
+/// Block written into the archive together with what the hash table and "(attributes)" are made from
+struct WrittenBlock {
+    std::string filename;
+    BlockEntry block;
+    uint32_t crc32 = 0;
+    Md5Digest md5 {};
+};
+
+constexpr auto name_key(const NameHashes& name_hashes)-> uint64_t
+{
+    return (uint64_t { name_hashes.name_a } << 32U) | name_hashes.name_b;
+}
+
+// "(attributes)" with the CRC32 and MD5 records of every block, the records of the attributes file itself stay zero
+auto make_attributes(std::span<const WrittenBlock> written_blocks)-> FileData
+{
+    const size_t block_count = written_blocks.size() + 1;
+    const std::array<uint32_t, 2> header { kAttributesVersion, kAttributesCrc32 | kAttributesMd5 };
+
+    FileData attributes(sizeof(header) + (block_count * (sizeof(uint32_t) + sizeof(Md5Digest))), 0);
+    std::memcpy(attributes.data(), header.data(), sizeof(header));
+    char* crcs = attributes.data() + sizeof(header); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    char* md5s = crcs + (block_count * sizeof(uint32_t)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (size_t block_idx = 0; block_idx < written_blocks.size(); ++block_idx) {
+        std::memcpy(crcs + (block_idx * sizeof(uint32_t)), &written_blocks[block_idx].crc32, sizeof(uint32_t)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        std::memcpy(md5s + (block_idx * sizeof(Md5Digest)), written_blocks[block_idx].md5.data(), sizeof(Md5Digest)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    }
+    return attributes;
+}
+
+// Hash table placing every file at the first free slot from its table offset, the way readers probe it.
+// The names are unique, duplicates are rejected when the files are added
+auto make_hash_table(std::span<const WrittenBlock> written_blocks)-> std::vector<HashEntry>
+{
+    const size_t table_size = std::bit_ceil(std::max(kMinHashTableSize, written_blocks.size() + (written_blocks.size() / 3) + 1));
+    std::vector<HashEntry> hash_table(table_size, HashEntry{
+        .name_a = ArchiveIndex::kHashEntryEmpty,
+        .name_b = ArchiveIndex::kHashEntryEmpty,
+        .locale = 0xFFFF,
+        .platform = 0xFFFF,
+        .block_index = ArchiveIndex::kHashEntryEmpty });
+
+    for (size_t block_idx = 0; block_idx < written_blocks.size(); ++block_idx) {
+        const NameHashes name_hashes = hash_name(written_blocks[block_idx].filename);
+
+        size_t slot = name_hashes.table_offset & (table_size - 1);
+        while (hash_table[slot].block_index != ArchiveIndex::kHashEntryEmpty) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        hash_table[slot] = HashEntry{
+            .name_a = name_hashes.name_a,
+            .name_b = name_hashes.name_b,
+            .locale = 0,
+            .platform = 0,
+            .block_index = static_cast<uint32_t>(block_idx) };
+    }
+    return hash_table;
+}
+
+template<typename T>
+void write_span(std::ofstream& stream, std::span<const T> data)
+{
+    stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size_bytes())); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+}
+
+// Table entries are plain words, they are encrypted in a copy
+template<typename Entry>
+void write_table(std::ofstream& stream, std::vector<Entry> table, std::string_view key_name)
+{
+    const std::span<char> bytes(reinterpret_cast<char*>(table.data()), table.size() * sizeof(Entry)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    encrypt_block(bytes, hash_string(key_name, HashType::FileKey));
+    stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Data of one file at the stream position: the sector offset table and the sectors of a compressed file,
+// the file itself otherwise
+auto write_file_data(std::ofstream& stream, const StoredFile& stored_file)-> BlockEntry
+{
+    BlockEntry block{
+        .offset = 0,
+        .compressed_size = static_cast<uint32_t>(stored_file.file->data.size()),
+        .file_size = static_cast<uint32_t>(stored_file.file->data.size()),
+        .flags = ArchiveIndex::kBlockExists };
+    if (!stored_file.is_compressed) {
+        write_span<char>(stream, stored_file.file->data);
+        return block;
+    }
+
+    std::vector<uint32_t> sector_offsets { static_cast<uint32_t>((stored_file.sectors.size() + 1) * sizeof(uint32_t)) };
+    for (const auto& sector : stored_file.sectors) {
+        sector_offsets.push_back(sector_offsets.back() + static_cast<uint32_t>(sector.size()));
+    }
+
+    write_span<uint32_t>(stream, sector_offsets);
+    for (const auto& sector : stored_file.sectors) {
+        write_span<char>(stream, sector);
+    }
+    block.compressed_size = sector_offsets.back();
+    block.flags |= ArchiveIndex::kBlockCompressed;
+    return block;
+}
+
+} // namespace
+
+struct ArchiveWriter::State {
+    std::filesystem::path archive_path;
+    std::ofstream stream;
+    ArchiveWriteOptions options;
+    uint32_t sector_size = 0;
+    unsigned thread_count = 1;
+    std::vector<std::pair<GlobFilter, FileCompression>> compression_rules;
+    std::unordered_set<uint64_t> name_keys;         ///< MPQ name hashes A and B of every added file
+    std::vector<ArchiveFile> pending_files;         ///< Added files waiting for the next batch
+    size_t pending_size = 0;
+    std::vector<WrittenBlock> written_blocks;
+    uint64_t position = sizeof(ArchiveHeader);
+    size_t file_count = 0;
+    bool is_closed = false;
+
+    auto reserve_name(const std::string& filename)-> std::expected<void, ErrorMessage>;
+    auto queue(ArchiveFile file)-> std::expected<void, ErrorMessage>;
+    auto write_stored(std::span<StoredFile> stored_files, unsigned worker_count)-> std::expected<void, ErrorMessage>;
+    auto write_pending()-> std::expected<void, ErrorMessage>;
+    auto write_tables()-> std::expected<void, ErrorMessage>;
+    void discard();
+};
+
+auto ArchiveWriter::State::reserve_name(const std::string& filename)-> std::expected<void, ErrorMessage>
+{
+    if (!name_keys.insert(name_key(hash_name(filename))).second) {
+        return std::unexpected(std::format("Duplicate file name: {}", filename));
+    }
+    return {};
+}
+
+auto ArchiveWriter::State::queue(ArchiveFile file)-> std::expected<void, ErrorMessage>
+{
+    if (file.data.size() > std::numeric_limits<uint32_t>::max()) {
+        return std::unexpected(std::format("File is larger than 4 GB: {}", file.filename));
+    }
+    if (auto reserved = reserve_name(file.filename); !reserved.has_value()) {
+        return reserved;
+    }
+
+    pending_size += file.data.size();
+    pending_files.push_back(std::move(file));
+    return {};
+}
+
+// Compress the files on the pool and write them behind the blocks written before
+auto ArchiveWriter::State::write_stored(std::span<StoredFile> stored_files, unsigned worker_count)-> std::expected<void, ErrorMessage>
+{
+    run_compression_jobs(stored_files, make_compression_jobs(stored_files, sector_size), sector_size, worker_count);
+
+    for (const auto& stored_file : stored_files) {
+        BlockEntry block = write_file_data(stream, stored_file);
+        block.offset = static_cast<uint32_t>(position);
+        written_blocks.push_back(WrittenBlock{ .filename = stored_file.file->filename, .block = block, .crc32 = stored_file.crc32, .md5 = stored_file.md5 });
+
+        position += block.compressed_size;
+        if (position > std::numeric_limits<uint32_t>::max()) {
+            return std::unexpected("Archive is larger than 4 GB.");
+        }
+    }
+
+    if (!stream) {
+        return std::unexpected(std::format("Archive write error: {}", archive_path.string()));
+    }
+    return {};
+}
+
+auto ArchiveWriter::State::write_pending()-> std::expected<void, ErrorMessage>
+{
+    std::vector<StoredFile> stored_files;
+    stored_files.reserve(pending_files.size());
+    for (const auto& file : pending_files) {
+        const FileCompression compression = file_compression(file.filename, compression_rules, options.compression);
+        stored_files.push_back(StoredFile{
+            .file = &file,
+            .compression = sector_compression(compression),
+            .is_compressed = compression != FileCompression::None && !file.data.empty(),
+            .sectors = {},
+            .crc32 = 0,
+            .md5 = {} });
+    }
+
+    auto written = write_stored(stored_files, thread_count);
+    pending_files.clear();
+    pending_size = 0;
+    return written;
+}
+
+// Special files are stored behind the added ones, "(attributes)" last as it covers every other block,
+// then the tables and the final header
+auto ArchiveWriter::State::write_tables()-> std::expected<void, ErrorMessage>
+{
+    if (options.has_listfile) {
+        ArchiveFile listfile{ .filename = "(listfile)", .data = {} };
+        const auto add_name = [&listfile](const std::string& filename) {
+            std::ranges::replace_copy(filename, std::back_inserter(listfile.data), '/', '\\');
+            listfile.data.push_back('\r');
+            listfile.data.push_back('\n');
+        };
+        std::ranges::for_each(written_blocks, add_name, &WrittenBlock::filename);
+        std::ranges::for_each(pending_files, add_name, &ArchiveFile::filename);
+        if (auto queued = queue(std::move(listfile)); !queued.has_value()) {
+            return queued;
+        }
+    }
+    if (auto written = write_pending(); !written.has_value()) {
+        return written;
+    }
+
+    if (options.has_attributes) {
+        ArchiveFile attributes{ .filename = "(attributes)", .data = make_attributes(written_blocks) };
+        if (auto reserved = reserve_name(attributes.filename); !reserved.has_value()) {
+            return reserved;
+        }
+        std::array<StoredFile, 1> attributes_file { StoredFile{ .file = &attributes, .compression = SectorCompression::Deflate, .is_compressed = true, .sectors = {}, .crc32 = 0, .md5 = {} } };
+        if (auto written = write_stored(attributes_file, 1); !written.has_value()) {
+            return written;
+        }
+    }
+
+    std::vector<HashEntry> hash_table = make_hash_table(written_blocks);
+    std::vector<BlockEntry> block_table;
+    block_table.reserve(written_blocks.size());
+    std::ranges::transform(written_blocks, std::back_inserter(block_table), &WrittenBlock::block);
+
+    const uint64_t archive_size = position + ((hash_table.size() + block_table.size()) * sizeof(HashEntry));
+    if (archive_size > std::numeric_limits<uint32_t>::max()) {
+        return std::unexpected("Archive is larger than 4 GB.");
+    }
+    const ArchiveHeader header{
+        .magic = ArchiveHeader::kMagic,
+        .header_size = sizeof(ArchiveHeader),
+        .archive_size = static_cast<uint32_t>(archive_size),
+        .format_version = 0,
+        .sector_size_shift = options.sector_size_shift,
+        .hash_table_offset = static_cast<uint32_t>(position),
+        .block_table_offset = static_cast<uint32_t>(position + (hash_table.size() * sizeof(HashEntry))),
+        .hash_table_entries = static_cast<uint32_t>(hash_table.size()),
+        .block_table_entries = static_cast<uint32_t>(block_table.size()) };
+
+    write_table(stream, std::move(hash_table), "(hash table)");
+    write_table(stream, std::move(block_table), "(block table)");
+    stream.seekp(0);
+    write_span<ArchiveHeader>(stream, std::span(&header, 1));
+    stream.close();
+    if (stream.fail()) {
+        return std::unexpected(std::format("Archive write error: {}", archive_path.string()));
+    }
+    return {};
+}
+
+// An archive without its tables cannot be read, it is not left behind
+void ArchiveWriter::State::discard()
+{
+    stream.close();
+    std::error_code error;
+    std::filesystem::remove(archive_path, error);
+    is_closed = true;
+}
+
+ArchiveWriter::ArchiveWriter() = default;
+
+ArchiveWriter::ArchiveWriter(ArchiveWriter&& other) noexcept = default;
+
+ArchiveWriter::~ArchiveWriter()
+{
+    if (state_ != nullptr && !state_->is_closed) {
+        state_->discard();
+    }
+}
+
+auto ArchiveWriter::open(const std::filesystem::path& archive_path, const ArchiveWriteOptions& options)
+    -> std::expected<ArchiveWriter, ErrorMessage>
+{
+    if (options.sector_size_shift > kMaxSectorSizeShift) {
+        return std::unexpected("Sector size is too large.");
+    }
+
+    ArchiveWriter writer;
+    writer.state_ = std::make_unique<State>();
+    State& state = *writer.state_;
+    state.archive_path = archive_path;
+    state.options = options;
+    state.sector_size = kBaseSectorSize << options.sector_size_shift;
+    state.thread_count = options.thread_count != 0 ? options.thread_count : WorkerPool::instance().concurrency();
+    for (const auto& rule : options.compression_rules) {
+        auto filter = GlobFilter::compile(rule.mask);
+        if (!filter.has_value()) {
+            return std::unexpected(filter.error());
+        }
+        state.compression_rules.emplace_back(std::move(filter.value()), rule.compression);
+    }
+
+    // The header is written again once the tables are placed
+    state.stream.open(archive_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    const ArchiveHeader header {};
+    write_span<ArchiveHeader>(state.stream, std::span(&header, 1));
+    if (!state.stream) {
+        state.discard();
+        return std::unexpected(std::format("Archive write error: {}", archive_path.string()));
+    }
+
+    return writer;
+}
+
+auto ArchiveWriter::add(ArchiveFile file)-> std::expected<void, ErrorMessage>
+{
+    if (state_ == nullptr || state_->is_closed) {
+        return std::unexpected("Archive writer is closed.");
+    }
+
+    if (auto queued = state_->queue(std::move(file)); !queued.has_value()) {
+        return queued;
+    }
+    ++state_->file_count;
+
+    if (state_->pending_size >= state_->options.batch_size) {
+        if (auto written = state_->write_pending(); !written.has_value()) {
+            state_->discard();
+            return written;
+        }
+    }
+    return {};
+}
+
+auto ArchiveWriter::finish()-> std::expected<size_t, ErrorMessage>
+{
+    if (state_ == nullptr || state_->is_closed) {
+        return std::unexpected("Archive writer is closed.");
+    }
+
+    if (auto written = state_->write_tables(); !written.has_value()) {
+        state_->discard();
+        return std::unexpected(written.error());
+    }
+    state_->is_closed = true;
+
+    return state_->file_count;
+}
+
+auto write_mpq_archive(const std::filesystem::path& archive_path, const std::vector<ArchiveFile>& files, const ArchiveWriteOptions& options)
+    -> std::expected<size_t, ErrorMessage>
+{
+    auto writer = ArchiveWriter::open(archive_path, options);
+    if (!writer.has_value()) {
+        return std::unexpected(writer.error());
+    }
+
+    for (const auto& file : files) {
+        if (auto added = writer->add(ArchiveFile{ .filename = file.filename, .data = file.data.clone() }); !added.has_value()) {
+            return std::unexpected(added.error());
+        }
+    }
+    return writer->finish();
+}
+
+} // namespace assmpq::mpq
@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <format>
+#include <ranges>
+
+#include "assets_mpq_importer/glob.hpp"
+
+namespace assmpq::mpq {
+
+namespace {
+
+// One bit per pattern position, the last position accepts the name
+using StateSet = std::array<uint64_t, (GlobFilter::kMaxPatternTokens / 64) + 1>;
+
+constexpr auto kNormalizedChars = [] {
+    std::array<char, 256> table {};
+    for (size_t idx = 0; idx < table.size(); ++idx) {
+        auto ch = static_cast<char>(idx);
+        if (ch == '\\') {
+            ch = '/';
+        } else if (ch >= 'A' && ch <= 'Z') {
+            ch = static_cast<char>(ch - 'A' + 'a');
+        }
+        table[idx] = ch;
+    }
+    return table;
+}();
+
+constexpr auto normalize_char(char ch)-> char
+{
+    return kNormalizedChars[static_cast<unsigned char>(ch)];
+}
+
+constexpr auto is_separator(char ch)-> bool
+{
+    return ch == '/' || ch == '\\';
+}
+
+constexpr void set_state(StateSet& states, size_t state)
+{
+    states[state / 64] |= uint64_t { 1 } << (state % 64);
+}
+
+constexpr auto has_state(const StateSet& states, size_t state)-> bool
+{
+    return (states[state / 64] & (uint64_t { 1 } << (state % 64))) != 0;
+}
+
+constexpr auto to_class_bit(char ch)-> size_t
+{
+    return static_cast<unsigned char>(ch);
+}
+
+} // namespace
+
+auto GlobFilter::compile(std::string_view patterns)-> std::expected<GlobFilter, ErrorMessage>
+{
+    GlobFilter filter;
+
+    size_t pos = 0;
+    while (pos <= patterns.size()) {
+        const size_t end = std::min(patterns.find(';', pos), patterns.size());
+        std::string_view pattern = patterns.substr(pos, end - pos);
+        pos = end + 1;
+
+        const bool is_exclude = pattern.starts_with('!');
+        if (is_exclude) {
+            pattern.remove_prefix(1);
+        }
+        if (pattern.empty()) {
+            continue;
+        }
+
+        auto compiled = compile_pattern(pattern);
+        if (!compiled.has_value()) {
+            return std::unexpected(compiled.error());
+        }
+        (is_exclude ? filter.excludes_ : filter.includes_).push_back(std::move(compiled.value()));
+    }
+
+    return filter;
+}
+
+auto GlobFilter::matches(std::string_view filename) const-> bool
+{
+    if (filename.empty()) {
+        return false;
+    }
+
+    const auto match = [filename](const Pattern& pattern) { return match_pattern(pattern, filename); };
+
+    return (includes_.empty() || std::ranges::any_of(includes_, match)) && std::ranges::none_of(excludes_, match);
+}
+
+auto GlobFilter::compile_pattern(std::string_view pattern)-> std::expected<Pattern, ErrorMessage>
+{
+    Pattern result;
+    result.is_path_aware = pattern.contains("**");
+
+    for (size_t pos = 0; pos < pattern.size(); ++pos) {
+        const char ch = pattern[pos];
+
+        if (ch == '*') {
+            if (pos + 1 < pattern.size() && pattern[pos + 1] == '*') {
+                while (pos + 1 < pattern.size() && pattern[pos + 1] == '*') {
+                    ++pos;
+                }
+                if (pos + 1 < pattern.size() && is_separator(pattern[pos + 1])) {
+                    ++pos;
+                    result.tokens.push_back(Token{ .kind = TokenKind::GlobstarDir });
+                } else {
+                    result.tokens.push_back(Token{ .kind = TokenKind::Globstar });
+                }
+            } else {
+                result.tokens.push_back(Token{ .kind = TokenKind::Star });
+            }
+        } else if (ch == '?') {
+            result.tokens.push_back(Token{ .kind = TokenKind::AnyChar });
+        } else if (ch == '[') {
+            size_t class_pos = pos + 1;
+            const bool is_negated = class_pos < pattern.size() && (pattern[class_pos] == '!' || pattern[class_pos] == '^');
+            if (is_negated) {
+                ++class_pos;
+            }
+
+            std::bitset<256> char_class;
+            // A ']' right after the opening bracket is a literal
+            bool is_first = true;
+            while (class_pos < pattern.size() && (pattern[class_pos] != ']' || is_first)) {
+                const char range_begin = pattern[class_pos];
+                char range_end = range_begin;
+                if (class_pos + 2 < pattern.size() && pattern[class_pos + 1] == '-' && pattern[class_pos + 2] != ']') {
+                    range_end = pattern[class_pos + 2];
+                    class_pos += 2;
+                }
+                for (int range_ch = static_cast<unsigned char>(range_begin); range_ch <= static_cast<unsigned char>(range_end); ++range_ch) {
+                    char_class.set(to_class_bit(normalize_char(static_cast<char>(range_ch))));
+                }
+                ++class_pos;
+                is_first = false;
+            }
+
+            if (class_pos >= pattern.size()) {
+                return std::unexpected(std::format("Unclosed character class in pattern: {}", pattern));
+            }
+
+            if (is_negated) {
+                char_class.flip();
+            }
+            result.tokens.push_back(Token{ .kind = TokenKind::Class, .class_idx = static_cast<uint8_t>(result.classes.size()) });
+            result.classes.push_back(char_class);
+            pos = class_pos;
+        } else {
+            result.tokens.push_back(Token{ .kind = TokenKind::Char, .value = normalize_char(ch) });
+        }
+
+        if (result.tokens.size() > kMaxPatternTokens) {
+            return std::unexpected(std::format("Pattern is too long: {}", pattern));
+        }
+    }
+
+    for (size_t token_idx = 0; token_idx < result.tokens.size(); ++token_idx) {
+        const TokenKind kind = result.tokens[token_idx].kind;
+        if (kind == TokenKind::Star || kind == TokenKind::Globstar || kind == TokenKind::GlobstarDir) {
+            result.star_positions.push_back(token_idx);
+        }
+    }
+
+    for (const auto& token : result.tokens) {
+        if (token.kind != TokenKind::Char) {
+            break;
+        }
+        result.literal_prefix.push_back(token.value);
+    }
+
+    for (const auto& token : result.tokens | std::views::reverse) {
+        if (token.kind != TokenKind::Char) {
+            break;
+        }
+        result.literal_suffix.insert(result.literal_suffix.begin(), token.value);
+    }
+
+    return result;
+}
+
+auto GlobFilter::match_tokens(const Pattern& pattern, size_t token_begin, size_t token_end, std::string_view filename, size_t name_pos)-> bool
+{
+    for (size_t token_idx = token_begin; token_idx < token_end; ++token_idx, ++name_pos) {
+        const Token& token = pattern.tokens[token_idx];
+        const char ch = normalize_char(filename[name_pos]);
+        if ((token.kind == TokenKind::Char && token.value != ch)
+            || (token.kind == TokenKind::Class && !pattern.classes[token.class_idx].test(to_class_bit(ch)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto GlobFilter::match_segments(const Pattern& pattern, std::string_view filename)-> bool
+{
+    // Any '*' spans separators here, so every literal segment between two stars
+    // can be taken at its leftmost occurrence without backtracking
+    const auto& tokens = pattern.tokens;
+    const auto next_star = [&tokens](size_t token_idx) {
+        while (token_idx < tokens.size() && tokens[token_idx].kind != TokenKind::Star) {
+            ++token_idx;
+        }
+        return token_idx;
+    };
+
+    const size_t head_end = next_star(0);
+    if (head_end == tokens.size()) {
+        return filename.size() == tokens.size() && match_tokens(pattern, 0, tokens.size(), filename, 0);
+    }
+
+    size_t tail_begin = tokens.size();
+    while (tokens[tail_begin - 1].kind != TokenKind::Star) {
+        --tail_begin;
+    }
+    const size_t tail_size = tokens.size() - tail_begin;
+
+    if (filename.size() < head_end + tail_size
+        || !match_tokens(pattern, 0, head_end, filename, 0)
+        || !match_tokens(pattern, tail_begin, tokens.size(), filename, filename.size() - tail_size)) {
+        return false;
+    }
+
+    size_t name_pos = head_end;
+    const size_t name_end = filename.size() - tail_size;
+    for (size_t segment_begin = head_end + 1; segment_begin < tail_begin;) {
+        const size_t segment_end = next_star(segment_begin);
+        const size_t segment_size = segment_end - segment_begin;
+
+        while (name_pos + segment_size <= name_end && !match_tokens(pattern, segment_begin, segment_end, filename, name_pos)) {
+            ++name_pos;
+        }
+        if (name_pos + segment_size > name_end) {
+            return false;
+        }
+
+        name_pos += segment_size;
+        segment_begin = segment_end + 1;
+    }
+
+    return true;
+}
+
+auto GlobFilter::match_pattern(const Pattern& pattern, std::string_view filename)-> bool
+{
+    // Most patterns start with a folder and end with an extension, reject on them before running the automaton
+    const auto& prefix = pattern.literal_prefix;
+    const auto& suffix = pattern.literal_suffix;
+    if (filename.size() < std::max(prefix.size(), suffix.size())
+        || !std::ranges::equal(filename.substr(0, prefix.size()), prefix, {}, normalize_char)
+        || !std::ranges::equal(filename.substr(filename.size() - suffix.size()), suffix, {}, normalize_char)) {
+        return false;
+    }
+
+    if (!pattern.is_path_aware) {
+        return match_segments(pattern, filename);
+    }
+
+    const auto& tokens = pattern.tokens;
+    const size_t accept_state = tokens.size();
+
+    // Stars match the empty sequence as well, so they also enable the next position
+    const auto add_empty_matches = [&pattern](StateSet& states) {
+        for (const size_t state : pattern.star_positions) {
+            if (has_state(states, state)) {
+                set_state(states, state + 1);
+            }
+        }
+    };
+
+    StateSet current {};
+    set_state(current, prefix.size());
+    add_empty_matches(current);
+
+    for (const char name_ch : filename.substr(prefix.size())) {
+        const char ch = normalize_char(name_ch);
+        const bool is_crossing = ch == '/' && pattern.is_path_aware;
+
+        StateSet next {};
+        // Globstar directories kept inside a path, they skip to the next token only right after a '/'
+        StateSet in_directory {};
+        bool is_alive = false;
+        for (size_t word_idx = 0; word_idx < current.size(); ++word_idx) {
+            for (uint64_t bits = current[word_idx]; bits != 0; bits &= bits - 1) {
+                const auto state = (word_idx * 64) + static_cast<size_t>(std::countr_zero(bits));
+                if (state == accept_state) {
+                    continue;
+                }
+
+                const Token& token = tokens[state];
+                bool is_advanced = false;
+                bool is_kept = false;
+                switch (token.kind) {
+                case TokenKind::Char:
+                    is_advanced = token.value == ch;
+                    break;
+                case TokenKind::AnyChar:
+                    is_advanced = !is_crossing;
+                    break;
+                case TokenKind::Class:
+                    is_advanced = !is_crossing && pattern.classes[token.class_idx].test(to_class_bit(ch));
+                    break;
+                case TokenKind::Star:
+                    is_kept = !is_crossing;
+                    break;
+                case TokenKind::Globstar:
+                    is_kept = true;
+                    break;
+                case TokenKind::GlobstarDir:
+                    is_kept = true;
+                    is_advanced = ch == '/';
+                    break;
+                }
+
+                if (is_advanced) {
+                    set_state(next, state + 1);
+                }
+                if (is_kept) {
+                    set_state(token.kind == TokenKind::GlobstarDir ? in_directory : next, state);
+                }
+                is_alive = is_alive || is_advanced || is_kept;
+            }
+        }
+
+        if (!is_alive) {
+            return false;
+        }
+
+        add_empty_matches(next);
+        for (size_t word_idx = 0; word_idx < next.size(); ++word_idx) {
+            next[word_idx] |= in_directory[word_idx];
+        }
+        current = next;
+    }
+
+    return has_state(current, accept_state);
+}
+
+} // namespace assmpq::mpq
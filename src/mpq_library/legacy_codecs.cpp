@@ -0,0 +1,661 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include <huffman/huffman.h>
+
+#include "legacy_codecs.hpp"
+
+namespace assmpq::mpq {
+
+namespace {
+
+/// @brief LSB-first bit reader, reads zeros past the end of the input
+class BitReader {
+public:
+    explicit BitReader(std::span<const char> input) : input_(input) {}
+
+    /// @brief Next count bits, count is at most 32
+    auto peek(unsigned count)-> uint32_t
+    {
+        if (bit_count_ < count) {
+            refill();
+        }
+        return static_cast<uint32_t>(bits_ & ((uint64_t { 1 } << count) - 1));
+    }
+
+    void skip(unsigned count)
+    {
+        bits_ >>= count;
+        bit_count_ -= count;
+    }
+
+    auto read(unsigned count)-> uint32_t
+    {
+        const uint32_t value = peek(count);
+        skip(count);
+        return value;
+    }
+
+    /// @brief Number of consumed bits
+    [[nodiscard]] auto position() const-> size_t { return (byte_pos_ * 8) - bit_count_; }
+    [[nodiscard]] auto size() const-> size_t { return input_.size() * 8; }
+
+private:
+    void refill()
+    {
+        // The bits above bit_count_ already hold the start of the next word, OR-ing it again keeps them
+        if (byte_pos_ + sizeof(uint64_t) <= input_.size()) {
+            uint64_t word = 0;
+            std::memcpy(&word, input_.data() + byte_pos_, sizeof(word)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            bits_ |= word << bit_count_;
+            const unsigned byte_count = (63 - bit_count_) / 8;
+            byte_pos_ += byte_count;
+            bit_count_ += byte_count * 8;
+            return;
+        }
+        while (bit_count_ <= 56) {
+            const uint64_t byte = byte_pos_ < input_.size() ? static_cast<uint8_t>(input_[byte_pos_]) : 0;
+            bits_ |= byte << bit_count_;
+            ++byte_pos_;
+            bit_count_ += 8;
+        }
+    }
+
+    std::span<const char> input_;
+    uint64_t bits_ = 0;
+    unsigned bit_count_ = 0;
+    size_t byte_pos_ = 0;
+};
+
+// PKWARE DCL tables, from explode.c of the PKWARE decoder in wc3lib
+
+constexpr uint8_t kImplodeBinary = 0;
+constexpr uint8_t kImplodeAscii = 1;
+constexpr uint32_t kImplodeEndLengthCode = 15;
+constexpr uint32_t kImplodeEndExtraLength = 0xFF;
+
+constexpr std::array<uint8_t, 64> kDistanceBits {
+    0x02, 0x04, 0x04, 0x05, 0x05, 0x05, 0x05, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+    0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+    0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07,
+    0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+};
+
+constexpr std::array<uint8_t, 64> kDistanceCodes {
+    0x03, 0x0D, 0x05, 0x19, 0x09, 0x11, 0x01, 0x3E, 0x1E, 0x2E, 0x0E, 0x36, 0x16, 0x26, 0x06, 0x3A,
+    0x1A, 0x2A, 0x0A, 0x32, 0x12, 0x22, 0x42, 0x02, 0x7C, 0x3C, 0x5C, 0x1C, 0x6C, 0x2C, 0x4C, 0x0C,
+    0x74, 0x34, 0x54, 0x14, 0x64, 0x24, 0x44, 0x04, 0x78, 0x38, 0x58, 0x18, 0x68, 0x28, 0x48, 0x08,
+    0xF0, 0x70, 0xB0, 0x30, 0xD0, 0x50, 0x90, 0x10, 0xE0, 0x60, 0xA0, 0x20, 0xC0, 0x40, 0x80, 0x00,
+};
+
+constexpr std::array<uint8_t, 16> kExtraLengthBits {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+};
+
+constexpr std::array<uint16_t, 16> kLengthBase {
+    0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007,
+    0x0008, 0x000A, 0x000E, 0x0016, 0x0026, 0x0046, 0x0086, 0x0106,
+};
+
+constexpr std::array<uint8_t, 16> kLengthBits {
+    0x03, 0x02, 0x03, 0x03, 0x04, 0x04, 0x04, 0x05, 0x05, 0x05, 0x05, 0x06, 0x06, 0x06, 0x07, 0x07,
+};
+
+constexpr std::array<uint8_t, 16> kLengthCodes {
+    0x05, 0x03, 0x01, 0x06, 0x0A, 0x02, 0x0C, 0x14, 0x04, 0x18, 0x08, 0x30, 0x10, 0x20, 0x40, 0x00,
+};
+
+constexpr std::array<uint8_t, 256> kAsciiBits {
+    0x0B, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x08, 0x07, 0x0C, 0x0C, 0x07, 0x0C, 0x0C,
+    0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0D, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C,
+    0x04, 0x0A, 0x08, 0x0C, 0x0A, 0x0C, 0x0A, 0x08, 0x07, 0x07, 0x08, 0x09, 0x07, 0x06, 0x07, 0x08,
+    0x07, 0x06, 0x07, 0x07, 0x07, 0x07, 0x08, 0x07, 0x07, 0x08, 0x08, 0x0C, 0x0B, 0x07, 0x09, 0x0B,
+    0x0C, 0x06, 0x07, 0x06, 0x06, 0x05, 0x07, 0x08, 0x08, 0x06, 0x0B, 0x09, 0x06, 0x07, 0x06, 0x06,
+    0x07, 0x0B, 0x06, 0x06, 0x06, 0x07, 0x09, 0x08, 0x09, 0x09, 0x0B, 0x08, 0x0B, 0x09, 0x0C, 0x08,
+    0x0C, 0x05, 0x06, 0x06, 0x06, 0x05, 0x06, 0x06, 0x06, 0x05, 0x0B, 0x07, 0x05, 0x06, 0x05, 0x05,
+    0x06, 0x0A, 0x05, 0x05, 0x05, 0x05, 0x08, 0x07, 0x08, 0x08, 0x0A, 0x0B, 0x0B, 0x0C, 0x0C, 0x0C,
+    0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D,
+    0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D,
+    0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D,
+    0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C,
+    0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C,
+    0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C,
+    0x0D, 0x0C, 0x0D, 0x0D, 0x0D, 0x0C, 0x0D, 0x0D, 0x0D, 0x0C, 0x0D, 0x0D, 0x0D, 0x0D, 0x0C, 0x0D,
+    0x0D, 0x0D, 0x0C, 0x0C, 0x0C, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D, 0x0D,
+};
+
+constexpr std::array<uint16_t, 256> kAsciiCodes {
+    0x0490, 0x0FE0, 0x07E0, 0x0BE0, 0x03E0, 0x0DE0, 0x05E0, 0x09E0,
+    0x01E0, 0x00B8, 0x0062, 0x0EE0, 0x06E0, 0x0022, 0x0AE0, 0x02E0,
+    0x0CE0, 0x04E0, 0x08E0, 0x00E0, 0x0F60, 0x0760, 0x0B60, 0x0360,
+    0x0D60, 0x0560, 0x1240, 0x0960, 0x0160, 0x0E60, 0x0660, 0x0A60,
+    0x000F, 0x0250, 0x0038, 0x0260, 0x0050, 0x0C60, 0x0390, 0x00D8,
+    0x0042, 0x0002, 0x0058, 0x01B0, 0x007C, 0x0029, 0x003C, 0x0098,
+    0x005C, 0x0009, 0x001C, 0x006C, 0x002C, 0x004C, 0x0018, 0x000C,
+    0x0074, 0x00E8, 0x0068, 0x0460, 0x0090, 0x0034, 0x00B0, 0x0710,
+    0x0860, 0x0031, 0x0054, 0x0011, 0x0021, 0x0017, 0x0014, 0x00A8,
+    0x0028, 0x0001, 0x0310, 0x0130, 0x003E, 0x0064, 0x001E, 0x002E,
+    0x0024, 0x0510, 0x000E, 0x0036, 0x0016, 0x0044, 0x0030, 0x00C8,
+    0x01D0, 0x00D0, 0x0110, 0x0048, 0x0610, 0x0150, 0x0060, 0x0088,
+    0x0FA0, 0x0007, 0x0026, 0x0006, 0x003A, 0x001B, 0x001A, 0x002A,
+    0x000A, 0x000B, 0x0210, 0x0004, 0x0013, 0x0032, 0x0003, 0x001D,
+    0x0012, 0x0190, 0x000D, 0x0015, 0x0005, 0x0019, 0x0008, 0x0078,
+    0x00F0, 0x0070, 0x0290, 0x0410, 0x0010, 0x07A0, 0x0BA0, 0x03A0,
+    0x0240, 0x1C40, 0x0C40, 0x1440, 0x0440, 0x1840, 0x0840, 0x1040,
+    0x0040, 0x1F80, 0x0F80, 0x1780, 0x0780, 0x1B80, 0x0B80, 0x1380,
+    0x0380, 0x1D80, 0x0D80, 0x1580, 0x0580, 0x1980, 0x0980, 0x1180,
+    0x0180, 0x1E80, 0x0E80, 0x1680, 0x0680, 0x1A80, 0x0A80, 0x1280,
+    0x0280, 0x1C80, 0x0C80, 0x1480, 0x0480, 0x1880, 0x0880, 0x1080,
+    0x0080, 0x1F00, 0x0F00, 0x1700, 0x0700, 0x1B00, 0x0B00, 0x1300,
+    0x0DA0, 0x05A0, 0x09A0, 0x01A0, 0x0EA0, 0x06A0, 0x0AA0, 0x02A0,
+    0x0CA0, 0x04A0, 0x08A0, 0x00A0, 0x0F20, 0x0720, 0x0B20, 0x0320,
+    0x0D20, 0x0520, 0x0920, 0x0120, 0x0E20, 0x0620, 0x0A20, 0x0220,
+    0x0C20, 0x0420, 0x0820, 0x0020, 0x0FC0, 0x07C0, 0x0BC0, 0x03C0,
+    0x0DC0, 0x05C0, 0x09C0, 0x01C0, 0x0EC0, 0x06C0, 0x0AC0, 0x02C0,
+    0x0CC0, 0x04C0, 0x08C0, 0x00C0, 0x0F40, 0x0740, 0x0B40, 0x0340,
+    0x0300, 0x0D40, 0x1D00, 0x0D00, 0x1500, 0x0540, 0x0500, 0x1900,
+    0x0900, 0x0940, 0x1100, 0x0100, 0x1E00, 0x0E00, 0x0140, 0x1600,
+    0x0600, 0x1A00, 0x0E40, 0x0640, 0x0A40, 0x0A00, 0x1200, 0x0200,
+    0x1C00, 0x0C00, 0x1400, 0x0400, 0x1800, 0x0800, 0x1000, 0x0000,
+};
+
+/**
+ * @brief Expand a prefix code into a direct lookup table
+ * @details Codes are stored LSB first, so every index whose low bits match a code maps to its symbol.
+ */
+template<unsigned kIndexBits, typename Code, size_t kSymbols>
+consteval auto make_decode_table(const std::array<Code, kSymbols>& codes, const std::array<uint8_t, kSymbols>& code_bits)
+    -> std::array<uint8_t, size_t { 1 } << kIndexBits>
+{
+    std::array<uint8_t, size_t { 1 } << kIndexBits> table {};
+    for (size_t symbol = 0; symbol < kSymbols; ++symbol) {
+        for (size_t idx = codes[symbol]; idx < table.size(); idx += size_t { 1 } << code_bits[symbol]) {
+            table[idx] = static_cast<uint8_t>(symbol);
+        }
+    }
+    return table;
+}
+
+constexpr auto kLengthDecode = make_decode_table<8>(kLengthCodes, kLengthBits);
+constexpr auto kDistanceDecode = make_decode_table<8>(kDistanceCodes, kDistanceBits);
+constexpr auto kAsciiDecode = make_decode_table<13>(kAsciiCodes, kAsciiBits);
+
+// Storm Huffman coding, the tree update follows huffman.cpp of wc3lib
+
+constexpr uint32_t kHuffmanTypes = 9;
+constexpr size_t kHuffmanWeightStride = 258;    // Weight table entries per type
+constexpr uint16_t kHuffmanEnd = 0x100;
+constexpr uint16_t kHuffmanNewValue = 0x101;
+constexpr uint16_t kHuffmanNodeCount = 0x203;    // Leaves of all bytes and both codes, and their inner nodes
+constexpr uint16_t kNil = kHuffmanNodeCount;      // List head and the missing parent or child
+constexpr unsigned kQuickBits = 8;
+
+/**
+ * @brief Adaptive Huffman tree of Storm
+ * @details Nodes sit in one list sorted by descending weight, the two children of an inner
+ * node are its child and the node in front of it. Incrementing a weight moves the node in
+ * front of all lighter ones, swapping it with the first of them in the tree too.
+ * Paths up to kQuickBits long are cached until the tree changes.
+ */
+class HuffmanTree {
+public:
+    explicit HuffmanTree(uint32_t type);
+
+    /// @brief Decode the next value by walking down from the root
+    auto decode(BitReader& reader)-> uint16_t;
+
+    /// @brief Split the lightest leaf to give a new value a leaf of weight zero
+    [[nodiscard]] auto add_value(uint8_t value)-> bool;
+
+    /// @brief Increment the weights from a node to the root, false if the tree is damaged
+    [[nodiscard]] auto increment(uint16_t node)-> bool;
+
+    [[nodiscard]] auto leaf(uint16_t value) const-> uint16_t { return leaves_.at(value); }
+    [[nodiscard]] auto has_room() const-> bool { return node_count_ + 2 <= kHuffmanNodeCount; }
+
+private:
+    struct Node {
+        uint16_t next = kNil;
+        uint16_t prev = kNil;
+        uint16_t parent = kNil;
+        uint16_t child = kNil;
+        uint16_t value = 0;
+        uint32_t weight = 0;
+    };
+
+    struct QuickEntry {
+        uint32_t generation = 0;
+        uint16_t bit_count = 0;
+        uint16_t target = 0;        ///< Value for paths of up to kQuickBits, else the node reached after them
+    };
+
+    auto allocate(uint16_t value, uint32_t weight)-> uint16_t;
+    void unlink(uint16_t node);
+    void insert_after(uint16_t position, uint16_t node);
+
+    /// @brief Last node at or in front of from that is not lighter than weight, kNil if there is none
+    [[nodiscard]] auto find_heavier(uint16_t from, uint32_t weight) const-> uint16_t;
+
+    std::array<Node, kHuffmanNodeCount + 1> nodes_ {};
+    std::array<uint16_t, 0x102> leaves_ {};
+    std::array<QuickEntry, size_t { 1 } << kQuickBits> quick_ {};
+    uint32_t generation_ = 1;
+    uint16_t node_count_ = 0;
+};
+
+HuffmanTree::HuffmanTree(uint32_t type)
+{
+    // The weight tables are shared with the wc3lib encoder
+    const std::span<const uint8_t> weights(&huffman::THuffmannTree::Table1502A630[type * kHuffmanWeightStride], 0x100); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    uint32_t max_weight = 0;
+    for (uint16_t value = 0; value < 0x100; ++value) {
+        const uint32_t weight = weights[value];
+        if (weight == 0) {
+            continue;
+        }
+
+        const uint16_t node = allocate(value, weight);
+        leaves_[value] = node;
+        insert_after(kNil, node);
+        if (weight >= max_weight) {
+            max_weight = weight;
+            continue;
+        }
+        unlink(node);
+        insert_after(find_heavier(nodes_[kNil].prev, weight), node);
+    }
+
+    for (const uint16_t value : { kHuffmanEnd, kHuffmanNewValue }) {
+        leaves_[value] = allocate(value, 1);
+        insert_after(nodes_[kNil].prev, leaves_[value]);
+    }
+
+    // Pair the lightest nodes from the back of the list
+    for (uint16_t child = nodes_[kNil].prev; child != kNil && nodes_[child].prev != kNil;) {
+        const uint16_t sibling = nodes_[child].prev;
+        const uint16_t node = allocate(0, nodes_[child].weight + nodes_[sibling].weight);
+        nodes_[node].child = child;
+        nodes_[child].parent = node;
+        nodes_[sibling].parent = node;
+
+        insert_after(kNil, node);
+        if (nodes_[node].weight >= max_weight) {
+            max_weight = nodes_[node].weight;
+        } else {
+            const uint16_t position = find_heavier(nodes_[sibling].prev, nodes_[node].weight);
+            if (position != node) {
+                unlink(node);
+                insert_after(position, node);
+            }
+        }
+        child = nodes_[sibling].prev;
+    }
+}
+
+auto HuffmanTree::allocate(uint16_t value, uint32_t weight)-> uint16_t
+{
+    const uint16_t node = node_count_++;
+    nodes_[node] = Node { .value = value, .weight = weight };
+    return node;
+}
+
+void HuffmanTree::unlink(uint16_t node)
+{
+    nodes_[nodes_[node].prev].next = nodes_[node].next;
+    nodes_[nodes_[node].next].prev = nodes_[node].prev;
+}
+
+void HuffmanTree::insert_after(uint16_t position, uint16_t node)
+{
+    const uint16_t next = nodes_[position].next;
+    nodes_[node].next = next;
+    nodes_[node].prev = position;
+    nodes_[next].prev = node;
+    nodes_[position].next = node;
+}
+
+auto HuffmanTree::find_heavier(uint16_t from, uint32_t weight) const-> uint16_t
+{
+    uint16_t node = from;
+    while (node != kNil && nodes_[node].weight < weight) {
+        node = nodes_[node].prev;
+    }
+    return node;
+}
+
+auto HuffmanTree::decode(BitReader& reader)-> uint16_t
+{
+    const uint32_t quick_bits = reader.peek(kQuickBits);
+    QuickEntry& entry = quick_[quick_bits];
+    const bool cached = entry.generation == generation_;
+
+    uint16_t node = nodes_[kNil].next;
+    unsigned depth = 0;
+    if (cached) {
+        if (entry.bit_count <= kQuickBits) {
+            reader.skip(entry.bit_count);
+            return entry.target;
+        }
+        reader.skip(kQuickBits);
+        node = entry.target;
+        depth = kQuickBits;
+    }
+
+    uint16_t quick_node = kNil;
+    while (nodes_[node].child != kNil) {
+        node = nodes_[node].child;
+        if (reader.read(1) != 0) {
+            node = nodes_[node].prev;
+        }
+        if (++depth == kQuickBits) {
+            quick_node = node;
+        }
+    }
+
+    if (!cached) {
+        if (depth > kQuickBits) {
+            entry = QuickEntry { .generation = generation_, .bit_count = static_cast<uint16_t>(depth), .target = quick_node };
+        } else {
+            for (size_t idx = quick_bits & ((1U << depth) - 1); idx < quick_.size(); idx += size_t { 1 } << depth) {
+                quick_[idx] = QuickEntry { .generation = generation_, .bit_count = static_cast<uint16_t>(depth), .target = nodes_[node].value };
+            }
+        }
+    }
+    return nodes_[node].value;
+}
+
+auto HuffmanTree::add_value(uint8_t value)-> bool
+{
+    if (!has_room()) {
+        return false;
+    }
+
+    const uint16_t last = nodes_[kNil].prev;
+    const uint16_t moved = allocate(nodes_[last].value, nodes_[last].weight);
+    insert_after(nodes_[kNil].prev, moved);
+    nodes_[moved].parent = last;
+    leaves_.at(nodes_[moved].value) = moved;
+
+    const uint16_t added = allocate(value, 0);
+    insert_after(nodes_[kNil].prev, added);
+    nodes_[added].parent = last;
+    leaves_[value] = added;
+
+    nodes_[last].child = added;
+    ++generation_;
+    return increment(added);
+}
+
+auto HuffmanTree::increment(uint16_t node)-> bool
+{
+    for (; node != kNil; node = nodes_[node].parent) {
+        const uint32_t weight = ++nodes_[node].weight;
+
+        uint16_t lighter = node;
+        while (nodes_[lighter].prev != kNil && nodes_[nodes_[lighter].prev].weight < weight) {
+            lighter = nodes_[lighter].prev;
+        }
+        if (lighter == node) {
+            continue;
+        }
+        if (nodes_[lighter].parent == kNil) {
+            return false;
+        }
+
+        // Swap the list positions
+        const uint16_t position = nodes_[lighter].prev;
+        unlink(lighter);
+        insert_after(node, lighter);
+        unlink(node);
+        insert_after(position, node);
+
+        // Swap the tree positions
+        Node& node_parent = nodes_[nodes_[node].parent];
+        Node& lighter_parent = nodes_[nodes_[lighter].parent];
+        const bool lighter_is_child = lighter_parent.child == lighter;
+        if (node_parent.child == node) {
+            node_parent.child = lighter;
+        }
+        if (lighter_is_child) {
+            lighter_parent.child = node;
+        }
+        std::swap(nodes_[node].parent, nodes_[lighter].parent);
+        ++generation_;
+    }
+    return true;
+}
+
+// IMA ADPCM tables of Storm
+
+constexpr int32_t kAdpcmInitialStepIndex = 0x2C;
+constexpr int32_t kAdpcmMaxStepIndex = 0x58;
+
+constexpr std::array<int32_t, 89> kAdpcmSteps {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21,
+    23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66,
+    73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209,
+    230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+    7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+    22385, 24623, 27086, 29794, 32767,
+};
+
+// wc3lib stores the -1 entries as 0xFFFFFFFF in 64 bit integers, which breaks the step index on LP64 platforms
+constexpr std::array<int32_t, 32> kAdpcmStepIndexAdjust {
+    -1, 0, -1, 4, -1, 2, -1, 6, -1, 1, -1, 5, -1, 3, -1, 7,
+    -1, 1, -1, 5, -1, 3, -1, 7, -1, 2, -1, 4, -1, 6, -1, 8,
+};
+
+// Sum of the step fractions selected by the six low bits of a code, for every step
+constexpr auto kAdpcmDeltas = [] {
+    std::array<std::array<uint16_t, 64>, kAdpcmSteps.size()> deltas {};
+    for (size_t step_index = 0; step_index < kAdpcmSteps.size(); ++step_index) {
+        for (uint32_t code = 0; code < 64; ++code) {
+            int32_t delta = 0;
+            for (uint32_t bit = 0; bit < 6; ++bit) {
+                if ((code & (1U << bit)) != 0) {
+                    delta += kAdpcmSteps[step_index] >> bit;
+                }
+            }
+            deltas[step_index][code] = static_cast<uint16_t>(delta);
+        }
+    }
+    return deltas;
+}();
+
+template<size_t kChannels>
+auto decode_adpcm(std::span<const char> input, std::span<char> output)-> std::optional<size_t>
+{
+    constexpr size_t kHeaderSize = 2 + (kChannels * sizeof(int16_t));
+    if (input.size() < kHeaderSize) {
+        return std::nullopt;
+    }
+
+    size_t output_pos = 0;
+    const auto write_sample = [&output, &output_pos](int32_t sample) {
+        if (output.size() - output_pos < sizeof(int16_t)) {
+            return false;
+        }
+        const auto bits = static_cast<uint16_t>(sample);
+        output[output_pos] = static_cast<char>(bits & 0xFF);
+        output[output_pos + 1] = static_cast<char>(bits >> 8);
+        output_pos += sizeof(int16_t);
+        return true;
+    };
+
+    const auto shift = static_cast<uint8_t>(input[1]);
+    std::array<int32_t, kChannels> samples {};
+    std::array<int32_t, kChannels> step_indices {};
+    step_indices.fill(kAdpcmInitialStepIndex);
+    for (size_t channel = 0; channel < kChannels; ++channel) {
+        const auto low = static_cast<uint8_t>(input[2 + (channel * 2)]);
+        const auto high = static_cast<uint8_t>(input[3 + (channel * 2)]);
+        samples[channel] = static_cast<int16_t>(static_cast<uint16_t>(low | (high << 8)));
+        if (!write_sample(samples[channel])) {
+            return output_pos;
+        }
+    }
+
+    size_t channel = kChannels - 1;
+    for (const char byte : input.subspan(kHeaderSize)) {
+        const auto code = static_cast<uint8_t>(byte);
+        if constexpr (kChannels == 2) {
+            channel ^= 1;
+        }
+        int32_t& sample = samples[channel];
+        int32_t& step_index = step_indices[channel];
+
+        if ((code & 0x80) != 0) {
+            switch (code & 0x7F) {
+            case 0:     // Repeat the sample with a smaller step
+                step_index = std::max(step_index - 1, 0);
+                if (!write_sample(sample)) {
+                    return output_pos;
+                }
+                break;
+            case 1:     // Larger step, the next code is for the same channel
+                step_index = std::min(step_index + 8, kAdpcmMaxStepIndex);
+                channel ^= kChannels - 1;
+                break;
+            case 2:
+                break;
+            default:    // Smaller step, the next code is for the same channel
+                step_index = std::max(step_index - 8, 0);
+                channel ^= kChannels - 1;
+                break;
+            }
+            continue;
+        }
+
+        const int32_t step = kAdpcmSteps[static_cast<size_t>(step_index)];
+        const int32_t delta = (shift < 32 ? step >> shift : 0) + kAdpcmDeltas[static_cast<size_t>(step_index)][code & 0x3F];
+        sample = (code & 0x40) != 0 ? std::max(sample - delta, -32768) : std::min(sample + delta, 32767);
+        if (!write_sample(sample)) {
+            return output_pos;
+        }
+        step_index = std::clamp(step_index + kAdpcmStepIndexAdjust[code & 0x1F], 0, kAdpcmMaxStepIndex);
+    }
+    return output_pos;
+}
+
+} // namespace
+
+auto decode_implode(std::span<const char> input, std::span<char> output)-> std::optional<size_t>
+{
+    if (input.size() <= 4) {
+        return std::nullopt;
+    }
+    const auto mode = static_cast<uint8_t>(input[0]);
+    const auto dictionary_bits = static_cast<uint8_t>(input[1]);
+    if ((mode != kImplodeBinary && mode != kImplodeAscii) || dictionary_bits < 4 || dictionary_bits > 6) {
+        return std::nullopt;
+    }
+
+    BitReader reader(input.subspan(2));
+    // The PKWARE decoder fails on any code that leaves less than a byte of the input unread
+    const size_t bit_limit = reader.size() - 8;
+    size_t output_pos = 0;
+
+    for (;;) {
+        if (reader.read(1) == 0) {
+            uint32_t literal = 0;
+            if (mode == kImplodeBinary) {
+                literal = reader.read(8);
+            } else {
+                literal = kAsciiDecode[reader.peek(13)];
+                reader.skip(kAsciiBits[literal]);
+            }
+            if (reader.position() > bit_limit) {
+                return std::nullopt;
+            }
+            if (output_pos == output.size()) {
+                return output_pos;
+            }
+            output[output_pos++] = static_cast<char>(literal);
+            continue;
+        }
+
+        const uint8_t length_code = kLengthDecode[reader.peek(8)];
+        reader.skip(kLengthBits[length_code]);
+        if (reader.position() > bit_limit) {
+            return std::nullopt;
+        }
+        const uint32_t extra_length = reader.read(kExtraLengthBits[length_code]);
+        if (length_code == kImplodeEndLengthCode && extra_length == kImplodeEndExtraLength) {
+            return output_pos;
+        }
+        const size_t length = kLengthBase[length_code] + extra_length + 2;
+
+        const uint8_t distance_code = kDistanceDecode[reader.peek(8)];
+        reader.skip(kDistanceBits[distance_code]);
+        const unsigned distance_bits = length == 2 ? 2 : dictionary_bits;
+        const size_t distance = ((size_t { distance_code } << distance_bits) | reader.read(distance_bits)) + 1;
+        if (reader.position() > bit_limit || distance > output_pos) {
+            return std::nullopt;
+        }
+
+        // Repetitions may overlap their own output, the bytes are copied one by one
+        const size_t copy_size = std::min(length, output.size() - output_pos);
+        for (size_t idx = 0; idx < copy_size; ++idx, ++output_pos) {
+            output[output_pos] = output[output_pos - distance];
+        }
+        if (copy_size < length) {
+            return output_pos;
+        }
+    }
+}
+
+auto decode_huffman(std::span<const char> input, std::span<char> output)-> std::optional<size_t>
+{
+    if (input.empty()) {
+        return std::nullopt;
+    }
+
+    BitReader reader(input);
+    const uint32_t type = reader.read(8);
+    if (type >= kHuffmanTypes) {
+        return std::nullopt;
+    }
+    // Type 0 adapts to every decoded byte, the others only to new values
+    const bool adaptive = type == 0;
+
+    HuffmanTree tree(type);
+    size_t output_pos = 0;
+    while (output_pos < output.size()) {
+        uint16_t value = tree.decode(reader);
+        if (value == kHuffmanNewValue) {
+            value = static_cast<uint16_t>(reader.read(8));
+            if (!tree.add_value(static_cast<uint8_t>(value)) || (!adaptive && !tree.increment(tree.leaf(value)))) {
+                return std::nullopt;
+            }
+        }
+        if (reader.position() > reader.size()) {
+            return std::nullopt;
+        }
+        if (value == kHuffmanEnd) {
+            break;
+        }
+
+        output[output_pos++] = static_cast<char>(value);
+        if (adaptive && !tree.increment(tree.leaf(value))) {
+            return std::nullopt;
+        }
+    }
+    return output_pos;
+}
+
+auto decode_adpcm_mono(std::span<const char> input, std::span<char> output)-> std::optional<size_t>
+{
+    return decode_adpcm<1>(input, output);
+}
+
+auto decode_adpcm_stereo(std::span<const char> input, std::span<char> output)-> std::optional<size_t>
+{
+    return decode_adpcm<2>(input, output);
+}
+
+} // namespace assmpq::mpq
@@ -0,0 +1,43 @@
+#ifndef ASSMPQ_MPQ_LEGACY_CODECS_H_
+#define ASSMPQ_MPQ_LEGACY_CODECS_H_
+
+#include <optional>
+#include <span>
+
+namespace assmpq::mpq {
+
+/**
+ * @brief Decode PKWARE DCL imploded data
+ * @details Binary and ASCII modes with 1, 2 and 4 KB dictionaries. Repetitions are copied
+ * from the output itself, no sliding window is kept. Data past the end of the output is
+ * dropped, as the PKWARE decoder does.
+ * @param input Imploded data, starting with the mode and dictionary size bytes
+ * @param output Room for the exploded data
+ * @return Number of exploded bytes or nothing if the data is damaged
+ */
+[[nodiscard]] auto decode_implode(std::span<const char> input, std::span<char> output)-> std::optional<size_t>;
+
+/**
+ * @brief Decode Storm's adaptive Huffman coding
+ * @details The tree is rebuilt from the weight table named by the first byte of the input
+ * and updated while decoding, exactly as the encoder does.
+ * @param input Huffman coded data
+ * @param output Room for the decoded data
+ * @return Number of decoded bytes or nothing if the data is damaged
+ */
+[[nodiscard]] auto decode_huffman(std::span<const char> input, std::span<char> output)-> std::optional<size_t>;
+
+/**
+ * @brief Decode Storm's IMA ADPCM variant into 16 bit little-endian samples
+ * @param input ADPCM data of a mono sound
+ * @param output Room for the samples
+ * @return Number of decoded bytes or nothing if the data is damaged
+ */
+[[nodiscard]] auto decode_adpcm_mono(std::span<const char> input, std::span<char> output)-> std::optional<size_t>;
+
+/// @brief Stereo variant of decode_adpcm_mono, samples of the two channels are interleaved
+[[nodiscard]] auto decode_adpcm_stereo(std::span<const char> input, std::span<char> output)-> std::optional<size_t>;
+
+} // namespace assmpq::mpq
+
+#endif  /// ASSMPQ_MPQ_LEGACY_CODECS_H_
@@ -1,39 +1,150 @@
 #include <string>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <deque>
 #include <functional>
+#include <limits>
+#include <memory>
 #include <ranges>
 #include <filesystem>
 #include <expected>
-#include <regex>
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <spanstream>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
 
 #include <platform.hpp>
 #include <exception.hpp>
 #include <mpq/archive.hpp>
 #include <mpq/listfile.hpp>
+#include <mpq/attributes.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <md5-cc/md5.hh>
+#include <zlib.h>
 
 #include "assets_mpq_importer/mpq.hpp"
+#include "assets_mpq_importer/glob.hpp"
+#include "archive_index.hpp"
+#include "archive_sidecar.hpp"
+#include "name_dictionary.hpp"
+#include "sector_cache.hpp"
+#include "sector_codec.hpp"
+#include "worker_pool.hpp"
 
 
 namespace assmpq::mpq {
 
-using filelist_filter_t = std::function<bool(const std::string&)>;
+// Listfile entries, or nothing if the archive has no valid listfile
+static auto read_listfile_entries(wc3lib::mpq::Archive& archive, bool sorted = true)-> std::optional<wc3lib::mpq::Listfile::Entries>
+{
+    if (!archive.containsListfileFile()) {
+        return std::nullopt;
+    }
 
-static auto wildcard_to_regex(std::string mask)-> std::regex {
-    // Convert wildcard to regex pattern
-    // Simple replacements; for production, escape other regex special chars
-    std::size_t pos = 0;
-    while ((pos = mask.find('.', pos)) != std::string::npos) { mask.replace(pos, 1, "\\."); pos += 2; }
-    pos = 0;
-    while ((pos = mask.find('?', pos)) != std::string::npos) { mask.replace(pos, 1, "."); pos += 1; }
-    pos = 0;
-    while ((pos = mask.find('*', pos)) != std::string::npos) { mask.replace(pos, 1, ".*"); pos += 2; }
+    const wc3lib::mpq::Listfile filelist = archive.listfileFile();
+    if (!filelist.isValid()) {
+        return std::nullopt;
+    }
 
-    return std::regex(mask, std::regex_constants::icase); // icase for case-insensitive
+    wc3lib::mpq::Listfile::Entries entries = filelist.entries();
+    if (sorted) {
+        std::ranges::sort(entries);
+    }
+    return entries;
 }
 
-auto list_mpq_files(const std::filesystem::path& archive_path, const std::string& mask)
-    -> std::expected<ArchiveEntries, ErrorMessage>
+namespace {
+
+using indexed_file_callback_t = std::function<void(const FileEntry&, uint32_t block_index)>;
+
+// Hash table entry of every block, nullptr for blocks no entry points to.
+// A block stored in several locales keeps its neutral locale entry
+auto block_hash_entries(const ArchiveIndex& index)-> std::vector<const HashEntry*>
+{
+    const auto& block_table = index.block_table();
+
+    std::vector<const HashEntry*> block_hashes(block_table.size(), nullptr);
+    for (const auto& hash_entry : index.hash_table()) {
+        if (hash_entry.block_index >= block_table.size()) {
+            continue;
+        }
+        const HashEntry*& block_hash = block_hashes[hash_entry.block_index];
+        if (block_hash == nullptr || (block_hash->locale != 0 && hash_entry.locale == 0)) {
+            block_hash = &hash_entry;
+        }
+    }
+    return block_hashes;
+}
+
+// Walk the block table of an archive without a listfile, names come from the dictionary
+auto for_each_recovered_file(
+    const ArchiveIndex& index,
+    const NameDictionary& dictionary,
+    const GlobFilter& filter,
+    const indexed_file_callback_t& callback,
+    bool sorted)-> size_t
+{
+    const auto& block_table = index.block_table();
+    const auto block_hashes = block_hash_entries(index);
+
+    std::vector<std::pair<FileEntry, uint32_t>> recovered_entries;
+    for (uint32_t block_idx = 0; block_idx < block_table.size(); ++block_idx) {
+        const BlockEntry& block = block_table[block_idx];
+        if ((block.flags & ArchiveIndex::kBlockExists) == 0) {
+            continue;
+        }
+
+        std::optional<std::string_view> name;
+        if (const HashEntry* hash_entry = block_hashes[block_idx]; hash_entry != nullptr) {
+            name = dictionary.find(hash_entry->name_a, hash_entry->name_b);
+        }
+        // The key of an encrypted file is made from its name, without it the file cannot be read
+        if (!name.has_value() && (block.flags & ArchiveIndex::kBlockEncrypted) != 0) {
+            continue;
+        }
+
+        FileEntry entry{
+            .filename = name.has_value() ? std::string(name.value()) : std::format("File{:08}.xxx", block_idx),
+            .size = block.file_size };
+        if (filter.matches(entry.filename)) {
+            recovered_entries.emplace_back(std::move(entry), block_idx);
+        }
+    }
+
+    if (sorted) {
+        std::ranges::sort(recovered_entries, {}, [](const auto& recovered_entry) -> const std::string& {
+            return recovered_entry.first.filename;
+        });
+    }
+    for (const auto& [entry, block_idx] : recovered_entries) {
+        callback(entry, block_idx);
+    }
+
+    return recovered_entries.size();
+}
+
+// Files of the archive together with their block table index
+auto for_each_indexed_file(
+    const std::filesystem::path& archive_path,
+    const ArchiveIndex& index,
+    const indexed_file_callback_t& callback,
+    const std::string& mask,
+    bool sorted,
+    const std::filesystem::path& dictionary_path)
+    -> std::expected<size_t, ErrorMessage>
 {
     wc3lib::mpq::Archive archive;
 
@@ -43,56 +154,1233 @@ auto list_mpq_files(const std::filesystem::path& archive_path, const std::string
         return std::unexpected(exception.what());
     }
 
-    if (archive.containsListfileFile()) {
-        const wc3lib::mpq::Listfile filelist = archive.listfileFile();
+    const auto entries = read_listfile_entries(archive, sorted);
+    if (!entries.has_value() && dictionary_path.empty()) {
+        return std::unexpected("List file not found.");
+    }
+
+    const auto filter = GlobFilter::compile(mask);
+    if (!filter.has_value()) {
+        return std::unexpected(filter.error());
+    }
+
+    if (!entries.has_value()) {
+        const auto dictionary = NameDictionary::open(dictionary_path);
+        if (!dictionary.has_value()) {
+            return std::unexpected(dictionary.error());
+        }
+        return for_each_recovered_file(index, dictionary.value(), filter.value(), callback, sorted);
+    }
+
+    size_t visited_count = 0;
+    for (const auto& entry : entries.value() | std::views::filter(std::bind_front(&GlobFilter::matches, &filter.value()))) {
+        const auto block_idx = index.find_block_index(entry);
+        if (!block_idx.has_value()) {
+            continue;
+        }
+
+        callback(FileEntry{ .filename = entry, .size = index.block_table()[block_idx.value()].file_size }, block_idx.value());
+        ++visited_count;
+    }
+
+    return visited_count;
+}
+
+} // namespace
+
+auto for_each_mpq_file(
+    const std::filesystem::path& archive_path,
+    const file_entry_callback_t& callback,
+    const std::string& mask,
+    bool sorted,
+    const std::filesystem::path& dictionary_path)
+    -> std::expected<size_t, ErrorMessage>
+{
+    const auto index = ArchiveIndex::open_cached(archive_path);
+    if (!index.has_value()) {
+        return std::unexpected(index.error());
+    }
+
+    return for_each_indexed_file(archive_path, *index.value(), [&callback](const FileEntry& entry, uint32_t /*block_index*/) {
+        callback(entry);
+    }, mask, sorted, dictionary_path);
+}
+
+auto write_mpq_sidecar(const std::filesystem::path& archive_path, const std::filesystem::path& sidecar_path, const std::filesystem::path& dictionary_path)
+    -> std::expected<size_t, ErrorMessage>
+{
+    const auto cached_index = ArchiveIndex::open_cached(archive_path);
+    if (!cached_index.has_value()) {
+        return std::unexpected(cached_index.error());
+    }
+    const ArchiveIndex& index = *cached_index.value();
+
+    const auto archive_key = read_archive_key(archive_path);
+    if (!archive_key.has_value()) {
+        return std::unexpected("Archive open error.");
+    }
+
+    std::ifstream archive_stream(archive_path, std::ios::in | std::ios::binary);
+    std::vector<ArchiveSidecar::File> files;
+    const auto visited_count = for_each_indexed_file(archive_path, index, [&](const FileEntry& entry, uint32_t block_index) {
+        const auto sector_table = SectorTableCache::instance().get_or_load(archive_key.value(), block_index, [&] {
+            return index.read_sector_offsets(archive_stream, index.block_table()[block_index], entry.filename);
+        });
+        files.push_back(ArchiveSidecar::File{ .filename = entry.filename, .block_index = block_index, .sector_offsets = *sector_table });
+    }, "", false, dictionary_path);
+    if (!visited_count.has_value()) {
+        return std::unexpected(visited_count.error());
+    }
+
+    return ArchiveSidecar::write(sidecar_path, archive_path, index, std::move(files));
+}
+
+auto for_each_mpq_sidecar_file(
+    const std::filesystem::path& archive_path,
+    const std::filesystem::path& sidecar_path,
+    const file_entry_callback_t& callback,
+    const std::string& mask)
+    -> std::expected<size_t, ErrorMessage>
+{
+    const auto sidecar = ArchiveSidecar::open(sidecar_path, archive_path);
+    if (!sidecar.has_value()) {
+        return std::unexpected(sidecar.error());
+    }
+
+    const auto filter = GlobFilter::compile(mask);
+    if (!filter.has_value()) {
+        return std::unexpected(filter.error());
+    }
+
+    size_t visited_count = 0;
+    for (const auto& sidecar_entry : sidecar->entries()) {
+        const std::string_view filename = sidecar->name(sidecar_entry);
+        if (!filter->matches(filename)) {
+            continue;
+        }
+
+        // A visited file is usually extracted next, its sector table is known already
+        if (const auto sector_offsets = sidecar->sector_offsets(sidecar_entry); !sector_offsets.empty()) {
+            SectorTableCache::instance().insert(sidecar->archive_key(), sidecar_entry.block_index, { sector_offsets.begin(), sector_offsets.end() });
+        }
+        callback(FileEntry{ .filename = std::string(filename), .size = sidecar_entry.file_size });
+        ++visited_count;
+    }
+
+    return visited_count;
+}
+
+auto list_mpq_files(const std::filesystem::path& archive_path, const std::string& mask, const std::filesystem::path& dictionary_path)
+    -> std::expected<ArchiveEntries, ErrorMessage>
+{
+    ArchiveEntries archive_entries;
+
+    const auto visited_count = for_each_mpq_file(archive_path, [&archive_entries](const FileEntry& entry) {
+        archive_entries.push_back(entry);
+    }, mask, true, dictionary_path);
+    if (!visited_count.has_value()) {
+        return std::unexpected(visited_count.error());
+    }
+
+    return archive_entries;
+}
+
+auto build_name_dictionary(const std::vector<std::filesystem::path>& listfile_paths, const std::filesystem::path& dictionary_path)
+    -> std::expected<size_t, ErrorMessage>
+{
+    return NameDictionary::build(listfile_paths, dictionary_path);
+}
+
+namespace {
+
+/// Extended attributes of all blocks, empty vectors for absent attributes
+struct ArchiveAttributes {
+    wc3lib::mpq::Attributes::Crc32s crcs;
+    wc3lib::mpq::Attributes::FileTimes file_times;
+    wc3lib::mpq::Attributes::Md5s md5s;
+};
+
+auto read_archive_attributes(wc3lib::mpq::Archive& archive)-> ArchiveAttributes
+{
+    ArchiveAttributes attributes;
+    if (!archive.containsAttributesFile()) {
+        return attributes;
+    }
+
+    try {
+        wc3lib::int32 version = 0;
+        auto extended_attributes = wc3lib::mpq::Attributes::ExtendedAttributes::None;
+        archive.attributesFile().attributes(
+            version,
+            extended_attributes,
+            attributes.crcs,
+            attributes.file_times,
+            attributes.md5s);
+    } catch (const wc3lib::Exception &/*exception*/) {
+        // Damaged attributes only cost the checksum comparison
+        return {};
+    }
+
+    return attributes;
+}
+
+// Compares two files by block table entries and extended attributes, payloads are never read.
+// Zeroed attributes are treated as missing, so a file is reported changed unless a checksum proves otherwise.
+auto is_same_file(
+    const ArchiveIndex& old_index,
+    uint32_t old_block_idx,
+    const ArchiveAttributes& old_attributes,
+    const ArchiveIndex& new_index,
+    uint32_t new_block_idx,
+    const ArchiveAttributes& new_attributes
+)-> bool
+{
+    const BlockEntry& old_block = old_index.block_table()[old_block_idx];
+    const BlockEntry& new_block = new_index.block_table()[new_block_idx];
+    if (old_block.file_size != new_block.file_size) {
+        return false;
+    }
+
+    const size_t old_idx = old_block_idx;
+    const size_t new_idx = new_block_idx;
+
+    const auto has_attribute = [](const auto& old_values, size_t old_value_idx, const auto& new_values, size_t new_value_idx, const auto& empty_value) {
+        return old_value_idx < old_values.size() && new_value_idx < new_values.size()
+            && !(old_values[old_value_idx] == empty_value) && !(new_values[new_value_idx] == empty_value);
+    };
+
+    if (has_attribute(old_attributes.md5s, old_idx, new_attributes.md5s, new_idx, wc3lib::mpq::MD5Checksum{})) {
+        return old_attributes.md5s[old_idx] == new_attributes.md5s[new_idx];
+    }
+
+    if (has_attribute(old_attributes.crcs, old_idx, new_attributes.crcs, new_idx, wc3lib::mpq::CRC32{})) {
+        return old_attributes.crcs[old_idx] == new_attributes.crcs[new_idx];
+    }
+
+    if (has_attribute(old_attributes.file_times, old_idx, new_attributes.file_times, new_idx, wc3lib::mpq::FILETIME{})) {
+        return old_attributes.file_times[old_idx] == new_attributes.file_times[new_idx]
+            && old_block.compressed_size == new_block.compressed_size
+            && old_block.flags == new_block.flags;
+    }
+
+    return false;
+}
+
+} // namespace
+
+auto diff_mpq_archives(const std::filesystem::path& old_archive_path, const std::filesystem::path& new_archive_path, const std::string& mask)
+    -> std::expected<ArchiveDiff, ErrorMessage>
+{
+    wc3lib::mpq::Archive old_archive;
+    wc3lib::mpq::Archive new_archive;
+
+    try {
+        old_archive.open(old_archive_path.c_str());
+        new_archive.open(new_archive_path.c_str());
+    } catch (const wc3lib::Exception &exception) {
+        return std::unexpected(exception.what());
+    }
+
+    const auto old_entries = read_listfile_entries(old_archive);
+    const auto new_entries = read_listfile_entries(new_archive);
+    if (!old_entries.has_value() || !new_entries.has_value()) {
+        return std::unexpected("List file not found.");
+    }
+
+    const auto glob_filter = GlobFilter::compile(mask);
+    if (!glob_filter.has_value()) {
+        return std::unexpected(glob_filter.error());
+    }
+
+    const auto old_cached_index = ArchiveIndex::open_cached(old_archive_path);
+    const auto new_cached_index = ArchiveIndex::open_cached(new_archive_path);
+    if (!old_cached_index.has_value() || !new_cached_index.has_value()) {
+        return std::unexpected(!old_cached_index.has_value() ? old_cached_index.error() : new_cached_index.error());
+    }
+    const ArchiveIndex& old_index = *old_cached_index.value();
+    const ArchiveIndex& new_index = *new_cached_index.value();
+
+    const ArchiveAttributes old_attributes = read_archive_attributes(old_archive);
+    const ArchiveAttributes new_attributes = read_archive_attributes(new_archive);
+    const auto filter = std::bind_front(&GlobFilter::matches, &glob_filter.value());
+
+    ArchiveDiff archive_diff;
+
+    // Lookups go through the hash tables, so differently cased names still match
+    for (const auto& entry : new_entries.value() | std::views::filter(filter)) {
+        // Both tables use the same hashes, so every name is hashed once
+        const NameHashes name_hashes = hash_name(entry);
+        const auto new_block_idx = new_index.find_block_index(name_hashes);
+        if (!new_block_idx.has_value()) {
+            continue;
+        }
+
+        const auto old_block_idx = old_index.find_block_index(name_hashes);
+        if (!old_block_idx.has_value()) {
+            archive_diff.push_back(FileDiffEntry{ .filename = entry, .change = FileChange::Added });
+        } else if (!is_same_file(old_index, old_block_idx.value(), old_attributes, new_index, new_block_idx.value(), new_attributes)) {
+            archive_diff.push_back(FileDiffEntry{ .filename = entry, .change = FileChange::Changed });
+        }
+    }
+
+    for (const auto& entry : old_entries.value() | std::views::filter(filter)) {
+        const NameHashes name_hashes = hash_name(entry);
+        if (old_index.find_block_index(name_hashes).has_value() && !new_index.find_block_index(name_hashes).has_value()) {
+            archive_diff.push_back(FileDiffEntry{ .filename = entry, .change = FileChange::Removed });
+        }
+    }
+
+    std::ranges::sort(archive_diff, {}, &FileDiffEntry::filename);
+
+    return archive_diff;
+}
+
+namespace {
+
+/// Where the sectors of a file are stored, relative to the file data
+struct SectorLayout {
+    std::shared_ptr<const SectorTableCache::SectorTable> sector_table;   ///< Null for uncompressed files, their sectors are contiguous
+    uint64_t data_offset = 0;       ///< File data position in the archive file
+    uint32_t sector_size = 0;
+    uint32_t file_size = 0;
+    uint32_t flags = 0;             ///< Block table flags
+    uint32_t key = 0;               ///< Key of the first sector, used if the file is encrypted
+
+    [[nodiscard]] auto sector_count() const-> uint32_t
+    {
+        return static_cast<uint32_t>((uint64_t { file_size } + sector_size - 1) / sector_size);
+    }
+
+    [[nodiscard]] auto uncompressed_size(uint32_t sector_idx) const-> uint32_t
+    {
+        return std::min(sector_size, file_size - (sector_idx * sector_size));
+    }
+
+    [[nodiscard]] auto offset(uint32_t sector_idx) const-> uint32_t
+    {
+        return sector_table != nullptr ? (*sector_table)[sector_idx] : sector_idx * sector_size;
+    }
+
+    [[nodiscard]] auto stored_size(uint32_t sector_idx) const-> uint32_t
+    {
+        return sector_table != nullptr ? (*sector_table)[sector_idx + 1] - (*sector_table)[sector_idx] : uncompressed_size(sector_idx);
+    }
+};
+
+// Decode the sectors [first_sector, last_sector) of a layout from their stored run, which starts with the first of them.
+// The run is decrypted in place and checked against the sector checksums if there are any, 0 marks an unchecked sector.
+// Every sector is decoded straight into its slot of the output
+auto decode_sectors(
+    const SectorLayout& layout,
+    uint32_t first_sector,
+    uint32_t last_sector,
+    std::span<char> run,
+    std::span<const uint32_t> sector_checksums,
+    std::span<char> output)-> std::expected<void, ErrorMessage>
+{
+    const uint32_t run_begin = layout.offset(first_sector);
+    const auto sector_data = [&](uint32_t sector_idx) {
+        return run.subspan(layout.offset(sector_idx) - run_begin, layout.stored_size(sector_idx));
+    };
+
+    // Sectors are keyed by their index, the whole run is decrypted in one batch
+    if ((layout.flags & ArchiveIndex::kBlockEncrypted) != 0) {
+        std::vector<CryptBlock> sectors;
+        sectors.reserve(last_sector - first_sector);
+        for (uint32_t sector_idx = first_sector; sector_idx < last_sector; ++sector_idx) {
+            sectors.push_back(CryptBlock{ .data = sector_data(sector_idx), .key = layout.key + sector_idx });
+        }
+        decrypt_blocks(sectors);
+    }
+
+    const bool imploded = (layout.flags & ArchiveIndex::kBlockImploded) != 0;
+    for (uint32_t sector_idx = first_sector; sector_idx < last_sector; ++sector_idx) {
+        const std::span<char> sector = sector_data(sector_idx);
+        const std::span<char> target = output.subspan(size_t { sector_idx - first_sector } * layout.sector_size, layout.uncompressed_size(sector_idx));
+
+        // Checksums cover the stored sector, before decompression
+        if (sector_idx < sector_checksums.size() && sector_checksums[sector_idx] != 0
+            && adler32(0, reinterpret_cast<const Bytef*>(sector.data()), static_cast<uInt>(sector.size())) != sector_checksums[sector_idx]) { // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            return std::unexpected(std::format("Sector {} checksum mismatch.", sector_idx));
+        }
+
+        // Sectors that did not shrink are stored as they are, without a compression byte
+        if (sector.size() >= target.size()) {
+            std::ranges::copy(sector.first(target.size()), target.begin());
+            continue;
+        }
+
+        const auto sector_size = decompress_sector(sector, target, imploded);
+        if (!sector_size.has_value()) {
+            return std::unexpected(sector_size.error());
+        }
+        if (sector_size.value() != target.size()) {
+            return std::unexpected("Sector size mismatch.");
+        }
+    }
+    return {};
+}
+
+// Sector layout of a block in the mapped archive, a file stored in one piece is a single sector as large as the file.
+// The sector checksum table behind the last sector is read into sector_checksums
+auto verified_layout(const ArchiveIndex& index, std::span<const char> archive, const BlockEntry& block, uint32_t key, std::vector<uint32_t>& sector_checksums)
+    -> std::expected<SectorLayout, ErrorMessage>
+{
+    const uint64_t data_offset = index.archive_offset() + block.offset;
+    if (data_offset + block.compressed_size > archive.size()) {
+        return std::unexpected("File data is outside of the archive.");
+    }
+
+    SectorLayout layout{
+        .sector_table = nullptr,
+        .data_offset = data_offset,
+        .sector_size = (block.flags & ArchiveIndex::kBlockSingleUnit) != 0 ? block.file_size : index.sector_size(),
+        .file_size = block.file_size,
+        .flags = block.flags,
+        .key = key };
+
+    if ((block.flags & (ArchiveIndex::kBlockImploded | ArchiveIndex::kBlockCompressed)) == 0) {
+        if (block.compressed_size < block.file_size) {
+            return std::unexpected("File data is truncated.");
+        }
+        return layout;
+    }
+
+    if ((block.flags & ArchiveIndex::kBlockSingleUnit) != 0) {
+        layout.sector_table = std::make_shared<const SectorTableCache::SectorTable>(SectorTableCache::SectorTable{ 0, block.compressed_size });
+        return layout;
+    }
+
+    std::ispanstream stream(archive);
+    auto sector_offsets = read_sector_offsets(stream, data_offset, layout.sector_size, block, key);
+    const uint32_t sector_count = layout.sector_count();
+    if (sector_offsets.size() < size_t { sector_count } + 1) {
+        return std::unexpected("Sector offset table is damaged.");
+    }
+
+    // Stored like a sector, compressed if that made it smaller
+    if (sector_offsets.size() == size_t { sector_count } + 2) {
+        const std::span<const char> stored = archive.subspan(data_offset + sector_offsets[sector_count], sector_offsets[sector_count + 1] - sector_offsets[sector_count]);
+        const size_t table_size = size_t { sector_count } * sizeof(uint32_t);
+        if (!stored.empty() && stored.size() <= table_size) {
+            sector_checksums.resize(sector_count);
+            const std::span<char> table(reinterpret_cast<char*>(sector_checksums.data()), table_size); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            if (stored.size() == table_size) {
+                std::ranges::copy(stored, table.begin());
+            } else if (decompress_sector(stored, table, false).value_or(0) != table_size) {
+                return std::unexpected("Sector checksum table is damaged.");
+            }
+        }
+    }
+
+    layout.sector_table = std::make_shared<const SectorTableCache::SectorTable>(std::move(sector_offsets));
+    return layout;
+}
+
+// Block of a file by its name. A file of unknown name is listed as "File%08u.xxx" and resolves to that block,
+// unless it is encrypted: its key is made from the name, so it cannot be read
+auto resolve_block_index(const ArchiveIndex& index, std::string_view filename)-> std::expected<uint32_t, ErrorMessage>
+{
+    if (const auto block_index = index.find_block_index(filename); block_index.has_value()) {
+        return block_index.value();
+    }
+
+    constexpr std::string_view kPrefix = "File";
+    constexpr std::string_view kSuffix = ".xxx";
+    if (!filename.starts_with(kPrefix) || !filename.ends_with(kSuffix) || filename.size() < kPrefix.size() + kSuffix.size() + 8) {
+        return std::unexpected("File not found.");
+    }
+    const std::string_view digits = filename.substr(kPrefix.size(), filename.size() - kPrefix.size() - kSuffix.size());
+    uint32_t block_index = 0;
+    const auto [digits_end, parse_error] = std::from_chars(digits.data(), digits.data() + digits.size(), block_index);
+    if (parse_error != std::errc {} || digits_end != digits.data() + digits.size() || block_index >= index.block_table().size()) {
+        return std::unexpected("File not found.");
+    }
+
+    const BlockEntry& block = index.block_table()[block_index];
+    if ((block.flags & ArchiveIndex::kBlockExists) == 0) {
+        return std::unexpected("File not found.");
+    }
+    if ((block.flags & ArchiveIndex::kBlockEncrypted) != 0) {
+        return std::unexpected("File key is unknown.");
+    }
+    return block_index;
+}
 
-        if (filelist.isValid()) {
-            static auto mask_regex = wildcard_to_regex(mask);
+// Sector layout of a block in the mapped archive for extraction. The offset table of a file split into sectors
+// is shared through the sector table cache, sector checksums are left to verify_mpq_archive
+auto extraction_layout(const ArchiveIndex& index, const ArchiveKey& archive_key, std::span<const char> archive, uint32_t block_index, std::string_view filename)
+    -> std::expected<SectorLayout, ErrorMessage>
+{
+    const BlockEntry& block = index.block_table()[block_index];
+    const uint32_t key = (block.flags & ArchiveIndex::kBlockEncrypted) != 0 ? file_key(filename, block) : 0;
+    const bool is_split = (block.flags & (ArchiveIndex::kBlockImploded | ArchiveIndex::kBlockCompressed)) != 0
+        && (block.flags & ArchiveIndex::kBlockSingleUnit) == 0;
+    if (!is_split) {
+        std::vector<uint32_t> sector_checksums;
+        return verified_layout(index, archive, block, key, sector_checksums);
+    }
 
-            auto filter = mask.empty() ?
-                filelist_filter_t([](const std::string &entry)-> bool { return !entry.empty(); }) :
-                filelist_filter_t([](const std::string &entry)-> bool {
-                    return std::regex_match(entry, mask_regex);
-                });
+    const uint64_t data_offset = index.archive_offset() + block.offset;
+    if (data_offset + block.compressed_size > archive.size()) {
+        return std::unexpected("File data is outside of the archive.");
+    }
+
+    SectorLayout layout{
+        .sector_table = nullptr,
+        .data_offset = data_offset,
+        .sector_size = index.sector_size(),
+        .file_size = block.file_size,
+        .flags = block.flags,
+        .key = key };
+    layout.sector_table = SectorTableCache::instance().get_or_load(archive_key, block_index, [&] {
+        std::ispanstream stream(archive);
+        return read_sector_offsets(stream, data_offset, layout.sector_size, block, key);
+    });
+    if (layout.sector_table == nullptr || layout.sector_table->size() < size_t { layout.sector_count() } + 1) {
+        return std::unexpected("Sector offset table is damaged.");
+    }
+    return layout;
+}
 
-            wc3lib::mpq::Listfile::Entries entries = filelist.entries();
-            std::ranges::sort(entries);
+// Decode the sectors [first_sector, last_sector) of a layout from the mapped archive into output
+auto decompress_sectors(
+    std::span<const char> archive,
+    const SectorLayout& layout,
+    uint32_t first_sector,
+    uint32_t last_sector,
+    std::span<char> output)-> std::expected<void, ErrorMessage>
+{
+    const uint64_t run_begin = layout.data_offset + layout.offset(first_sector);
+    const uint64_t run_end = layout.data_offset + layout.offset(last_sector - 1) + layout.stored_size(last_sector - 1);
+    if (run_begin > run_end || run_end > archive.size()) {
+        return std::unexpected("File data is outside of the archive.");
+    }
 
-            return entries |
-                std::views::filter(filter) |
-                std::views::transform([&archive](const auto &entry)-> FileEntry {
-                    const wc3lib::mpq::File file = archive.findFile(entry);
-                    return FileEntry{ .filename = entry, .size = file.size() };
-                }) |
-                std::ranges::to<ArchiveEntries>();
+    // Copied out of the mapping, encrypted sectors are decrypted in place
+    thread_local std::vector<char> run;
+    const std::span<const char> stored = archive.subspan(run_begin, run_end - run_begin);
+    run.assign(stored.begin(), stored.end());
+
+    return decode_sectors(layout, first_sector, last_sector, run, {}, output);
+}
+
+constexpr uint32_t kSectorsPerWorker = 32;     // Smaller sector ranges are decompressed on the calling thread
+
+// Decompress the sectors [first_sector, last_sector) into output, large ranges are split across worker threads
+auto decompress_sector_range(
+    std::span<const char> archive,
+    const SectorLayout& layout,
+    uint32_t first_sector,
+    uint32_t last_sector,
+    std::span<char> output)-> std::expected<void, ErrorMessage>
+{
+    WorkerPool& pool = WorkerPool::instance();
+    const uint32_t sector_count = last_sector - first_sector;
+    const uint32_t worker_count = std::min(pool.concurrency(), sector_count / kSectorsPerWorker);
+    if (worker_count <= 1) {
+        return decompress_sectors(archive, layout, first_sector, last_sector, output);
+    }
+
+    // Every sector but the last one of a file inflates to exactly sector_size bytes,
+    // so each worker owns a fixed slice of the output
+    const uint64_t output_begin = uint64_t { first_sector } * layout.sector_size;
+    std::vector<std::expected<void, ErrorMessage>> results(worker_count);
+    pool.run(worker_count, worker_count, [&](size_t worker_idx) {
+        const auto chunk_first = static_cast<uint32_t>(first_sector + (uint64_t { sector_count } * worker_idx / worker_count));
+        const auto chunk_last = static_cast<uint32_t>(first_sector + (uint64_t { sector_count } * (worker_idx + 1) / worker_count));
+        const size_t slice_begin = (uint64_t { chunk_first } * layout.sector_size) - output_begin;
+        const size_t slice_end = std::min<uint64_t>((uint64_t { chunk_last } * layout.sector_size) - output_begin, output.size());
+        results[worker_idx] = decompress_sectors(archive, layout, chunk_first, chunk_last, output.subspan(slice_begin, slice_end - slice_begin));
+    });
+
+    for (const auto& result : results) {
+        if (!result.has_value()) {
+            return result;
         }
     }
+    return {};
+}
+
+// Bytes [offset, offset + length) of a file, clamped to its end, only the sectors covering them are decompressed
+auto read_file_range(const std::filesystem::path& archive_path, const std::string& filename, size_t offset, size_t length)
+    -> std::expected<FileData, ErrorMessage>
+{
+    const auto cached_index = ArchiveIndex::open_cached(archive_path);
+    if (!cached_index.has_value()) {
+        return std::unexpected(cached_index.error());
+    }
+    const ArchiveIndex& index = *cached_index.value();
+
+    const auto block_index = resolve_block_index(index, filename);
+    if (!block_index.has_value()) {
+        return std::unexpected(block_index.error());
+    }
+    const BlockEntry& block = index.block_table()[block_index.value()];
+    if (offset > block.file_size) {
+        return std::unexpected("Range is outside of the file.");
+    }
+    length = std::min<size_t>(length, block.file_size - offset);
+    if (length == 0) {
+        return {};
+    }
+
+    const auto archive_key = read_archive_key(archive_path);
+    if (!archive_key.has_value()) {
+        return std::unexpected("Archive open error.");
+    }
+
+    boost::iostreams::mapped_file_source mapping;
+    try {
+        mapping.open(archive_path.string());
+    } catch (const std::exception&) {
+        return std::unexpected("Archive open error.");
+    }
+    const std::span<const char> archive(mapping.data(), mapping.size());
+
+    const auto layout = extraction_layout(index, archive_key.value(), archive, block_index.value(), filename);
+    if (!layout.has_value()) {
+        return std::unexpected(layout.error());
+    }
+    if (layout->sector_size == 0) {
+        return std::unexpected("Archive sector size is invalid.");
+    }
 
-    return std::unexpected("List file not found.");
+    const auto first_sector = static_cast<uint32_t>(offset / layout->sector_size);
+    const auto last_sector = static_cast<uint32_t>((offset + length + layout->sector_size - 1) / layout->sector_size);
+    const uint64_t range_begin = uint64_t { first_sector } * layout->sector_size;
+    const uint64_t range_end = std::min<uint64_t>(uint64_t { last_sector } * layout->sector_size, layout->file_size);
+
+    // Every byte is written by the decoders, the buffer is not zeroed first
+    FileData buffer;
+    buffer.resize_uninitialized(range_end - range_begin);
+    const auto decompressed = decompress_sector_range(archive, layout.value(), first_sector, last_sector, buffer);
+    if (!decompressed.has_value()) {
+        return std::unexpected(decompressed.error());
+    }
+
+    buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(offset - range_begin));
+    buffer.resize(length);
+    return buffer;
+}
+
+} // namespace
+
+auto md5_digest(std::span<const char> data)-> std::array<uint8_t, 16>
+{
+    MD5 md5;
+    if (!data.empty()) {
+        md5.update(reinterpret_cast<unsigned char*>(const_cast<char*>(data.data())), static_cast<unsigned int>(data.size())); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-type-const-cast)
+    }
+    md5.finalize();
+
+    // The raw digest is allocated for the caller
+    const std::unique_ptr<unsigned char[]> digest(md5.raw_digest()); // NOLINT(cppcoreguidelines-avoid-c-arrays)
+    Md5Digest checksum {};
+    std::memcpy(checksum.data(), digest.get(), checksum.size());
+    return checksum;
 }
 
 auto extract_mpq_file(const std::filesystem::path& archive_path, const std::string& filename)
     -> std::expected<FileData, ErrorMessage>
 {
-    wc3lib::mpq::Archive archive;
+    return read_file_range(archive_path, filename, 0, std::numeric_limits<size_t>::max());
+}
+
+auto read_mpq_file_range(const std::filesystem::path& archive_path, const std::string& filename, size_t offset, size_t length)
+    -> std::expected<FileData, ErrorMessage>
+{
+    return read_file_range(archive_path, filename, offset, length);
+}
+
+auto mpq_file_source_key(const std::filesystem::path& archive_path, const std::string& filename)
+    -> std::expected<std::string, ErrorMessage>
+{
+    const auto cached_index = ArchiveIndex::open_cached(archive_path);
+    if (!cached_index.has_value()) {
+        return std::unexpected(cached_index.error());
+    }
+    const ArchiveIndex& index = *cached_index.value();
+
+    const auto archive_key = read_archive_key(archive_path);
+    if (!archive_key.has_value()) {
+        return std::unexpected("Archive open error.");
+    }
+
+    const auto block_index = resolve_block_index(index, filename);
+    if (!block_index.has_value()) {
+        return std::unexpected(block_index.error());
+    }
+    const BlockEntry& block = index.block_table()[block_index.value()];
+
+    return std::format("{}|{}|{}|{}|{}|{}|{}|{}",
+        archive_key->path, archive_key->size, archive_key->time,
+        index.archive_offset(), block.offset, block.compressed_size, block.file_size, block.flags);
+}
+
+namespace {
+
+/// Checksums of a block from the "(attributes)" file, zero values mark absent records
+struct BlockChecksums {
+    uint32_t crc32 = 0;
+    Md5Digest md5 {};
+};
+
+/// File under verification, its sector runs are decoded by whichever worker takes them
+struct VerifiedFile {
+    std::string filename;
+    SectorLayout layout;
+    std::vector<uint32_t> sector_checksums;     ///< Adler-32 of every stored sector, empty if the file has none
+    BlockChecksums checksums;
+    FileData data;                              ///< Allocated by the first decoded run, released once the file is checked
+    std::once_flag data_allocated;
+    std::atomic<uint32_t> pending_runs = 0;
+    std::atomic<bool> is_failed = false;
+};
+
+// Checksums of every block from the decoded "(attributes)" file, records cut short by the file end are absent
+auto parse_attributes(std::span<const char> data, size_t block_count)-> std::vector<BlockChecksums>
+{
+    std::vector<BlockChecksums> checksums(block_count);
+    std::array<uint32_t, 2> header {};      // Version and the kinds of stored records
+    if (data.size() < sizeof(header)) {
+        return checksums;
+    }
+    std::memcpy(header.data(), data.data(), sizeof(header));
+    data = data.subspan(sizeof(header));
+
+    // Records of one kind for all blocks, empty if the kind is not stored
+    const auto next_records = [&data, block_count, flags = header[1]](uint32_t kind, size_t record_size) {
+        if ((flags & kind) == 0 || data.size() < block_count * record_size) {
+            return std::span<const char> {};
+        }
+        const auto records = data.first(block_count * record_size);
+        data = data.subspan(records.size());
+        return records;
+    };
+
+    const auto crcs = next_records(kAttributesCrc32, sizeof(uint32_t));
+    next_records(kAttributesFileTime, sizeof(uint64_t));
+    const auto md5s = next_records(kAttributesMd5, sizeof(Md5Digest));
+    for (size_t block_idx = 0; block_idx < block_count; ++block_idx) {
+        if (!crcs.empty()) {
+            std::memcpy(&checksums[block_idx].crc32, crcs.data() + (block_idx * sizeof(uint32_t)), sizeof(uint32_t)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        }
+        if (!md5s.empty()) {
+            std::memcpy(checksums[block_idx].md5.data(), md5s.data() + (block_idx * sizeof(Md5Digest)), sizeof(Md5Digest)); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        }
+    }
+    return checksums;
+}
 
+// Decode the sectors [first_sector, first_sector + kSectorsPerWorker) of a file into its data
+auto verify_sector_run(std::span<const char> archive, VerifiedFile& file, uint32_t first_sector)-> std::expected<void, ErrorMessage>
+{
+    const SectorLayout& layout = file.layout;
+    const uint32_t last_sector = std::min(first_sector + kSectorsPerWorker, layout.sector_count());
+    std::call_once(file.data_allocated, [&file] { file.data.resize_uninitialized(file.layout.file_size); });
+
+    // Copied out of the mapping, encrypted sectors are decrypted in place
+    thread_local std::vector<char> run;
+    const std::span<const char> stored = archive.subspan(
+        layout.data_offset + layout.offset(first_sector),
+        layout.offset(last_sector - 1) + layout.stored_size(last_sector - 1) - layout.offset(first_sector));
+    run.assign(stored.begin(), stored.end());
+
+    return decode_sectors(layout, first_sector, last_sector, run, file.sector_checksums,
+        std::span(file.data).subspan(uint64_t { first_sector } * layout.sector_size));
+}
+
+// Compare a decoded file with its attributes, returns the number of matched checksums
+auto verify_file_checksums(const VerifiedFile& file)-> std::expected<size_t, ErrorMessage>
+{
+    size_t checksum_count = static_cast<size_t>(std::ranges::count_if(file.sector_checksums, [](uint32_t checksum) { return checksum != 0; }));
+
+    if (file.checksums.crc32 != 0) {
+        if (crc32(0, reinterpret_cast<const Bytef*>(file.data.data()), static_cast<uInt>(file.data.size())) != file.checksums.crc32) { // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+            return std::unexpected("CRC32 mismatch.");
+        }
+        ++checksum_count;
+    }
+
+    if (file.checksums.md5 != Md5Digest {}) {
+        if (md5_digest(file.data) != file.checksums.md5) {
+            return std::unexpected("MD5 mismatch.");
+        }
+        ++checksum_count;
+    }
+
+    return checksum_count;
+}
+
+} // namespace
+
+auto verify_mpq_archive(const std::filesystem::path& archive_path, bool fail_fast, const std::filesystem::path& dictionary_path)
+    -> std::expected<VerifyReport, ErrorMessage>
+{
+    const auto start_time = std::chrono::steady_clock::now();
+
+    const auto cached_index = ArchiveIndex::open_cached(archive_path);
+    if (!cached_index.has_value()) {
+        return std::unexpected(cached_index.error());
+    }
+    const ArchiveIndex& index = *cached_index.value();
+    const auto& block_table = index.block_table();
+
+    boost::iostreams::mapped_file_source mapping;
     try {
-        archive.open(archive_path.c_str());
+        mapping.open(archive_path.string());
+    } catch (const std::exception&) {
+        return std::unexpected("Archive open error.");
+    }
+    const std::span<const char> archive(mapping.data(), mapping.size());
+
+    // Only names that hash to their block are kept, encrypted files need them for their key
+    std::vector<std::string> names(block_table.size());
+    const auto add_name = [&index, &names](std::string_view filename, uint32_t block_index) {
+        if (index.find_block_index(filename) == block_index) {
+            names[block_index] = filename;
+        }
+    };
+    for (const std::string_view special_name : { "(listfile)", "(attributes)", "(signature)" }) {
+        if (const auto block_index = index.find_block_index(special_name); block_index.has_value()) {
+            add_name(special_name, block_index.value());
+        }
+    }
+    // An archive without a listfile and dictionary is still verified, its encrypted files are skipped
+    (void)for_each_indexed_file(archive_path, index, [&add_name](const FileEntry& entry, uint32_t block_index) {
+        add_name(entry.filename, block_index);
+    }, "", false, dictionary_path);
 
-        const wc3lib::mpq::File file = archive.findFile(filename);
-        if (!file.isValid()) {
-            return std::unexpected("File not found.");
+    VerifyReport report;
+    std::mutex report_mutex;
+    std::atomic<bool> is_stopped = false;
+    const auto add_failure = [&](const std::string& filename, const ErrorMessage& reason) {
+        const std::lock_guard lock(report_mutex);
+        report.failures.push_back(VerifyFailure{ .filename = filename, .reason = reason });
+        if (fail_fast) {
+            is_stopped = true;
+        }
+    };
+    const auto add_verified = [&](VerifiedFile& file) {
+        const auto checksum_count = verify_file_checksums(file);
+        FileData().swap(file.data);
+        if (!checksum_count.has_value()) {
+            add_failure(file.filename, checksum_count.error());
+            return;
         }
 
-        std::vector<char> buffer(file.size());
-        std::ospanstream output(buffer, std::ios::out | std::ios::binary);
-        file.decompress(output);
+        const std::lock_guard lock(report_mutex);
+        ++(checksum_count.value() > 0 ? report.verified_count : report.unchecked_count);
+        report.checksum_count += checksum_count.value();
+        report.byte_count += file.layout.file_size;
+    };
 
-        return buffer;
-    } catch (const wc3lib::Exception &exception) {
-        return std::unexpected(exception.what());
+    // Runs of at most kSectorsPerWorker sectors, in file order so that few files are decoded at a time
+    std::deque<VerifiedFile> files;
+    std::vector<std::pair<VerifiedFile*, uint32_t>> sector_runs;
+    std::vector<BlockChecksums> block_checksums(block_table.size());
+    const auto attributes_block = index.find_block_index("(attributes)");
+
+    // The attributes are verified first, every other file is compared with them
+    std::vector<uint32_t> block_order;
+    if (attributes_block.has_value()) {
+        block_order.push_back(attributes_block.value());
+    }
+    for (uint32_t block_idx = 0; block_idx < block_table.size(); ++block_idx) {
+        if (block_idx != attributes_block) {
+            block_order.push_back(block_idx);
+        }
+    }
+
+    for (const uint32_t block_idx : block_order) {
+        const BlockEntry& block = block_table[block_idx];
+        if ((block.flags & ArchiveIndex::kBlockExists) == 0 || is_stopped) {
+            continue;
+        }
+
+        const bool is_encrypted = (block.flags & ArchiveIndex::kBlockEncrypted) != 0;
+        if (is_encrypted && names[block_idx].empty()) {
+            ++report.skipped_count;
+            continue;
+        }
+
+        VerifiedFile& file = files.emplace_back();
+        file.filename = names[block_idx].empty() ? std::format("File{:08}.xxx", block_idx) : names[block_idx];
+        file.checksums = block_checksums[block_idx];
+
+        auto layout = verified_layout(index, archive, block, is_encrypted ? file_key(file.filename, block) : 0, file.sector_checksums);
+        if (!layout.has_value()) {
+            add_failure(file.filename, layout.error());
+            continue;
+        }
+        file.layout = std::move(layout.value());
+
+        const uint32_t sector_count = file.layout.file_size != 0 ? file.layout.sector_count() : 0;
+        file.pending_runs = (sector_count + kSectorsPerWorker - 1) / kSectorsPerWorker;
+        if (block_idx == attributes_block) {
+            // Decoded right away, its records are needed before the other files are queued
+            for (uint32_t first_sector = 0; first_sector < sector_count && !file.is_failed; first_sector += kSectorsPerWorker) {
+                if (const auto decoded = verify_sector_run(archive, file, first_sector); !decoded.has_value()) {
+                    file.is_failed = true;
+                    add_failure(file.filename, decoded.error());
+                }
+            }
+            if (!file.is_failed) {
+                block_checksums = parse_attributes(file.data, block_table.size());
+                add_verified(file);
+            }
+            continue;
+        }
+
+        if (sector_count == 0) {
+            add_verified(file);
+        }
+        for (uint32_t first_sector = 0; first_sector < sector_count; first_sector += kSectorsPerWorker) {
+            sector_runs.emplace_back(&file, first_sector);
+        }
+    }
+
+    std::atomic<size_t> next_run = 0;
+    const auto verify_runs = [&] {
+        for (size_t run_idx = next_run++; run_idx < sector_runs.size() && !is_stopped; run_idx = next_run++) {
+            auto& [file, first_sector] = sector_runs[run_idx];
+            if (!file->is_failed) {
+                if (const auto decoded = verify_sector_run(archive, *file, first_sector); !decoded.has_value() && !file->is_failed.exchange(true)) {
+                    add_failure(file->filename, decoded.error());
+                }
+            }
+
+            // The worker decoding the last run of a file checks it as a whole
+            if (--file->pending_runs == 0) {
+                if (file->is_failed) {
+                    FileData().swap(file->data);
+                } else {
+                    add_verified(*file);
+                }
+            }
+        }
+    };
+
+    // Every job takes runs until none is left
+    WorkerPool& pool = WorkerPool::instance();
+    const size_t worker_count = std::min<size_t>(pool.concurrency(), sector_runs.size());
+    pool.run(worker_count, pool.concurrency(), [&verify_runs](size_t) { verify_runs(); });
+
+    std::ranges::sort(report.failures, {}, &VerifyFailure::filename);
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return report;
+}
+
+namespace {
+
+constexpr uint32_t kSectorsPerStreamedRun = 64;     // Decoded sectors held in memory while a file is streamed
+
+// Drop an existing output before it is written, so a hard link or symlink is replaced instead of written
+// through to the file it points at, and an output a failed extraction left incomplete
+void remove_output(const std::filesystem::path& output_path)
+{
+    std::error_code error;
+    std::filesystem::remove(output_path, error);
+}
+
+// Copy the stored bytes [offset, offset + size) of the archive into the output file, inside the kernel where the platform allows it
+auto copy_stored_bytes(const std::filesystem::path& archive_path, uint64_t offset, uint32_t size, const std::filesystem::path& output_path)
+    -> std::expected<void, ErrorMessage>
+{
+#if defined(__linux__)
+    const int input_fd = ::open(archive_path.c_str(), O_RDONLY | O_CLOEXEC); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (input_fd < 0) {
+        return std::unexpected("Archive open error.");
+    }
+    remove_output(output_path);
+    const int output_fd = ::open(output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); // NOLINT(cppcoreguidelines-pro-type-vararg)
+    if (output_fd < 0) {
+        ::close(input_fd);
+        return std::unexpected(std::format("File write error: {}", output_path.string()));
+    }
+
+    // copy_file_range may share the extents on the filesystem, sendfile covers the kernels and filesystem pairs it rejects
+    auto input_offset = static_cast<off_t>(offset);
+    size_t bytes_left = size;
+    bool is_sendfile = false;
+    while (bytes_left > 0) {
+        const ssize_t copied = is_sendfile
+            ? ::sendfile(output_fd, input_fd, &input_offset, bytes_left)
+            : ::copy_file_range(input_fd, &input_offset, output_fd, nullptr, bytes_left, 0);
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (!is_sendfile && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                is_sendfile = true;
+                continue;
+            }
+        }
+        if (copied <= 0) {
+            break;
+        }
+        bytes_left -= static_cast<size_t>(copied);
+    }
+
+    ::close(input_fd);
+    if (::close(output_fd) != 0 || bytes_left > 0) {
+        remove_output(output_path);
+        return std::unexpected(std::format("File write error: {}", output_path.string()));
+    }
+#else
+    constexpr size_t kCopyBufferSize = 1024ULL * 1024;
+
+    std::ifstream input(archive_path, std::ios::in | std::ios::binary);
+    input.seekg(static_cast<std::streamoff>(offset));
+    remove_output(output_path);
+    std::ofstream output(output_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output) {
+        return std::unexpected(std::format("File write error: {}", output_path.string()));
+    }
+
+    std::vector<char> buffer(std::min<size_t>(size, kCopyBufferSize));
+    for (size_t bytes_left = size; bytes_left > 0 && input && output;) {
+        const size_t chunk_size = std::min(bytes_left, buffer.size());
+        input.read(buffer.data(), static_cast<std::streamsize>(chunk_size));
+        output.write(buffer.data(), input.gcount());
+        bytes_left -= static_cast<size_t>(input.gcount());
+    }
+    output.close();
+    if (!input || !output) {
+        remove_output(output_path);
+        return std::unexpected(std::format("File write error: {}", output_path.string()));
+    }
+#endif
+    return {};
+}
+
+// Decode a file from the mapped archive into the output file run by run, one run of sectors is held in memory
+auto stream_sectors(std::span<const char> archive, const SectorLayout& layout, const std::filesystem::path& output_path)
+    -> std::expected<void, ErrorMessage>
+{
+    remove_output(output_path);
+    std::ofstream output(output_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output) {
+        return std::unexpected(std::format("File write error: {}", output_path.string()));
+    }
+
+    const uint32_t sector_count = layout.file_size != 0 ? layout.sector_count() : 0;
+    std::vector<char> run;
+    FileData decoded;
+    std::expected<void, ErrorMessage> result;
+    for (uint32_t first_sector = 0; first_sector < sector_count; first_sector += kSectorsPerStreamedRun) {
+        const uint32_t last_sector = std::min(first_sector + kSectorsPerStreamedRun, sector_count);
+        const uint64_t run_begin = layout.data_offset + layout.offset(first_sector);
+        const uint64_t run_end = layout.data_offset + layout.offset(last_sector - 1) + layout.stored_size(last_sector - 1);
+        if (run_begin > run_end || run_end > archive.size()) {
+            result = std::unexpected("File data is outside of the archive.");
+            break;
+        }
+
+        // Copied out of the mapping, encrypted sectors are decrypted in place
+        const std::span<const char> stored = archive.subspan(run_begin, run_end - run_begin);
+        run.assign(stored.begin(), stored.end());
+        decoded.resize_uninitialized(std::min<uint64_t>(uint64_t { last_sector } * layout.sector_size, layout.file_size) - (uint64_t { first_sector } * layout.sector_size));
+        result = decode_sectors(layout, first_sector, last_sector, run, {}, decoded);
+        if (!result.has_value()) {
+            break;
+        }
+        output.write(decoded.data(), static_cast<std::streamsize>(decoded.size()));
+    }
+
+    output.close();
+    if (result.has_value() && !output) {
+        result = std::unexpected(std::format("File write error: {}", output_path.string()));
+    }
+    if (!result.has_value()) {
+        remove_output(output_path);
+    }
+    return result;
+}
+
+} // namespace
+
+auto extract_mpq_file_to(const std::filesystem::path& archive_path, const std::string& filename, const std::filesystem::path& output_path)
+    -> std::expected<uint64_t, ErrorMessage>
+{
+    const auto cached_index = ArchiveIndex::open_cached(archive_path);
+    if (!cached_index.has_value()) {
+        return std::unexpected(cached_index.error());
+    }
+    const ArchiveIndex& index = *cached_index.value();
+
+    const auto block_index = resolve_block_index(index, filename);
+    if (!block_index.has_value()) {
+        return std::unexpected(block_index.error());
+    }
+    const BlockEntry& block = index.block_table()[block_index.value()];
+
+    const auto archive_key = read_archive_key(archive_path);
+    if (!archive_key.has_value()) {
+        return std::unexpected("Archive open error.");
+    }
+
+    boost::iostreams::mapped_file_source mapping;
+    try {
+        mapping.open(archive_path.string());
+    } catch (const std::exception&) {
+        return std::unexpected("Archive open error.");
+    }
+    const std::span<const char> archive(mapping.data(), mapping.size());
+
+    const auto layout = extraction_layout(index, archive_key.value(), archive, block_index.value(), filename);
+    if (!layout.has_value()) {
+        return std::unexpected(layout.error());
+    }
+
+    // The stored bytes of a plain block are the file itself
+    const bool is_plain = (block.flags & (ArchiveIndex::kBlockImploded | ArchiveIndex::kBlockCompressed | ArchiveIndex::kBlockEncrypted)) == 0;
+    const auto extracted = is_plain
+        ? copy_stored_bytes(archive_path, layout->data_offset, block.file_size, output_path)
+        : stream_sectors(archive, layout.value(), output_path);
+    if (!extracted.has_value()) {
+        return std::unexpected(extracted.error());
+    }
+    return block.file_size;
+}
+
+
+namespace {
+
+constexpr auto name_key(uint32_t name_a, uint32_t name_b)-> uint64_t
+{
+    return (uint64_t { name_a } << 32U) | name_b;
+}
+
+// Whether the name hashes to the key, a placeholder of a file of unknown name does not
+auto is_hashed_name(std::string_view filename, uint64_t key)-> bool
+{
+    const NameHashes name_hashes = hash_name(filename);
+    return name_key(name_hashes.name_a, name_hashes.name_b) == key;
+}
+
+} // namespace
+
+auto ArchiveChain::open(const std::vector<std::filesystem::path>& archive_paths, const std::filesystem::path& dictionary_path)
+    -> std::expected<ArchiveChain, ErrorMessage>
+{
+    ArchiveChain chain;
+    chain.archive_paths_ = archive_paths;
+
+    for (size_t archive_idx = 0; archive_idx < archive_paths.size(); ++archive_idx) {
+        const std::filesystem::path& archive_path = archive_paths[archive_idx];
+        const auto index = ArchiveIndex::open_cached(archive_path);
+        if (!index.has_value()) {
+            return std::unexpected(std::format("{}: {}", archive_path.string(), index.error()));
+        }
+
+        // Files are keyed by the name hashes of their hash table entries, which a file of unknown name has as well
+        const auto block_hashes = block_hash_entries(*index.value());
+        const auto visited_count = for_each_indexed_file(archive_path, *index.value(), [&](const FileEntry& entry, uint32_t block_index) {
+            const HashEntry* hash_entry = block_hashes[block_index];
+            const NameHashes name_hashes = hash_entry != nullptr
+                ? NameHashes{ .table_offset = 0, .name_a = hash_entry->name_a, .name_b = hash_entry->name_b }
+                : hash_name(entry.filename);
+            const uint64_t key = name_key(name_hashes.name_a, name_hashes.name_b);
+
+            const auto [lookup, is_inserted] = chain.entry_lookup_.try_emplace(key, chain.entries_.size());
+            if (is_inserted) {
+                chain.entries_.push_back(Entry{ .file = entry, .name_key = key, .archive_idx = archive_idx });
+                return;
+            }
+
+            // A later archive overrides the earlier copy, a repeated entry of the same archive does not
+            Entry& chain_entry = chain.entries_[lookup->second];
+            if (chain_entry.archive_idx != archive_idx) {
+                // A patch without a listfile names an unknown file by its block, the earlier real name is kept
+                std::string filename = is_hashed_name(entry.filename, key) || !is_hashed_name(chain_entry.file.filename, key)
+                    ? entry.filename
+                    : std::move(chain_entry.file.filename);
+                chain_entry = Entry{ .file = FileEntry{ .filename = std::move(filename), .size = entry.size }, .name_key = key, .archive_idx = archive_idx };
+                ++chain.overridden_count_;
+            }
+        }, "", false, dictionary_path);
+        if (!visited_count.has_value()) {
+            return std::unexpected(std::format("{}: {}", archive_path.string(), visited_count.error()));
+        }
+    }
+
+    std::ranges::sort(chain.entries_, {}, [](const Entry& entry) -> const std::string& { return entry.file.filename; });
+    for (size_t entry_idx = 0; entry_idx < chain.entries_.size(); ++entry_idx) {
+        chain.entry_lookup_[chain.entries_[entry_idx].name_key] = entry_idx;
+    }
+
+    return chain;
+}
+
+auto ArchiveChain::find(std::string_view filename) const-> const std::filesystem::path*
+{
+    const NameHashes name_hashes = hash_name(filename);
+    if (const auto lookup = entry_lookup_.find(name_key(name_hashes.name_a, name_hashes.name_b)); lookup != entry_lookup_.end()) {
+        return &archive_paths_[entries_[lookup->second].archive_idx];
     }
+
+    // The placeholder of a file of unknown name does not hash to its key, the entries are sorted by name
+    const auto entry = std::ranges::lower_bound(entries_, filename, {}, [](const Entry& chain_entry) -> std::string_view {
+        return chain_entry.file.filename;
+    });
+    if (entry == entries_.end() || entry->file.filename != filename) {
+        return nullptr;
+    }
+    return &archive_paths_[entry->archive_idx];
+}
+
+auto ArchiveChain::source_key(const std::string& filename) const-> std::expected<std::string, ErrorMessage>
+{
+    const std::filesystem::path* archive_path = find(filename);
+    if (archive_path == nullptr) {
+        return std::unexpected("File not found.");
+    }
+
+    return mpq_file_source_key(*archive_path, filename);
 }
 
+auto ArchiveChain::for_each_file(const file_entry_callback_t& callback, const std::string& mask) const
+    -> std::expected<size_t, ErrorMessage>
+{
+    const auto filter = GlobFilter::compile(mask);
+    if (!filter.has_value()) {
+        return std::unexpected(filter.error());
+    }
+
+    size_t visited_count = 0;
+    for (const auto& entry : entries_) {
+        if (!filter->matches(entry.file.filename)) {
+            continue;
+        }
+
+        callback(entry.file);
+        ++visited_count;
+    }
+
+    return visited_count;
+}
+
+auto ArchiveChain::extract_file(const std::string& filename) const-> std::expected<FileData, ErrorMessage>
+{
+    const std::filesystem::path* archive_path = find(filename);
+    if (archive_path == nullptr) {
+        return std::unexpected("File not found.");
+    }
+
+    return extract_mpq_file(*archive_path, filename);
+}
+
+auto ArchiveChain::extract_file_to(const std::string& filename, const std::filesystem::path& output_path) const
+    -> std::expected<uint64_t, ErrorMessage>
+{
+    const std::filesystem::path* archive_path = find(filename);
+    if (archive_path == nullptr) {
+        return std::unexpected("File not found.");
+    }
+
+    return extract_mpq_file_to(*archive_path, filename, output_path);
+}
 
-}  // namespace assmpq::mpq
\ No newline at end of file
+}  // namespace assmpq::mpq
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "archive_index.hpp"
+#include "name_dictionary.hpp"
+
+namespace assmpq::mpq {
+
+namespace {
+
+constexpr uint32_t kDictionaryMagic = 0x4451504D;   // "MPQD"
+constexpr uint32_t kDictionaryVersion = 1;
+
+/// @brief Index file header, mirrors the on-disk layout
+struct DictionaryHeader {
+    uint32_t magic = kDictionaryMagic;
+    uint32_t version = kDictionaryVersion;
+    uint64_t record_count = 0;
+    uint64_t names_offset = 0;      ///< Name blob offset from the file start
+    uint64_t names_size = 0;
+};
+
+static_assert(sizeof(DictionaryHeader) == 32);
+
+constexpr auto is_name_separator(char ch)-> bool
+{
+    return ch == ';' || ch == '\r' || ch == '\n';
+}
+
+constexpr auto record_key(const DictionaryRecord& record)-> uint64_t
+{
+    return (uint64_t { record.name_a } << 32) | record.name_b;
+}
+
+} // namespace
+
+auto NameDictionary::build(std::span<const std::filesystem::path> listfile_paths, const std::filesystem::path& dictionary_path)
+    -> std::expected<size_t, ErrorMessage>
+{
+    std::string source_names;
+    for (const auto& listfile_path : listfile_paths) {
+        std::ifstream listfile_stream(listfile_path, std::ios::in | std::ios::binary);
+        if (!listfile_stream) {
+            return std::unexpected(std::format("Listfile read error: {}", listfile_path.string()));
+        }
+        source_names.append(std::istreambuf_iterator<char>(listfile_stream), std::istreambuf_iterator<char>());
+        source_names.push_back('\n');
+    }
+
+    if (source_names.size() > std::numeric_limits<uint32_t>::max()) {
+        return std::unexpected("Listfiles are too large.");
+    }
+
+    std::vector<DictionaryRecord> records;
+    for (size_t pos = 0; pos < source_names.size();) {
+        const auto name_begin = std::find_if_not(source_names.begin() + static_cast<std::ptrdiff_t>(pos), source_names.end(), is_name_separator);
+        const auto name_end = std::find_if(name_begin, source_names.end(), is_name_separator);
+        pos = static_cast<size_t>(name_end - source_names.begin());
+        if (name_begin == name_end) {
+            continue;
+        }
+
+        const NameHashes name_hashes = hash_name(std::string_view(name_begin, name_end));
+        records.push_back(DictionaryRecord{
+            .name_a = name_hashes.name_a,
+            .name_b = name_hashes.name_b,
+            .name_offset = static_cast<uint32_t>(name_begin - source_names.begin()),
+            .name_size = static_cast<uint32_t>(name_end - name_begin) });
+    }
+
+    // The stable sort keeps the first spelling of a name in front of its duplicates
+    std::ranges::stable_sort(records, {}, record_key);
+    const auto duplicates = std::ranges::unique(records, {}, record_key);
+    records.erase(duplicates.begin(), duplicates.end());
+
+    std::string names;
+    names.reserve(source_names.size());
+    for (auto& record : records) {
+        const size_t name_offset = names.size();
+        names.append(source_names, record.name_offset, record.name_size);
+        record.name_offset = static_cast<uint32_t>(name_offset);
+    }
+
+    const DictionaryHeader header{
+        .record_count = records.size(),
+        .names_offset = sizeof(DictionaryHeader) + (records.size() * sizeof(DictionaryRecord)),
+        .names_size = names.size() };
+
+    std::ofstream dictionary_stream(dictionary_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    dictionary_stream.write(reinterpret_cast<const char*>(&header), sizeof(header)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    dictionary_stream.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(DictionaryRecord))); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    dictionary_stream.write(names.data(), static_cast<std::streamsize>(names.size()));
+    if (!dictionary_stream) {
+        return std::unexpected(std::format("Dictionary write error: {}", dictionary_path.string()));
+    }
+
+    return records.size();
+}
+
+auto NameDictionary::open(const std::filesystem::path& dictionary_path)-> std::expected<NameDictionary, ErrorMessage>
+{
+    NameDictionary dictionary;
+
+    try {
+        dictionary.file_.open(dictionary_path.string());
+    } catch (const std::exception&) {
+        return std::unexpected(std::format("Dictionary open error: {}", dictionary_path.string()));
+    }
+
+    DictionaryHeader header;
+    const size_t file_size = dictionary.file_.size();
+    if (file_size < sizeof(header)) {
+        return std::unexpected(std::format("Invalid dictionary: {}", dictionary_path.string()));
+    }
+    std::memcpy(static_cast<void*>(&header), dictionary.file_.data(), sizeof(header));
+
+    const uint64_t records_size = header.record_count * sizeof(DictionaryRecord);
+    if (header.magic != kDictionaryMagic || header.version != kDictionaryVersion
+        || header.names_offset != sizeof(header) + records_size
+        || header.names_offset + header.names_size > file_size) {
+        return std::unexpected(std::format("Invalid dictionary: {}", dictionary_path.string()));
+    }
+
+    // The mapping is page aligned and the records follow the 32 byte header, so they are read in place
+    const char* data = dictionary.file_.data();
+    dictionary.records_ = std::span(reinterpret_cast<const DictionaryRecord*>(data + sizeof(header)), header.record_count); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    dictionary.names_ = std::string_view(data + header.names_offset, header.names_size); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    return dictionary;
+}
+
+auto NameDictionary::find(uint32_t name_a, uint32_t name_b) const-> std::optional<std::string_view>
+{
+    const uint64_t key = (uint64_t { name_a } << 32) | name_b;
+    const auto record = std::ranges::lower_bound(records_, key, {}, record_key);
+    if (record == records_.end() || record_key(*record) != key
+        || uint64_t { record->name_offset } + record->name_size > names_.size()) {
+        return std::nullopt;
+    }
+
+    return names_.substr(record->name_offset, record->name_size);
+}
+
+} // namespace assmpq::mpq
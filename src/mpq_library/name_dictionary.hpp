@@ -0,0 +1,70 @@
+#ifndef ASSMPQ_MPQ_NAME_DICTIONARY_H_
+#define ASSMPQ_MPQ_NAME_DICTIONARY_H_
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "assets_mpq_importer/assmpq.hpp"
+
+namespace assmpq::mpq {
+
+/// @brief Dictionary record, mirrors the on-disk layout
+struct DictionaryRecord {
+    uint32_t name_a = 0;            ///< Name hash of type A
+    uint32_t name_b = 0;            ///< Name hash of type B
+    uint32_t name_offset = 0;       ///< Offset in the name blob
+    uint32_t name_size = 0;
+};
+
+static_assert(sizeof(DictionaryRecord) == 16);
+
+/**
+ * @brief Memory-mapped index of candidate file names by their MPQ name hashes
+ * @details The index file holds a header, the records sorted by (name A, name B) and
+ * the blob of names. It is built once from plain listfiles, opening only maps it,
+ * so a dictionary of millions of names is ready without parsing or hashing.
+ */
+class NameDictionary {
+public:
+    /**
+     * @brief Build an index file from listfiles
+     * @details Names are separated by ';', '\r' or '\n', the first spelling of a name wins.
+     * @param listfile_paths Plain text listfiles
+     * @param dictionary_path Index file to write
+     * @return Expected containing the number of indexed names or an error message
+     */
+    [[nodiscard]] static auto build(std::span<const std::filesystem::path> listfile_paths, const std::filesystem::path& dictionary_path)
+        -> std::expected<size_t, ErrorMessage>;
+
+    /**
+     * @brief Map an index file made by build
+     * @param dictionary_path Index file
+     * @return Expected containing the dictionary or an error message
+     */
+    [[nodiscard]] static auto open(const std::filesystem::path& dictionary_path)-> std::expected<NameDictionary, ErrorMessage>;
+
+    /**
+     * @brief Find a name by its hashes
+     * @param name_a Name hash of type A
+     * @param name_b Name hash of type B
+     * @return Name or nothing if the dictionary has no such name
+     */
+    [[nodiscard]] auto find(uint32_t name_a, uint32_t name_b) const-> std::optional<std::string_view>;
+
+    [[nodiscard]] auto size() const-> size_t { return records_.size(); }
+
+private:
+    boost::iostreams::mapped_file_source file_;
+    std::span<const DictionaryRecord> records_;
+    std::string_view names_;
+};
+
+} // namespace assmpq::mpq
+
+#endif  /// ASSMPQ_MPQ_NAME_DICTIONARY_H_
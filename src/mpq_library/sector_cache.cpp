@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <functional>
+
+#include "sector_cache.hpp"
+
+namespace assmpq::mpq {
+
+SectorTableCache::SectorTableCache(size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1))
+{
+}
+
+auto SectorTableCache::instance()-> SectorTableCache&
+{
+    static SectorTableCache cache;
+    return cache;
+}
+
+auto SectorTableCache::get_or_load(const ArchiveKey& archive_key, uint32_t block_index, const sector_table_loader_t& load)
+    -> std::shared_ptr<const SectorTable>
+{
+    TableKey key{ .archive_key = archive_key, .block_index = block_index };
+    {
+        const std::lock_guard lock(mutex_);
+        if (auto sector_table = find(key)) {
+            hit_count_.fetch_add(1, std::memory_order_relaxed);
+            return sector_table;
+        }
+    }
+
+    // Loaded outside the lock, a thread losing the race keeps the table stored first
+    auto sector_table = std::make_shared<const SectorTable>(load());
+
+    const std::lock_guard lock(mutex_);
+    return emplace(std::move(key), std::move(sector_table));
+}
+
+void SectorTableCache::insert(const ArchiveKey& archive_key, uint32_t block_index, SectorTable sector_table)
+{
+    TableKey key{ .archive_key = archive_key, .block_index = block_index };
+
+    const std::lock_guard lock(mutex_);
+    emplace(std::move(key), std::make_shared<const SectorTable>(std::move(sector_table)));
+}
+
+void SectorTableCache::clear()
+{
+    const std::lock_guard lock(mutex_);
+    positions_.clear();
+    tables_.clear();
+}
+
+auto SectorTableCache::size()-> size_t
+{
+    const std::lock_guard lock(mutex_);
+    return tables_.size();
+}
+
+auto SectorTableCache::find(const TableKey& key)-> std::shared_ptr<const SectorTable>
+{
+    const auto position = positions_.find(key);
+    if (position == positions_.end()) {
+        return nullptr;
+    }
+    tables_.splice(tables_.begin(), tables_, position->second);
+    return position->second->second;
+}
+
+auto SectorTableCache::emplace(TableKey key, std::shared_ptr<const SectorTable> sector_table)-> std::shared_ptr<const SectorTable>
+{
+    if (auto cached = find(key)) {
+        return cached;
+    }
+
+    if (tables_.size() == capacity_) {
+        positions_.erase(tables_.back().first);
+        tables_.pop_back();
+    }
+    tables_.emplace_front(std::move(key), std::move(sector_table));
+    positions_.emplace(tables_.front().first, tables_.begin());
+    return tables_.front().second;
+}
+
+auto SectorTableCache::TableKeyHash::operator()(const TableKey& key) const noexcept-> size_t
+{
+    size_t hash = std::hash<std::string>{}(key.archive_key.path);
+    for (const auto value : { key.archive_key.size, static_cast<uint64_t>(key.archive_key.time), uint64_t{ key.block_index } }) {
+        hash ^= std::hash<uint64_t>{}(value) + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+} // namespace assmpq::mpq
@@ -0,0 +1,98 @@
+#ifndef ASSMPQ_MPQ_SECTOR_CACHE_H_
+#define ASSMPQ_MPQ_SECTOR_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "archive_index.hpp"
+
+namespace assmpq::mpq {
+
+/**
+ * @brief Process-wide cache of sector offset tables
+ * @details Tables are keyed by the archive identity and the block index, so a rewritten
+ * archive never reuses the tables of its previous version. Entries are filled lazily on
+ * the first read of a file or seeded from a sidecar index, lookups from any thread share
+ * the same immutable tables. The least recently used table is dropped once the cache
+ * holds its capacity.
+ */
+class SectorTableCache {
+public:
+    using SectorTable = std::vector<uint32_t>;
+    using sector_table_loader_t = std::function<SectorTable()>;
+
+    /// Tables kept by the shared instance
+    static constexpr size_t kDefaultCapacity = 4096;
+
+    /// @param capacity Number of tables kept, at least one
+    explicit SectorTableCache(size_t capacity = kDefaultCapacity);
+
+    /// @brief Instance shared by all archive readers
+    static auto instance()-> SectorTableCache&;
+
+    /**
+     * @brief Get the cached table of a block or load and cache it
+     * @param archive_key Identity of the archive
+     * @param block_index Block table index of the file
+     * @param load Reads the table if it is not cached yet, an empty table is cached as well
+     * @return Sector offset table, empty for files stored in one piece
+     */
+    auto get_or_load(const ArchiveKey& archive_key, uint32_t block_index, const sector_table_loader_t& load)
+        -> std::shared_ptr<const SectorTable>;
+
+    /**
+     * @brief Store a known table, an existing entry is kept
+     * @param archive_key Identity of the archive
+     * @param block_index Block table index of the file
+     * @param sector_table Sector offset table
+     */
+    void insert(const ArchiveKey& archive_key, uint32_t block_index, SectorTable sector_table);
+
+    /// @brief Drop every cached table, the hit count is kept
+    void clear();
+
+    /// @brief Number of cached tables
+    [[nodiscard]] auto size()-> size_t;
+
+    /// @brief Number of lookups answered without calling the loader
+    [[nodiscard]] auto hit_count() const-> uint64_t { return hit_count_.load(std::memory_order_relaxed); }
+
+private:
+    struct TableKey {
+        ArchiveKey archive_key;
+        uint32_t block_index = 0;
+
+        bool operator==(const TableKey& other) const = default;
+    };
+
+    struct TableKeyHash {
+        auto operator()(const TableKey& key) const noexcept-> size_t;
+    };
+
+    using CachedTable = std::pair<TableKey, std::shared_ptr<const SectorTable>>;
+
+    // Looks up a table and marks it most recently used, the caller holds the lock
+    auto find(const TableKey& key)-> std::shared_ptr<const SectorTable>;
+    // Adds a table unless it is cached already, the caller holds the lock
+    auto emplace(TableKey key, std::shared_ptr<const SectorTable> sector_table)-> std::shared_ptr<const SectorTable>;
+
+    const size_t capacity_;
+    std::atomic<uint64_t> hit_count_ = 0;
+
+    std::mutex mutex_;
+    std::list<CachedTable> tables_;     // Most recently used first
+    std::unordered_map<TableKey, std::list<CachedTable>::iterator, TableKeyHash> positions_;
+};
+
+} // namespace assmpq::mpq
+
+#endif  /// ASSMPQ_MPQ_SECTOR_CACHE_H_
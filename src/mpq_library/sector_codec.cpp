@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <format>
+#include <memory>
+#include <vector>
+
+#include <zlib.h>
+#include <bzlib.h>
+#if defined(ASSMPQ_USE_LIBDEFLATE)
+#include <libdeflate.h>
+#endif
+
+#include "legacy_codecs.hpp"
+#include "sector_codec.hpp"
+
+namespace assmpq::mpq {
+
+namespace {
+
+// Order in which the kinds of a multi-compressed sector are undone
+constexpr std::array kDecompressionOrder {
+    SectorCompression::Bzip2,
+    SectorCompression::Implode,
+    SectorCompression::Deflate,
+    SectorCompression::Huffman,
+    SectorCompression::WaveStereo,
+    SectorCompression::WaveMono,
+};
+
+constexpr uint8_t kKnownCompressionMask = 0xDB;    // All SectorCompression bits
+
+// The decoders of the C libraries take mutable pointers but never write to the input
+auto mutable_input(std::span<const char> input)-> char*
+{
+    return const_cast<char*>(input.data()); // NOLINT(cppcoreguidelines-pro-type-const-cast)
+}
+
+#if defined(ASSMPQ_USE_LIBDEFLATE)
+auto inflate_libdeflate(std::span<const char> input, std::span<char> output)-> std::optional<size_t>
+{
+    struct DecompressorDeleter {
+        void operator()(libdeflate_decompressor* decompressor) const { libdeflate_free_decompressor(decompressor); }
+    };
+    thread_local const std::unique_ptr<libdeflate_decompressor, DecompressorDeleter> decompressor(libdeflate_alloc_decompressor());
+    if (decompressor == nullptr) {
+        return std::nullopt;
+    }
+
+    size_t output_size = 0;
+    if (libdeflate_zlib_decompress(decompressor.get(), input.data(), input.size(), output.data(), output.size(), &output_size) != LIBDEFLATE_SUCCESS) {
+        return std::nullopt;
+    }
+    return output_size;
+}
+#else
+auto inflate_zlib(std::span<const char> input, std::span<char> output)-> std::optional<size_t>
+{
+    // The inflate state is reset between sectors instead of being allocated for each one
+    struct InflateStream {
+        z_stream stream {};
+        bool initialized = inflateInit(&stream) == Z_OK;
+
+        InflateStream() = default;
+        InflateStream(const InflateStream&) = delete;
+        InflateStream& operator=(const InflateStream&) = delete;
+        ~InflateStream() { if (initialized) { inflateEnd(&stream); } }
+    };
+    thread_local InflateStream inflater;
+    if (!inflater.initialized || inflateReset(&inflater.stream) != Z_OK) {
+        return std::nullopt;
+    }
+
+    z_stream& stream = inflater.stream;
+    stream.next_in = reinterpret_cast<Bytef*>(mutable_input(input)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(output.data()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    stream.avail_out = static_cast<uInt>(output.size());
+    if (inflate(&stream, Z_FINISH) != Z_STREAM_END) {
+        return std::nullopt;
+    }
+    return output.size() - stream.avail_out;
+}
+#endif
+
+auto decode_bzip2(std::span<const char> input, std::span<char> output)-> std::optional<size_t>
+{
+    auto output_size = static_cast<unsigned int>(output.size());
+    if (BZ2_bzBuffToBuffDecompress(output.data(), &output_size, mutable_input(input), static_cast<unsigned int>(input.size()), 0, 0) != BZ_OK) {
+        return std::nullopt;
+    }
+    return output_size;
+}
+
+constexpr auto codec_slot(SectorCompression compression)-> size_t
+{
+    return static_cast<size_t>(std::ranges::find(kDecompressionOrder, compression) - kDecompressionOrder.begin());
+}
+
+} // namespace
+
+SectorCodecRegistry::SectorCodecRegistry()
+{
+#if defined(ASSMPQ_USE_LIBDEFLATE)
+    set({ .compression = SectorCompression::Deflate, .name = "libdeflate", .decode = inflate_libdeflate });
+#else
+    set({ .compression = SectorCompression::Deflate, .name = "zlib", .decode = inflate_zlib });
+#endif
+    set({ .compression = SectorCompression::Bzip2, .name = "bzip2", .decode = decode_bzip2 });
+    set({ .compression = SectorCompression::Implode, .name = "implode", .decode = decode_implode });
+    set({ .compression = SectorCompression::Huffman, .name = "huffman", .decode = decode_huffman });
+    set({ .compression = SectorCompression::WaveMono, .name = "adpcm mono", .decode = decode_adpcm_mono });
+    set({ .compression = SectorCompression::WaveStereo, .name = "adpcm stereo", .decode = decode_adpcm_stereo });
+}
+
+auto SectorCodecRegistry::instance()-> SectorCodecRegistry&
+{
+    static SectorCodecRegistry registry;
+    return registry;
+}
+
+void SectorCodecRegistry::set(const SectorCodec& codec)
+{
+    codecs_.at(codec_slot(codec.compression)) = codec;
+}
+
+auto SectorCodecRegistry::find(SectorCompression compression) const-> const SectorCodec*
+{
+    const SectorCodec& codec = codecs_.at(codec_slot(compression));
+    return codec.decode != nullptr ? &codec : nullptr;
+}
+
+auto decompress_sector(std::span<const char> sector, std::span<char> output, bool imploded)
+    -> std::expected<size_t, ErrorMessage>
+{
+    const SectorCodecRegistry& registry = SectorCodecRegistry::instance();
+
+    if (imploded) {
+        const SectorCodec* codec = registry.find(SectorCompression::Implode);
+        const auto output_size = codec != nullptr ? codec->decode(sector, output) : std::nullopt;
+        if (!output_size.has_value()) {
+            return std::unexpected(std::format("Sector decompression error: {}.", codec != nullptr ? codec->name : "implode"));
+        }
+        return output_size.value();
+    }
+
+    if (sector.empty()) {
+        return std::unexpected("Sector is empty.");
+    }
+
+    const auto compression_mask = static_cast<uint8_t>(sector.front());
+    const auto stage_count = static_cast<size_t>(std::ranges::count_if(kDecompressionOrder, [compression_mask](SectorCompression compression) {
+        return (compression_mask & static_cast<uint8_t>(compression)) != 0;
+    }));
+
+    if ((compression_mask & ~kKnownCompressionMask) != 0) {
+        return std::unexpected(std::format("Unsupported sector compression: {:#04x}.", compression_mask));
+    }
+
+    // Stages alternate between the output and a scratch buffer so that the last one lands in the output
+    thread_local std::vector<char> scratch;
+    scratch.resize(output.size());
+
+    std::span<const char> input = sector.subspan(1);
+    size_t stage_idx = 0;
+    for (const SectorCompression compression : kDecompressionOrder) {
+        if ((compression_mask & static_cast<uint8_t>(compression)) == 0) {
+            continue;
+        }
+
+        const SectorCodec* codec = registry.find(compression);
+        if (codec == nullptr) {
+            return std::unexpected(std::format("Unsupported sector compression: {:#04x}.", compression_mask));
+        }
+
+        const std::span<char> target = (stage_count - stage_idx) % 2 == 1 ? output : std::span<char>(scratch);
+        const auto output_size = codec->decode(input, target);
+        if (!output_size.has_value() || output_size.value() > target.size()) {
+            return std::unexpected(std::format("Sector decompression error: {}.", codec->name));
+        }
+        input = target.first(output_size.value());
+        ++stage_idx;
+    }
+
+    if (stage_count == 0) {
+        if (input.size() > output.size()) {
+            return std::unexpected("Sector decompression error: stored data.");
+        }
+        std::ranges::copy(input, output.begin());
+    }
+    return input.size();
+}
+
+void compress_sector(std::span<const char> sector, SectorCompression compression, std::vector<char>& output)
+{
+    // Sectors are far below 4 GB, bzip2 may grow incompressible data by about one percent plus its block header
+    const auto sector_size = static_cast<uInt>(sector.size());
+    const size_t output_bound = std::max<size_t>(compressBound(sector_size), sector.size() + (sector.size() / 100) + 600);
+    output.resize(1 + output_bound);
+    output.front() = static_cast<char>(compression);
+
+    bool is_compressed = false;
+    size_t output_size = 0;
+    if (compression == SectorCompression::Deflate) {
+        uLongf deflated_size = static_cast<uInt>(output_bound);
+        is_compressed = compress2(
+            reinterpret_cast<Bytef*>(output.data() + 1), &deflated_size, // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            reinterpret_cast<const Bytef*>(sector.data()), sector_size, Z_DEFAULT_COMPRESSION) == Z_OK; // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        output_size = deflated_size;
+    } else if (compression == SectorCompression::Bzip2) {
+        auto packed_size = static_cast<unsigned int>(output_bound);
+        is_compressed = BZ2_bzBuffToBuffCompress(output.data() + 1, &packed_size, mutable_input(sector), sector_size, 9, 0, 0) == BZ_OK; // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        output_size = packed_size;
+    }
+
+    if (!is_compressed || 1 + output_size >= sector.size()) {
+        output.assign(sector.begin(), sector.end());
+        return;
+    }
+    output.resize(1 + output_size);
+}
+
+} // namespace assmpq::mpq
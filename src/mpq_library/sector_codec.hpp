@@ -0,0 +1,91 @@
+#ifndef ASSMPQ_MPQ_SECTOR_CODEC_H_
+#define ASSMPQ_MPQ_SECTOR_CODEC_H_
+
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "assets_mpq_importer/assmpq.hpp"
+
+namespace assmpq::mpq {
+
+/// @brief Compression kind of a sector, a bit of its leading compression byte
+enum class SectorCompression : uint8_t {
+    Huffman = 0x01,
+    Deflate = 0x02,
+    Implode = 0x08,
+    Bzip2 = 0x10,
+    WaveMono = 0x40,
+    WaveStereo = 0x80,
+};
+
+/**
+ * @brief Sector decoder of one compression kind
+ * @param input Compressed data
+ * @param output Room for the decompressed data
+ * @return Number of decompressed bytes or nothing if the data is damaged
+ */
+using SectorDecoder = auto (*)(std::span<const char> input, std::span<char> output)-> std::optional<size_t>;
+
+/// @brief Named decoder of one compression kind
+struct SectorCodec {
+    SectorCompression compression = SectorCompression::Deflate;
+    std::string_view name;              ///< Implementation name, shown in errors and benchmarks
+    SectorDecoder decode = nullptr;
+};
+
+/**
+ * @brief Decoders used for sector decompression, one per compression kind
+ * @details Starts with the built-in decoders. Deflate goes through libdeflate when the
+ * library is built with ASSMPQ_USE_LIBDEFLATE and through zlib otherwise, bzip2 through
+ * the libbz2 buffer API, the legacy kinds through the decoders of legacy_codecs.hpp.
+ * Codecs are not synchronized, replace them before the first extraction.
+ */
+class SectorCodecRegistry {
+public:
+    [[nodiscard]] static auto instance()-> SectorCodecRegistry&;
+
+    /// @brief Replace the codec of the compression kind of codec
+    void set(const SectorCodec& codec);
+
+    /// @brief Codec of a compression kind or nullptr if there is none
+    [[nodiscard]] auto find(SectorCompression compression) const-> const SectorCodec*;
+
+    [[nodiscard]] auto codecs() const-> std::span<const SectorCodec> { return codecs_; }
+
+private:
+    SectorCodecRegistry();
+
+    std::array<SectorCodec, 6> codecs_;
+};
+
+/**
+ * @brief Decompress one sector of a compressed or imploded file
+ * @details Compressed sectors start with a byte of SectorCompression bits, the kinds are
+ * undone in the MPQ order: bzip2, implode, deflate, Huffman, wave. Sectors of imploded
+ * files have no compression byte.
+ * @param sector Stored sector data, already decrypted
+ * @param output Room for the decompressed sector
+ * @param imploded True for sectors of files with the imploded block flag
+ * @return Expected containing the decompressed size or an error message
+ */
+[[nodiscard]] auto decompress_sector(std::span<const char> sector, std::span<char> output, bool imploded)
+    -> std::expected<size_t, ErrorMessage>;
+
+/**
+ * @brief Compress one sector of a file being written
+ * @details The output starts with the compression byte. A sector that does not shrink is stored
+ * as it is, without the byte, which is how readers tell the two apart.
+ * @param sector Sector data
+ * @param compression Deflate or Bzip2, any other kind stores the sector as it is
+ * @param output Stored sector, replaced
+ */
+void compress_sector(std::span<const char> sector, SectorCompression compression, std::vector<char>& output);
+
+} // namespace assmpq::mpq
+
+#endif  /// ASSMPQ_MPQ_SECTOR_CODEC_H_
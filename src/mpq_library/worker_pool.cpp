@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <functional>
+
+#include "worker_pool.hpp"
+
+namespace assmpq::mpq {
+
+WorkerPool::WorkerPool(unsigned thread_count)
+{
+    workers_.reserve(thread_count);
+    for (unsigned worker_idx = 0; worker_idx < thread_count; ++worker_idx) {
+        workers_.emplace_back([this] {
+            std::unique_lock lock(mutex_);
+            while (true) {
+                Task* task = nullptr;
+                work_ready_.wait(lock, [&] {
+                    task = find_open_task();
+                    return is_stopping_ || task != nullptr;
+                });
+                if (is_stopping_) {
+                    return;
+                }
+
+                ++task->worker_count;
+                lock.unlock();
+                work_on(*task);
+                lock.lock();
+                --task->worker_count;
+                task_done_.notify_all();
+            }
+        });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        const std::lock_guard lock(mutex_);
+        is_stopping_ = true;
+    }
+    work_ready_.notify_all();
+}
+
+auto WorkerPool::instance()-> WorkerPool&
+{
+    static WorkerPool pool(std::max(std::thread::hardware_concurrency(), 1U) - 1);
+    return pool;
+}
+
+void WorkerPool::run(size_t job_count, unsigned max_threads, const job_t& job)
+{
+    if (job_count <= 1 || max_threads <= 1 || workers_.empty()) {
+        for (size_t job_idx = 0; job_idx < job_count; ++job_idx) {
+            job(job_idx);
+        }
+        return;
+    }
+
+    Task task;
+    task.job = &job;
+    task.job_count = job_count;
+    task.worker_limit = static_cast<unsigned>(std::min<size_t>({ workers_.size(), max_threads - 1, job_count - 1 }));
+
+    {
+        const std::lock_guard lock(mutex_);
+        tasks_.push_back(&task);
+    }
+    work_ready_.notify_all();
+
+    work_on(task);
+
+    // The task lives on this stack, it is dropped once every job is done and no worker holds it
+    std::unique_lock lock(mutex_);
+    task_done_.wait(lock, [&] { return task.done_count == task.job_count && task.worker_count == 0; });
+    std::erase(tasks_, &task);
+}
+
+void WorkerPool::work_on(Task& task)
+{
+    size_t finished_count = 0;
+    for (size_t job_idx = task.next_job++; job_idx < task.job_count; job_idx = task.next_job++) {
+        (*task.job)(job_idx);
+        ++finished_count;
+    }
+
+    if (finished_count != 0) {
+        const std::lock_guard lock(mutex_);
+        task.done_count += finished_count;
+        task_done_.notify_all();
+    }
+}
+
+auto WorkerPool::find_open_task()-> Task*
+{
+    const auto open_task = std::ranges::find_if(tasks_, [](const Task* task) {
+        return task->worker_count < task->worker_limit && task->next_job.load() < task->job_count;
+    });
+    return open_task != tasks_.end() ? *open_task : nullptr;
+}
+
+} // namespace assmpq::mpq
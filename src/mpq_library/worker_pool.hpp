@@ -0,0 +1,72 @@
+#ifndef ASSMPQ_MPQ_WORKER_POOL_H_
+#define ASSMPQ_MPQ_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace assmpq::mpq {
+
+/**
+ * @brief Process-wide pool of worker threads shared by the archive readers and writers
+ * @details The threads are started once and wait for work between calls, so decoding a large
+ * file or compressing a batch of files does not start threads of its own. The calling thread
+ * takes jobs as well, a call made from a job or while every worker is busy still completes.
+ */
+class WorkerPool {
+public:
+    using job_t = std::function<void(size_t)>;
+
+    /// @param thread_count Number of worker threads besides the calling ones
+    explicit WorkerPool(unsigned thread_count);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool(WorkerPool&&) = delete;
+    auto operator=(const WorkerPool&)-> WorkerPool& = delete;
+    auto operator=(WorkerPool&&)-> WorkerPool& = delete;
+
+    /// @brief Instance shared by all archives, one thread per core together with the caller
+    static auto instance()-> WorkerPool&;
+
+    /**
+     * @brief Run jobs on the pool and wait for all of them
+     * @param job_count Number of jobs, job is called once with every index below it
+     * @param max_threads Threads working on the jobs at most, the calling thread included
+     * @param job Job function, it must not throw
+     */
+    void run(size_t job_count, unsigned max_threads, const job_t& job);
+
+    /// @brief Threads a call can use, the calling thread included
+    [[nodiscard]] auto concurrency() const-> unsigned { return static_cast<unsigned>(workers_.size()) + 1; }
+
+private:
+    struct Task {
+        const job_t* job = nullptr;
+        size_t job_count = 0;
+        unsigned worker_limit = 0;          ///< Workers joining the calling thread at most
+        unsigned worker_count = 0;          ///< Workers on the task, guarded by the mutex
+        size_t done_count = 0;              ///< Finished jobs, guarded by the mutex
+        std::atomic<size_t> next_job = 0;
+    };
+
+    // Takes jobs of a task until none is left
+    void work_on(Task& task);
+    // A queued task a worker can join, the caller holds the lock
+    auto find_open_task()-> Task*;
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable task_done_;
+    std::vector<Task*> tasks_;
+    bool is_stopping_ = false;
+    std::vector<std::jthread> workers_;
+};
+
+} // namespace assmpq::mpq
+
+#endif  /// ASSMPQ_MPQ_WORKER_POOL_H_
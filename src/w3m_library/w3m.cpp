@@ -1,4 +1,5 @@
 #include <expected>
+#include <span>
 #include <spanstream>
 
 #include <platform.hpp>
@@ -12,27 +13,32 @@ namespace assmpq::w3m {
 
 using format_getter_t = const char*(*)(const wc3lib::map::W3m& map);
 
-static auto extract_file(const FileData& w3m_file, format_getter_t fmt_getter)
+static auto extract_file(std::span<const std::byte> w3m_file, format_getter_t fmt_getter)
     -> std::expected<FileData, ErrorMessage>
 {
 	wc3lib::map::W3m map;
     try {
-        std::ispanstream input(w3m_file);
+        std::ispanstream input(as_chars(w3m_file));
         map.read(input);
 
         // const auto* format = map.environment().get();
         const wc3lib::mpq::File file = map.findFile(fmt_getter(map));
 
-        std::vector<char> buffer(file.size());
+        // Decompressed straight into the returned buffer, which is not zeroed first
+        FileData buffer;
+        buffer.resize_uninitialized(file.size());
         std::ospanstream output(buffer, std::ios::out | std::ios::binary);
         file.decompress(input, output);
+        if (!output || output.span().size() != buffer.size()) {
+            return std::unexpected("File size mismatch.");
+        }
         return buffer;
     } catch (const wc3lib::Exception &exception) {
         return std::unexpected(exception.what());
     }
 }
 
-auto extract_w3e_file(const FileData& w3m_file)
+auto extract_w3e_file(std::span<const std::byte> w3m_file)
     -> std::expected<FileData, ErrorMessage>
 {
     return extract_file(w3m_file, [](const auto& map) -> const char* {
@@ -40,7 +46,7 @@ auto extract_w3e_file(const FileData& w3m_file)
     });
 }
 
-auto extract_shd_file(const FileData& w3m_file)
+auto extract_shd_file(std::span<const std::byte> w3m_file)
     -> std::expected<FileData, ErrorMessage>
 {
     return extract_file(w3m_file, [](const auto& map) -> const char* {
@@ -48,7 +54,7 @@ auto extract_shd_file(const FileData& w3m_file)
     });
 }
 
-auto extract_wpm_file(const FileData& w3m_file)
+auto extract_wpm_file(std::span<const std::byte> w3m_file)
     -> std::expected<FileData, ErrorMessage>
 {
     return extract_file(w3m_file, [](const auto& map) -> const char* {
@@ -56,7 +62,7 @@ auto extract_wpm_file(const FileData& w3m_file)
     });
 }
 
-auto extract_doo_file(const FileData& w3m_file)
+auto extract_doo_file(std::span<const std::byte> w3m_file)
     -> std::expected<FileData, ErrorMessage>
 {
     return extract_file(w3m_file, [](const auto& map) -> const char* {
@@ -64,4 +70,28 @@ auto extract_doo_file(const FileData& w3m_file)
     });
 }
 
+auto extract_w3e_file(const FileData& w3m_file)
+    -> std::expected<FileData, ErrorMessage>
+{
+    return extract_w3e_file(std::as_bytes(std::span(w3m_file)));
+}
+
+auto extract_shd_file(const FileData& w3m_file)
+    -> std::expected<FileData, ErrorMessage>
+{
+    return extract_shd_file(std::as_bytes(std::span(w3m_file)));
+}
+
+auto extract_wpm_file(const FileData& w3m_file)
+    -> std::expected<FileData, ErrorMessage>
+{
+    return extract_wpm_file(std::as_bytes(std::span(w3m_file)));
+}
+
+auto extract_doo_file(const FileData& w3m_file)
+    -> std::expected<FileData, ErrorMessage>
+{
+    return extract_doo_file(std::as_bytes(std::span(w3m_file)));
+}
+
 }  // namespace assmpq::w3m
\ No newline at end of file
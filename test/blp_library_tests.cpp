@@ -4,6 +4,8 @@
 
 #include <assets_mpq_importer/blp.hpp>
 
+#include <memory_resource>
+#include <span>
 #include <vector>
 #include <tuple>
 #define STB_IMAGE_IMPLEMENTATION
@@ -13,7 +15,7 @@
 
 namespace assmpq::test {
 
-    inline static auto get_png_info(const std::vector<char>& data)
+    inline static auto get_png_info(const assmpq::FileData& data)
         -> std::expected<std::tuple<int, int, int>, std::string>
     {
         int width = 0;
@@ -37,7 +39,7 @@ namespace assmpq::test {
         return std::make_tuple(width, height, channels);
     }
 
-    inline static auto get_dds_info(const std::vector<char>& data)
+    inline static auto get_dds_info(const assmpq::FileData& data)
         -> std::expected<std::tuple<int, int, int, int, int>, std::string>
     {
         static constexpr std::uint32_t kDDSMagic = 0x20534444; // "DDS "
@@ -60,11 +62,34 @@ namespace assmpq::test {
 
         return std::unexpected("Invalid DDS header");
     }
+
+    // Counts the bytes allocated through it, the allocations are served by the default resource
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        size_t allocated_bytes = 0;
+
+    private:
+        auto do_allocate(size_t bytes, size_t alignment)-> void* override
+        {
+            allocated_bytes += bytes;
+            return std::pmr::get_default_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+        {
+            std::pmr::get_default_resource()->deallocate(ptr, bytes, alignment);
+        }
+
+        [[nodiscard]] auto do_is_equal(const std::pmr::memory_resource& other) const noexcept-> bool override
+        {
+            return this == &other;
+        }
+    };
 }
 
 TEST_CASE("Convert_BLP_to_PNG_with_invalid_data_failed", "[blp]")
 {
-    const std::vector<char> invalid_data = { 'I', 'N', 'V', 'A', 'L', 'I', 'D' };
+    const assmpq::FileData invalid_data = { 'I', 'N', 'V', 'A', 'L', 'I', 'D' };
     const auto result = assmpq::blp::convert_blp_to_png_image(invalid_data);
 
     // This should fail since the data is not a valid BLP file
@@ -119,6 +144,38 @@ TEST_CASE("Convert_BLP_to_PNG_paletted_success", "[blp]")
     REQUIRE(channels == 4);
 }
 
+TEST_CASE("Convert_BLP_to_PNG_with_memory_resource_success", "[blp]")
+{
+    const auto blp_data = assmpq::test::load_file("testdata/test_raw_32x32_paletted.blp");
+    assmpq::test::CountingResource memory;
+    const auto result = assmpq::blp::convert_blp_to_png_image(blp_data, 0, &memory);
+
+    REQUIRE(result.has_value());
+    REQUIRE(memory.allocated_bytes >= 32 * 32 * sizeof(uint32_t));
+
+    const auto default_result = assmpq::blp::convert_blp_to_png_image(blp_data);
+    REQUIRE(default_result.has_value());
+    REQUIRE(result.value() == default_result.value());
+}
+
+TEST_CASE("Convert_BLP_to_PNG_from_byte_view_success", "[blp]")
+{
+    // The texture sits inside a larger buffer, like a stored file of a memory-mapped archive
+    const auto blp_data = assmpq::test::load_file("testdata/test_jpeg_32x32.blp");
+    assmpq::FileData container(16, 'X');
+    container.insert(container.end(), blp_data.begin(), blp_data.end());
+    container.resize(container.size() + 16, 'X');
+
+    const auto blp_view = std::as_bytes(std::span(container)).subspan(16, blp_data.size());
+    const auto result = assmpq::blp::convert_blp_to_png_image(blp_view);
+
+    REQUIRE(result.has_value());
+
+    const auto file_data_result = assmpq::blp::convert_blp_to_png_image(blp_data);
+    REQUIRE(file_data_result.has_value());
+    REQUIRE(result.value() == file_data_result.value());
+}
+
 TEST_CASE("Convert_BLP_to_PNG_with_mipmap_index_out_of_range_failed", "[blp]")
 {
     const auto blp_data = assmpq::test::load_file("testdata/test_jpeg_32x32.blp");
@@ -128,9 +185,53 @@ TEST_CASE("Convert_BLP_to_PNG_with_mipmap_index_out_of_range_failed", "[blp]")
     REQUIRE(result.error() == "Mipmap index 100500 is out of range.");
 }
 
+TEST_CASE("Decode_BLP_to_RGBA_image_success", "[blp]")
+{
+    const auto blp_data = assmpq::test::load_file("testdata/test_raw_32x32_paletted.blp");
+    const auto result = assmpq::blp::decode_blp_to_rgba_image(blp_data, 1);
+
+    REQUIRE(result.has_value());
+    REQUIRE(result->width == 16);
+    REQUIRE(result->height == 16);
+    REQUIRE(result->pixels.size() == 16 * 16);
+}
+
+TEST_CASE("Decode_BLP_to_RGBA_image_with_mipmap_index_out_of_range_failed", "[blp]")
+{
+    const auto blp_data = assmpq::test::load_file("testdata/test_jpeg_32x32.blp");
+    const auto result = assmpq::blp::decode_blp_to_rgba_image(blp_data, 100500);
+
+    REQUIRE_FALSE(result.has_value());
+    REQUIRE(result.error() == "Mipmap index 100500 is out of range.");
+}
+
+TEST_CASE("Convert_RGBA_to_PNG_success", "[blp]")
+{
+    const assmpq::blp::RgbaImage image{ .width = 8, .height = 4, .pixels = std::vector<uint32_t>(8 * 4, 0xFF00FF00U) };
+    const auto result = assmpq::blp::convert_rgba_to_png_image(image);
+
+    REQUIRE(result.has_value());
+
+    const auto png_info = assmpq::test::get_png_info(result.value());
+    REQUIRE(png_info.has_value());
+
+    auto [width, height, channels] = png_info.value();
+    REQUIRE(width == 8);
+    REQUIRE(height == 4);
+    REQUIRE(channels == 4);
+}
+
+TEST_CASE("Convert_RGBA_to_PNG_with_invalid_size_failed", "[blp]")
+{
+    const assmpq::blp::RgbaImage image{ .width = 8, .height = 4, .pixels = std::vector<uint32_t>(3, 0) };
+    const auto result = assmpq::blp::convert_rgba_to_png_image(image);
+
+    REQUIRE_FALSE(result.has_value());
+}
+
 TEST_CASE("Convert_BLP_to_DDS_NVTT_with_invalid_data_failed", "[blp]")
 {
-    const std::vector<char> invalid_data = { 'I', 'N', 'V', 'A', 'L', 'I', 'D' };
+    const assmpq::FileData invalid_data = { 'I', 'N', 'V', 'A', 'L', 'I', 'D' };
     const auto result = assmpq::blp::convert_blp_to_dds_texture_nvtt(invalid_data);
 
     // This should fail since the data is not a valid BLP file
@@ -286,7 +387,7 @@ TEST_CASE("Convert_BLP_to_DDS_NVTT_paletted_generate_mipmaps_succeess", "[blp]")
 
 TEST_CASE("Convert_BLP_to_DDS_AMDC_with_invalid_data_failed", "[blp]")
 {
-    const std::vector<char> invalid_data = { 'I', 'N', 'V', 'A', 'L', 'I', 'D' };
+    const assmpq::FileData invalid_data = { 'I', 'N', 'V', 'A', 'L', 'I', 'D' };
     const auto result = assmpq::blp::convert_blp_to_dds_texture_amdc(invalid_data);
 
     // This should fail since the data is not a valid BLP file
@@ -310,6 +411,19 @@ TEST_CASE("Convert_BLP_to_DDS_AMDC_success", "[blp]")
     REQUIRE(mipmap_count == 1);
 }
 
+TEST_CASE("Convert_BLP_to_DDS_AMDC_with_memory_resource_success", "[blp]")
+{
+    const auto blp_data = assmpq::test::load_file("testdata/test_jpeg_32x32.blp");
+    std::pmr::monotonic_buffer_resource memory;
+    const auto result = assmpq::blp::convert_blp_to_dds_texture_amdc(blp_data, assmpq::blp::Compression::DDS_BC3, false, &memory);
+
+    REQUIRE(result.has_value());
+
+    const auto default_result = assmpq::blp::convert_blp_to_dds_texture_amdc(blp_data, assmpq::blp::Compression::DDS_BC3, false);
+    REQUIRE(default_result.has_value());
+    REQUIRE(result.value() == default_result.value());
+}
+
 TEST_CASE("Convert_BLP_to_DDS_AMDC_with_compression_BC1_success", "[blp]")
 {
     const auto blp_data = assmpq::test::load_file("testdata/test_jpeg_32x32.blp");
@@ -437,3 +551,51 @@ TEST_CASE("Convert_BLP_to_DDS_AMDC_dont_generate_mipmaps_succeess", "[blp]")
     REQUIRE(mipmap_count == 1);
     REQUIRE(format == nv::DXGI_FORMAT_BC3_UNORM);
 }
+
+TEST_CASE("Convert_RGBA_to_DDS_NVTT_with_mipmap_limit_success", "[blp]")
+{
+    const assmpq::blp::RgbaImage image{ .width = 64, .height = 32, .pixels = std::vector<uint32_t>(64 * 32, 0xFF0000FFU) };
+    const auto result = assmpq::blp::convert_rgba_to_dds_texture_nvtt(image, assmpq::blp::Compression::DDS_BC3, 3);
+
+    REQUIRE(result.has_value());
+
+    const auto dds_info = assmpq::test::get_dds_info(result.value());
+    REQUIRE(dds_info.has_value());
+
+    const auto [width, height, color_bits, mipmap_count, format] = dds_info.value();
+    REQUIRE(width == 64);
+    REQUIRE(height == 32);
+    REQUIRE(mipmap_count == 3);
+    REQUIRE(format == nv::DXGI_FORMAT_BC3_UNORM);
+}
+
+TEST_CASE("Convert_RGBA_to_DDS_AMDC_with_mipmap_limit_success", "[blp]")
+{
+    const assmpq::blp::RgbaImage image{ .width = 64, .height = 32, .pixels = std::vector<uint32_t>(64 * 32, 0xFF0000FFU) };
+    const auto result = assmpq::blp::convert_rgba_to_dds_texture_amdc(image, assmpq::blp::Compression::DDS_BC1, 3);
+
+    REQUIRE(result.has_value());
+
+    const auto dds_info = assmpq::test::get_dds_info(result.value());
+    REQUIRE(dds_info.has_value());
+
+    const auto [width, height, color_bits, mipmap_count, format] = dds_info.value();
+    REQUIRE(width == 64);
+    REQUIRE(height == 32);
+    REQUIRE(mipmap_count == 3);
+    REQUIRE(format == nv::DXGI_FORMAT_BC1_UNORM);
+}
+
+TEST_CASE("Convert_RGBA_to_DDS_AMDC_full_mipmap_chain_success", "[blp]")
+{
+    const assmpq::blp::RgbaImage image{ .width = 32, .height = 32, .pixels = std::vector<uint32_t>(32 * 32, 0xFFFFFFFFU) };
+    const auto result = assmpq::blp::convert_rgba_to_dds_texture_amdc(image);
+
+    REQUIRE(result.has_value());
+
+    const auto dds_info = assmpq::test::get_dds_info(result.value());
+    REQUIRE(dds_info.has_value());
+
+    const auto [width, height, color_bits, mipmap_count, format] = dds_info.value();
+    REQUIRE(mipmap_count == 6);
+}
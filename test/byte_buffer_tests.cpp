@@ -0,0 +1,140 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <assets_mpq_importer/byte_buffer.hpp>
+
+#include <iterator>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    // Adopted memory together with a counter of the owners still alive
+    struct TrackedBytes {
+        std::unique_ptr<char[]> bytes; // NOLINT(cppcoreguidelines-avoid-c-arrays)
+        std::shared_ptr<int> tracker;
+    };
+
+    auto adopt_tracked(std::string_view text, const std::shared_ptr<int>& tracker)-> assmpq::ByteBuffer
+    {
+        TrackedBytes owner{ .bytes = std::make_unique<char[]>(text.size()), .tracker = tracker }; // NOLINT(cppcoreguidelines-avoid-c-arrays)
+        std::ranges::copy(text, owner.bytes.get());
+        const std::span<char> bytes(owner.bytes.get(), text.size());
+        return assmpq::ByteBuffer::adopt(bytes, std::move(owner));
+    }
+
+    auto as_string(const assmpq::ByteBuffer& buffer)-> std::string
+    {
+        return { buffer.begin(), buffer.end() };
+    }
+
+} // namespace
+
+TEST_CASE("Byte_buffer_adopt_release_success", "[byte_buffer]")
+{
+    const auto tracker = std::make_shared<int>(0);
+    {
+        const auto buffer = adopt_tracked("adopted", tracker);
+        REQUIRE(as_string(buffer) == "adopted");
+        REQUIRE(buffer.capacity() == 7);
+        REQUIRE(tracker.use_count() == 2);
+    }
+    REQUIRE(tracker.use_count() == 1);
+
+    // A vector hands its storage over without a copy
+    std::vector<char> bytes{ 'v', 'e', 'c' };
+    const void* vector_data = bytes.data();
+    const assmpq::ByteBuffer buffer(std::move(bytes));
+    REQUIRE(static_cast<const void*>(buffer.data()) == vector_data);
+    REQUIRE(as_string(buffer) == "vec");
+}
+
+TEST_CASE("Byte_buffer_grow_adopted_success", "[byte_buffer]")
+{
+    // Growing copies the adopted bytes into own storage and releases the owner
+    const auto tracker = std::make_shared<int>(0);
+    auto buffer = adopt_tracked("abc", tracker);
+    const void* adopted_data = buffer.data();
+
+    buffer.push_back('d');
+    REQUIRE(static_cast<const void*>(buffer.data()) != adopted_data);
+    REQUIRE(as_string(buffer) == "abcd");
+    REQUIRE(tracker.use_count() == 1);
+
+    buffer.resize(6, 'x');
+    REQUIRE(as_string(buffer) == "abcdxx");
+}
+
+TEST_CASE("Byte_buffer_insert_from_self_success", "[byte_buffer]")
+{
+    // The source bytes live in the storage the insertion replaces
+    assmpq::ByteBuffer buffer{ 'a', 'b', 'c', 'd' };
+    REQUIRE(buffer.capacity() == buffer.size());
+    buffer.insert(buffer.end(), buffer.begin(), buffer.end());
+    REQUIRE(as_string(buffer) == "abcdabcd");
+
+    const auto tracker = std::make_shared<int>(0);
+    auto adopted = adopt_tracked("xy", tracker);
+    adopted.insert(adopted.begin() + 1, adopted.begin(), adopted.end());
+    REQUIRE(as_string(adopted) == "xxyy");
+    REQUIRE(tracker.use_count() == 1);
+}
+
+TEST_CASE("Byte_buffer_insert_middle_success", "[byte_buffer]")
+{
+    assmpq::ByteBuffer buffer{ 'a', 'b', 'e', 'f' };
+    const std::string middle = "cd";
+    const auto inserted = buffer.insert(buffer.begin() + 2, middle.begin(), middle.end());
+    REQUIRE(as_string(buffer) == "abcdef");
+    REQUIRE(inserted - buffer.begin() == 2);
+
+    // Single pass input is appended byte by byte before it is moved in place
+    std::istringstream input("12");
+    buffer.insert(buffer.begin() + 1, std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    REQUIRE(as_string(buffer) == "a12bcdef");
+
+    buffer.insert(buffer.begin(), middle.begin(), middle.begin());
+    REQUIRE(as_string(buffer) == "a12bcdef");
+}
+
+TEST_CASE("Byte_buffer_erase_success", "[byte_buffer]")
+{
+    assmpq::ByteBuffer buffer{ 'a', 'b', 'c', 'd', 'e', 'f' };
+    const size_t capacity = buffer.capacity();
+
+    const auto next = buffer.erase(buffer.begin() + 1, buffer.begin() + 3);
+    REQUIRE(as_string(buffer) == "adef");
+    REQUIRE(*next == 'd');
+
+    buffer.erase(buffer.begin() + 2, buffer.end());
+    REQUIRE(as_string(buffer) == "ad");
+    buffer.erase(buffer.begin(), buffer.begin());
+    REQUIRE(as_string(buffer) == "ad");
+    REQUIRE(buffer.capacity() == capacity);
+}
+
+TEST_CASE("Byte_buffer_moved_from_success", "[byte_buffer]")
+{
+    const auto tracker = std::make_shared<int>(0);
+    auto buffer = adopt_tracked("moved", tracker);
+    const void* adopted_data = buffer.data();
+
+    auto moved = std::move(buffer);
+    REQUIRE(static_cast<const void*>(moved.data()) == adopted_data);
+    REQUIRE(buffer.empty()); // NOLINT(bugprone-use-after-move,hicpp-invalid-access-moved)
+    REQUIRE(static_cast<const void*>(buffer.data()) == nullptr); // NOLINT(bugprone-use-after-move,hicpp-invalid-access-moved)
+    REQUIRE(buffer.capacity() == 0);
+    REQUIRE(tracker.use_count() == 2);
+
+    // A moved-from buffer is empty and usable again
+    buffer.push_back('x');
+    REQUIRE(as_string(buffer) == "x");
+
+    // Assigning over the adopting buffer releases the owner
+    moved = std::move(buffer);
+    REQUIRE(as_string(moved) == "x");
+    REQUIRE(tracker.use_count() == 1);
+}
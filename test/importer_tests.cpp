@@ -0,0 +1,385 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include <assets_mpq_importer/mpq.hpp>
+#include "atlas.hpp"
+#include "cache.hpp"
+#include "dedup.hpp"
+#include "mpq_output.hpp"
+#include "pack.hpp"
+#include "writer.hpp"
+#include "test_utils.hpp"
+
+namespace {
+
+auto overlaps(const assmpq::importer::AtlasRect& lhs, const assmpq::importer::AtlasRect& rhs)-> bool
+{
+    return lhs.x < rhs.x + rhs.width && rhs.x < lhs.x + lhs.width
+        && lhs.y < rhs.y + rhs.height && rhs.y < lhs.y + lhs.height;
+}
+
+// Little endian field of the pack header at the read position, which is moved past it
+template <typename T>
+auto read_field(const assmpq::FileData& pack, size_t& pos)-> T
+{
+    T value {};
+    std::memcpy(&value, pack.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return value;
+}
+
+auto read_text(const std::filesystem::path& file_path)-> std::string
+{
+    std::ifstream input_file(file_path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(input_file), std::istreambuf_iterator<char>() };
+}
+
+} // namespace
+
+TEST_CASE("Skyline_packer_placement_success", "[importer]")
+{
+    assmpq::importer::SkylinePacker packer(64, 64);
+
+    const auto first = packer.insert(32, 32);
+    REQUIRE(first.has_value());
+    REQUIRE(first->x == 0);
+    REQUIRE(first->y == 0);
+
+    // The lowest position wins over the leftmost one
+    const auto second = packer.insert(32, 16);
+    REQUIRE(second.has_value());
+    REQUIRE(second->x == 32);
+    REQUIRE(second->y == 0);
+
+    const auto third = packer.insert(32, 16);
+    REQUIRE(third.has_value());
+    REQUIRE(third->x == 32);
+    REQUIRE(third->y == 16);
+
+    // The skyline is flat again and the full width row fits on top of it
+    const auto fourth = packer.insert(64, 32);
+    REQUIRE(fourth.has_value());
+    REQUIRE(fourth->x == 0);
+    REQUIRE(fourth->y == 32);
+
+    REQUIRE(packer.used_width() == 64);
+    REQUIRE(packer.used_height() == 64);
+    REQUIRE_FALSE(packer.insert(4, 4).has_value());
+}
+
+TEST_CASE("Skyline_packer_no_overlaps_success", "[importer]")
+{
+    assmpq::importer::SkylinePacker packer(128, 128);
+
+    std::vector<assmpq::importer::AtlasRect> placed;
+    for (uint32_t idx = 0; idx < 32; ++idx) {
+        const auto rect = packer.insert(8 + ((idx * 12) % 28), 8 + ((idx * 7) % 20));
+        if (!rect.has_value()) {
+            continue;
+        }
+        REQUIRE(rect->x + rect->width <= 128);
+        REQUIRE(rect->y + rect->height <= 128);
+        for (const auto& other : placed) {
+            REQUIRE_FALSE(overlaps(rect.value(), other));
+        }
+        placed.push_back(rect.value());
+    }
+
+    REQUIRE(placed.size() > 16);
+}
+
+TEST_CASE("Skyline_packer_oversized_failed", "[importer]")
+{
+    assmpq::importer::SkylinePacker packer(64, 64);
+
+    REQUIRE_FALSE(packer.insert(65, 4).has_value());
+    REQUIRE_FALSE(packer.insert(4, 65).has_value());
+    REQUIRE(packer.used_width() == 0);
+    REQUIRE(packer.used_height() == 0);
+}
+
+TEST_CASE("Import_atlas_lookup_table_success", "[importer]")
+{
+    std::vector<assmpq::mpq::ArchiveFile> files;
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "Textures\\First.blp", .data = assmpq::test::load_file("testdata/test_jpeg_32x32.blp") });
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "Textures\\Second.blp", .data = assmpq::test::load_file("testdata/test_raw_32x32_paletted.blp") });
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "war3map.j", .data = assmpq::FileData(100, 'j') });
+    REQUIRE(assmpq::mpq::write_mpq_archive("atlas_input.mpq", files).has_value());
+
+    std::filesystem::remove_all("atlas_output");
+    assmpq::importer::ProgramOptions popt;
+    popt.input_mpq_file = "atlas_input.mpq";
+    popt.output_folder = "atlas_output";
+    popt.atlas_pattern = "*.blp";
+    popt.atlas_size = 256;
+    popt.atlas_padding = 4;
+
+    std::unordered_set<std::string> atlased_files;
+    {
+        assmpq::importer::OutputWriter output_writer(popt);
+        atlased_files = assmpq::importer::import_atlas(popt, nullptr, output_writer);
+        REQUIRE(output_writer.flush() == 0);
+    }
+
+    REQUIRE(atlased_files == std::unordered_set<std::string> { "Textures\\First.blp", "Textures\\Second.blp" });
+    REQUIRE(std::filesystem::exists("atlas_output/atlas_0.png"));
+
+    std::ifstream atlas_file("atlas_output/atlas.json");
+    REQUIRE(atlas_file.is_open());
+    const auto atlas_doc = nlohmann::json::parse(atlas_file);
+
+    // Two 40x40 cells side by side, the page shrinks to the power of two covering them
+    REQUIRE(atlas_doc["pages"].size() == 1);
+    REQUIRE(atlas_doc["pages"][0]["file"] == "atlas_0.png");
+    REQUIRE(atlas_doc["pages"][0]["width"] == 128);
+    REQUIRE(atlas_doc["pages"][0]["height"] == 64);
+
+    REQUIRE(atlas_doc["sprites"].size() == 2);
+    const auto& first = atlas_doc["sprites"]["Textures/First.blp"];
+    REQUIRE(first["page"] == 0);
+    REQUIRE(first["x"] == 4);
+    REQUIRE(first["y"] == 4);
+    REQUIRE(first["width"] == 32);
+    REQUIRE(first["height"] == 32);
+    REQUIRE_THAT(first["u0"].get<double>(), Catch::Matchers::WithinAbs(4.0 / 128.0, 1e-9));
+    REQUIRE_THAT(first["v0"].get<double>(), Catch::Matchers::WithinAbs(4.0 / 64.0, 1e-9));
+    REQUIRE_THAT(first["u1"].get<double>(), Catch::Matchers::WithinAbs(36.0 / 128.0, 1e-9));
+    REQUIRE_THAT(first["v1"].get<double>(), Catch::Matchers::WithinAbs(36.0 / 64.0, 1e-9));
+
+    const auto& second = atlas_doc["sprites"]["Textures/Second.blp"];
+    REQUIRE(second["page"] == 0);
+    REQUIRE(second["x"] == 44);
+    REQUIRE(second["y"] == 4);
+    REQUIRE_THAT(second["u0"].get<double>(), Catch::Matchers::WithinAbs(44.0 / 128.0, 1e-9));
+    REQUIRE_THAT(second["u1"].get<double>(), Catch::Matchers::WithinAbs(76.0 / 128.0, 1e-9));
+}
+
+TEST_CASE("Import_atlas_no_matches_failed", "[importer]")
+{
+    assmpq::importer::ProgramOptions popt;
+    popt.input_mpq_file = "testdata/test_with_three_files.mpq";
+    popt.output_folder = "atlas_empty_output";
+    popt.atlas_pattern = "*.blp";
+
+    assmpq::importer::OutputWriter output_writer(popt);
+    const auto atlased_files = assmpq::importer::import_atlas(popt, nullptr, output_writer);
+    REQUIRE(output_writer.flush() == 0);
+
+    REQUIRE(atlased_files.empty());
+    REQUIRE_FALSE(std::filesystem::exists("atlas_empty_output/atlas.json"));
+}
+
+TEST_CASE("Pack_writer_round_trip_success", "[importer]")
+{
+    assmpq::FileData texture_data(1000);
+    for (size_t idx = 0; idx < texture_data.size(); ++idx) {
+        texture_data[idx] = static_cast<char>((idx * 31) % 256);
+    }
+    const assmpq::FileData stale_terrain_data(20, 's');
+    const assmpq::FileData terrain_data(37, 't');
+
+    {
+        assmpq::importer::PackWriter pack_writer("round_trip.pck");
+        REQUIRE(pack_writer.is_open());
+        REQUIRE(pack_writer.add("textures/first.png", texture_data));
+        REQUIRE(pack_writer.add("maps/terrain.w3e", stale_terrain_data));
+        REQUIRE(pack_writer.add_alias("textures/second.png", "textures/first.png"));
+        REQUIRE_FALSE(pack_writer.add_alias("textures/third.png", "textures/missing.png"));
+        // The latest content of a path written twice wins
+        REQUIRE(pack_writer.add("maps/terrain.w3e", terrain_data));
+        REQUIRE(pack_writer.finish());
+    }
+    REQUIRE_FALSE(std::filesystem::exists("round_trip.pck.tmp"));
+
+    std::ifstream pack_file("round_trip.pck", std::ios::binary);
+    const assmpq::FileData pack((std::istreambuf_iterator<char>(pack_file)), std::istreambuf_iterator<char>());
+    REQUIRE(pack.size() > 100);
+
+    size_t pos = 0;
+    REQUIRE(read_field<uint32_t>(pack, pos) == 0x43504447);
+    REQUIRE(read_field<uint32_t>(pack, pos) == 2);
+    REQUIRE(read_field<uint32_t>(pack, pos) == 4);
+    REQUIRE(read_field<uint32_t>(pack, pos) == 0);
+    REQUIRE(read_field<uint32_t>(pack, pos) == 0);
+    REQUIRE(read_field<uint32_t>(pack, pos) == 0);
+    const auto file_base = read_field<uint64_t>(pack, pos);
+    pos += 16 * sizeof(uint32_t);
+    REQUIRE(file_base % 16 == 0);
+
+    const auto file_count = read_field<uint32_t>(pack, pos);
+    REQUIRE(file_count == 3);
+
+    std::map<std::string, assmpq::FileData> packed_files;
+    for (uint32_t idx = 0; idx < file_count; ++idx) {
+        const auto path_length = read_field<uint32_t>(pack, pos);
+        REQUIRE(path_length % 4 == 0);
+        const std::string path(pack.data() + pos, std::strlen(pack.data() + pos));
+        pos += path_length;
+        const auto offset = read_field<uint64_t>(pack, pos);
+        const auto size = read_field<uint64_t>(pack, pos);
+        std::array<uint8_t, 16> md5 {};
+        std::memcpy(md5.data(), pack.data() + pos, md5.size());
+        pos += md5.size();
+        REQUIRE(read_field<uint32_t>(pack, pos) == 0);
+
+        REQUIRE(offset % 16 == 0);
+        REQUIRE(file_base + offset + size <= pack.size());
+        assmpq::FileData packed_data(pack.begin() + static_cast<std::ptrdiff_t>(file_base + offset),
+            pack.begin() + static_cast<std::ptrdiff_t>(file_base + offset + size));
+        REQUIRE(md5 == assmpq::mpq::md5_digest(packed_data));
+        packed_files.emplace(path, std::move(packed_data));
+    }
+    REQUIRE(pos <= file_base);
+
+    REQUIRE(packed_files.size() == 3);
+    REQUIRE(packed_files.at("res://textures/first.png") == texture_data);
+    REQUIRE(packed_files.at("res://textures/second.png") == texture_data);
+    REQUIRE(packed_files.at("res://maps/terrain.w3e") == terrain_data);
+}
+
+TEST_CASE("Write_output_mpq_success", "[importer]")
+{
+    std::filesystem::remove_all("mpq_output");
+    std::filesystem::create_directories("mpq_output/units");
+    {
+        std::ofstream("mpq_output/units/footman.mdl") << "model";
+        std::ofstream("mpq_output/war3map.j") << "script";
+        std::ofstream(std::filesystem::path("mpq_output") / assmpq::importer::kImportCacheFilename) << "{}";
+        std::ofstream(std::filesystem::path("mpq_output") / assmpq::importer::kDedupIndexFilename) << "{}";
+    }
+
+    assmpq::importer::ProgramOptions popt;
+    popt.output_folder = "mpq_output";
+    popt.mpq_file = "mpq_output/output.mpq";
+
+    // The bookkeeping files and the archive itself are left out
+    const auto file_count = assmpq::importer::write_output_mpq(popt);
+    REQUIRE(file_count.has_value());
+    REQUIRE(file_count.value() == 2);
+
+    const auto list_files = assmpq::mpq::list_mpq_files(popt.mpq_file);
+    const assmpq::mpq::ArchiveEntries expected_list = std::vector {
+        assmpq::mpq::FileEntry { .filename = "units\\footman.mdl", .size = 5 },
+        assmpq::mpq::FileEntry { .filename = "war3map.j", .size = 6 },
+    };
+    REQUIRE(list_files.has_value());
+    REQUIRE(*list_files == expected_list);
+    REQUIRE(assmpq::mpq::extract_mpq_file(popt.mpq_file, "units\\footman.mdl").value() == assmpq::FileData{ 'm', 'o', 'd', 'e', 'l' });
+}
+
+TEST_CASE("Dedup_index_link_rewrite_success", "[importer]")
+{
+    const std::string_view original_text = "original";
+    const std::string_view rewritten_text = "rewritten";
+
+    for (const auto dedup_mode : { assmpq::importer::DedupMode::Hardlink, assmpq::importer::DedupMode::Symlink }) {
+        assmpq::importer::ProgramOptions popt;
+        popt.output_folder = "dedup_rewrite";
+        popt.dedup = dedup_mode;
+        std::filesystem::remove_all(popt.output_folder);
+
+        assmpq::importer::OutputWriter output_writer(popt);
+        output_writer.write("units/first.png", assmpq::FileData(original_text.begin(), original_text.end()));
+        REQUIRE(output_writer.flush() == 0);
+
+        assmpq::importer::DedupIndex dedup_index(popt);
+        const auto content_key = assmpq::importer::make_content_key("0123", "units/first.blp");
+        REQUIRE(dedup_index.find(content_key) == nullptr);
+        dedup_index.add(content_key, { "units/first.png" });
+
+        const auto* original_paths = dedup_index.find(content_key);
+        REQUIRE(original_paths != nullptr);
+        REQUIRE(dedup_index.link_duplicate(*original_paths, "doodads/second.blp"));
+        REQUIRE(std::filesystem::equivalent(popt.output_folder / "units/first.png", popt.output_folder / "doodads/second.png"));
+
+        // A later write of the duplicate replaces the link and leaves the original alone
+        output_writer.write("doodads/second.png", assmpq::FileData(rewritten_text.begin(), rewritten_text.end()));
+        REQUIRE(output_writer.flush() == 0);
+        REQUIRE_FALSE(std::filesystem::is_symlink(popt.output_folder / "doodads/second.png"));
+        REQUIRE_FALSE(std::filesystem::equivalent(popt.output_folder / "units/first.png", popt.output_folder / "doodads/second.png"));
+        REQUIRE(read_text(popt.output_folder / "units/first.png") == original_text);
+        REQUIRE(read_text(popt.output_folder / "doodads/second.png") == rewritten_text);
+    }
+}
+
+TEST_CASE("Import_cache_round_trip_success", "[importer]")
+{
+    const std::string_view output_text = "converted";
+    assmpq::importer::ProgramOptions popt;
+    popt.output_folder = "import_cache";
+    std::filesystem::remove_all(popt.output_folder);
+
+    const assmpq::FileData output_data(output_text.begin(), output_text.end());
+    REQUIRE(assmpq::importer::import_save(output_data, "units/footman.png", popt));
+    {
+        assmpq::importer::ImportCache import_cache(popt);
+        import_cache.update("units/footman.blp", assmpq::importer::CachedImport{
+            .source_key = "archive|1",
+            .content_hash = "payload",
+            .outputs = { { .output_path = "units/footman.png", .content_hash = assmpq::importer::make_content_hash(output_data), .size = output_data.size() } } });
+        REQUIRE(import_cache.save());
+    }
+
+    const assmpq::importer::ImportCache import_cache(popt);
+    const auto* cached_import = import_cache.find_up_to_date("units/footman.blp", "archive|1");
+    REQUIRE(cached_import != nullptr);
+    REQUIRE(cached_import->content_hash == "payload");
+    REQUIRE(cached_import->outputs.size() == 1);
+    REQUIRE(cached_import->outputs.front().output_path == "units/footman.png");
+    REQUIRE(import_cache.find_up_to_date("units/peasant.blp", "archive|1") == nullptr);
+
+    // Forced runs start without the recorded entries
+    popt.is_force = true;
+    const assmpq::importer::ImportCache forced_cache(popt);
+    REQUIRE(forced_cache.find_up_to_date("units/footman.blp", "archive|1") == nullptr);
+}
+
+TEST_CASE("Import_cache_stale_entry_failed", "[importer]")
+{
+    const std::string_view output_text = "converted";
+    assmpq::importer::ProgramOptions popt;
+    popt.output_folder = "import_cache_stale";
+    std::filesystem::remove_all(popt.output_folder);
+
+    const assmpq::FileData output_data(output_text.begin(), output_text.end());
+    REQUIRE(assmpq::importer::import_save(output_data, "units/footman.png", popt));
+
+    assmpq::importer::ImportCache import_cache(popt);
+    import_cache.update("units/footman.blp", assmpq::importer::CachedImport{
+        .source_key = "archive|1",
+        .content_hash = {},
+        .outputs = { { .output_path = "units/footman.png", .content_hash = assmpq::importer::make_content_hash(output_data), .size = output_data.size() } } });
+    REQUIRE(import_cache.find_up_to_date("units/footman.blp", "archive|1") != nullptr);
+
+    // A rewritten archive gives the file another source key
+    REQUIRE(import_cache.find_up_to_date("units/footman.blp", "archive|2") == nullptr);
+
+    // An output edited in place keeps its size but not its content
+    const std::string_view edited_text = "CONVERTED";
+    REQUIRE(assmpq::importer::import_save(assmpq::FileData(edited_text.begin(), edited_text.end()), "units/footman.png", popt));
+    REQUIRE(import_cache.find_up_to_date("units/footman.blp", "archive|1") == nullptr);
+
+    std::filesystem::remove(popt.output_folder / "units/footman.png");
+    REQUIRE(import_cache.find_up_to_date("units/footman.blp", "archive|1") == nullptr);
+
+    // Options made by other settings invalidate the whole manifest
+    REQUIRE(import_cache.save());
+    popt.is_dds = true;
+    const assmpq::importer::ImportCache changed_cache(popt);
+    REQUIRE(assmpq::importer::import_save(output_data, "units/footman.png", popt));
+    REQUIRE(changed_cache.find_up_to_date("units/footman.blp", "archive|1") == nullptr);
+}
@@ -1,3 +1,4 @@
+#include <span>
 #include <spanstream>
 #include <string>
 #include <catch2/catch_test_macros.hpp>
@@ -7,7 +8,7 @@
 
 namespace assmpq::test {
 
-    inline static auto get_obj_info(const std::vector<char>& data)
+    inline static auto get_obj_info(const assmpq::FileData& data)
         -> std::expected<std::tuple<int, int, int, int>, std::string>
     {
         std::ispanstream input(data);
@@ -48,3 +49,18 @@ TEST_CASE("Convert_MDX_to_OBJ", "[mdlx]")
     REQUIRE(num_normales == 4);
     REQUIRE(num_faces == 2);
 }
+
+TEST_CASE("Convert_MDX_to_OBJ_from_byte_view", "[mdlx]")
+{
+    const auto mdlx_data = assmpq::test::load_file("testdata/test_4v_4n_4t_2f.mdx");
+    const auto obj_result = assmpq::mdlx::convert_mdlx_to_obj_mesh("test_mesh", std::as_bytes(std::span(mdlx_data)));
+
+    REQUIRE(obj_result.has_value());
+    const auto obj_info = assmpq::test::get_obj_info(obj_result.value());
+
+    auto [num_vertices, num_uv_components, num_normales, num_faces] = obj_info.value();
+    REQUIRE(num_vertices == 4);
+    REQUIRE(num_uv_components == 4);
+    REQUIRE(num_normales == 4);
+    REQUIRE(num_faces == 2);
+}
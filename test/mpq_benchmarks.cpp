@@ -0,0 +1,156 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <format>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "archive_index.hpp"
+#include "legacy_codecs.hpp"
+#include "sector_codec.hpp"
+#include "mpq_codec_utils.hpp"
+
+using namespace assmpq::mpq;
+using namespace assmpq::test;
+
+namespace {
+
+// Stored sectors of an encrypted file, compressed ones differ in size and rarely end on a whole word
+auto make_encrypted_sectors(std::mt19937& random, size_t count)-> std::vector<std::vector<char>>
+{
+    std::vector<std::vector<char>> sectors;
+    sectors.reserve(count);
+    for (size_t idx = 0; idx < count; ++idx) {
+        sectors.push_back(make_random_bytes(random, kSectorSize - (random() % 1500), 256));
+    }
+    return sectors;
+}
+
+} // namespace
+
+TEST_CASE("Hash_names_benchmark", "[mpq][benchmark]")
+{
+    const auto names = make_names(40000);
+    std::vector<NameHashes> name_hashes(names.size());
+
+    BENCHMARK("wc3lib HashString")
+    {
+        uint32_t sum = 0;
+        for (const auto& name : names) {
+            sum += wc3lib_hash(name, wc3lib::mpq::HashType::TableOffset)
+                ^ wc3lib_hash(name, wc3lib::mpq::HashType::NameA)
+                ^ wc3lib_hash(name, wc3lib::mpq::HashType::NameB);
+        }
+        return sum;
+    };
+
+    BENCHMARK("hash_string")
+    {
+        uint32_t sum = 0;
+        for (const auto& name : names) {
+            sum += hash_string(name, HashType::TableOffset)
+                ^ hash_string(name, HashType::NameA)
+                ^ hash_string(name, HashType::NameB);
+        }
+        return sum;
+    };
+
+    BENCHMARK("hash_names")
+    {
+        hash_names(names, name_hashes);
+        return name_hashes.back().name_b;
+    };
+}
+
+TEST_CASE("Decrypt_benchmark", "[mpq][benchmark]")
+{
+    std::mt19937 random(43);
+    auto sectors = make_encrypted_sectors(random, 64);
+    std::vector<CryptBlock> crypt_blocks;
+    for (auto& sector : sectors) {
+        crypt_blocks.push_back(CryptBlock{ .data = sector, .key = static_cast<uint32_t>(crypt_blocks.size()) });
+    }
+
+    // Decrypting twice does not restore the data, it does not matter for the timing
+    BENCHMARK("wc3lib DecryptData 64 sectors")
+    {
+        for (const CryptBlock& block : crypt_blocks) {
+            wc3lib_decrypt(block.data, block.key);
+        }
+        return sectors.back().back();
+    };
+
+    BENCHMARK("decrypt_block 64 sectors")
+    {
+        for (const CryptBlock& block : crypt_blocks) {
+            decrypt_block(block.data, block.key);
+        }
+        return sectors.back().back();
+    };
+
+    BENCHMARK("decrypt_blocks 64 sectors")
+    {
+        decrypt_blocks(crypt_blocks);
+        return sectors.back().back();
+    };
+}
+
+TEST_CASE("Sector_codecs_benchmark", "[mpq][benchmark]")
+{
+    std::vector<char> plain(kSectorSize);
+
+    for (const SectorCodec& codec : SectorCodecRegistry::instance().codecs()) {
+        const auto packed = encode_sector(codec.compression, make_sector(codec.compression));
+
+        BENCHMARK(std::format("wc3lib {}", codec.name))
+        {
+            return wc3lib_decode(codec.compression, packed).size();
+        };
+
+        BENCHMARK(std::format("registry {}", codec.name))
+        {
+            return codec.decode(packed, plain).value_or(0);
+        };
+    }
+}
+
+TEST_CASE("Compress_sector_benchmark", "[mpq][benchmark]")
+{
+    std::vector<char> packed;
+    for (const SectorCompression compression : { SectorCompression::Deflate, SectorCompression::Bzip2 }) {
+        const auto plain = make_sector(compression);
+        const auto* const name = compression == SectorCompression::Deflate ? "deflate" : "bzip2";
+
+        BENCHMARK(std::format("wc3lib {}", name))
+        {
+            return encode_sector(compression, plain).size();
+        };
+
+        BENCHMARK(std::format("compress_sector {}", name))
+        {
+            compress_sector(plain, compression, packed);
+            return packed.size();
+        };
+    }
+}
+
+TEST_CASE("Implode_ascii_benchmark", "[mpq][benchmark]")
+{
+    const auto plain = make_sector(SectorCompression::Implode);
+    auto packed = implode_with(plain, CMP_ASCII, CMP_IMPLODE_DICT_SIZE3);
+    std::vector<char> decoded(plain.size());
+
+    BENCHMARK("wc3lib implode ascii")
+    {
+        int decoded_size = static_cast<int>(decoded.size());
+        wc3lib::mpq::decompressPklib(decoded.data(), decoded_size, packed.data(), static_cast<int>(packed.size()));
+        return decoded_size;
+    };
+
+    BENCHMARK("decode_implode ascii")
+    {
+        return decode_implode(packed, decoded).value_or(0);
+    };
+}
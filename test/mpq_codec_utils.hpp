@@ -0,0 +1,203 @@
+#ifndef ASSMPQ_TEST_MPQ_CODEC_UTILS_H_
+#define ASSMPQ_TEST_MPQ_CODEC_UTILS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <numbers>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mpq/algorithm.hpp"
+#include "mpq/archive.hpp"
+
+#include "sector_codec.hpp"
+
+// Sample data and wc3lib reference coders shared by the MPQ internals tests and benchmarks
+namespace assmpq::test {
+
+// Names shaped like the listfile of a large map
+inline auto make_names(size_t count)-> std::vector<std::string>
+{
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t idx = 0; idx < count; ++idx) {
+        names.push_back(std::format("Units\\Creature{:05}\\Creature{:05}_Portrait.mdx", idx, idx * 7));
+    }
+    return names;
+}
+
+inline auto wc3lib_hash(const std::string& name, wc3lib::mpq::HashType hash_type)-> uint32_t
+{
+    return wc3lib::mpq::HashString(wc3lib::mpq::Archive::cryptTable(), name.c_str(), hash_type);
+}
+
+inline constexpr size_t kSectorSize = 4096;
+
+inline auto is_wave(assmpq::mpq::SectorCompression compression)-> bool
+{
+    return compression == assmpq::mpq::SectorCompression::WaveMono || compression == assmpq::mpq::SectorCompression::WaveStereo;
+}
+
+// One sector of map script text, or of 16 bit samples for the wave codecs
+inline auto make_sector(assmpq::mpq::SectorCompression compression)-> std::vector<char>
+{
+    std::vector<char> sector(kSectorSize);
+    if (is_wave(compression)) {
+        std::vector<int16_t> samples(kSectorSize / sizeof(int16_t));
+        for (size_t idx = 0; idx < samples.size(); ++idx) {
+            samples[idx] = static_cast<int16_t>(12000.0 * std::sin(static_cast<double>(idx) * std::numbers::pi / 50.0));
+        }
+        std::memcpy(sector.data(), samples.data(), sector.size());
+        return sector;
+    }
+
+    const std::string_view text = "call SetUnitPosition(udg_Footman, GetRectCenterX(gg_rct_Base), 0.0)\r\n";
+    for (size_t idx = 0; idx < sector.size(); ++idx) {
+        sector[idx] = text[(idx * 7 / 5) % text.size()];
+    }
+    return sector;
+}
+
+inline auto stream_bytes(wc3lib::stringstream& stream)-> std::vector<char>
+{
+    const std::string bytes = stream.str();
+    return { bytes.begin(), bytes.end() };
+}
+
+// Compressed with the wc3lib encoders, as MPQ editors write them
+inline auto encode_sector(assmpq::mpq::SectorCompression compression, std::vector<char> plain)-> std::vector<char>
+{
+    std::vector<char> packed(plain.size() * 2);
+    int packed_size = static_cast<int>(packed.size());
+    int compression_type = 0;
+
+    switch (compression) {
+    case assmpq::mpq::SectorCompression::Deflate:
+    case assmpq::mpq::SectorCompression::Bzip2: {
+        wc3lib::iarraystream input(plain.data(), plain.size());
+        wc3lib::stringstream output;
+        if (compression == assmpq::mpq::SectorCompression::Deflate) {
+            wc3lib::mpq::compressZlib(input, output);
+        } else {
+            wc3lib::mpq::compressBzip2(input, output);
+        }
+        return stream_bytes(output);
+    }
+    case assmpq::mpq::SectorCompression::Implode:
+        wc3lib::mpq::compressPklib(packed.data(), packed_size, plain.data(), static_cast<int>(plain.size()), &compression_type, 0);
+        break;
+    case assmpq::mpq::SectorCompression::Huffman:
+        wc3lib::mpq::compressHuffman(packed.data(), &packed_size, plain.data(), static_cast<int>(plain.size()), &compression_type, 0);
+        break;
+    case assmpq::mpq::SectorCompression::WaveMono:
+    case assmpq::mpq::SectorCompression::WaveStereo: {
+        auto* samples = reinterpret_cast<short*>(plain.data()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto* output = reinterpret_cast<unsigned char*>(packed.data()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        if (compression == assmpq::mpq::SectorCompression::WaveMono) {
+            wc3lib::mpq::compressWaveMono(samples, static_cast<int>(plain.size()), output, packed_size, 3);
+        } else {
+            wc3lib::mpq::compressWaveStereo(samples, static_cast<int>(plain.size()), output, packed_size, 3);
+        }
+        break;
+    }
+    }
+
+    packed.resize(static_cast<size_t>(packed_size));
+    return packed;
+}
+
+// Decoded the way wc3lib::mpq::Sector does it
+inline auto wc3lib_decode(assmpq::mpq::SectorCompression compression, std::vector<char> packed)-> std::vector<char>
+{
+    std::vector<char> plain(kSectorSize);
+    int plain_size = static_cast<int>(plain.size());
+
+    switch (compression) {
+    case assmpq::mpq::SectorCompression::Deflate:
+    case assmpq::mpq::SectorCompression::Bzip2: {
+        wc3lib::iarraystream input(packed.data(), packed.size());
+        wc3lib::stringstream output;
+        if (compression == assmpq::mpq::SectorCompression::Deflate) {
+            wc3lib::mpq::decompressZlib(input, output, kSectorSize);
+        } else {
+            wc3lib::mpq::decompressBzip2(input, output, kSectorSize);
+        }
+        return stream_bytes(output);
+    }
+    case assmpq::mpq::SectorCompression::Implode:
+        wc3lib::mpq::decompressPklib(plain.data(), plain_size, packed.data(), static_cast<int>(packed.size()));
+        break;
+    case assmpq::mpq::SectorCompression::Huffman:
+        wc3lib::mpq::decompressHuffman(plain.data(), &plain_size, packed.data(), static_cast<int>(packed.size()));
+        break;
+    case assmpq::mpq::SectorCompression::WaveMono:
+    case assmpq::mpq::SectorCompression::WaveStereo: {
+        auto* input = reinterpret_cast<unsigned char*>(packed.data()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        auto* output = reinterpret_cast<unsigned char*>(plain.data()); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        if (compression == assmpq::mpq::SectorCompression::WaveMono) {
+            wc3lib::mpq::decompressWaveMono(input, static_cast<int>(packed.size()), output, plain_size);
+        } else {
+            wc3lib::mpq::decompressWaveStereo(input, static_cast<int>(packed.size()), output, plain_size);
+        }
+        break;
+    }
+    }
+
+    plain.resize(static_cast<size_t>(plain_size));
+    return plain;
+}
+
+// Bytes of a small, skewed alphabet with runs, so the encoders find repetitions
+inline auto make_random_bytes(std::mt19937& random, size_t size, size_t alphabet_size)-> std::vector<char>
+{
+    std::vector<char> bytes;
+    bytes.reserve(size);
+    while (bytes.size() < size) {
+        const auto byte = static_cast<char>(std::min(random() % alphabet_size, random() % alphabet_size) * 7);
+        bytes.resize(std::min(size, bytes.size() + 1 + (random() % 4 == 0 ? random() % 16 : 0)), byte);
+    }
+    return bytes;
+}
+
+struct PklibStreams {
+    std::span<const char> input;
+    std::vector<char> output;
+};
+
+// Imploded with the PKWARE encoder of wc3lib, which also writes the ASCII mode
+inline auto implode_with(std::span<const char> plain, unsigned int mode, unsigned int dictionary_size)-> std::vector<char>
+{
+    PklibStreams streams { .input = plain, .output = {} };
+    std::vector<char> work_buffer(CMP_BUFFER_SIZE);
+    const auto read = [](char* buffer, unsigned int* size, void* param)-> unsigned int {
+        auto& input = static_cast<PklibStreams*>(param)->input;
+        const size_t read_size = std::min<size_t>(*size, input.size());
+        std::memcpy(buffer, input.data(), read_size);
+        input = input.subspan(read_size);
+        return static_cast<unsigned int>(read_size);
+    };
+    const auto write = [](char* buffer, unsigned int* size, void* param) {
+        auto& output = static_cast<PklibStreams*>(param)->output;
+        output.insert(output.end(), buffer, buffer + *size); // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    };
+    implode(read, write, work_buffer.data(), &streams, &mode, &dictionary_size);
+    return streams.output;
+}
+
+inline void wc3lib_decrypt(std::span<char> data, uint32_t key)
+{
+    // DecryptData asserts on the null buffer of an empty block
+    if (data.empty()) {
+        return;
+    }
+    wc3lib::mpq::DecryptData(wc3lib::mpq::Archive::cryptTable(), data.data(), static_cast<uint32_t>(data.size()), key);
+}
+
+} // namespace assmpq::test
+
+#endif // ASSMPQ_TEST_MPQ_CODEC_UTILS_H_
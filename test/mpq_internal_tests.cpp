@@ -0,0 +1,412 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "archive_index.hpp"
+#include "legacy_codecs.hpp"
+#include "sector_cache.hpp"
+#include "sector_codec.hpp"
+#include "worker_pool.hpp"
+#include "mpq_codec_utils.hpp"
+
+using namespace assmpq::mpq;
+using namespace assmpq::test;
+
+namespace {
+
+auto codec_decode(const SectorCodec& codec, std::span<const char> packed)-> std::vector<char>
+{
+    std::vector<char> plain(kSectorSize);
+    plain.resize(codec.decode(packed, plain).value_or(0));
+    return plain;
+}
+
+// Random ADPCM codes, the step index adjustments that wc3lib gets wrong on LP64 platforms are left out
+auto make_adpcm_stream(std::mt19937& random, size_t channels, size_t code_count)-> std::vector<char>
+{
+    std::vector<char> stream { 0, static_cast<char>(random() % 7) };
+    for (size_t idx = 0; idx < channels * 2 + code_count; ++idx) {
+        const auto value = random();
+        if (idx < channels * 2) {
+            stream.push_back(static_cast<char>(value));
+        } else if (value % 8 == 0) {
+            stream.push_back(static_cast<char>(0x80 | ((value >> 3) % 6)));
+        } else {
+            stream.push_back(static_cast<char>(((value >> 3) & 0x7F) | 1));
+        }
+    }
+    return stream;
+}
+
+auto wc3lib_decode_adpcm(std::vector<char> packed, size_t channels, size_t plain_size)-> std::vector<char>
+{
+    std::vector<char> plain(plain_size);
+    const int decoded_size = DecompressADPCM(
+        reinterpret_cast<unsigned char*>(plain.data()), static_cast<int>(plain.size()), // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        reinterpret_cast<unsigned char*>(packed.data()), static_cast<int>(packed.size()), static_cast<int>(channels)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    plain.resize(static_cast<size_t>(decoded_size));
+    return plain;
+}
+
+auto decode_with(SectorDecoder decode, std::span<const char> packed, size_t plain_size)-> std::optional<std::vector<char>>
+{
+    std::vector<char> plain(plain_size);
+    const auto decoded_size = decode(packed, plain);
+    if (!decoded_size.has_value()) {
+        return std::nullopt;
+    }
+    plain.resize(decoded_size.value());
+    return plain;
+}
+
+// Tables are written encrypted, the way they are stored in archives
+template<typename Entry>
+void write_encrypted_table(std::ofstream& stream, std::vector<Entry> table, std::string_view key_name)
+{
+    const std::span<char> bytes(reinterpret_cast<char*>(table.data()), table.size() * sizeof(Entry)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+    encrypt_block(bytes, hash_string(key_name, HashType::FileKey));
+    stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+} // namespace
+
+TEST_CASE("Hash_name_matches_wc3lib", "[mpq]")
+{
+    const auto names = make_names(100);
+    std::vector<NameHashes> name_hashes(names.size());
+    hash_names(names, name_hashes);
+
+    for (size_t idx = 0; idx < names.size(); ++idx) {
+        REQUIRE(name_hashes[idx].table_offset == wc3lib_hash(names[idx], wc3lib::mpq::HashType::TableOffset));
+        REQUIRE(name_hashes[idx].name_a == wc3lib_hash(names[idx], wc3lib::mpq::HashType::NameA));
+        REQUIRE(name_hashes[idx].name_b == wc3lib_hash(names[idx], wc3lib::mpq::HashType::NameB));
+        REQUIRE(name_hashes[idx] == hash_name(names[idx]));
+    }
+}
+
+TEST_CASE("Decrypt_blocks_match_wc3lib", "[mpq]")
+{
+    std::mt19937 random(43);
+
+    for (size_t round = 0; round < 200; ++round) {
+        // Batches of every size around the lane count, blocks down to a few bytes
+        std::vector<std::vector<char>> blocks(round % 11);
+        for (auto& block : blocks) {
+            block = make_random_bytes(random, random() % (round < 100 ? 40 : 1200), 256);
+        }
+        const auto first_key = static_cast<uint32_t>(random());
+
+        auto expected = blocks;
+        std::vector<CryptBlock> crypt_blocks;
+        for (size_t idx = 0; idx < blocks.size(); ++idx) {
+            wc3lib_decrypt(expected[idx], first_key + static_cast<uint32_t>(idx));
+            crypt_blocks.push_back(CryptBlock{ .data = blocks[idx], .key = first_key + static_cast<uint32_t>(idx) });
+        }
+        decrypt_blocks(crypt_blocks);
+        REQUIRE(blocks == expected);
+
+        if (!blocks.empty() && !blocks.front().empty()) {
+            auto block = blocks.front();
+            wc3lib::mpq::EncryptData(wc3lib::mpq::Archive::cryptTable(), block.data(), static_cast<uint32_t>(block.size()), first_key);
+            decrypt_block(std::span(block), first_key);
+            REQUIRE(block == blocks.front());
+        }
+    }
+}
+
+TEST_CASE("Encrypt_block_matches_wc3lib", "[mpq]")
+{
+    std::mt19937 random(47);
+
+    for (size_t round = 0; round < 100; ++round) {
+        auto block = make_random_bytes(random, 1 + (random() % 1200), 256);
+        const auto key = static_cast<uint32_t>(random());
+
+        const auto plain = block;
+        auto expected = block;
+        wc3lib::mpq::EncryptData(wc3lib::mpq::Archive::cryptTable(), expected.data(), static_cast<uint32_t>(expected.size()), key);
+        encrypt_block(block, key);
+        REQUIRE(block == expected);
+
+        decrypt_block(std::span(block), key);
+        REQUIRE(block == plain);
+    }
+}
+
+TEST_CASE("Sector_codecs_match_wc3lib", "[mpq]")
+{
+    for (const SectorCodec& codec : SectorCodecRegistry::instance().codecs()) {
+        INFO(codec.name);
+        const auto plain = make_sector(codec.compression);
+        const auto packed = encode_sector(codec.compression, plain);
+        const auto decoded = codec_decode(codec, packed);
+
+        // The wc3lib ADPCM coder drifts from Storm's step index on LP64 platforms, see Legacy_codecs_match_wc3lib
+        if (is_wave(codec.compression)) {
+            REQUIRE(decoded.size() == plain.size());
+            continue;
+        }
+        REQUIRE(decoded == wc3lib_decode(codec.compression, packed));
+        REQUIRE(decoded == plain);
+    }
+}
+
+TEST_CASE("Compressed_sectors_match_wc3lib", "[mpq]")
+{
+    std::vector<char> packed;
+    for (const SectorCompression compression : { SectorCompression::Deflate, SectorCompression::Bzip2 }) {
+        const auto plain = make_sector(compression);
+        compress_sector(plain, compression, packed);
+
+        REQUIRE(packed.size() < plain.size());
+        REQUIRE(packed.front() == static_cast<char>(compression));
+        REQUIRE(wc3lib_decode(compression, { packed.begin() + 1, packed.end() }) == plain);
+    }
+
+    // Data that does not shrink is stored without the compression byte
+    std::mt19937 random(53);
+    std::vector<char> noise(kSectorSize);
+    std::ranges::generate(noise, [&random] { return static_cast<char>(random()); });
+    compress_sector(noise, SectorCompression::Deflate, packed);
+    REQUIRE(packed == noise);
+}
+
+TEST_CASE("Legacy_codecs_match_wc3lib", "[mpq]")
+{
+    std::mt19937 random(0x4D50511A);
+
+    SECTION("implode")
+    {
+        for (size_t round = 0; round < 300; ++round) {
+            const auto plain = make_random_bytes(random, 1 + (random() % 8192), 2 + (random() % 60));
+            const unsigned int mode = round % 2 == 0 ? CMP_BINARY : CMP_ASCII;
+            const unsigned int dictionary_size = CMP_IMPLODE_DICT_SIZE1 << (round % 3);
+            INFO(std::format("round {}, {} bytes", round, plain.size()));
+
+            auto packed = implode_with(plain, mode, dictionary_size);
+            const auto decoded = decode_with(decode_implode, packed, plain.size());
+            REQUIRE(decoded == plain);
+
+            std::vector<char> wc3lib_plain(plain.size());
+            int wc3lib_size = static_cast<int>(wc3lib_plain.size());
+            wc3lib::mpq::decompressPklib(wc3lib_plain.data(), wc3lib_size, packed.data(), static_cast<int>(packed.size()));
+            REQUIRE(wc3lib_plain == plain);
+        }
+    }
+
+    SECTION("huffman")
+    {
+        for (size_t round = 0; round < 300; ++round) {
+            const auto plain = make_random_bytes(random, 1 + (random() % 8192), 2 + (random() % 254));
+            int compression_type = static_cast<int>(round % 9);
+            INFO(std::format("round {}, type {}, {} bytes", round, compression_type, plain.size()));
+
+            auto input = plain;
+            std::vector<char> packed(plain.size() * 2 + 16);
+            int packed_size = static_cast<int>(packed.size());
+            wc3lib::mpq::compressHuffman(packed.data(), &packed_size, input.data(), static_cast<int>(input.size()), &compression_type, 0);
+            packed.resize(static_cast<size_t>(packed_size));
+
+            const auto decoded = decode_with(decode_huffman, packed, plain.size());
+            REQUIRE(decoded == plain);
+
+            std::vector<char> wc3lib_plain(plain.size());
+            int wc3lib_size = static_cast<int>(wc3lib_plain.size());
+            wc3lib::mpq::decompressHuffman(wc3lib_plain.data(), &wc3lib_size, packed.data(), static_cast<int>(packed.size()));
+            REQUIRE(wc3lib_plain == plain);
+        }
+    }
+
+    SECTION("adpcm")
+    {
+        for (size_t round = 0; round < 300; ++round) {
+            const size_t channels = 1 + (round % 2);
+            const size_t code_count = random() % 4096;
+            const auto packed = make_adpcm_stream(random, channels, code_count);
+            const size_t plain_size = (channels + code_count) * sizeof(int16_t);
+            INFO(std::format("round {}, {} channels, {} codes", round, channels, code_count));
+
+            const auto decoded = decode_with(channels == 1 ? decode_adpcm_mono : decode_adpcm_stereo, packed, plain_size);
+            REQUIRE(decoded == wc3lib_decode_adpcm(packed, channels, plain_size));
+        }
+    }
+}
+
+TEST_CASE("Adpcm_step_index_matches_storm", "[mpq]")
+{
+    // Shift 0, first sample 0, then two codes that lower the step index and one that subtracts
+    const std::vector<char> packed { 0, 0, 0, 0, 0x00, 0x00, 0x40 };
+    const std::vector<int16_t> samples { 0, 494, 943, 535 };
+
+    const auto decoded = decode_with(decode_adpcm_mono, packed, samples.size() * sizeof(int16_t));
+    REQUIRE(decoded.has_value());
+    REQUIRE(std::memcmp(decoded->data(), samples.data(), decoded->size()) == 0);
+}
+
+TEST_CASE("Legacy_codecs_reject_damaged_data", "[mpq]")
+{
+    std::mt19937 random(0x0DA3A6ED);
+    const auto plain = make_random_bytes(random, kSectorSize, 40);
+
+    auto huffman_input = plain;
+    std::vector<char> huffman_packed(plain.size() * 2);
+    int huffman_size = static_cast<int>(huffman_packed.size());
+    int compression_type = 0;
+    wc3lib::mpq::compressHuffman(huffman_packed.data(), &huffman_size, huffman_input.data(), static_cast<int>(huffman_input.size()), &compression_type, 0);
+    huffman_packed.resize(static_cast<size_t>(huffman_size));
+
+    const std::array<std::pair<SectorDecoder, std::vector<char>>, 4> streams { {
+        { decode_implode, implode_with(plain, CMP_BINARY, CMP_IMPLODE_DICT_SIZE3) },
+        { decode_implode, implode_with(plain, CMP_ASCII, CMP_IMPLODE_DICT_SIZE1) },
+        { decode_huffman, huffman_packed },
+        { decode_adpcm_stereo, make_adpcm_stream(random, 2, 2048) },
+    } };
+
+    // Damaged data must not be read or written out of bounds, run under a sanitizer to be meaningful
+    for (const auto& [decode, packed] : streams) {
+        for (size_t round = 0; round < 2000; ++round) {
+            auto damaged = packed;
+            damaged.resize(1 + (random() % damaged.size()));
+            for (size_t flip = random() % 8; flip > 0; --flip) {
+                damaged[random() % damaged.size()] ^= static_cast<char>(1 << (random() % 8));
+            }
+            std::vector<char> output(plain.size());
+            REQUIRE(decode(damaged, output).value_or(0) <= output.size());
+        }
+    }
+}
+
+TEST_CASE("Archive_index_truncated_hash_table_success", "[mpq]")
+{
+    // The header claims 16 hash entries, the file ends after 12 of them
+    constexpr uint32_t kHeaderEntries = 16;
+    constexpr uint32_t kStoredEntries = 12;
+
+    // One name probed from a slot that a lookup modulo the stored count misses, one from the missing tail
+    std::string listed_name;
+    std::string cut_name;
+    for (size_t idx = 0; listed_name.empty() || cut_name.empty(); ++idx) {
+        auto name = std::format("Units\\Unit{}.mdx", idx);
+        const uint32_t table_offset = hash_name(name).table_offset;
+        const uint32_t slot = table_offset & (kHeaderEntries - 1);
+        if (slot < kStoredEntries && table_offset % kStoredEntries != slot) {
+            listed_name = listed_name.empty() ? std::move(name) : listed_name;
+        } else if (slot >= kStoredEntries) {
+            cut_name = cut_name.empty() ? std::move(name) : cut_name;
+        }
+    }
+
+    const HashEntry empty_entry{
+        .name_a = ArchiveIndex::kHashEntryEmpty,
+        .name_b = ArchiveIndex::kHashEntryEmpty,
+        .locale = 0xFFFF,
+        .platform = 0xFFFF,
+        .block_index = ArchiveIndex::kHashEntryEmpty };
+    std::vector<HashEntry> hash_table(kStoredEntries, empty_entry);
+    const NameHashes listed_hashes = hash_name(listed_name);
+    hash_table[listed_hashes.table_offset & (kHeaderEntries - 1)] = HashEntry{
+        .name_a = listed_hashes.name_a,
+        .name_b = listed_hashes.name_b,
+        .locale = 0,
+        .platform = 0,
+        .block_index = 0 };
+    std::vector<BlockEntry> block_table{ BlockEntry{ .offset = 0, .compressed_size = 0, .file_size = 0, .flags = ArchiveIndex::kBlockExists } };
+
+    const ArchiveHeader header{
+        .magic = ArchiveHeader::kMagic,
+        .header_size = sizeof(ArchiveHeader),
+        .archive_size = sizeof(ArchiveHeader) + ((1 + kHeaderEntries) * sizeof(HashEntry)),
+        .format_version = 0,
+        .sector_size_shift = 3,
+        .hash_table_offset = sizeof(ArchiveHeader) + sizeof(BlockEntry),
+        .block_table_offset = sizeof(ArchiveHeader),
+        .hash_table_entries = kHeaderEntries,
+        .block_table_entries = 1 };
+    {
+        std::ofstream stream("truncated_hash_table.mpq", std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+        write_encrypted_table(stream, std::move(block_table), "(block table)");
+        write_encrypted_table(stream, std::move(hash_table), "(hash table)");
+    }
+
+    const auto index = ArchiveIndex::open("truncated_hash_table.mpq");
+    REQUIRE(index.has_value());
+    REQUIRE(index->hash_table().size() == kStoredEntries);
+    REQUIRE(index->find_block_index(listed_name) == 0);
+    REQUIRE_FALSE(index->find_block_index(cut_name).has_value());
+    REQUIRE_FALSE(index->find_block_index("Units\\Missing.mdx").has_value());
+}
+
+TEST_CASE("Sector_table_cache_repeated_success", "[mpq]")
+{
+    const auto index = ArchiveIndex::open("testdata/test.w3m");
+    const auto archive_key = read_archive_key("testdata/test.w3m");
+    REQUIRE(index.has_value());
+    REQUIRE(archive_key.has_value());
+    const auto block_index = index->find_block_index("war3map.w3e");
+    REQUIRE(block_index.has_value());
+
+    SectorTableCache cache(2);
+    size_t load_count = 0;
+    std::ifstream stream("testdata/test.w3m", std::ios::binary);
+    const auto load = [&] {
+        ++load_count;
+        return index->read_sector_offsets(stream, index->block_table()[block_index.value()], "war3map.w3e");
+    };
+
+    // The second lookup of a file is served from the cache
+    const auto first = cache.get_or_load(archive_key.value(), block_index.value(), load);
+    const auto second = cache.get_or_load(archive_key.value(), block_index.value(), load);
+    REQUIRE(load_count == 1);
+    REQUIRE(cache.hit_count() == 1);
+    REQUIRE(first == second);
+    REQUIRE_FALSE(first->empty());
+
+    // The same block of a rewritten archive is a different entry
+    ArchiveKey rewritten_key = archive_key.value();
+    ++rewritten_key.time;
+    cache.get_or_load(rewritten_key, block_index.value(), load);
+    REQUIRE(load_count == 2);
+
+    // A third table evicts the least recently used one
+    cache.get_or_load(archive_key.value(), block_index.value(), load);
+    cache.insert(archive_key.value(), block_index.value() + 1, {});
+    REQUIRE(cache.size() == 2);
+    cache.get_or_load(archive_key.value(), block_index.value(), load);
+    REQUIRE(load_count == 2);
+    cache.get_or_load(rewritten_key, block_index.value(), load);
+    REQUIRE(load_count == 3);
+    REQUIRE(cache.hit_count() == 3);
+}
+
+TEST_CASE("Worker_pool_nested_run_success", "[mpq]")
+{
+    WorkerPool pool(3);
+    REQUIRE(pool.concurrency() == 4);
+
+    // Jobs running on the workers start runs of their own, the pool is reused across calls
+    for (size_t round = 0; round < 10; ++round) {
+        std::vector<std::atomic<size_t>> counts(64);
+        pool.run(counts.size(), pool.concurrency(), [&](size_t job_idx) {
+            pool.run(job_idx, 2, [&](size_t) { ++counts[job_idx]; });
+        });
+        for (size_t job_idx = 0; job_idx < counts.size(); ++job_idx) {
+            REQUIRE(counts[job_idx].load() == job_idx);
+        }
+    }
+
+    size_t inline_count = 0;
+    pool.run(5, 1, [&](size_t) { ++inline_count; });
+    REQUIRE(inline_count == 5);
+}
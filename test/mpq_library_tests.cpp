@@ -1,7 +1,18 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_vector.hpp>
 
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include <assets_mpq_importer/mpq.hpp>
+#include <assets_mpq_importer/glob.hpp>
 
 TEST_CASE("Get_MPQ_listfile_success", "[mpq]")
 {
@@ -37,6 +48,131 @@ TEST_CASE("Get_MPQ_listfile_failed", "[mpq]")
     REQUIRE(result.error() == "List file not found.");
 }
 
+TEST_CASE("For_each_MPQ_file_sorted_success", "[mpq]")
+{
+    assmpq::mpq::ArchiveEntries visited_list;
+    const auto result = assmpq::mpq::for_each_mpq_file("testdata/test_with_three_files.mpq", [&visited_list](const auto& entry) {
+        visited_list.push_back(entry);
+    }, "", true);
+
+    REQUIRE(result.has_value());
+    REQUIRE(result.value() == 3);
+    REQUIRE_THAT(visited_list, Catch::Matchers::Equals(assmpq::mpq::list_mpq_files("testdata/test_with_three_files.mpq").value()));
+}
+
+TEST_CASE("For_each_MPQ_file_unsorted_filtered_success", "[mpq]")
+{
+    assmpq::mpq::ArchiveEntries visited_list;
+    const auto result = assmpq::mpq::for_each_mpq_file("testdata/test_with_three_files.mpq", [&visited_list](const auto& entry) {
+        visited_list.push_back(entry);
+    }, "*2*");
+    const assmpq::mpq::ArchiveEntries expected_list = std::vector {
+        assmpq::mpq::FileEntry { .filename = "testfile20.txt", .size = 20  },
+        assmpq::mpq::FileEntry { .filename = "testfile25.txt", .size = 25  },
+    };
+
+    REQUIRE(result.has_value());
+    REQUIRE(result.value() == 2);
+    REQUIRE_THAT(visited_list, Catch::Matchers::UnorderedEquals(expected_list));
+}
+
+TEST_CASE("For_each_MPQ_file_in_map_success", "[mpq]")
+{
+    assmpq::mpq::ArchiveEntries visited_list;
+    const auto result = assmpq::mpq::for_each_mpq_file("testdata/test.w3m", [&visited_list](const auto& entry) {
+        visited_list.push_back(entry);
+    }, "*.w3e;*.wpm");
+    const assmpq::mpq::ArchiveEntries expected_list = std::vector {
+        assmpq::mpq::FileEntry { .filename = "war3map.w3e", .size = 7684  },
+        assmpq::mpq::FileEntry { .filename = "war3map.wpm", .size = 16400  },
+    };
+
+    REQUIRE(result.has_value());
+    REQUIRE_THAT(visited_list, Catch::Matchers::UnorderedEquals(expected_list));
+}
+
+TEST_CASE("For_each_MPQ_file_failed", "[mpq]")
+{
+    size_t visited_count = 0;
+    const auto result = assmpq::mpq::for_each_mpq_file("testdata/test_with_no_listfile.mpq", [&visited_count](const auto& /*entry*/) {
+        ++visited_count;
+    });
+
+    REQUIRE_FALSE(result.has_value());
+    REQUIRE(result.error() == "List file not found.");
+    REQUIRE(visited_count == 0);
+}
+
+TEST_CASE("List_MPQ_files_with_dictionary_success", "[mpq]")
+{
+    const auto name_count = assmpq::mpq::build_name_dictionary({ "testdata/unlisted_names.txt" }, "unlisted_names.idx");
+    REQUIRE(name_count.has_value());
+    REQUIRE(name_count.value() == 4);
+
+    const auto result = assmpq::mpq::list_mpq_files("testdata/test_with_unlisted_files.mpq", "", "unlisted_names.idx");
+    const assmpq::mpq::ArchiveEntries expected_list = std::vector {
+        assmpq::mpq::FileEntry { .filename = "File00000002.xxx", .size = 7  },
+        assmpq::mpq::FileEntry { .filename = "units\\footman.mdx", .size = 30  },
+        assmpq::mpq::FileEntry { .filename = "war3map.j", .size = 12  },
+    };
+
+    REQUIRE(result.has_value());
+    REQUIRE_THAT(result.value(), Catch::Matchers::Equals(expected_list));
+
+    const auto extracted = assmpq::mpq::extract_mpq_file("testdata/test_with_unlisted_files.mpq", "units\\footman.mdx");
+    REQUIRE(extracted.has_value());
+    REQUIRE(extracted->size() == 30);
+
+    // A file of unknown name is extracted by its block placeholder
+    const auto unnamed = assmpq::mpq::extract_mpq_file("testdata/test_with_unlisted_files.mpq", "File00000002.xxx");
+    REQUIRE(unnamed.has_value());
+    REQUIRE(unnamed->size() == 7);
+    REQUIRE(assmpq::mpq::mpq_file_source_key("testdata/test_with_unlisted_files.mpq", "File00000002.xxx").has_value());
+    REQUIRE(assmpq::mpq::extract_mpq_file("testdata/test_with_unlisted_files.mpq", "File00000009.xxx").error() == "File not found.");
+
+    const auto chain = assmpq::mpq::ArchiveChain::open({ "testdata/test_with_unlisted_files.mpq" }, "unlisted_names.idx");
+    REQUIRE(chain.has_value());
+    REQUIRE(chain->extract_file("File00000002.xxx").value() == unnamed.value());
+}
+
+TEST_CASE("List_MPQ_files_with_dictionary_failed", "[mpq]")
+{
+    const auto result = assmpq::mpq::list_mpq_files("testdata/test_with_unlisted_files.mpq", "", "testdata/unlisted_names.txt");
+
+    REQUIRE_FALSE(result.has_value());
+    REQUIRE(result.error() == "Invalid dictionary: testdata/unlisted_names.txt");
+}
+
+TEST_CASE("For_each_MPQ_sidecar_file_success", "[mpq]")
+{
+    const auto indexed_count = assmpq::mpq::write_mpq_sidecar("testdata/test_with_three_files.mpq", "three_files.sidecar");
+    REQUIRE(indexed_count.has_value());
+    REQUIRE(indexed_count.value() == 3);
+
+    assmpq::mpq::ArchiveEntries visited_list;
+    const auto result = assmpq::mpq::for_each_mpq_sidecar_file("testdata/test_with_three_files.mpq", "three_files.sidecar", [&visited_list](const auto& entry) {
+        visited_list.push_back(entry);
+    }, "*.txt");
+
+    REQUIRE(result.has_value());
+    REQUIRE(result.value() == 3);
+    REQUIRE_THAT(visited_list, Catch::Matchers::Equals(assmpq::mpq::list_mpq_files("testdata/test_with_three_files.mpq").value()));
+}
+
+TEST_CASE("For_each_MPQ_sidecar_file_stale", "[mpq]")
+{
+    REQUIRE(assmpq::mpq::write_mpq_sidecar("testdata/test_with_three_files.mpq", "stale.sidecar").has_value());
+
+    size_t visited_count = 0;
+    const auto result = assmpq::mpq::for_each_mpq_sidecar_file("testdata/test_with_three_files_patched.mpq", "stale.sidecar", [&visited_count](const auto& /*entry*/) {
+        ++visited_count;
+    });
+
+    REQUIRE_FALSE(result.has_value());
+    REQUIRE(result.error() == "Sidecar index is stale.");
+    REQUIRE(visited_count == 0);
+}
+
 TEST_CASE("Extract_MPQ_file_success", "[mpq]")
 {
     const auto result = assmpq::mpq::extract_mpq_file("testdata/test_with_three_files.mpq", "testfile25.txt");
@@ -45,9 +181,558 @@ TEST_CASE("Extract_MPQ_file_success", "[mpq]")
     REQUIRE(result->size() == 25);
 }
 
+TEST_CASE("Extract_MPQ_file_repeated_success", "[mpq]")
+{
+    // The second extraction reuses the cached sector offset table, see Sector_table_cache_repeated_success
+    const auto first = assmpq::mpq::extract_mpq_file("testdata/test.w3m", "war3map.w3e");
+    const auto second = assmpq::mpq::extract_mpq_file("testdata/test.w3m", "war3map.w3e");
+
+    REQUIRE(first.has_value());
+    REQUIRE(second.has_value());
+    REQUIRE(first->size() == 7684);
+    REQUIRE(first.value() == second.value());
+}
+
+TEST_CASE("Read_MPQ_file_range_success", "[mpq]")
+{
+    const auto whole = assmpq::mpq::extract_mpq_file("testdata/test.w3m", "war3map.w3e");
+    const auto range = assmpq::mpq::read_mpq_file_range("testdata/test.w3m", "war3map.w3e", 4000, 200);
+    const auto header = assmpq::mpq::read_mpq_file_range("testdata/test.w3m", "war3map.w3e", 0, 4);
+    const auto tail = assmpq::mpq::read_mpq_file_range("testdata/test_with_three_files.mpq", "testfile25.txt", 20, 100);
+
+    REQUIRE(whole.has_value());
+    REQUIRE(range.has_value());
+    REQUIRE(range.value() == assmpq::FileData(whole->begin() + 4000, whole->begin() + 4200));
+    REQUIRE(header.has_value());
+    REQUIRE(std::string(header->begin(), header->end()) == "W3E!");
+    REQUIRE(tail.has_value());
+    REQUIRE(tail->size() == 5);
+}
+
+TEST_CASE("Read_MPQ_encoded_file_range_success", "[mpq]")
+{
+    // The range starts in the first sector and ends in the second, both are decrypted or exploded with their own key or state
+    for (const auto& [archive_path, filename] : std::vector<std::pair<std::string, std::string>> {
+        { "testdata/test_with_encrypted_file.mpq", "scripts\\war3map.j" },
+        { "testdata/test_with_imploded_file.mpq", "war3map.j" } }) {
+        const auto whole = assmpq::mpq::extract_mpq_file(archive_path, filename);
+        const auto range = assmpq::mpq::read_mpq_file_range(archive_path, filename, 4000, 1000);
+
+        REQUIRE(whole.has_value());
+        REQUIRE(range.has_value());
+        REQUIRE(range.value() == assmpq::FileData(whole->begin() + 4000, whole->begin() + 5000));
+    }
+}
+
+TEST_CASE("Extract_MPQ_large_file_success", "[mpq]")
+{
+    // 80 compressed sectors are split across worker threads, 16 sector ranges are read on the calling thread
+    const auto whole = assmpq::mpq::extract_mpq_file("testdata/test_with_large_file.mpq", "war3map.j");
+
+    REQUIRE(whole.has_value());
+    REQUIRE(whole->size() == 40960);
+
+    assmpq::FileData joined;
+    for (size_t offset = 0; offset < whole->size(); offset += 8192) {
+        const auto range = assmpq::mpq::read_mpq_file_range("testdata/test_with_large_file.mpq", "war3map.j", offset, 8192);
+        REQUIRE(range.has_value());
+        joined.insert(joined.end(), range->begin(), range->end());
+    }
+    REQUIRE(joined == whole.value());
+}
+
+TEST_CASE("Extract_MPQ_encrypted_file_success", "[mpq]")
+{
+    const auto result = assmpq::mpq::extract_mpq_file("testdata/test_with_encrypted_file.mpq", "scripts\\war3map.j");
+
+    REQUIRE(result.has_value());
+    REQUIRE(result->size() == 6000);
+    REQUIRE(std::string(result->begin(), result->begin() + 10) == "water gold");
+}
+
+TEST_CASE("Extract_MPQ_imploded_file_success", "[mpq]")
+{
+    // Two sectors of map script, PKWARE imploded in ASCII mode
+    const auto result = assmpq::mpq::extract_mpq_file("testdata/test_with_imploded_file.mpq", "war3map.j");
+
+    REQUIRE(result.has_value());
+    REQUIRE(result->size() == 6000);
+    REQUIRE(std::string(result->begin(), result->begin() + 40) == "function Trig_Melee_Initialization_Actio");
+    REQUIRE(std::string(result->begin() + 4086, result->begin() + 4106) == "itialization_Actions");
+}
+
+TEST_CASE("Extract_MPQ_file_to_success", "[mpq]")
+{
+    // A file stored without compression is copied as it is, the others are decoded one run of sectors at a time
+    std::vector<assmpq::mpq::ArchiveFile> files;
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "stored.bin", .data = assmpq::FileData(70000, 's') });
+    const assmpq::mpq::ArchiveWriteOptions options { .compression_rules = {}, .compression = assmpq::mpq::FileCompression::None };
+    REQUIRE(assmpq::mpq::write_mpq_archive("stored.mpq", files, options).has_value());
+
+    const std::vector<std::pair<std::string, std::string>> archived_files = {
+        { "stored.mpq", "stored.bin" },
+        { "testdata/test_with_three_files.mpq", "testfile25.txt" },
+        { "testdata/test.w3m", "war3map.w3e" },
+        { "testdata/test_with_large_file.mpq", "war3map.j" },
+        { "testdata/test_with_encrypted_file.mpq", "scripts\\war3map.j" },
+        { "testdata/test_with_imploded_file.mpq", "war3map.j" },
+    };
+    for (const auto& [archive_path, filename] : archived_files) {
+        const auto written = assmpq::mpq::extract_mpq_file_to(archive_path, filename, "extracted.bin");
+        REQUIRE(written.has_value());
+
+        std::ifstream extracted_file("extracted.bin", std::ios::in | std::ios::binary);
+        const assmpq::FileData extracted_data((std::istreambuf_iterator<char>(extracted_file)), std::istreambuf_iterator<char>());
+        REQUIRE(written.value() == extracted_data.size());
+        REQUIRE(extracted_data == assmpq::mpq::extract_mpq_file(archive_path, filename).value());
+    }
+}
+
+TEST_CASE("Extract_MPQ_file_to_failed", "[mpq]")
+{
+    const auto result = assmpq::mpq::extract_mpq_file_to("testdata/test_with_three_files.mpq", "testfile_not_exist.txt", "extracted.bin");
+
+    REQUIRE_FALSE(result.has_value());
+    REQUIRE(result.error() == "File not found.");
+}
+
+TEST_CASE("Extract_MPQ_file_to_damaged_failed", "[mpq]")
+{
+    // The deflate stream of the second sector is overwritten, the output file exists by the time it fails to decode
+    std::vector<assmpq::mpq::ArchiveFile> files;
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "damaged.bin", .data = assmpq::FileData(10000, 'd') });
+    assmpq::mpq::ArchiveWriteOptions options;
+    options.sector_size_shift = 0;
+    options.has_listfile = false;
+    options.has_attributes = false;
+    REQUIRE(assmpq::mpq::write_mpq_archive("damaged.mpq", files, options).has_value());
+    {
+        std::ifstream input("damaged.mpq", std::ios::in | std::ios::binary);
+        std::string archive((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        const size_t first_sector = archive.find("\x02\x78");
+        const size_t second_sector = archive.find("\x02\x78", first_sector + 1);
+        REQUIRE(second_sector != std::string::npos);
+        std::fill_n(archive.begin() + static_cast<std::ptrdiff_t>(second_sector) + 1, 8, '\xFF');
+
+        std::ofstream output("damaged.mpq", std::ios::out | std::ios::binary | std::ios::trunc);
+        output.write(archive.data(), static_cast<std::streamsize>(archive.size()));
+    }
+
+    const auto result = assmpq::mpq::extract_mpq_file_to("damaged.mpq", "damaged.bin", "damaged.bin");
+
+    REQUIRE_FALSE(result.has_value());
+    REQUIRE_FALSE(std::filesystem::exists("damaged.bin"));
+}
+
+TEST_CASE("Read_MPQ_file_range_failed", "[mpq]")
+{
+    const auto result = assmpq::mpq::read_mpq_file_range("testdata/test_with_three_files.mpq", "testfile25.txt", 26, 1);
+
+    REQUIRE_FALSE(result.has_value());
+    REQUIRE(result.error() == "Range is outside of the file.");
+}
+
 TEST_CASE("Extract_MPQ_file_failed", "[mpq]")
 {
     const auto result = assmpq::mpq::extract_mpq_file("testdata/test_with_three_files.mpq", "testfile_not_exist.txt");
 
     REQUIRE_FALSE(result.has_value());
 }
+
+TEST_CASE("MPQ_file_source_key_success", "[mpq]")
+{
+    const auto first = assmpq::mpq::mpq_file_source_key("testdata/test_with_three_files.mpq", "testfile25.txt");
+    const auto repeated = assmpq::mpq::mpq_file_source_key("testdata/test_with_three_files.mpq", "testfile25.txt");
+    const auto other = assmpq::mpq::mpq_file_source_key("testdata/test_with_three_files.mpq", "testfile20.txt");
+    const auto patched = assmpq::mpq::mpq_file_source_key("testdata/test_with_three_files_patched.mpq", "testfile10.txt");
+
+    REQUIRE(first.has_value());
+    REQUIRE(other.has_value());
+    REQUIRE(patched.has_value());
+    REQUIRE(repeated == first);
+    REQUIRE(other.value() != first.value());
+
+    // An unchanged file of another archive has another key as well
+    REQUIRE(patched.value() != assmpq::mpq::mpq_file_source_key("testdata/test_with_three_files.mpq", "testfile10.txt").value());
+
+    // Rewriting the archive gives its files new keys
+    std::vector<assmpq::mpq::ArchiveFile> files;
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "rewritten.txt", .data = assmpq::FileData(100, 'a') });
+    REQUIRE(assmpq::mpq::write_mpq_archive("source_key.mpq", files).has_value());
+    const auto written = assmpq::mpq::mpq_file_source_key("source_key.mpq", "rewritten.txt");
+    files.front().data = assmpq::FileData(200, 'b');
+    REQUIRE(assmpq::mpq::write_mpq_archive("source_key.mpq", files).has_value());
+    const auto rewritten = assmpq::mpq::mpq_file_source_key("source_key.mpq", "rewritten.txt");
+    REQUIRE(written.has_value());
+    REQUIRE(rewritten.has_value());
+    REQUIRE(rewritten.value() != written.value());
+
+    const auto missing = assmpq::mpq::mpq_file_source_key("testdata/test_with_three_files.mpq", "testfile_not_exist.txt");
+    REQUIRE_FALSE(missing.has_value());
+    REQUIRE(missing.error() == "File not found.");
+}
+
+TEST_CASE("Diff_MPQ_archives_success", "[mpq]")
+{
+    const auto result = assmpq::mpq::diff_mpq_archives(
+        "testdata/test_with_three_files.mpq",
+        "testdata/test_with_three_files_patched.mpq");
+    const assmpq::mpq::ArchiveDiff expected_diff = std::vector {
+        assmpq::mpq::FileDiffEntry { .filename = "testfile20.txt", .change = assmpq::mpq::FileChange::Changed },
+        assmpq::mpq::FileDiffEntry { .filename = "testfile25.txt", .change = assmpq::mpq::FileChange::Removed },
+        assmpq::mpq::FileDiffEntry { .filename = "testfile30.txt", .change = assmpq::mpq::FileChange::Added },
+    };
+
+    REQUIRE(result.has_value());
+    REQUIRE_THAT(result.value(), Catch::Matchers::Equals(expected_diff));
+}
+
+TEST_CASE("Diff_MPQ_archives_filtered_success", "[mpq]")
+{
+    const auto result = assmpq::mpq::diff_mpq_archives(
+        "testdata/test_with_three_files.mpq",
+        "testdata/test_with_three_files_patched.mpq",
+        "*30*");
+    const assmpq::mpq::ArchiveDiff expected_diff = std::vector {
+        assmpq::mpq::FileDiffEntry { .filename = "testfile30.txt", .change = assmpq::mpq::FileChange::Added },
+    };
+
+    REQUIRE(result.has_value());
+    REQUIRE_THAT(result.value(), Catch::Matchers::Equals(expected_diff));
+}
+
+TEST_CASE("Diff_MPQ_same_archive_is_empty", "[mpq]")
+{
+    const auto result = assmpq::mpq::diff_mpq_archives(
+        "testdata/test_with_three_files.mpq",
+        "testdata/test_with_three_files.mpq");
+
+    REQUIRE(result.has_value());
+    REQUIRE(result->empty());
+}
+
+TEST_CASE("Diff_MPQ_archives_without_listfile_failed", "[mpq]")
+{
+    const auto result = assmpq::mpq::diff_mpq_archives(
+        "testdata/test_with_three_files.mpq",
+        "testdata/test_with_no_listfile.mpq");
+
+    REQUIRE_FALSE(result.has_value());
+    REQUIRE(result.error() == "List file not found.");
+}
+
+TEST_CASE("Verify_MPQ_archive_success", "[mpq]")
+{
+    // CRC32 and MD5 attributes for every file, sector checksums for the encrypted script and the units
+    const auto report = assmpq::mpq::verify_mpq_archive("testdata/test_with_checksums.mpq");
+
+    REQUIRE(report.has_value());
+    REQUIRE(report->is_valid());
+    REQUIRE(report->verified_count == 5);
+    REQUIRE(report->unchecked_count == 1);
+    REQUIRE(report->skipped_count == 0);
+    REQUIRE(report->checksum_count == 42);
+}
+
+TEST_CASE("Verify_MPQ_map_success", "[mpq]")
+{
+    const auto report = assmpq::mpq::verify_mpq_archive("testdata/test.w3m");
+
+    REQUIRE(report.has_value());
+    REQUIRE(report->is_valid());
+    REQUIRE(report->verified_count > 0);
+}
+
+TEST_CASE("Verify_MPQ_archive_corrupted_failed", "[mpq]")
+{
+    // A flipped byte in a stored file and another one in a compressed sector
+    const auto report = assmpq::mpq::verify_mpq_archive("testdata/test_with_corrupted_files.mpq", false);
+    const auto fail_fast_report = assmpq::mpq::verify_mpq_archive("testdata/test_with_corrupted_files.mpq");
+
+    REQUIRE(report.has_value());
+    REQUIRE(report->failures == std::vector<assmpq::mpq::VerifyFailure>{
+        { .filename = "war3map.mmp", .reason = "CRC32 mismatch." },
+        { .filename = "war3map.w3u", .reason = "Sector 2 checksum mismatch." } });
+    REQUIRE(report->verified_count == 3);
+    REQUIRE(fail_fast_report.has_value());
+    REQUIRE_FALSE(fail_fast_report->is_valid());
+}
+
+TEST_CASE("Verify_MPQ_archive_failed", "[mpq]")
+{
+    const auto report = assmpq::mpq::verify_mpq_archive("testdata/test_not_exist.mpq");
+
+    REQUIRE_FALSE(report.has_value());
+}
+
+TEST_CASE("Write_MPQ_archive_success", "[mpq]")
+{
+    assmpq::FileData texture_data(100000);
+    for (size_t idx = 0; idx < texture_data.size(); ++idx) {
+        texture_data[idx] = static_cast<char>((idx * idx) % 251);
+    }
+    std::vector<assmpq::mpq::ArchiveFile> files;
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "Textures\\Terrain.dds", .data = texture_data.clone() });
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "Units/Footman.blp", .data = assmpq::FileData(texture_data.begin(), texture_data.begin() + 5000) });
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "war3map.j", .data = assmpq::FileData(3000, 'j') });
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "empty.txt", .data = {} });
+    const assmpq::mpq::ArchiveWriteOptions options {
+        .compression_rules = {
+            assmpq::mpq::CompressionRule { .mask = "*.blp", .compression = assmpq::mpq::FileCompression::None },
+            assmpq::mpq::CompressionRule { .mask = "*.j", .compression = assmpq::mpq::FileCompression::Bzip2 },
+        },
+        .thread_count = 4,
+    };
+
+    const auto result = assmpq::mpq::write_mpq_archive("written.mpq", files, options);
+    REQUIRE(result.has_value());
+    REQUIRE(result.value() == 4);
+
+    const auto list_files = assmpq::mpq::list_mpq_files("written.mpq");
+    const assmpq::mpq::ArchiveEntries expected_list = std::vector {
+        assmpq::mpq::FileEntry { .filename = "Textures\\Terrain.dds", .size = 100000 },
+        assmpq::mpq::FileEntry { .filename = "Units\\Footman.blp", .size = 5000 },
+        assmpq::mpq::FileEntry { .filename = "empty.txt", .size = 0 },
+        assmpq::mpq::FileEntry { .filename = "war3map.j", .size = 3000 },
+    };
+    REQUIRE(list_files.has_value());
+    REQUIRE_THAT(list_files.value(), Catch::Matchers::Equals(expected_list));
+
+    for (const auto& file : files) {
+        auto filename = file.filename;
+        std::ranges::replace(filename, '/', '\\');
+        const auto extracted_file = assmpq::mpq::extract_mpq_file("written.mpq", filename);
+        REQUIRE(extracted_file.has_value());
+        REQUIRE(extracted_file.value() == file.data);
+    }
+
+    const auto report = assmpq::mpq::verify_mpq_archive("written.mpq");
+    REQUIRE(report.has_value());
+    REQUIRE(report->is_valid());
+    REQUIRE(report->unchecked_count == 1);
+}
+
+TEST_CASE("Archive_writer_batches_success", "[mpq]")
+{
+    // Every added file is written as its own batch
+    assmpq::mpq::ArchiveWriteOptions options;
+    options.batch_size = 1;
+    {
+        auto writer = assmpq::mpq::ArchiveWriter::open("batches.mpq", options);
+        REQUIRE(writer.has_value());
+        for (char fill = 'a'; fill < 'e'; ++fill) {
+            REQUIRE(writer->add({ .filename = std::format("file_{}.txt", fill), .data = assmpq::FileData(5000, fill) }).has_value());
+        }
+        REQUIRE(writer->add({ .filename = "FILE_A.TXT", .data = {} }).error() == "Duplicate file name: FILE_A.TXT");
+
+        const auto file_count = writer->finish();
+        REQUIRE(file_count.has_value());
+        REQUIRE(file_count.value() == 4);
+        REQUIRE(writer->add({ .filename = "late.txt", .data = {} }).error() == "Archive writer is closed.");
+    }
+
+    const auto list_files = assmpq::mpq::list_mpq_files("batches.mpq");
+    REQUIRE(list_files.has_value());
+    REQUIRE(list_files->size() == 4);
+    REQUIRE(assmpq::mpq::extract_mpq_file("batches.mpq", "file_c.txt").value() == assmpq::FileData(5000, 'c'));
+
+    const auto report = assmpq::mpq::verify_mpq_archive("batches.mpq");
+    REQUIRE(report.has_value());
+    REQUIRE(report->is_valid());
+
+    // An archive which is not finished is removed
+    {
+        auto writer = assmpq::mpq::ArchiveWriter::open("unfinished.mpq", options);
+        REQUIRE(writer.has_value());
+        REQUIRE(writer->add({ .filename = "file.txt", .data = assmpq::FileData(10, 'x') }).has_value());
+    }
+    REQUIRE_FALSE(std::filesystem::exists("unfinished.mpq"));
+}
+
+TEST_CASE("Write_MPQ_archive_duplicate_failed", "[mpq]")
+{
+    std::vector<assmpq::mpq::ArchiveFile> files;
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "units/footman.mdx", .data = assmpq::FileData(10, 'a') });
+    files.push_back(assmpq::mpq::ArchiveFile { .filename = "UNITS\\FOOTMAN.MDX", .data = assmpq::FileData(10, 'b') });
+
+    const auto result = assmpq::mpq::write_mpq_archive("duplicate.mpq", files);
+
+    REQUIRE_FALSE(result.has_value());
+    REQUIRE(result.error() == "Duplicate file name: UNITS\\FOOTMAN.MDX");
+}
+
+TEST_CASE("MD5_digest_RFC_1321_success", "[mpq]")
+{
+    const std::vector<std::pair<std::string_view, std::string_view>> test_suite = {
+        { "", "d41d8cd98f00b204e9800998ecf8427e" },
+        { "a", "0cc175b9c0f1b6a831c399e269772661" },
+        { "abc", "900150983cd24fb0d6963f7d28e17f72" },
+        { "message digest", "f96b697d7cb7938d525a2f31aaf161d0" },
+        { "abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b" },
+        { "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", "d174ab98d277d9f5a5611c2c9f419d9f" },
+        { "12345678901234567890123456789012345678901234567890123456789012345678901234567890", "57edf4a22be3c955ac49da2e2107b67a" },
+    };
+
+    for (const auto& [message, expected_digest] : test_suite) {
+        std::string hex_digest;
+        for (const uint8_t byte : assmpq::mpq::md5_digest(message)) {
+            hex_digest += std::format("{:02x}", byte);
+        }
+        REQUIRE(hex_digest == expected_digest);
+    }
+}
+
+TEST_CASE("Archive_chain_success", "[mpq]")
+{
+    const auto chain = assmpq::mpq::ArchiveChain::open({
+        "testdata/test_with_three_files.mpq",
+        "testdata/test_with_three_files_patched.mpq" });
+    REQUIRE(chain.has_value());
+
+    assmpq::mpq::ArchiveEntries visited_list;
+    const auto result = chain->for_each_file([&visited_list](const auto& entry) {
+        visited_list.push_back(entry);
+    });
+    const assmpq::mpq::ArchiveEntries expected_list = std::vector {
+        assmpq::mpq::FileEntry { .filename = "testfile10.txt", .size = 10  },
+        assmpq::mpq::FileEntry { .filename = "testfile20.txt", .size = 20  },
+        assmpq::mpq::FileEntry { .filename = "testfile25.txt", .size = 25  },
+        assmpq::mpq::FileEntry { .filename = "testfile30.txt", .size = 30  },
+    };
+
+    REQUIRE(result.has_value());
+    REQUIRE(result.value() == 4);
+    REQUIRE_THAT(visited_list, Catch::Matchers::Equals(expected_list));
+    REQUIRE(chain->overridden_count() == 2);
+
+    REQUIRE(chain->find("TESTFILE25.TXT") != nullptr);
+    REQUIRE(*chain->find("TESTFILE25.TXT") == "testdata/test_with_three_files.mpq");
+    REQUIRE(*chain->find("testfile20.txt") == "testdata/test_with_three_files_patched.mpq");
+    REQUIRE(chain->find("testfile40.txt") == nullptr);
+
+    const auto extracted_file = chain->extract_file("testfile20.txt");
+    REQUIRE(extracted_file.has_value());
+    REQUIRE(extracted_file.value() == assmpq::mpq::extract_mpq_file("testdata/test_with_three_files_patched.mpq", "testfile20.txt").value());
+}
+
+TEST_CASE("Archive_chain_unlisted_patch_success", "[mpq]")
+{
+    std::vector<assmpq::mpq::ArchiveFile> base_files;
+    base_files.push_back(assmpq::mpq::ArchiveFile { .filename = "Units\\Footman.mdx", .data = assmpq::FileData(10, 'a') });
+    base_files.push_back(assmpq::mpq::ArchiveFile { .filename = "war3map.j", .data = assmpq::FileData(20, 'j') });
+    REQUIRE(assmpq::mpq::write_mpq_archive("chain_base.mpq", base_files).has_value());
+
+    // The patch has no listfile and the dictionary does not know the patched file
+    std::vector<assmpq::mpq::ArchiveFile> patch_files;
+    patch_files.push_back(assmpq::mpq::ArchiveFile { .filename = "Units\\Footman.mdx", .data = assmpq::FileData(12, 'b') });
+    assmpq::mpq::ArchiveWriteOptions patch_options;
+    patch_options.has_listfile = false;
+    patch_options.has_attributes = false;
+    REQUIRE(assmpq::mpq::write_mpq_archive("chain_patch.mpq", patch_files, patch_options).has_value());
+    {
+        std::ofstream listfile("chain_names.txt", std::ios::trunc);
+        listfile << "war3map.j\n";
+    }
+    REQUIRE(assmpq::mpq::build_name_dictionary({ "chain_names.txt" }, "chain_names.idx").has_value());
+
+    const auto chain = assmpq::mpq::ArchiveChain::open({ "chain_base.mpq", "chain_patch.mpq" }, "chain_names.idx");
+    REQUIRE(chain.has_value());
+
+    assmpq::mpq::ArchiveEntries visited_list;
+    const auto result = chain->for_each_file([&visited_list](const auto& entry) {
+        visited_list.push_back(entry);
+    });
+    const assmpq::mpq::ArchiveEntries expected_list = std::vector {
+        assmpq::mpq::FileEntry { .filename = "Units\\Footman.mdx", .size = 12  },
+        assmpq::mpq::FileEntry { .filename = "war3map.j", .size = 20  },
+    };
+
+    REQUIRE(result.has_value());
+    REQUIRE_THAT(visited_list, Catch::Matchers::Equals(expected_list));
+    REQUIRE(chain->overridden_count() == 1);
+    REQUIRE(*chain->find("units\\footman.mdx") == "chain_patch.mpq");
+
+    const auto extracted_file = chain->extract_file("Units\\Footman.mdx");
+    REQUIRE(extracted_file.has_value());
+    REQUIRE(extracted_file.value() == assmpq::FileData(12, 'b'));
+}
+
+TEST_CASE("Archive_chain_failed", "[mpq]")
+{
+    const auto chain = assmpq::mpq::ArchiveChain::open({
+        "testdata/test_with_three_files.mpq",
+        "testdata/test_with_no_listfile.mpq" });
+
+    REQUIRE_FALSE(chain.has_value());
+    REQUIRE(chain.error() == "testdata/test_with_no_listfile.mpq: List file not found.");
+}
+
+TEST_CASE("Glob_filter_wildcards_success", "[mpq]")
+{
+    const auto filter = assmpq::mpq::GlobFilter::compile("*.BLP;units\\?uman\\*.mdx");
+
+    REQUIRE(filter.has_value());
+    REQUIRE(filter->matches("Textures\\Peasant.blp"));
+    REQUIRE(filter->matches("textures/peasant.Blp"));
+    REQUIRE(filter->matches("Units/Human/Footman/Footman.mdx"));
+    REQUIRE_FALSE(filter->matches("Units\\Orc\\Grunt\\Grunt.mdx"));
+    REQUIRE_FALSE(filter->matches("Textures\\Peasant.blp.bak"));
+    REQUIRE_FALSE(filter->matches(""));
+}
+
+TEST_CASE("Glob_filter_classes_and_globstar_success", "[mpq]")
+{
+    const auto filter = assmpq::mpq::GlobFilter::compile("ReplaceableTextures/**/BTN[a-c]*.blp;**/*[!0-9].mdx");
+
+    REQUIRE(filter.has_value());
+    REQUIRE(filter->matches("ReplaceableTextures\\CommandButtons\\BTNAbility.blp"));
+    REQUIRE(filter->matches("ReplaceableTextures\\BTNCancel.blp"));
+    REQUIRE_FALSE(filter->matches("ReplaceableTextures\\CommandButtons\\BTNFootman.blp"));
+    REQUIRE_FALSE(filter->matches("ReplaceableTextures\\CommandButtons\\BTNA\\Icon.blp"));
+    REQUIRE(filter->matches("Footman.mdx"));
+    REQUIRE(filter->matches("Units\\Footman.mdx"));
+    REQUIRE_FALSE(filter->matches("Units\\Footman0.mdx"));
+}
+
+TEST_CASE("Glob_filter_globstar_directory_boundary_failed", "[mpq]")
+{
+    const auto leading = assmpq::mpq::GlobFilter::compile("**/foo");
+    const auto inner = assmpq::mpq::GlobFilter::compile("a/**/b");
+
+    REQUIRE(leading.has_value());
+    REQUIRE(leading->matches("foo"));
+    REQUIRE(leading->matches("x\\foo"));
+    REQUIRE(leading->matches("x/y/foo"));
+    REQUIRE_FALSE(leading->matches("xfoo"));
+    REQUIRE_FALSE(leading->matches("x/yfoo"));
+    REQUIRE(inner.has_value());
+    REQUIRE(inner->matches("a/b"));
+    REQUIRE(inner->matches("a\\x\\b"));
+    REQUIRE(inner->matches("a/x/y/b"));
+    REQUIRE_FALSE(inner->matches("a/xb"));
+    REQUIRE_FALSE(inner->matches("a/x/yb"));
+    REQUIRE_FALSE(inner->matches("ab"));
+}
+
+TEST_CASE("Glob_filter_excludes_success", "[mpq]")
+{
+    const auto filter = assmpq::mpq::GlobFilter::compile("*.blp;!*Disabled*;!*Passive*");
+    const auto exclude_only = assmpq::mpq::GlobFilter::compile("!*.mdx");
+
+    REQUIRE(filter.has_value());
+    REQUIRE(filter->matches("BTNFootman.blp"));
+    REQUIRE(filter->matches("DISBTNFootman.BLP"));
+    REQUIRE_FALSE(filter->matches("Disabled\\DISBTNFootman.blp"));
+    REQUIRE_FALSE(filter->matches("PassiveButtons\\PASBTNEvasion.blp"));
+    REQUIRE(exclude_only.has_value());
+    REQUIRE(exclude_only->matches("war3map.w3e"));
+    REQUIRE_FALSE(exclude_only->matches("Footman.mdx"));
+}
+
+TEST_CASE("Glob_filter_unclosed_class_failed", "[mpq]")
+{
+    const auto filter = assmpq::mpq::GlobFilter::compile("*.blp;BTN[abc.blp");
+
+    REQUIRE_FALSE(filter.has_value());
+    REQUIRE(filter.error() == "Unclosed character class in pattern: BTN[abc.blp");
+}
@@ -1,21 +1,22 @@
 #ifndef ASSMPQ_TEST_H_
 #define ASSMPQ_TEST_H_
 
-#include <vector>
 #include <string>
 #include <iostream>
 #include <fstream>
 
+#include <assets_mpq_importer/assmpq.hpp>
+
 namespace assmpq::test {
 
-    inline auto load_file(const std::string& filename)-> std::vector<char>
+    inline auto load_file(const std::string& filename)-> assmpq::FileData
     {
-        std::vector<char> buffer;
+        assmpq::FileData buffer;
         std::ifstream file(filename, std::ios::binary);
 
         if (file.is_open()) {
             file.seekg(0, std::ios::end);
-            buffer.resize(static_cast<size_t>(file.tellg()));
+            buffer.resize_uninitialized(static_cast<size_t>(file.tellg()));
             file.seekg(0, std::ios::beg);
             file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
             file.close();
@@ -15,3 +15,14 @@ TEST_CASE("Extract_W3E_success", "[w3m]")
     REQUIRE(result->size() == 7684);
     REQUIRE_THAT(std::span(result->data(), 4),  Catch::Matchers::RangeEquals(expected));
 }
+
+TEST_CASE("Extract_W3E_from_byte_view_success", "[w3m]")
+{
+    const auto w3m_data = assmpq::test::load_file("testdata/test.w3m");
+    const auto result = assmpq::w3m::extract_w3e_file(std::as_bytes(std::span(w3m_data)));
+    const std::vector<char> expected = {'W', '3', 'E', '!'};
+
+    REQUIRE(result.has_value());
+    REQUIRE(result->size() == 7684);
+    REQUIRE_THAT(std::span(result->data(), 4),  Catch::Matchers::RangeEquals(expected));
+}